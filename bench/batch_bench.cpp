@@ -0,0 +1,98 @@
+// Compares evaluating an expression once per row through the REPL entry point
+// (set the row's variables, then run a cached query) with one evaluate_batch()
+// call over the same columns.
+//
+//   batch_bench [rows]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "repl/cache.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/optimize.hpp"
+#include "repl/state.hpp"
+
+namespace {
+
+struct Workload {
+    const char* label;
+    std::vector<std::string> setup;
+    std::string query;
+};
+
+void define(const Workload& workload, repl::State& state) {
+    for (const auto& line : workload.setup) {
+        repl::process_query(line, state);
+    }
+}
+
+double time_rows(const Workload& workload, const std::vector<double>& xs,
+                 const std::vector<double>& ys) {
+    repl::State state;
+    define(workload, state);
+    repl::ExpressionCache cache;
+    const repl::Identifier x = repl::intern("x");
+    const repl::Identifier y = repl::intern("y");
+    volatile double sink = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t row = 0; row < xs.size(); ++row) {
+        state.vars.set(x, xs[row]);
+        state.vars.set(y, ys[row]);
+        try {
+            sink = sink + *repl::process_query(workload.query, state, cache).value;
+        } catch (const repl::EvalError&) {
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count() * 1e9 /
+           static_cast<double>(xs.size());
+}
+
+double time_batch(const Workload& workload, const std::vector<double>& xs,
+                  const std::vector<double>& ys) {
+    repl::State state;
+    define(workload, state);
+    repl::QueryContext ctx;
+    const repl::Expression& expr =
+        *repl::optimize(repl::parse(workload.query, ctx), ctx.arena);
+    const repl::BatchColumn columns[] = {{repl::intern("x"), xs}, {repl::intern("y"), ys}};
+    auto start = std::chrono::steady_clock::now();
+    const repl::BatchResult result = repl::evaluate_batch(expr, columns, state);
+    auto stop = std::chrono::steady_clock::now();
+    volatile double sink = result.values.back();
+    (void)sink;
+    return std::chrono::duration<double>(stop - start).count() * 1e9 /
+           static_cast<double>(xs.size());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int rows = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    for (int row = 0; row < rows; ++row) {
+        xs.push_back((row % 1000) / 250.0 - 2.0);
+        ys.push_back((row % 7) - 3.0);
+    }
+
+    const std::vector<Workload> workloads = {
+        {"arithmetic", {}, "3 * x * x - 2 * x * y + y / 7 - 1"},
+        {"branches", {}, "x < y ? x * y : x > 1 ? x - y : y - x"},
+        {"errors", {}, "x / y + 1"},
+        {"builtins", {}, "sin(x) * cos(y) + sqrt(abs(x)) + max(x, y)"},
+        {"user function", {"f(a, b) = (t = a * b) > 1 ? t - a : b - t"}, "f(x, y) + f(y, x)"},
+    };
+
+    for (const auto& workload : workloads) {
+        const double scalar = time_rows(workload, xs, ys);
+        const double batch = time_batch(workload, xs, ys);
+        std::cout << workload.label << ": per row " << scalar << " ns, batch " << batch
+                  << " ns (" << scalar / batch << "x)\n";
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Compares the tree-walking, bytecode and native engines on user-function-heavy
+// workloads. Each workload defines functions once, then times repeated calls
+// of a cached query line. A last line times a query that fails inside a user
+// function, through the throwing and the std::expected API.
+//
+//   eval_bench [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "repl/cache.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/state.hpp"
+
+namespace {
+
+struct Workload {
+    const char* label;
+    std::vector<std::string> setup;
+    std::string query;
+    int scale;
+};
+
+double time_workload(const Workload& workload, repl::Engine engine, int iterations) {
+    repl::State state;
+    state.engine = engine;
+    for (const auto& line : workload.setup) {
+        repl::process_query(line, state);
+    }
+
+    repl::ExpressionCache cache;
+    volatile double sink = 0.0;
+    const int count = iterations / workload.scale;
+    auto start = std::chrono::steady_clock::now();
+    for (int index = 0; index < count; ++index) {
+        sink = sink + *repl::process_query(workload.query, state, cache).value;
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count() * 1e9 / count;
+}
+
+/** @brief Nanoseconds per failing query through process_query() or try_process_query(). */
+double time_failure(repl::Engine engine, bool throwing, int iterations) {
+    repl::State state;
+    state.engine = engine;
+    repl::process_query("x = 1", state);
+    repl::process_query("f(a) = 1 + a / (a - x)", state);
+
+    repl::ExpressionCache cache;
+    std::size_t failures = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int index = 0; index < iterations; ++index) {
+        if (throwing) {
+            try {
+                repl::process_query("f(x) * 2", state, cache);
+            } catch (const repl::EvalError&) {
+                ++failures;
+            }
+        } else if (!repl::try_process_query("f(x) * 2", state, cache)) {
+            ++failures;
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    if (failures != static_cast<std::size_t>(iterations)) {
+        std::cerr << "unexpected success\n";
+    }
+    return std::chrono::duration<double>(stop - start).count() * 1e9 / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    const std::vector<Workload> workloads = {
+        {"polynomial", {"p(x) = 3 * x ^ 3 - 2 * x ^ 2 + x / 7 - 1", "x = 0.5"}, "p(x)", 1},
+        {"nested calls", {"sq(a) = a * a", "f(a, b) = sq(a) + sq(b) - a * b", "x = 0.5"},
+         "f(x, x + 1) + f(2, x)", 1},
+        {"locals", {"g(a) = (t = a * 2 + 1) * t - (u = t / 3) * u", "x = 0.5"}, "g(x)", 1},
+        {"recursion", {"fact(n) = n <= 1 ? 1 : n * fact(n - 1)"}, "fact(20)", 10},
+        {"builtins", {"h(a) = sin(a) * cos(a) + sqrt(abs(a)) + max(a, 1)", "x = 0.5"}, "h(x)", 1},
+    };
+
+    for (const auto& workload : workloads) {
+        const double tree = time_workload(workload, repl::Engine::Tree, iterations);
+        const double vm = time_workload(workload, repl::Engine::Bytecode, iterations);
+        const double jit = time_workload(workload, repl::Engine::Jit, iterations);
+        std::cout << workload.label << ": tree " << tree << " ns, vm " << vm << " ns ("
+                  << tree / vm << "x), jit " << jit << " ns (" << tree / jit << "x)\n";
+    }
+
+    std::cout << "failing call:";
+    for (auto [label, engine] : {std::pair{"tree", repl::Engine::Tree},
+                                 std::pair{"vm", repl::Engine::Bytecode},
+                                 std::pair{"jit", repl::Engine::Jit}}) {
+        const double thrown = time_failure(engine, true, iterations / 10);
+        const double returned = time_failure(engine, false, iterations / 10);
+        std::cout << ' ' << label << " throw " << thrown << " ns, expected " << returned
+                  << " ns (" << thrown / returned << "x);";
+    }
+    std::cout << '\n';
+    return 0;
+}
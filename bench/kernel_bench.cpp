@@ -0,0 +1,78 @@
+// Times each builtin's array form on every instruction set this CPU supports,
+// against a loop over the scalar function.
+//
+//   kernel_bench [count]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "repl/kernels.hpp"
+#include "repl/registry.hpp"
+
+namespace {
+
+template <typename Body>
+double time_ns(std::size_t count, Body body) {
+    body();
+    constexpr int kRounds = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+        body();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count() * 1e9 /
+           static_cast<double>(count * kRounds);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+
+    // Arguments inside every builtin's domain, so timings reflect the packed path.
+    std::vector<double> first;
+    std::vector<double> second;
+    for (std::size_t index = 0; index < count; ++index) {
+        first.push_back(0.1 + static_cast<double>(index % 1000) / 1100.0);
+        second.push_back(1.0 + static_cast<double>(index % 37) / 10.0);
+    }
+    std::vector<double> out(count);
+
+    std::vector<repl::KernelIsa> isas;
+    for (auto isa : {repl::KernelIsa::Scalar, repl::KernelIsa::SSE2, repl::KernelIsa::AVX2}) {
+        if (static_cast<int>(isa) <= static_cast<int>(repl::detected_kernel_isa())) {
+            isas.push_back(isa);
+        }
+    }
+
+    for (const repl::BuiltinSpec& spec : repl::kBuiltins) {
+        volatile double sink = 0.0;
+        const double loop = time_ns(count, [&] {
+            for (std::size_t index = 0; index < count; ++index) {
+                out[index] = spec.arity == 1 ? spec.unary(first[index])
+                                             : spec.binary(first[index], second[index]);
+            }
+            sink = sink + out[count - 1];
+        });
+        std::cout << spec.name << ": loop " << loop << " ns";
+        for (repl::KernelIsa isa : isas) {
+            repl::set_kernel_isa(isa);
+            const double packed = time_ns(count, [&] {
+                if (spec.arity == 1) {
+                    spec.unary_array(first.data(), out.data(), count);
+                } else {
+                    spec.binary_array(first.data(), second.data(), out.data(), count);
+                }
+                sink = sink + out[count - 1];
+            });
+            std::cout << ", " << repl::to_string(isa) << " " << packed << " ns (" << loop / packed
+                      << "x)";
+        }
+        std::cout << "\n";
+        repl::set_kernel_isa(repl::detected_kernel_isa());
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Compares tokenizer throughput across the scalar, SSE2, and AVX2 scanners on
+// long machine-generated expressions.
+//
+//   lexer_bench [size_kb] [repetitions]
+//
+// "compact" mimics hand-written formulas (short names, single spaces);
+// "generated" mimics code generators (aligned padding, long qualified names,
+// long digit strings), where whitespace and identifier runs exceed a vector.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "repl/scan.hpp"
+#include "repl/token.hpp"
+
+namespace {
+
+std::string generate_compact(std::size_t target_size) {
+    static constexpr const char* kNames[] = {"a", "b1", "x", "y0", "rate", "k"};
+    std::string text;
+    text.reserve(target_size + 64);
+    std::size_t index = 0;
+    while (text.size() < target_size) {
+        text += kNames[index % std::size(kNames)];
+        text += " * (";
+        text += std::to_string(index * 7919 % 1000);
+        text += ".5 + sin(";
+        text += kNames[(index + 3) % std::size(kNames)];
+        text += ")) - ";
+        ++index;
+    }
+    text += "1";
+    return text;
+}
+
+std::string generate_padded(std::size_t target_size) {
+    std::string text;
+    text.reserve(target_size + 256);
+    std::size_t index = 0;
+    while (text.size() < target_size) {
+        text += "model_parameter_block_";
+        text += std::to_string(index % 97);
+        text += "_temperature_offset_coefficient";
+        text += std::string(24 + index % 16, ' ');
+        text += "*\n";
+        text += std::string(32, ' ');
+        text += "31415926535897932384626.4338327950288e-20";
+        text += std::string(20, '\t');
+        text += "+\n";
+        ++index;
+    }
+    text += "1";
+    return text;
+}
+
+double best_seconds(const std::string& input, int repetitions, std::size_t& token_count) {
+    double best = 1e300;
+    for (int rep = 0; rep < repetitions; ++rep) {
+        auto start = std::chrono::steady_clock::now();
+        repl::Tokens tokens = repl::tokenize(input);
+        auto stop = std::chrono::steady_clock::now();
+        token_count = tokens.size();
+        best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+    return best;
+}
+
+void run(const char* label, const std::string& input, int repetitions) {
+    std::cout << label << ": " << input.size() / 1024 << " KiB, best of " << repetitions
+              << '\n';
+    double scalar_seconds = 0.0;
+    for (repl::ScanIsa isa : {repl::ScanIsa::Scalar, repl::ScanIsa::SSE2, repl::ScanIsa::AVX2}) {
+        if (repl::set_scan_isa(isa) != isa) {
+            std::cout << "  " << repl::to_string(isa) << ": not supported on this CPU\n";
+            continue;
+        }
+        std::size_t tokens = 0;
+        double seconds = best_seconds(input, repetitions, tokens);
+        if (isa == repl::ScanIsa::Scalar) {
+            scalar_seconds = seconds;
+        }
+        double mib_per_s = static_cast<double>(input.size()) / seconds / (1024.0 * 1024.0);
+        std::cout << "  " << repl::to_string(isa) << ": " << tokens << " tokens, "
+                  << seconds * 1e3 << " ms, " << mib_per_s << " MiB/s, "
+                  << scalar_seconds / seconds << "x scalar\n";
+    }
+    repl::set_scan_isa(repl::detected_scan_isa());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t size_kb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 512;
+    const int repetitions = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    run("compact", generate_compact(size_kb * 1024), repetitions);
+    run("generated", generate_padded(size_kb * 1024), repetitions);
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Measures how parse time scales with call nesting depth and argument count.
+// Linear parsing shows up as a flat ns/token column as the size doubles.
+//
+//   parser_bench [max_size] [repetitions]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include "repl/expression.hpp"
+
+namespace {
+
+// f(f(f(...f(x)...)))
+std::string nested_calls(std::size_t depth) {
+    std::string text;
+    text.reserve(depth * 3 + 1);
+    for (std::size_t index = 0; index < depth; ++index) {
+        text += "f(";
+    }
+    text += 'x';
+    text.append(depth, ')');
+    return text;
+}
+
+// g(x + 1, x + 2, ..., x + n)
+std::string wide_call(std::size_t width) {
+    std::string text = "g(";
+    for (std::size_t index = 0; index < width; ++index) {
+        if (index > 0) {
+            text += ", ";
+        }
+        text += "x + ";
+        text += std::to_string(index);
+    }
+    text += ')';
+    return text;
+}
+
+// h(h(x, 1), h(x, 2)) nested to a given depth: a balanced tree of calls.
+std::string call_tree(std::size_t depth) {
+    if (depth == 0) {
+        return "x";
+    }
+    std::string child = call_tree(depth - 1);
+    return "h(" + child + ", " + child + ")";
+}
+
+std::size_t count_tokens(const std::string& text) {
+    return static_cast<std::size_t>(std::count_if(text.begin(), text.end(), [](char ch) {
+        return ch != ' ';
+    }));
+}
+
+void run(const char* label, const std::string& input, int repetitions) {
+    repl::QueryContext ctx;
+    // The parser is stack-safe, so measure deep inputs instead of rejecting them.
+    ctx.max_depth = std::numeric_limits<std::size_t>::max();
+    double best = 1e300;
+    for (int rep = 0; rep < repetitions; ++rep) {
+        auto start = std::chrono::steady_clock::now();
+        ctx.reset();
+        [[maybe_unused]] repl::ExpressionPtr expr = repl::parse(std::string_view{input}, ctx);
+        auto stop = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(stop - start).count());
+    }
+    const double tokens = static_cast<double>(count_tokens(input));
+    std::cout << "  " << label << ": " << best * 1e3 << " ms, " << best * 1e9 / tokens
+              << " ns/char\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t max_size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+    const int repetitions = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    std::cout << "nested calls f(f(...))\n";
+    for (std::size_t depth = 256; depth <= max_size * 16; depth *= 2) {
+        run(("depth " + std::to_string(depth)).c_str(), nested_calls(depth), repetitions);
+    }
+
+    std::cout << "wide call g(a1, ..., an)\n";
+    for (std::size_t width = 1024; width <= max_size * 16; width *= 2) {
+        run(("width " + std::to_string(width)).c_str(), wide_call(width), repetitions);
+    }
+
+    std::cout << "balanced call tree h(h(..), h(..))\n";
+    for (std::size_t depth = 10; depth <= 16; ++depth) {
+        run(("depth " + std::to_string(depth)).c_str(), call_tree(depth), repetitions);
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Measures the cost of changing one input of a large binding model against the
+// number of bindings downstream of it, which is all the work should scale with.
+//
+//   reactive_bench [bindings]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include "repl/evaluator.hpp"
+#include "repl/state.hpp"
+
+namespace {
+
+/** @brief Define input `prefix0` and a chain of `length` bindings reading it. */
+void define_chain(const std::string& prefix, std::size_t length, repl::State& state,
+                  repl::QueryContext& ctx) {
+    repl::process_query(prefix + "0 = 1", state, ctx);
+    for (std::size_t index = 1; index <= length; ++index) {
+        const std::string previous = prefix + std::to_string(index - 1);
+        repl::process_query(prefix + std::to_string(index) + " := " + previous + " * 0.5 + " +
+                                previous + " ^ 2 / 1000",
+                            state, ctx);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t bindings = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+    const std::size_t lengths[] = {1, 10, 100, 1000, 10000};
+
+    repl::State state;
+    repl::QueryContext ctx;
+    auto start = std::chrono::steady_clock::now();
+    std::size_t defined = 0;
+    for (std::size_t length : lengths) {
+        define_chain(std::format("c{}_", length), length, state, ctx);
+        defined += length;
+    }
+    // The rest of the model is filler that no measured input reaches.
+    for (std::size_t group = 0; defined < bindings; ++group) {
+        define_chain(std::format("f{}_", group), 100, state, ctx);
+        defined += 100;
+    }
+    auto stop = std::chrono::steady_clock::now();
+    std::cout << state.bindings.size() << " bindings defined in "
+              << std::chrono::duration<double>(stop - start).count() * 1e3 << " ms\n";
+
+    for (std::size_t length : lengths) {
+        const std::string input = std::format("c{}_0 = ", length);
+        const std::size_t changes = std::max<std::size_t>(10, 100000 / length);
+        start = std::chrono::steady_clock::now();
+        for (std::size_t change = 0; change < changes; ++change) {
+            repl::process_query(input + std::to_string(change % 7), state, ctx);
+        }
+        stop = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(stop - start).count() / changes;
+        std::cout << "  " << length << " downstream: " << seconds * 1e6 << " us per change, "
+                  << seconds * 1e9 / length << " ns per binding\n";
+    }
+    return 0;
+}
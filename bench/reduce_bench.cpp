@@ -0,0 +1,79 @@
+// Measures sum and integrate throughput as the number of workers grows, and
+// checks that every worker count gives the same bits; then the cost of a
+// call to a function that contains a small sum.
+//
+//   reduce_bench [terms]
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "repl/evaluator.hpp"
+#include "repl/optimize.hpp"
+#include "repl/reduce.hpp"
+#include "repl/state.hpp"
+
+int main(int argc, char** argv) {
+    const std::size_t terms = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000000;
+
+    repl::State state;
+    repl::process_query("g(t) = sin(t) / (1 + t * t)", state);
+    const std::vector<std::string> sources = {
+        "sum(i, 1, " + std::to_string(terms) + ", sin(i) / i + exp(-i * 1e-6))",
+        "sum(i, 1, " + std::to_string(terms / 20) + ", g(i))",
+        "integrate(x, -50, 50, sin(30 * x) * exp(-x * x / 500))",
+    };
+
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> worker_counts;
+    for (std::size_t workers = 1; workers < hardware; workers *= 2) {
+        worker_counts.push_back(workers);
+    }
+    worker_counts.push_back(hardware);
+
+    for (const std::string& source : sources) {
+        repl::QueryContext ctx;
+        const repl::Expression& expr = *repl::optimize(repl::parse(source, ctx), ctx.arena);
+        const repl::ReduceNode& node = expr.get<repl::ReduceNode>();
+        const double bounds[] = {node.lower()->get<double>(), node.upper()->get<double>()};
+        std::cout << source << '\n';
+
+        double single = 0.0;
+        double expected = 0.0;
+        for (std::size_t workers : worker_counts) {
+            repl::ThreadPool pool{workers};
+            auto start = std::chrono::steady_clock::now();
+            const double value = repl::reduce(node, bounds, state, {}, pool);
+            auto stop = std::chrono::steady_clock::now();
+            const double seconds = std::chrono::duration<double>(stop - start).count();
+            if (single == 0.0) {
+                single = seconds;
+                expected = value;
+            }
+            const bool same =
+                std::bit_cast<std::uint64_t>(value) == std::bit_cast<std::uint64_t>(expected);
+            std::cout << "  " << workers << " workers: " << seconds * 1e3 << " ms ("
+                      << single / seconds << "x), " << (same ? "same bits" : "DIFFERENT bits")
+                      << '\n';
+        }
+    }
+
+    constexpr int kCalls = 20000;
+    repl::process_query("h(n) = sum(i, 1, n, g(i) * n)", state);
+    const auto start = std::chrono::steady_clock::now();
+    double total = 0.0;
+    for (int call = 0; call < kCalls; ++call) {
+        total += *repl::process_query("h(16)", state).value;
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    std::cout << "h(16), " << kCalls << " calls: "
+              << std::chrono::duration<double>(stop - start).count() * 1e6 / kCalls
+              << " us per call (total " << total << ")\n";
+    return 0;
+}
@@ -0,0 +1,51 @@
+// Measures sweep() throughput over a grid as the number of workers grows.
+//
+//   sweep_bench [points per axis]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "repl/evaluator.hpp"
+#include "repl/optimize.hpp"
+#include "repl/state.hpp"
+#include "repl/sweep.hpp"
+
+int main(int argc, char** argv) {
+    const std::size_t points = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+
+    repl::State state;
+    repl::process_query("f(a, b) = (t = a * b) > 1 ? t - a : sin(b - t) / (1 + a * a)", state);
+    repl::QueryContext ctx;
+    const repl::Expression& expr =
+        *repl::optimize(repl::parse("f(x, y) + exp(-x * x)", ctx), ctx.arena);
+    const std::vector<repl::SweepRange> ranges = {{repl::intern("x"), -3.0, 3.0, points},
+                                                  {repl::intern("y"), -1.0, 4.0, points}};
+    const double rows = static_cast<double>(points) * static_cast<double>(points);
+
+    const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::size_t> worker_counts;
+    for (std::size_t workers = 1; workers < hardware; workers *= 2) {
+        worker_counts.push_back(workers);
+    }
+    worker_counts.push_back(hardware);
+
+    double single = 0.0;
+    for (std::size_t workers : worker_counts) {
+        repl::ThreadPool pool{workers};
+        repl::sweep(expr, ranges, state, pool);
+        auto start = std::chrono::steady_clock::now();
+        const repl::BatchResult result = repl::sweep(expr, ranges, state, pool);
+        auto stop = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(stop - start).count();
+        if (single == 0.0) {
+            single = seconds;
+        }
+        std::cout << workers << " workers: " << rows / seconds / 1e6 << " M rows/s ("
+                  << single / seconds << "x), " << result.errors.size() << " errors\n";
+    }
+    return 0;
+}
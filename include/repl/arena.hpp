@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace repl {
+
+/** @brief Bump allocator for trivially destructible objects.
+ *
+ *  Objects are carved out of large blocks and are never destroyed
+ *  individually. reset() rewinds to the first block and keeps every block for
+ *  reuse, so a loop that resets between uses stops allocating once it has
+ *  reached its peak size. release() returns all blocks to the system.
+ */
+class Arena {
+public:
+    static constexpr std::size_t kDefaultBlockSize = 4096;
+    static constexpr std::size_t kMaxBlockSize = std::size_t{1} << 20;
+
+    Arena() : Arena(kDefaultBlockSize) {}
+    explicit Arena(std::size_t first_block_size);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&& other) noexcept;
+    Arena& operator=(Arena&& other) noexcept;
+
+    /** @brief Allocate uninitialized storage. */
+    void* allocate(std::size_t size, std::size_t alignment) {
+        auto address = reinterpret_cast<std::uintptr_t>(cursor_);
+        auto aligned = (address + alignment - 1) & ~(std::uintptr_t{alignment} - 1);
+        if (cursor_ == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(limit_)) {
+            return allocate_slow(size, alignment);
+        }
+        cursor_ = reinterpret_cast<std::byte*>(aligned + size);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    /** @brief Construct an object in the arena. */
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "Arena objects are never destroyed individually");
+        return ::new (allocate(sizeof(T), alignof(T))) T{std::forward<Args>(args)...};
+    }
+
+    /** @brief Copy a range of trivially copyable values into the arena. */
+    template <typename T>
+    std::span<T> copy(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (values.empty()) {
+            return {};
+        }
+        auto* data = static_cast<T*>(allocate(values.size_bytes(), alignof(T)));
+        std::uninitialized_copy(values.begin(), values.end(), data);
+        return {data, values.size()};
+    }
+
+    /** @brief Discard all objects and rewind, keeping blocks for reuse. */
+    void reset();
+    /** @brief Discard all objects and free every block. */
+    void release();
+
+    /** @brief Total bytes held in blocks. */
+    std::size_t capacity() const { return capacity_; }
+
+    /** @brief Whether `address` lies in one of the arena's blocks. */
+    bool owns(const void* address) const;
+
+private:
+    struct Block;
+
+    void* allocate_slow(std::size_t size, std::size_t alignment);
+    void enter(Block* block);
+
+    Block* head_ = nullptr;
+    Block* current_ = nullptr;
+    std::byte* cursor_ = nullptr;
+    std::byte* limit_ = nullptr;
+    std::size_t next_block_size_;
+    std::size_t capacity_ = 0;
+};
+
+}  // namespace repl
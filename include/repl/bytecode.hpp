@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <vector>
+
+#include "repl/errors.hpp"
+#include "repl/expression.hpp"
+
+namespace repl {
+
+struct BuiltinSpec;
+struct State;
+struct WorkerView;
+
+/** @brief Bytecode operations for the stack VM.
+ *
+ *  Stack effects are noted as (popped -> pushed). Division and modulo pop the
+ *  dividend from the top, because the divisor is evaluated and checked first.
+ */
+enum class Op : std::uint8_t {
+    Number,        ///< (-> numbers[operand])
+    LoadLast,      ///< (-> last result), error if there is none
+    LoadParam,     ///< (-> slots[slot])
+    LoadLocal,     ///< (-> slots[slot] if assigned, else global `operand`)
+    LoadGlobal,    ///< (-> variable `operand`), error if undefined
+    LoadCached,    ///< (-> slots[slot]) and continue at `operand` if the slot was
+                   ///< stored during this call; otherwise fall through to compute it
+    StoreLocal,    ///< (v -> v) and slots[slot] = v
+    StoreGlobal,   ///< (v -> v) and variable `operand` = v
+    Negate,        ///< (a -> -a)
+    Add,           ///< (a b -> a + b)
+    Subtract,      ///< (a b -> a - b)
+    Multiply,      ///< (a b -> a * b)
+    CheckDivisor,  ///< (b -> b), error if b == 0
+    CheckModulus,  ///< (b -> b), error if b == 0
+    Divide,        ///< (b a -> a / b)
+    Modulo,        ///< (b a -> fmod(a, b))
+    Power,         ///< (a b -> pow(a, b)), error unless finite
+    IntegerPower,  ///< (a -> a ^ int32(operand)) by repeated squaring, error unless finite
+    SquareRoot,    ///< (a -> a ^ 0.5), error unless finite
+    Horner,        ///< (x -> p(x)) over numbers[operand...] of degree `slot` if |x| is
+                   ///< within the limit after them; otherwise (x ->) and skip one instruction
+    Less,          ///< (a b -> a < b)
+    LessEqual,     ///< (a b -> a <= b)
+    Greater,       ///< (a b -> a > b)
+    GreaterEqual,  ///< (a b -> a >= b)
+    Equal,         ///< (a b -> a == b)
+    NotEqual,      ///< (a b -> a != b)
+    Jump,          ///< continue at `operand`
+    JumpIfZero,    ///< (c ->) continue at `operand` if c == 0
+    CallUnary,     ///< (a -> builtins[operand](a)), error unless finite
+    CallBinary,    ///< (a b -> builtins[operand](a, b)), error unless finite
+    PrepareCall,   ///< resolve user function `operand` taking `slot` arguments
+    Call,          ///< (args... -> result) of the last prepared function
+    Reduce,        ///< (lower upper captures... -> value) of reductions[operand], which
+                   ///< takes `slot` values; see reduce()
+    Throw,         ///< fail with errors[operand]
+    Return,        ///< (v ->) and return v
+};
+
+/** @brief One VM instruction: opcode, a 16-bit slot/count, and a 32-bit operand. */
+struct Instruction {
+    Op op;
+    std::uint16_t slot = 0;
+    std::uint32_t operand = 0;
+};
+
+static_assert(sizeof(Instruction) == 8);
+
+/** @brief Compiled expression: linear code plus the pools it indexes. */
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<double> numbers;
+    std::vector<const BuiltinSpec*> builtins;
+    std::vector<Error> errors;
+    std::vector<const ReduceNode*> reductions;
+    /** @brief Source offset of the node each instruction belongs to; only
+     *  compile() records them, so errors in a function body carry none.
+     */
+    std::vector<std::uint32_t> positions;
+    /** @brief Parameters occupy slots [0, param_count); assigned locals and
+     *  cached common subexpressions follow.
+     */
+    std::uint16_t param_count = 0;
+    std::uint16_t slot_count = 0;
+    /** @brief Nodes cached in the last `shared.size()` slots, in slot order,
+     *  which is address order; the tree walker caches them in the same slots.
+     */
+    std::vector<const Expression*> shared;
+    /** @brief Deepest operand stack the code reaches, excluding slots. */
+    std::uint32_t max_stack = 0;
+};
+
+/** @brief Compile a top-level expression; assignments write global variables.
+ *
+ *  Errors the tree walker would raise for a node (read-only assignment, wrong
+ *  builtin arity, ...) compile to Throw instructions, so they still fire only
+ *  if that node is reached. Every instruction records its node's position.
+ */
+Chunk compile(const Expression& expr);
+
+/** @brief Compile a user function body resolved by resolve_locals().
+ *
+ *  Local nodes load and store frame slots; the first `param_count` of the
+ *  `frame_size` slots are parameters. If `body` is a DAG (see ExpressionDag),
+ *  every pure node reached through more than one parent is computed at most
+ *  once per call and then reloaded from a slot. Those nodes are listed in
+ *  Chunk::shared and flagged Expression::cached.
+ */
+Chunk compile_function(Expression& body, std::uint16_t param_count,
+                       std::uint16_t frame_size);
+
+/** @brief Run top-level bytecode against `state`.
+ *  @return The value, or the error the tree walker would report, at the
+ *  position of the failing instruction or of the call it happened in.
+ */
+std::expected<double, Error> execute(const Chunk& chunk, State& state);
+
+struct Machine;
+
+/** @brief Calls one compiled function body again and again on a VM stack of its own.
+ *
+ *  execute() runs on a stack shared by its thread; a runner keeps its own, so
+ *  a reduction can call its body from inside a running VM, and each worker
+ *  thread can hold a runner for the same chunk. The body runs against a
+ *  WorkerView, which only reads the state it was made from.
+ */
+class ChunkRunner {
+public:
+    /** @brief Runner for `chunk`, a compile_function() result that must outlive it. */
+    explicit ChunkRunner(const Chunk& chunk);
+    ~ChunkRunner();
+
+    ChunkRunner(ChunkRunner&&) noexcept;
+    ChunkRunner& operator=(ChunkRunner&&) noexcept;
+
+    /** @brief Run the body with `args`, one per parameter.
+     *  @return The value, or the error the tree walker would report.
+     */
+    std::expected<double, Error> operator()(const double* args, WorkerView& view);
+
+private:
+    const Chunk* chunk_;
+    std::unique_ptr<Machine> machine_;
+};
+
+}  // namespace repl
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "repl/bytecode.hpp"
+#include "repl/errors.hpp"
+#include "repl/expression.hpp"
+
+namespace repl {
+
+/** @brief A cached parse and, once compiled, its bytecode. */
+struct CachedQuery {
+    ExpressionPtr expr = nullptr;
+    std::optional<Chunk> code;
+};
+
+/** @brief LRU cache of parsed expressions keyed by source text.
+ *
+ *  Entries hold the optimized tree and name-independent bytecode; variables and user
+ *  functions are resolved when the query runs, so a cached expression stays
+ *  correct when they are redefined. Evicted entries are recycled for the next miss, reusing their
+ *  arena and key buffer. Sources that fail to parse are not cached.
+ */
+class ExpressionCache {
+public:
+    static constexpr std::size_t kDefaultCapacity = 256;
+
+    explicit ExpressionCache(std::size_t capacity = kDefaultCapacity) : capacity_(capacity) {}
+
+    ExpressionCache(const ExpressionCache&) = delete;
+    ExpressionCache& operator=(const ExpressionCache&) = delete;
+
+    /** @brief Return the cached query for `source`, parsing it on a miss.
+     *
+     *  The result stays valid until the next call to try_lookup(), lookup(),
+     *  get(), set_capacity(), or clear().
+     *  @return The query, or the parse error of invalid input.
+     */
+    std::expected<CachedQuery*, Error> try_lookup(std::string_view source);
+
+    /** @brief try_lookup(), throwing its error as a ParseError. */
+    CachedQuery& lookup(std::string_view source);
+
+    /** @brief Parsed expression for `source`; see lookup(). */
+    Expression& get(std::string_view source) { return *lookup(source).expr; }
+
+    /** @brief Change the capacity, evicting least recently used entries.
+     *  A capacity of zero disables caching.
+     */
+    void set_capacity(std::size_t capacity);
+    /** @brief Drop all entries and reset the counters. */
+    void clear();
+
+    std::size_t capacity() const { return capacity_; }
+    std::size_t size() const { return entries_.size(); }
+    std::size_t hits() const { return hits_; }
+    std::size_t misses() const { return misses_; }
+
+private:
+    /** @brief Small first block: most cached lines are short. */
+    static constexpr std::size_t kEntryBlockSize = 512;
+
+    struct Entry {
+        std::string source;
+        QueryContext query{kEntryBlockSize};
+        CachedQuery parsed;
+    };
+    using EntryList = std::list<Entry>;
+
+    // Most recently used first. List nodes never move, so views of each
+    // entry's source stay valid as index keys.
+    EntryList entries_;
+    std::unordered_map<std::string_view, EntryList::iterator> index_;
+    QueryContext uncached_;
+    CachedQuery uncached_query_;
+    std::size_t capacity_;
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+};
+
+}  // namespace repl
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "repl/arena.hpp"
+#include "repl/expression.hpp"
+
+namespace repl {
+
+/** @brief Hash-consing store that keeps one canonical node per distinct subtree.
+ *
+ *  Interned trees become a DAG: structurally equal subtrees, within one tree
+ *  or across every tree interned into the same store, share a single node.
+ *  Canonical nodes are immutable once interned and live as long as the store.
+ *  Each store has an id() no other store in the process has had, which a
+ *  move hands on to the target, so a cache keyed by node address can tell
+ *  when the store it was filled from is gone.
+ */
+class ExpressionDag {
+public:
+    ExpressionDag();
+    ExpressionDag(ExpressionDag&& other) noexcept;
+    ExpressionDag& operator=(ExpressionDag&& other) noexcept;
+
+    /** @brief Canonical copy of `expr`, reusing existing nodes where possible. */
+    ExpressionPtr intern(const Expression& expr);
+
+    /** @brief Number of distinct nodes held. */
+    std::size_t size() const { return nodes_.size(); }
+
+    /** @brief Identity of the store, unique in the process. */
+    std::uint64_t id() const { return id_; }
+
+    /** @brief Whether `address` lies inside a node held by the store. */
+    bool owns(const void* address) const { return arena_.owns(address); }
+
+private:
+    /** @brief Shallow structural hash: children are canonical, so compare pointers. */
+    struct NodeHash {
+        std::size_t operator()(const Expression* expr) const;
+    };
+    struct NodeEqual {
+        bool operator()(const Expression* lhs, const Expression* rhs) const;
+    };
+
+    Arena arena_;
+    std::unordered_set<const Expression*, NodeHash, NodeEqual> nodes_;
+    std::vector<ExpressionPtr> scratch_;
+    std::uint64_t id_;
+};
+
+}  // namespace repl
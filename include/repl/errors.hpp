@@ -1,20 +1,186 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 namespace repl {
 
+struct BuiltinSpec;
+enum class ReduceKind : std::uint8_t;
+enum class Symbol : std::uint32_t;
+enum class TType : std::uint8_t;
+
+/** @brief What went wrong; each code has one message template (see format_error()).
+ *
+ *  Codes up to UnexpectedToken are found while tokenizing or parsing, the
+ *  rest while evaluating.
+ */
+enum class ErrorCode : std::uint8_t {
+    None,
+    // Tokenizing
+    InputTooLong,
+    TokenTooLong,
+    MultipleDecimalPoints,
+    MissingExponent,
+    BangWithoutEquals,
+    NumberOutOfRange,
+    InvalidNumber,
+    UnexpectedCharacter,
+    // Parsing
+    UnexpectedEnd,
+    ExpectedOperand,
+    ExpectedColon,
+    UnclosedGroup,
+    ExpectedRParen,
+    UnclosedCall,
+    ExpectedSeparator,
+    EmptyArgument,
+    TooDeep,
+    ReductionVariable,
+    ReadOnlyBoundVariable,
+    InvalidParserState,
+    UnexpectedToken,
+    // Evaluation
+    DivisionByZero,
+    ModuloByZero,
+    PowerDomain,
+    BuiltinDomain,
+    ReductionDomain,
+    UndefinedVariable,
+    NoLastResult,
+    UndefinedFunction,
+    ArityMismatch,
+    InvalidAssignment,
+    ReadOnly,
+    InvalidOperator,
+    InvalidExpression,
+    CallDepthExceeded,
+    InvalidDefinition,
+    InvalidParameter,
+    DuplicateParameter,
+    MissingBody,
+    ReductionDefinition,
+    TooManyLocals,
+    NonFiniteBounds,
+    TooManyTerms,
+    NoConvergence,
+    BindingCycle,
+    BindingAssigns,
+    BindingReadsLast,
+};
+
+/** @brief Error::position of an error not tied to a place in the source. */
+constexpr std::uint32_t kNoPosition = std::numeric_limits<std::uint32_t>::max();
+
+/** @brief Error::binding of an error that is not a failed binding update. */
+constexpr std::uint32_t kNoBinding = std::numeric_limits<std::uint32_t>::max();
+
+/** @brief Compact description of a parse or evaluation failure.
+ *
+ *  `subject` is what the message names, interpreted by `code`: a symbol, a
+ *  token type, a character, a builtin's index in kBuiltins, or a ReduceKind.
+ *  `numbers` holds an arity mismatch as (expected, got), a limit as its high
+ *  and low halves, or the length of a rejected number literal. `position` is
+ *  the byte offset in the query of the token or node that failed: for errors
+ *  inside a user function, the call the query made. A binding that failed to
+ *  recompute sets `binding` to its symbol and clears `position`, which would
+ *  point into the binding's own definition.
+ */
+struct Error {
+    ErrorCode code = ErrorCode::None;
+    std::uint32_t position = kNoPosition;
+    std::uint32_t subject = 0;
+    std::uint32_t binding = kNoBinding;
+    std::array<std::uint32_t, 2> numbers{};
+
+    explicit operator bool() const { return code != ErrorCode::None; }
+};
+
+static_assert(sizeof(Error) <= 24);
+
+/** @brief Error with no subject, such as DivisionByZero. */
+constexpr Error make_error(ErrorCode code, std::uint32_t position = kNoPosition) {
+    return Error{.code = code, .position = position};
+}
+
+/** @brief Error about a variable, function, parameter or binding name. */
+constexpr Error name_error(ErrorCode code, Symbol name) {
+    return Error{.code = code, .subject = static_cast<std::uint32_t>(name)};
+}
+
+/** @brief Error naming the token type `found` at `position`. */
+constexpr Error token_error(ErrorCode code, TType found, std::uint32_t position) {
+    return Error{.code = code,
+                 .position = position,
+                 .subject = static_cast<std::uint32_t>(found)};
+}
+
+/** @brief Error naming a reduction form. */
+constexpr Error reduction_error(ErrorCode code, ReduceKind kind) {
+    return Error{.code = code, .subject = static_cast<std::uint32_t>(kind)};
+}
+
+/** @brief Error reporting a limit, such as TooDeep or CallDepthExceeded. */
+constexpr Error limit_error(ErrorCode code, std::uint64_t limit) {
+    return Error{.code = code,
+                 .numbers = {static_cast<std::uint32_t>(limit >> 32),
+                             static_cast<std::uint32_t>(limit)}};
+}
+
+/** @brief ArityMismatch for a call of `name` with `got` arguments. */
+constexpr Error arity_error(Symbol name, std::size_t expected, std::size_t got) {
+    return Error{.code = ErrorCode::ArityMismatch,
+                 .subject = static_cast<std::uint32_t>(name),
+                 .numbers = {static_cast<std::uint32_t>(expected),
+                             static_cast<std::uint32_t>(got)}};
+}
+
+/** @brief BuiltinDomain for a non-finite result of `spec`. */
+Error builtin_domain_error(const BuiltinSpec& spec);
+
+/** @brief Whether `code` is found while tokenizing or parsing. */
+constexpr bool is_parse_error(ErrorCode code) {
+    return code != ErrorCode::None && code <= ErrorCode::UnexpectedToken;
+}
+
+/** @brief Message for `error`, as the throwing API raises it.
+ *
+ *  `source` is the query the error was found in; only the messages for
+ *  rejected number literals quote it.
+ */
+std::string format_error(const Error& error, std::string_view source = {});
+
 /** @brief Error raised when tokenization or parsing fails. */
 class ParseError : public std::runtime_error {
 public:
     explicit ParseError(const std::string& message) : std::runtime_error(message) {}
+    ParseError(const Error& error, const std::string& message)
+        : std::runtime_error(message), error_(error) {}
+
+    /** @brief The error as a code; ErrorCode::None if raised from a message alone. */
+    const Error& error() const { return error_; }
+
+private:
+    Error error_;
 };
 
 /** @brief Error raised when expression evaluation fails at runtime. */
 class EvalError : public std::runtime_error {
 public:
     explicit EvalError(const std::string& message) : std::runtime_error(message) {}
+    EvalError(const Error& error, const std::string& message)
+        : std::runtime_error(message), error_(error) {}
+
+    /** @brief The error as a code; ErrorCode::None if raised from a message alone. */
+    const Error& error() const { return error_; }
+
+private:
+    Error error_;
 };
 
 /** @brief Error raised for invalid or unknown REPL meta-commands. */
@@ -23,4 +189,7 @@ public:
     explicit CommandError(const std::string& message) : std::runtime_error(message) {}
 };
 
+/** @brief Throw `error` as a ParseError or EvalError with its formatted message. */
+[[noreturn]] void throw_error(const Error& error, std::string_view source = {});
+
 }  // namespace repl
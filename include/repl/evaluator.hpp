@@ -1,9 +1,16 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <expected>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
+#include "repl/cache.hpp"
+#include "repl/errors.hpp"
 #include "repl/expression.hpp"
 #include "repl/state.hpp"
 
@@ -16,13 +23,105 @@ struct EvalResult {
 };
 
 /** @brief Evaluate a parsed expression in the given state.
- *  @throws EvalError on invalid evaluation.
+ *
+ *  The tree runs as given; process_query() passes it through optimize() first.
+ *  Function definitions and reactive bindings (`name := expr`, see
+ *  BindingGraph) are defined here, but only process_query() recomputes the
+ *  bindings that read a variable the expression assigns. No engine throws on
+ *  an invalid evaluation: the first error stops it and is returned, at the
+ *  position of the failing node, or of the call the expression made if the
+ *  error happened inside a user function.
+ *  @return The result, or the error of an invalid evaluation.
  */
+std::expected<EvalResult, Error> try_evaluate(Expression& expr, State& state);
+
+/** @brief try_evaluate(), throwing its error as an EvalError. */
 EvalResult evaluate(Expression& expr, State& state);
 
-/** @brief Parse and evaluate a source string.
- *  @throws ParseError or EvalError on failure.
+/** @brief Call a user function with the tree walker on already evaluated
+ *  arguments, one per parameter, answering from its memo table if it has
+ *  one. The caller accounts for the call in State::call_depth; calls the body
+ *  makes in tail position may tier up.
+ *  @return The value, or the error the same call in an expression would
+ *  fail with, without a position.
+ */
+std::expected<double, Error> call_function(FnObj& fn, const double* args, State& state);
+
+/** @brief Rows evaluate_batch() evaluates together, one lane each. */
+constexpr std::size_t kBatchLanes = 64;
+
+/** @brief Values of one free variable of a batch expression, one per row. */
+struct BatchColumn {
+    Identifier name;
+    std::span<const double> values;
+};
+
+/** @brief Row that evaluate_batch() could not evaluate. */
+struct BatchError {
+    std::size_t row;
+    /** @brief Index into BatchResult::messages. */
+    std::uint32_t message;
+};
+
+/** @brief Result column of evaluate_batch(). */
+struct BatchResult {
+    /** @brief One value per row; NaN for failed rows. */
+    std::vector<double> values;
+    /** @brief Failed rows in increasing order. */
+    std::vector<BatchError> errors;
+    /** @brief Distinct messages of `errors`, as the scalar evaluator reports them. */
+    std::vector<std::string> messages;
+};
+
+/** @brief Evaluate an optimized expression once per row of `columns`.
+ *
+ *  Each column binds a free variable of `expr`, shadowing any global of the
+ *  same name; user functions still see the globals. Every column must have
+ *  the same length, the number of rows; with no columns there is one row.
+ *
+ *  Rows are evaluated kBatchLanes at a time, structure-of-arrays: each node
+ *  computes a column of lanes, comparisons and ternaries select lanes by
+ *  mask, and a row that fails drops out of its chunk with the error the
+ *  scalar evaluator would raise, leaving the other rows to finish. User
+ *  functions are evaluated the same way, except memoized functions and calls
+ *  nested deeper than a few levels, which run per row through call_function().
+ *  Builtins run their array forms (kernels.hpp), whose results may differ
+ *  from a scalar call by up to BuiltinSpec::max_ulp. State::engine is not consulted, and globals are read, never written.
+ *  @throws EvalError if the columns differ in length or repeat a name, or
+ *  `expr` is a reactive binding.
+ */
+BatchResult evaluate_batch(const Expression& expr, std::span<const BatchColumn> columns,
+                           State& state);
+
+/** @brief Parse and evaluate a source string, then recompute the reactive
+ *  bindings downstream of every variable it assigned.
+ *
+ *  A query that fails after assigning still updates the bindings, but
+ *  reports its own error. A binding that fails to update is named in
+ *  Error::binding.
+ *  @return The result, or the first parse or evaluation error.
+ */
+std::expected<EvalResult, Error> try_process_query(std::string_view input, State& state);
+
+/** @brief Parse and evaluate a source string, reusing `ctx` for the AST.
+ *
+ *  The previous query's tree in `ctx` is discarded first. Reusing one context
+ *  across a session keeps parsing free of heap allocations after warm-up.
  */
+std::expected<EvalResult, Error> try_process_query(std::string_view input, State& state,
+                                                   QueryContext& ctx);
+
+/** @brief Evaluate a source string, reusing its parse from `cache` when present. */
+std::expected<EvalResult, Error> try_process_query(std::string_view input, State& state,
+                                                   ExpressionCache& cache);
+
+/** @brief try_process_query(), throwing its error as a ParseError or EvalError. */
 EvalResult process_query(std::string_view input, State& state);
 
+/** @brief try_process_query() reusing `ctx`, throwing its error. */
+EvalResult process_query(std::string_view input, State& state, QueryContext& ctx);
+
+/** @brief try_process_query() reusing `cache`, throwing its error. */
+EvalResult process_query(std::string_view input, State& state, ExpressionCache& cache);
+
 }  // namespace repl
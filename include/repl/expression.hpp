@@ -1,10 +1,18 @@
 #pragma once
 
-#include <memory>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
 #include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <variant>
 #include <vector>
 
+#include "repl/arena.hpp"
 #include "repl/errors.hpp"
 #include "repl/token.hpp"
 
@@ -18,13 +26,21 @@ enum class EType {
     Binary,
     FnCall,
     Ternary,
+    Power,
+    Polynomial,
+    Local,
+    Builtin,
+    Reduce,
 };
 
 std::ostream& operator<<(std::ostream& os, EType type);
 
+struct BuiltinSpec;
 struct Expression;
-using ExpressionPtr = std::unique_ptr<Expression>;
-using ExpressionList = std::vector<ExpressionPtr>;
+/** @brief Non-owning node pointer; nodes live in the Arena that built them. */
+using ExpressionPtr = Expression*;
+/** @brief Arena-allocated child list. */
+using ExpressionList = std::span<ExpressionPtr>;
 
 /** @brief Unary operator node. */
 struct UnaryNode {
@@ -45,6 +61,19 @@ struct FnNode {
     ExpressionList args;
 };
 
+/** @brief Largest arity of any built-in function. */
+constexpr std::size_t kMaxBuiltinArity = 2;
+
+/** @brief Builtin call bound by optimize() to its registry entry.
+ *
+ *  The argument count has already been checked against `spec->arity`, so
+ *  `args[1]` is null exactly when the builtin is unary.
+ */
+struct BuiltinNode {
+    const BuiltinSpec* spec;
+    std::array<ExpressionPtr, kMaxBuiltinArity> args;
+};
+
 /** @brief Ternary conditional node. */
 struct TernaryNode {
     ExpressionPtr condition;
@@ -52,10 +81,91 @@ struct TernaryNode {
     ExpressionPtr else_branch;
 };
 
+/** @brief Slot value meaning "not a frame slot": the name is looked up globally. */
+constexpr std::uint16_t kNoSlot = 0xFFFF;
+
+/** @brief Parameter or assigned local of a user function, bound to a frame
+ *  slot by resolve_locals(). Parameters occupy the first slots.
+ */
+struct LocalNode {
+    Identifier name;
+    std::uint16_t slot;
+};
+
+/** @brief Strength-reduced `base ^ exponent`, produced by optimize().
+ *
+ *  Integer exponents are computed by repeated squaring and a literal `0.5`
+ *  by a square root. Non-finite results raise the same error as `^`.
+ */
+struct PowerNode {
+    enum class Kind : std::uint8_t { Integer, SquareRoot };
+
+    Kind kind;
+    std::int32_t exponent;
+    ExpressionPtr base;
+};
+
+/** @brief Polynomial in one variable, produced by optimize().
+ *
+ *  `coefficients` holds `degree + 1` values from the highest power down,
+ *  followed by a limit: while |variable| <= limit the polynomial is evaluated
+ *  in Horner form, otherwise `fallback` (the tree it replaced) runs instead.
+ *  In a resolved function body, `slot` is the variable's frame slot.
+ */
+struct PolyNode {
+    Identifier variable;
+    std::uint16_t slot;
+    std::uint16_t degree;
+    const double* coefficients;
+    ExpressionPtr fallback;
+
+    double limit() const { return coefficients[degree + 1]; }
+};
+
+/** @brief Reduction forms, named in kReductions. */
+enum class ReduceKind : std::uint8_t { Sum, Product, Integral };
+
+/** @brief `sum`, `prod` or `integrate` of a body over one bound variable.
+ *
+ *  `args` holds the lower bound, the upper bound, the body, and then one
+ *  Variable node per other name the body mentions: its captures. The body is
+ *  a closure over `variable`. resolve_locals() turns the captures that name
+ *  an enclosing local into Local nodes but leaves the body alone; the body is
+ *  resolved and compiled when the reduction is evaluated, with `variable` and
+ *  the bound captures as its parameters (see reduce.hpp).
+ */
+struct ReduceNode {
+    Identifier variable;
+    ReduceKind kind;
+    ExpressionList args;
+
+    ExpressionPtr lower() const { return args[0]; }
+    ExpressionPtr upper() const { return args[1]; }
+    ExpressionPtr body() const { return args[2]; }
+    ExpressionList captures() const { return args.subspan(3); }
+};
+
 /** @brief Expression node container. */
 struct Expression {
     EType type;
-    std::variant<double, Identifier, UnaryNode, BinaryNode, FnNode, TernaryNode> data;
+    /** @brief Height of the subtree rooted here; leaves are 1. */
+    std::uint32_t height;
+    std::variant<double, Identifier, UnaryNode, BinaryNode, FnNode, TernaryNode, PowerNode,
+                 PolyNode, LocalNode, BuiltinNode, ReduceNode>
+        data;
+    /** @brief Whether the subtree may call a user function. resolve_locals()
+     *  computes it for function bodies; elsewhere it stays conservatively true.
+     */
+    bool calls = true;
+    /** @brief Byte offset in the parsed source of the token the node came
+     *  from (an operator, a name, a number), or kNoPosition. Error positions
+     *  are taken from here; optimize() keeps it on the nodes it rewrites.
+     */
+    std::uint32_t position = kNoPosition;
+    /** @brief Whether some compiled function body gives the node a cache slot
+     *  (see Chunk::shared); the tree walker only looks such nodes up.
+     */
+    bool cached = false;
 
     template <typename T>
     const T& get() const {
@@ -68,28 +178,114 @@ struct Expression {
     }
 };
 
-/** @brief Parse a token stream into an expression.
- *  @throws ParseError on invalid syntax.
+static_assert(std::is_trivially_destructible_v<Expression>);
+
+/** @brief Pending operator or bracket on the parser's explicit stack. */
+struct ParseFrame {
+    enum class Kind : std::uint8_t { Unary, Infix, TernaryThen, TernaryElse, Group, Call };
+
+    Kind kind;
+    TType op = TType::Plus;
+    Identifier name = Identifier{};
+    /** @brief Call frames: index of the first argument on the operand stack. */
+    std::size_t base = 0;
+    /** @brief Source offset of the operator or name that opened the frame. */
+    std::uint32_t position = kNoPosition;
+};
+
+/** @brief Default nesting limit; deeper input is rejected with ErrorCode::TooDeep. */
+constexpr std::size_t kDefaultMaxDepth = 4096;
+
+/** @brief Reusable storage for parsing one query at a time.
+ *
+ *  Nodes are bump-allocated in `arena`; `frames` and `scratch` are the
+ *  parser's operator and operand stacks. reset() drops the previous tree but
+ *  keeps every buffer, so a loop that reuses one context stops allocating once
+ *  warmed up. Expressions whose tree height or bracket nesting exceeds
+ *  `max_depth` fail to parse.
+ */
+struct QueryContext {
+    QueryContext() = default;
+    explicit QueryContext(std::size_t arena_block_size) : arena(arena_block_size) {}
+
+    Arena arena;
+    std::vector<ParseFrame> frames;
+    std::vector<ExpressionPtr> scratch;
+    std::size_t max_depth = kDefaultMaxDepth;
+
+    void reset() {
+        arena.reset();
+        frames.clear();
+        scratch.clear();
+    }
+};
+
+/** @brief Parse a token stream into an expression allocated in `ctx`.
+ *
+ *  Each node's `position` is the source offset of the token it came from.
+ *  @return The expression, or the error for invalid input or syntax.
  */
-ExpressionPtr parse(TokenStream& stream);
+std::expected<ExpressionPtr, Error> try_parse(TokenStream& stream, QueryContext& ctx);
 
 /** @brief Parse tokens and ensure full consumption.
+ *  @return The expression, or the error for invalid syntax or leftover tokens.
+ */
+std::expected<ExpressionPtr, Error> try_parse(const Tokens& tokens, QueryContext& ctx);
+
+/** @brief Lex and parse source text in one pass, without a token buffer.
+ *  @return The expression, or the error for invalid input, syntax, or leftover tokens.
+ */
+std::expected<ExpressionPtr, Error> try_parse(std::string_view source, QueryContext& ctx);
+
+/** @brief try_parse() for callers that handle errors as exceptions.
+ *  @throws ParseError on invalid syntax.
+ */
+ExpressionPtr parse(TokenStream& stream, QueryContext& ctx);
+
+/** @brief Throwing form of try_parse(const Tokens&, QueryContext&).
  *  @throws ParseError on invalid syntax or leftover tokens.
  */
-ExpressionPtr parse(const Tokens& tokens);
+ExpressionPtr parse(const Tokens& tokens, QueryContext& ctx);
+
+/** @brief Throwing form of try_parse(std::string_view, QueryContext&).
+ *  @throws ParseError on invalid input, syntax, or leftover tokens.
+ */
+ExpressionPtr parse(std::string_view source, QueryContext& ctx);
+
+/** @brief Render an expression as an indented tree, one node per line. */
+std::string format_tree(const Expression& expr);
+
+/** @brief Deep-copy an expression tree into another arena. */
+ExpressionPtr clone(const Expression& expr, Arena& arena);
 
 /** @brief Create a numeric expression node. */
-ExpressionPtr make_number(double value);
+ExpressionPtr make_number(Arena& arena, double value);
 /** @brief Create a variable expression node. */
-ExpressionPtr make_variable(Identifier name);
+ExpressionPtr make_variable(Arena& arena, Identifier name);
 /** @brief Create a unary expression node. */
-ExpressionPtr make_unary(TType op, ExpressionPtr right);
+ExpressionPtr make_unary(Arena& arena, TType op, ExpressionPtr right);
 /** @brief Create a binary expression node. */
-ExpressionPtr make_binary(TType op, ExpressionPtr left, ExpressionPtr right);
-/** @brief Create a function call expression node. */
-ExpressionPtr make_fn_call(Identifier name, ExpressionList args);
+ExpressionPtr make_binary(Arena& arena, TType op, ExpressionPtr left, ExpressionPtr right);
+/** @brief Create a function call node; `args` must already live in `arena`. */
+ExpressionPtr make_fn_call(Arena& arena, Identifier name, ExpressionList args);
 /** @brief Create a ternary expression node. */
-ExpressionPtr make_ternary(ExpressionPtr condition, ExpressionPtr then_branch,
+ExpressionPtr make_ternary(Arena& arena, ExpressionPtr condition, ExpressionPtr then_branch,
                            ExpressionPtr else_branch);
+/** @brief Create a strength-reduced power node. */
+ExpressionPtr make_power(Arena& arena, PowerNode::Kind kind, std::int32_t exponent,
+                         ExpressionPtr base);
+/** @brief Create a bound builtin call; `second` is null for a unary builtin. */
+ExpressionPtr make_builtin_call(Arena& arena, const BuiltinSpec& spec, ExpressionPtr first,
+                                ExpressionPtr second);
+/** @brief Create a reduction node; `args` (bounds, body, captures; see
+ *  ReduceNode) must already live in `arena`.
+ */
+ExpressionPtr make_reduce(Arena& arena, ReduceKind kind, Identifier variable,
+                          ExpressionList args);
+/** @brief Create a polynomial node; `coefficients` (degree + 2 values, see
+ *  PolyNode) must already live in `arena`.
+ */
+ExpressionPtr make_polynomial(Arena& arena, Identifier variable,
+                              std::span<const double> coefficients, ExpressionPtr fallback);
 
 }  // namespace repl
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "repl/bytecode.hpp"
+
+namespace repl {
+
+struct FnObj;
+struct State;
+
+/** @brief Calls after which the Jit engine compiles a user function to native code. */
+constexpr std::uint32_t kJitThreshold = 64;
+
+/** @brief x86-64 machine code translated from one user function's bytecode.
+ *
+ *  The code runs in a frame laid out like the VM's: slots, then the operand
+ *  stack, whose depth at every instruction is fixed at translation time. It
+ *  performs the same checks as the VM, but on failure it returns a bail-out
+ *  status that carries no error. The caller then re-runs the call in the
+ *  tree walker, which reports the identical error; function bodies write
+ *  only their own frame, so the abandoned attempt has no visible effect.
+ */
+class NativeCode {
+public:
+    NativeCode(const NativeCode&) = delete;
+    NativeCode& operator=(const NativeCode&) = delete;
+    ~NativeCode();
+
+    /** @brief Run with `args` (one per parameter); empty if the code bailed out. */
+    std::optional<double> run(const double* args, State& state) const;
+
+    /** @brief Bytes of machine code. */
+    std::size_t size() const { return code_size_; }
+
+private:
+    friend std::unique_ptr<NativeCode> jit_compile(const Chunk& chunk);
+
+    NativeCode() = default;
+
+    /** @brief Run in `frame`, whose `live` flags are already cleared. */
+    std::optional<double> enter(double* frame, std::uint8_t* live, const double* args,
+                                State& state) const;
+
+    void* memory_ = nullptr;
+    std::size_t mapped_size_ = 0;
+    std::size_t code_size_ = 0;
+    std::uint16_t param_count_ = 0;
+    std::uint16_t slot_count_ = 0;
+    std::uint32_t frame_size_ = 0;
+    /** @brief Horner coefficients the code points into. */
+    std::vector<double> data_;
+};
+
+/** @brief Whether this build can emit native code (x86-64 with POSIX mmap). */
+bool jit_supported();
+
+/** @brief Translate a function chunk to native code.
+ *  @return nullptr if native code is unsupported here, the chunk uses an
+ *  operation the translator does not handle, or executable memory is denied.
+ */
+std::unique_ptr<NativeCode> jit_compile(const Chunk& chunk);
+
+/** @brief Count a call of `fn` and compile it once it becomes hot.
+ *  @return Whether `fn` has native code to run.
+ */
+bool tier_up(FnObj& fn);
+
+}  // namespace repl
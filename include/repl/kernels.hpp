@@ -0,0 +1,97 @@
+#pragma once
+
+/** @file kernels.hpp
+ *  @brief Array forms of the built-in functions.
+ *
+ *  Each kernel computes `out[i] = f(in[i])` for `count` elements, or
+ *  `out[i] = f(first[i], second[i])` for the binary builtins; `out` may alias
+ *  an input. On x86-64 the elementary functions (trigonometric, exponential
+ *  and logarithmic), hypot, rounding, and the exact helpers run on packed
+ *  doubles, 2 per step with SSE2 or 4 with AVX2 and FMA; the widest
+ *  instruction set supported by the CPU is picked at startup. The remaining
+ *  builtins, and every builtin on other targets, loop over the scalar
+ *  function.
+ *
+ *  A packed kernel may differ from its scalar function by up to
+ *  BuiltinSpec::max_ulp units in the last place. It returns NaN or an
+ *  infinity exactly where the scalar function does, so domain errors are
+ *  the same either way. Lanes outside a kernel's reduced range (zero,
+ *  infinite, NaN or subnormal arguments, huge arguments to `sin`, ...) are
+ *  computed by the scalar function.
+ */
+
+#include <cstddef>
+#include <string_view>
+
+namespace repl {
+
+/** @brief Instruction sets the packed kernels can dispatch to. */
+enum class KernelIsa {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/** @brief Display name of a kernel instruction set. */
+std::string_view to_string(KernelIsa isa);
+
+/** @brief Widest instruction set supported by this CPU and build. */
+KernelIsa detected_kernel_isa();
+
+/** @brief Instruction set currently used by the kernels. */
+KernelIsa kernel_isa();
+
+/** @brief Force the kernels onto an instruction set (benchmarks and tests).
+ *
+ *  Requests wider than detected_kernel_isa() are clamped. Not thread-safe with
+ *  respect to concurrent kernel calls.
+ *  @return The instruction set actually selected.
+ */
+KernelIsa set_kernel_isa(KernelIsa isa);
+
+/** @brief Array form of a built-in function of one argument. */
+using UnaryArrayFn = void (*)(const double* in, double* out, std::size_t count);
+/** @brief Array form of a built-in function of two arguments. */
+using BinaryArrayFn = void (*)(const double* first, const double* second, double* out,
+                               std::size_t count);
+
+/** @brief One kernel per builtin, named after it. */
+namespace kernels {
+
+void sin(const double* in, double* out, std::size_t count);
+void cos(const double* in, double* out, std::size_t count);
+void tan(const double* in, double* out, std::size_t count);
+void asin(const double* in, double* out, std::size_t count);
+void acos(const double* in, double* out, std::size_t count);
+void atan(const double* in, double* out, std::size_t count);
+
+void sinh(const double* in, double* out, std::size_t count);
+void cosh(const double* in, double* out, std::size_t count);
+void tanh(const double* in, double* out, std::size_t count);
+void asinh(const double* in, double* out, std::size_t count);
+void acosh(const double* in, double* out, std::size_t count);
+void atanh(const double* in, double* out, std::size_t count);
+
+void sqrt(const double* in, double* out, std::size_t count);
+void cbrt(const double* in, double* out, std::size_t count);
+void exp(const double* in, double* out, std::size_t count);
+void ln(const double* in, double* out, std::size_t count);
+void log(const double* in, double* out, std::size_t count);
+void log2(const double* in, double* out, std::size_t count);
+void abs(const double* in, double* out, std::size_t count);
+void floor(const double* in, double* out, std::size_t count);
+void ceil(const double* in, double* out, std::size_t count);
+void round(const double* in, double* out, std::size_t count);
+void trunc(const double* in, double* out, std::size_t count);
+void sign(const double* in, double* out, std::size_t count);
+
+void pow(const double* first, const double* second, double* out, std::size_t count);
+void fmod(const double* first, const double* second, double* out, std::size_t count);
+void atan2(const double* first, const double* second, double* out, std::size_t count);
+void min(const double* first, const double* second, double* out, std::size_t count);
+void max(const double* first, const double* second, double* out, std::size_t count);
+void hypot(const double* first, const double* second, double* out, std::size_t count);
+
+}  // namespace kernels
+
+}  // namespace repl
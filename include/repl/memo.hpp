@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "repl/expression.hpp"
+#include "repl/symbol.hpp"
+
+namespace repl {
+
+struct FnObj;
+struct State;
+
+/** @brief Largest arity of a function that can be memoized. */
+constexpr std::size_t kMaxMemoArity = 8;
+
+/** @brief Bounded cache of one user function's results.
+ *
+ *  User functions are pure: they read parameters, globals, and constants, and
+ *  their assignments are local. A result is therefore determined by the
+ *  argument tuple and by the globals the function reads, directly or through
+ *  the functions it calls. validate() tracks those globals' versions and the
+ *  function table's, and empties the table when any of them changes.
+ *
+ *  The table is direct-mapped: each argument tuple hashes to one entry, and a
+ *  new result replaces whatever held it, so memory is fixed by the capacity.
+ *  Storage is allocated on the first insert. Arguments compare bitwise, which
+ *  tells `0` from `-0`.
+ */
+class MemoTable {
+public:
+    /** @brief Argument tuple; entries past the arity are ignored. */
+    using Key = std::array<double, kMaxMemoArity>;
+
+    /** @brief Entries per table; a power of two. */
+    static constexpr std::size_t kDefaultCapacity = 1024;
+
+    explicit MemoTable(std::size_t arity, std::size_t capacity = kDefaultCapacity);
+
+    MemoTable(const MemoTable&) = delete;
+    MemoTable& operator=(const MemoTable&) = delete;
+
+    /** @brief Prepare `fn`'s table for lookups under `state`.
+     *
+     *  Empties the table if a function was defined or a global that `fn`
+     *  depends on was assigned since the previous call.
+     *  @return false if `fn` depends on `_`, whose value changes with every
+     *  query, so its results must not be cached.
+     */
+    bool validate(const FnObj& fn, const State& state);
+
+    /** @brief Cached result for `key`, counting a hit or a miss. */
+    std::optional<double> find(const Key& key);
+    /** @brief Cache `value` as the result for `key`. */
+    void insert(const Key& key, double value);
+    /** @brief Drop every entry; the hit and miss counters are kept. */
+    void clear();
+
+    std::size_t arity() const { return arity_; }
+    std::size_t capacity() const { return capacity_; }
+    std::size_t size() const { return size_; }
+    std::size_t hits() const { return hits_; }
+    std::size_t misses() const { return misses_; }
+    /** @brief Bytes held by the table, including its dependency list. */
+    std::size_t memory_bytes() const;
+
+private:
+    std::size_t index_of(const Key& key) const;
+    bool matches(std::size_t index, const Key& key) const;
+
+    std::size_t arity_;
+    std::size_t capacity_;
+    std::size_t size_ = 0;
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+    // Entry i's arguments are keys_[i * arity_, (i + 1) * arity_).
+    std::vector<double> keys_;
+    std::vector<double> values_;
+    std::vector<std::uint8_t> used_;
+
+    // Function table version the dependencies were collected at; functions
+    // exist only after the first definition, so 0 never matches.
+    std::uint64_t fns_version_ = 0;
+    bool pure_ = true;
+    std::vector<std::pair<Identifier, std::uint64_t>> globals_;
+};
+
+/** @brief Globals a top-level expression reads, directly or through the
+ *  user functions it calls, as of `state`'s current function table.
+ */
+struct GlobalReads {
+    /** @brief Sorted and unique; `_` is reported in `last_result` instead. */
+    std::vector<Identifier> globals;
+    bool last_result = false;
+    /** @brief Whether it calls a user function, defined or not. */
+    bool calls = false;
+};
+
+GlobalReads global_reads(const Expression& expr, const State& state);
+
+/** @brief Whether `body`, the body of function `name`, calls `name` more than
+ *  once: the tree-recursive shape, as in `fib`, whose exponential call count
+ *  memoization reduces to linear. Such functions are memoized automatically.
+ */
+bool recurses_repeatedly(const Expression& body, Identifier name);
+
+}  // namespace repl
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "repl/arena.hpp"
+#include "repl/expression.hpp"
+
+namespace repl {
+
+/** @brief Largest |exponent| that optimize() turns into repeated squaring. */
+constexpr std::int32_t kMaxReducedExponent = 16;
+/** @brief Highest degree that optimize() evaluates in Horner form. */
+constexpr std::uint32_t kMaxPolynomialDegree = 32;
+
+/** @brief Rewrite an expression tree into a cheaper equivalent.
+ *
+ *  Folds constant subtrees (arithmetic, comparisons, pure builtins, and the
+ *  constants `pi`, `e`, `tau`) and replaces ternaries whose condition is
+ *  constant with the branch that runs. A subtree whose evaluation would raise
+ *  an error is left as is, so the error still surfaces at run time, and the
+ *  left side of `=` is never touched. Builtin calls with the right arity that
+ *  do not fold become BuiltinNodes bound to their registry entry.
+ *
+ *  Then strength-reduces what is left: `x ^ n` for a literal integer n
+ *  becomes a PowerNode, `x ^ 0.5` a square root, division by a power of two
+ *  a multiplication by its (exact) reciprocal, and a sum of terms in one
+ *  variable of degree >= 2 a PolyNode. See DESIGN.md for the accuracy bounds.
+ *  Nodes are rewritten in place; new nodes are allocated in `arena`.
+ *  @return The root of the rewritten tree, which may differ from `expr`.
+ */
+ExpressionPtr optimize(ExpressionPtr expr, Arena& arena);
+
+/** @brief `base ^ exponent` by repeated squaring, as evaluated for PowerNode.
+ *
+ *  Negative exponents take the reciprocal unless the positive power is not a
+ *  normal number, where that would lose accuracy; std::pow is used instead.
+ */
+inline double integer_power(double base, std::int32_t exponent) {
+    std::uint32_t remaining = exponent < 0 ? 0u - static_cast<std::uint32_t>(exponent)
+                                           : static_cast<std::uint32_t>(exponent);
+    double result = 1.0;
+    double square = base;
+    while (remaining != 0) {
+        if ((remaining & 1u) != 0) {
+            result *= square;
+        }
+        remaining >>= 1;
+        if (remaining != 0) {
+            square *= square;
+        }
+    }
+    if (exponent >= 0) {
+        return result;
+    }
+    if (!std::isnormal(result)) {
+        return std::pow(base, static_cast<double>(exponent));
+    }
+    return 1.0 / result;
+}
+
+/** @brief `base ^ 0.5` as evaluated for PowerNode; `+ 0.0` maps -0 to +0 like pow. */
+inline double square_root(double base) {
+    return std::sqrt(base) + 0.0;
+}
+
+/** @brief Evaluate `degree + 1` coefficients, highest power first, at `x`
+ *  in Horner form with FMA.
+ */
+inline double horner(const double* coefficients, std::uint32_t degree, double x) {
+    double value = coefficients[0];
+    for (std::uint32_t index = 1; index <= degree; ++index) {
+        value = std::fma(value, x, coefficients[index]);
+    }
+    return value;
+}
+
+}  // namespace repl
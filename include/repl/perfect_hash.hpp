@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace repl {
+
+/** @brief Seeded FNV-1a over a name, with a final mix so the low bits spread. */
+constexpr std::uint32_t name_hash(std::string_view name, std::uint32_t seed) {
+    std::uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+/** @brief Fixed set of named entries with a collision-free hash, built at compile time.
+ *
+ *  The constructor searches for a seed under which every name lands in its
+ *  own bucket, so a lookup hashes the name once, reads one bucket, and
+ *  compares one name. `Entry` needs a `name` member convertible to
+ *  `std::string_view`. Declared `constexpr`, the table is constant-initialized
+ *  and costs nothing at startup.
+ */
+template <typename Entry, std::size_t N>
+class PerfectHashTable {
+public:
+    static_assert(N > 0 && N < 255, "bucket indices are stored in one byte");
+
+    /** @brief Buckets per table: four per entry, rounded up to a power of two. */
+    static constexpr std::size_t kBuckets = std::bit_ceil(N) * 4;
+
+    constexpr explicit PerfectHashTable(const std::array<Entry, N>& entries) : entries_(entries) {
+        for (std::uint32_t seed = 0; seed < kMaxSeed; ++seed) {
+            if (try_seed(seed)) {
+                seed_ = seed;
+                return;
+            }
+        }
+        throw std::logic_error("no perfect hash seed found");
+    }
+
+    /** @brief Entry named `name`, or nullptr. */
+    constexpr const Entry* find(std::string_view name) const {
+        const std::uint8_t index = buckets_[bucket(name, seed_)];
+        if (index == 0) {
+            return nullptr;
+        }
+        const Entry& entry = entries_[index - 1];
+        return std::string_view{entry.name} == name ? &entry : nullptr;
+    }
+
+    constexpr bool contains(std::string_view name) const { return find(name) != nullptr; }
+
+    constexpr std::size_t size() const { return N; }
+    constexpr auto begin() const { return entries_.begin(); }
+    constexpr auto end() const { return entries_.end(); }
+
+private:
+    static constexpr std::uint32_t kMaxSeed = 1u << 16;
+
+    static constexpr std::size_t bucket(std::string_view name, std::uint32_t seed) {
+        return name_hash(name, seed) & (kBuckets - 1);
+    }
+
+    constexpr bool try_seed(std::uint32_t seed) {
+        buckets_.fill(0);
+        for (std::size_t index = 0; index < N; ++index) {
+            std::uint8_t& slot = buckets_[bucket(entries_[index].name, seed)];
+            if (slot != 0) {
+                return false;
+            }
+            slot = static_cast<std::uint8_t>(index + 1);
+        }
+        return true;
+    }
+
+    std::array<Entry, N> entries_;
+    std::uint32_t seed_ = 0;
+    /** @brief Per bucket: index of the entry hashed there plus one, or 0 if empty. */
+    std::array<std::uint8_t, kBuckets> buckets_{};
+};
+
+}  // namespace repl
@@ -0,0 +1,136 @@
+#pragma once
+
+/** @file reactive.hpp
+ *  @brief Reactive bindings: variables defined by `name := expr` that are
+ *  recomputed whenever a variable they read changes.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "repl/bytecode.hpp"
+#include "repl/errors.hpp"
+#include "repl/expression.hpp"
+
+namespace repl {
+
+struct State;
+
+/** @brief Whether `expr` is a reactive binding, `name := expr`. The parser
+ *  only accepts one as a whole query.
+ */
+bool is_binding(const Expression& expr);
+
+/** @brief Global names a top-level query may assign, in first-assignment
+ *  order. Assignments inside a reduction's body are local to it and skipped.
+ */
+Identifiers assigned_globals(const Expression& expr);
+
+/** @brief Bindings and the dependency graph between them and the variables they read.
+ *
+ *  A binding's value lives in State::vars like any variable, so every engine
+ *  reads it as a global. Each variable keeps the bindings that read it, directly
+ *  or through a user function; those edges form a DAG, checked for cycles
+ *  whenever edges are added. When variables change, the bindings reachable
+ *  from them are collected by a depth-first search, whose reverse postorder is
+ *  a topological order of just that subgraph, and recomputed in it: the cost
+ *  is proportional to the bindings affected, however large the graph is.
+ *
+ *  A binding that fails to recompute is left undefined, so the bindings that
+ *  read it fail too instead of keeping a stale value. Assigning a bound name
+ *  with `=` turns it back into a plain variable.
+ */
+class BindingGraph {
+public:
+    /** @brief Definition of one binding. `expr` is a canonical node in State::dag. */
+    struct Binding {
+        ExpressionPtr expr;
+        Chunk code;
+        /** @brief Globals read, sorted; see global_reads(). */
+        Identifiers reads;
+        /** @brief Whether `expr` calls a user function. */
+        bool calls = false;
+    };
+
+    bool empty() const { return count_ == 0; }
+    std::size_t size() const { return count_; }
+
+    /** @brief Binding of `name`, or nullptr if it is a plain variable or undefined. */
+    const Binding* find(Identifier name) const {
+        const std::size_t index = index_of(name);
+        return index < nodes_.size() ? nodes_[index].binding.get() : nullptr;
+    }
+
+    /** @brief Number of bindings that read `name`. */
+    std::size_t dependent_count(Identifier name) const {
+        const std::size_t index = index_of(name);
+        return index < nodes_.size() ? nodes_[index].dependents.size() : 0;
+    }
+
+    /** @brief Bind `name` to `expr`, an optimized top-level expression, and
+     *  recompute the bindings that read it.
+     *
+     *  `expr` is evaluated before anything changes, so a definition that fails
+     *  leaves the graph and the variables as they were.
+     *  @return The new value of `name`, or the error if `name` is reserved,
+     *  `expr` assigns a variable or reads `_`, the binding would depend on
+     *  itself, or `expr` fails. The definition stands if only a dependent
+     *  binding fails to update; that error names it in Error::binding.
+     */
+    std::expected<double, Error> define(Identifier name, const Expression& expr, State& state);
+
+    /** @brief Recompute the bindings downstream of `names`, variables a query
+     *  just assigned. Bound names among them become plain variables first.
+     *  @return The error of the first binding that failed to update, if any.
+     */
+    std::expected<void, Error> assigned(std::span<const Identifier> names, State& state);
+
+    /** @brief Collect again what each binding that calls a user function
+     *  reads, after a function was defined.
+     *  @return An error, having changed nothing, if a binding would depend on itself.
+     */
+    std::expected<void, Error> relink_callers(const State& state);
+
+    /** @brief Recompute every binding that calls a user function, and the
+     *  bindings downstream of them.
+     *  @return The error of the first binding that failed to update, if any.
+     */
+    std::expected<void, Error> recompute_callers(State& state);
+
+private:
+    struct Node {
+        /** @brief Bindings that read this name; an edge to each. */
+        Identifiers dependents;
+        std::unique_ptr<Binding> binding;
+        /** @brief Search that last visited this node. */
+        std::uint64_t mark = 0;
+    };
+
+    Node& node(Identifier name);
+    void link(Identifier name, std::span<const Identifier> reads);
+    void unlink(Identifier name, std::span<const Identifier> reads);
+    void unbind(Identifier name);
+    /** @brief Mark everything reachable from `sources` with a new search
+     *  number and leave it in `order_` in reverse topological order.
+     */
+    void search(std::span<const Identifier> sources);
+    /** @brief Whether `name` reaches any of `reads`, i.e. reading them would close a cycle. */
+    bool reaches(Identifier name, std::span<const Identifier> reads);
+    /** @brief Recompute the bindings in `order_`, except the ones in `skip`. */
+    std::expected<void, Error> recompute(std::span<const Identifier> skip, State& state);
+
+    std::vector<Node> nodes_;
+    std::size_t count_ = 0;
+    /** @brief Bindings whose expression calls a user function. */
+    Identifiers callers_;
+    std::uint64_t searches_ = 0;
+    Identifiers order_;
+    std::vector<std::pair<Identifier, std::size_t>> stack_;
+};
+
+}  // namespace repl
@@ -0,0 +1,85 @@
+#pragma once
+
+/** @file reduce.hpp
+ *  @brief Evaluation of `sum`, `prod` and `integrate`.
+ *
+ *  A reduction's body is a closure: when the reduction runs, a copy of the
+ *  body is resolved with the bound variable and the bound captures as
+ *  parameters, interned so repeated subtrees are computed once per point, and
+ *  compiled for the bytecode VM. A reduction in a function body or a binding
+ *  keeps its compiled body until a function is defined or the state is
+ *  reset, so later calls skip this step. The points are then cut into a
+ *  fixed set of tasks that the thread pool runs, and the partial results are
+ *  combined in task order, so the value does not depend on the number of
+ *  workers.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+
+#include "repl/errors.hpp"
+#include "repl/expression.hpp"
+#include "repl/thread_pool.hpp"
+
+namespace repl {
+
+struct State;
+struct WorkerView;
+
+/** @brief Points of a `sum` or `prod` that one task adds up. */
+constexpr std::size_t kReduceChunk = 4096;
+
+/** @brief Most points a `sum` or `prod` may visit. */
+constexpr std::uint64_t kMaxReducePoints = std::uint64_t{1} << 32;
+
+/** @brief Equal pieces an integral is cut into, one task each. */
+constexpr std::size_t kIntegralPieces = 16;
+
+/** @brief Most bisections a piece of an integral may make. */
+constexpr std::size_t kMaxIntegralSplits = 500;
+
+/** @brief Error an integral is refined until it meets, whichever is larger. */
+constexpr double kIntegralRelTolerance = 1e-10;
+constexpr double kIntegralAbsTolerance = 1e-12;
+
+/** @brief Whether a capture's value is passed to the body as a parameter.
+ *
+ *  Captures that resolve_locals() bound to an enclosing local are, and so are
+ *  captures named by one of `columns` (see evaluate_batch()); any other
+ *  capture is read as a global from the state while the body runs.
+ */
+bool is_bound_capture(const Expression& capture, std::span<const Identifier> columns);
+
+/** @brief Evaluate a reduction.
+ *
+ *  `values` holds the lower bound, the upper bound, and then the value of
+ *  each bound capture in order. `sum` and `prod` visit `lower`, `lower + 1`,
+ *  ... up to and including `upper`; `integrate` integrates from `lower` to
+ *  `upper` with adaptive Gauss-Kronrod quadrature. Sums and products are
+ *  compensated, so their error does not grow with the number of points.
+ *
+ *  `state` is only read: every worker, the calling thread included, runs the
+ *  body against a WorkerView of it. Errors are reported from the first
+ *  failing task.
+ *  @return The value, or the error if a bound is not finite, a sum or
+ *  product has more than kMaxReducePoints points or a non-finite result, an
+ *  integral does not converge, or the body fails.
+ */
+std::expected<double, Error> try_reduce(const ReduceNode& node, const double* values,
+                                        const State& state,
+                                        std::span<const Identifier> columns = {},
+                                        ThreadPool& pool = shared_pool());
+
+/** @brief try_reduce() for a reduction in a body that runs against `view`,
+ *  as when reductions nest; its workers start from the view's call depth.
+ */
+std::expected<double, Error> try_reduce(const ReduceNode& node, const double* values,
+                                        WorkerView& view, ThreadPool& pool = shared_pool());
+
+/** @brief try_reduce(), throwing its error as an EvalError. */
+double reduce(const ReduceNode& node, const double* values, const State& state,
+              std::span<const Identifier> columns = {}, ThreadPool& pool = shared_pool());
+
+}  // namespace repl
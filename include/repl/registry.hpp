@@ -0,0 +1,243 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <string_view>
+
+#include "repl/expression.hpp"
+#include "repl/kernels.hpp"
+#include "repl/perfect_hash.hpp"
+#include "repl/token.hpp"
+
+namespace repl {
+
+/** @brief Built-in function of one argument. */
+using UnaryFn = double (*)(double);
+/** @brief Built-in function of two arguments. */
+using BinaryFn = double (*)(double, double);
+
+/** @brief Metadata for built-in functions.
+ *
+ *  Exactly one of `unary` and `binary` is set, matching `arity`, and the
+ *  array form next to it (see kernels.hpp).
+ */
+struct BuiltinSpec {
+    std::string_view name;
+    std::size_t arity;
+    std::string_view description;
+    UnaryFn unary = nullptr;
+    BinaryFn binary = nullptr;
+    UnaryArrayFn unary_array = nullptr;
+    BinaryArrayFn binary_array = nullptr;
+    /** @brief Largest difference, in units in the last place, between the array
+     *  form and the scalar function on finite results. Zero means bit-identical.
+     */
+    std::uint32_t max_ulp = 0;
+};
+
+/** @brief Named built-in constant. */
+struct ConstantSpec {
+    std::string_view name;
+    double value;
+};
+
+/** @brief Reduction form `name(variable, lower, upper, body)`, parsed into a ReduceNode.
+ *  Calls of the name with another number of arguments are ordinary calls.
+ */
+struct ReductionSpec {
+    std::string_view name;
+    ReduceKind kind;
+    std::string_view description;
+};
+
+/** @brief Apply a builtin to `spec.arity` evaluated arguments. */
+inline double call_builtin(const BuiltinSpec& spec, const double* args) {
+    return spec.arity == 1 ? spec.unary(args[0]) : spec.binary(args[0], args[1]);
+}
+
+namespace detail {
+
+constexpr BuiltinSpec unary(std::string_view name, std::string_view description, UnaryFn fn,
+                            UnaryArrayFn array, std::uint32_t max_ulp = 0) {
+    return BuiltinSpec{name, 1, description, fn, nullptr, array, nullptr, max_ulp};
+}
+
+constexpr BuiltinSpec binary(std::string_view name, std::string_view description, BinaryFn fn,
+                             BinaryArrayFn array, std::uint32_t max_ulp = 0) {
+    return BuiltinSpec{name, 2, description, nullptr, fn, nullptr, array, max_ulp};
+}
+
+constexpr double sign(double x) {
+    if (x > 0.0) {
+        return 1.0;
+    }
+    if (x < 0.0) {
+        return -1.0;
+    }
+    return 0.0;
+}
+
+inline double min(double a, double b) {
+    return std::fmin(a, b);
+}
+
+inline double max(double a, double b) {
+    return std::fmax(a, b);
+}
+
+inline double hypot(double a, double b) {
+    return std::hypot(a, b);
+}
+
+}  // namespace detail
+
+/** @brief Built-in function registry, constant-initialized. */
+inline constexpr PerfectHashTable kBuiltins{std::array{
+    detail::unary("sin", "Sine (radians)", std::sin, kernels::sin, 1),
+    detail::unary("cos", "Cosine (radians)", std::cos, kernels::cos, 1),
+    detail::unary("tan", "Tangent (radians)", std::tan, kernels::tan, 3),
+    detail::unary("asin", "Inverse sine", std::asin, kernels::asin),
+    detail::unary("acos", "Inverse cosine", std::acos, kernels::acos),
+    detail::unary("atan", "Inverse tangent", std::atan, kernels::atan, 1),
+
+    detail::unary("sinh", "Hyperbolic sine", std::sinh, kernels::sinh),
+    detail::unary("cosh", "Hyperbolic cosine", std::cosh, kernels::cosh),
+    detail::unary("tanh", "Hyperbolic tangent", std::tanh, kernels::tanh),
+    detail::unary("asinh", "Inverse hyperbolic sine", std::asinh, kernels::asinh),
+    detail::unary("acosh", "Inverse hyperbolic cosine", std::acosh, kernels::acosh),
+    detail::unary("atanh", "Inverse hyperbolic tangent", std::atanh, kernels::atanh),
+
+    detail::unary("sqrt", "Square root", std::sqrt, kernels::sqrt),
+    detail::unary("cbrt", "Cube root", std::cbrt, kernels::cbrt),
+    detail::unary("exp", "Exponential (e^x)", std::exp, kernels::exp, 1),
+    detail::unary("ln", "Natural logarithm", std::log, kernels::ln, 1),
+    detail::unary("log", "Base-10 logarithm", std::log10, kernels::log, 2),
+    detail::unary("log2", "Base-2 logarithm", std::log2, kernels::log2, 1),
+    detail::unary("abs", "Absolute value", std::fabs, kernels::abs),
+    detail::unary("floor", "Round down", std::floor, kernels::floor),
+    detail::unary("ceil", "Round up", std::ceil, kernels::ceil),
+    detail::unary("round", "Round to nearest", std::round, kernels::round),
+    detail::unary("trunc", "Truncate fractional part", std::trunc, kernels::trunc),
+    detail::unary("sign", "Sign (-1, 0, or 1)", detail::sign, kernels::sign),
+
+    detail::binary("pow", "Power", std::pow, kernels::pow),
+    detail::binary("fmod", "Floating-point modulo", std::fmod, kernels::fmod),
+    detail::binary("atan2", "Quadrant-aware arctangent", std::atan2, kernels::atan2, 1),
+    detail::binary("min", "Minimum of two values", detail::min, kernels::min),
+    detail::binary("max", "Maximum of two values", detail::max, kernels::max),
+    detail::binary("hypot", "Euclidean distance sqrt(a^2 + b^2)", detail::hypot, kernels::hypot,
+                   1),
+}};
+
+/** @brief Built-in constant registry, constant-initialized. */
+inline constexpr PerfectHashTable kConstants{std::array{
+    ConstantSpec{"pi", std::numbers::pi_v<double>},
+    ConstantSpec{"e", std::numbers::e_v<double>},
+    ConstantSpec{"tau", std::numbers::pi_v<double> * 2.0},
+}};
+
+/** @brief Reduction forms, in ReduceKind order. */
+inline constexpr PerfectHashTable kReductions{std::array{
+    ReductionSpec{"sum", ReduceKind::Sum,
+                  "Sum of body for variable = lower, lower + 1, ..., upper"},
+    ReductionSpec{"prod", ReduceKind::Product,
+                  "Product of body for variable = lower, lower + 1, ..., upper"},
+    ReductionSpec{"integrate", ReduceKind::Integral,
+                  "Integral of body over variable from lower to upper"},
+}};
+
+/** @brief Symbol layout of the registry.
+ *
+ *  The session symbol table interns every registry name before anything
+ *  else, in this order: builtins, constants, `_`, then reductions. A name's
+ *  symbol is then its registry index plus an offset, so the Identifier
+ *  overloads below answer with a range check instead of hashing the name.
+ *  The reserved names come first, up to kFirstReduction.
+ */
+namespace registry_symbols {
+inline constexpr std::size_t kFirstConstant = kBuiltins.size();
+inline constexpr std::size_t kLastResult = kFirstConstant + kConstants.size();
+inline constexpr std::size_t kFirstReduction = kLastResult + 1;
+/** @brief Number of symbols the registry interns. */
+inline constexpr std::size_t kCount = kFirstReduction + kReductions.size();
+
+/** @brief Entry `index` of `table`, or nullptr past its end. */
+template <typename Table>
+constexpr auto entry(const Table& table, std::size_t index) -> decltype(&*table.begin()) {
+    return index < table.size() ? &*(table.begin() + static_cast<std::ptrdiff_t>(index))
+                                : nullptr;
+}
+}  // namespace registry_symbols
+
+/** @brief Intern the registry's names into an empty table, in the layout above. */
+void intern_registry(SymbolTable& table);
+
+/** @brief Built-in function named `name`, or nullptr. */
+constexpr const BuiltinSpec* find_builtin(std::string_view name) {
+    return kBuiltins.find(name);
+}
+/** @brief Built-in function named by a symbol, or nullptr. */
+inline const BuiltinSpec* find_builtin(Identifier name) {
+    return registry_symbols::entry(kBuiltins, index_of(name));
+}
+
+/** @brief Value of the constant named `name`, or nullptr. */
+constexpr const double* find_constant(std::string_view name) {
+    const ConstantSpec* spec = kConstants.find(name);
+    return spec ? &spec->value : nullptr;
+}
+/** @brief Value of the constant named by a symbol, or nullptr. */
+inline const double* find_constant(Identifier name) {
+    const ConstantSpec* spec =
+        registry_symbols::entry(kConstants, index_of(name) - registry_symbols::kFirstConstant);
+    return spec ? &spec->value : nullptr;
+}
+
+/** @brief Whether a name matches a built-in function. */
+constexpr bool is_builtin_function(std::string_view name) {
+    return kBuiltins.contains(name);
+}
+/** @brief Whether a symbol matches a built-in function. */
+inline bool is_builtin_function(Identifier name) {
+    return index_of(name) < kBuiltins.size();
+}
+
+/** @brief Reduction form named `name`, or nullptr. */
+constexpr const ReductionSpec* find_reduction(std::string_view name) {
+    return kReductions.find(name);
+}
+/** @brief Reduction form named by a symbol, or nullptr. */
+inline const ReductionSpec* find_reduction(Identifier name) {
+    return registry_symbols::entry(kReductions,
+                                   index_of(name) - registry_symbols::kFirstReduction);
+}
+/** @brief Registry entry of a reduction kind. */
+constexpr const ReductionSpec& reduction_spec(ReduceKind kind) {
+    return *(kReductions.begin() + static_cast<std::ptrdiff_t>(kind));
+}
+
+/** @brief Whether a name matches a constant. */
+constexpr bool is_constant(std::string_view name) {
+    return kConstants.contains(name);
+}
+/** @brief Whether a symbol matches a constant. */
+inline bool is_constant(Identifier name) {
+    return index_of(name) - registry_symbols::kFirstConstant < kConstants.size();
+}
+
+/** @brief Whether a name is reserved from assignment: `_`, a constant, or a
+ *  builtin. Reduction names are not: only a four-argument call of one is a
+ *  reduction, so they remain usable as variables and functions.
+ */
+constexpr bool is_reserved_identifier(std::string_view name) {
+    return name == "_" || is_constant(name) || is_builtin_function(name);
+}
+/** @brief Whether a symbol is reserved from assignment. */
+inline bool is_reserved_identifier(Identifier name) {
+    return index_of(name) < registry_symbols::kFirstReduction;
+}
+
+}  // namespace repl
@@ -7,5 +7,6 @@
 #include "repl/evaluator.hpp"
 #include "repl/expression.hpp"
 #include "repl/state.hpp"
+#include "repl/symbol.hpp"
 #include "repl/token.hpp"
 #include "repl/errors.hpp"
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <span>
+
+#include "repl/errors.hpp"
+#include "repl/expression.hpp"
+
+namespace repl {
+
+/** @brief Bind a user function body's parameters and locals to frame slots.
+ *
+ *  Parameters take slots [0, params.size()) in order; every other name the
+ *  body assigns takes the next free slot. Each reference to one of them,
+ *  including assignment targets and polynomial variables, is rewritten in
+ *  place into a Local node. The remaining Variable nodes are globals (whose
+ *  slot is their symbol, see VariableStore), `_`, or constants. Every node's
+ *  `calls` flag is set to whether its subtree contains a call that is not a
+ *  bound builtin. The body of a reduction is left unresolved and its
+ *  assignments stay local to it; only its bounds and captures are bound here.
+ *  Resolving an already resolved body with the same parameters changes
+ *  nothing.
+ *  @return The frame size: parameters plus assigned locals, or TooManyLocals
+ *  if the body needs more frame slots than a slot index holds.
+ */
+std::expected<std::uint16_t, Error> resolve_locals(Expression& body,
+                                                   std::span<const Identifier> params);
+
+}  // namespace repl
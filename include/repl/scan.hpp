@@ -0,0 +1,137 @@
+#pragma once
+
+/** @file scan.hpp
+ *  @brief Character classification and bulk scanning used by the lexer.
+ *
+ *  The bulk scanners find the end of whitespace, identifier, and digit runs.
+ *  On x86-64 they process 16 (SSE2) or 32 (AVX2) bytes per step; the widest
+ *  instruction set supported by the CPU is picked at startup, with a scalar
+ *  fallback everywhere else. Short runs, which dominate ordinary input, are
+ *  finished inline before the vector path is entered. Classification is
+ *  ASCII-only and independent of the C locale.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace repl {
+
+/** @brief Instruction sets the bulk scanners can dispatch to. */
+enum class ScanIsa {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/** @brief Display name of a scan instruction set. */
+std::string_view to_string(ScanIsa isa);
+
+/** @brief Widest instruction set supported by this CPU and build. */
+ScanIsa detected_scan_isa();
+
+/** @brief Instruction set currently used by the bulk scanners. */
+ScanIsa scan_isa();
+
+/** @brief Force the scanners onto an instruction set (benchmarks and tests).
+ *
+ *  Requests wider than detected_scan_isa() are clamped. Not thread-safe with
+ *  respect to concurrent tokenizing.
+ *  @return The instruction set actually selected.
+ */
+ScanIsa set_scan_isa(ScanIsa isa);
+
+namespace detail {
+
+enum CharClass : std::uint8_t {
+    kCharSpace = 1,
+    kCharDigit = 2,
+    kCharAlpha = 4,
+};
+
+constexpr std::array<std::uint8_t, 256> make_char_classes() {
+    std::array<std::uint8_t, 256> table{};
+    for (char ch : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        table[static_cast<unsigned char>(ch)] = kCharSpace;
+    }
+    for (int ch = '0'; ch <= '9'; ++ch) {
+        table[ch] = kCharDigit;
+    }
+    for (int ch = 'a'; ch <= 'z'; ++ch) {
+        table[ch] = kCharAlpha;
+        table[ch - 'a' + 'A'] = kCharAlpha;
+    }
+    table['_'] = kCharAlpha;
+    return table;
+}
+
+inline constexpr std::array<std::uint8_t, 256> kCharClasses = make_char_classes();
+
+constexpr std::uint8_t char_class(char ch) {
+    return kCharClasses[static_cast<unsigned char>(ch)];
+}
+
+/** @brief Number of characters checked inline before dispatching. */
+inline constexpr std::size_t kInlineScan = 8;
+
+std::size_t skip_spaces_bulk(const char* data, std::size_t size, std::size_t pos);
+std::size_t skip_identifier_chars_bulk(const char* data, std::size_t size, std::size_t pos);
+std::size_t skip_digits_bulk(const char* data, std::size_t size, std::size_t pos);
+
+}  // namespace detail
+
+/** @brief ASCII whitespace (space, \\t, \\n, \\v, \\f, \\r). */
+constexpr bool is_space_char(char ch) {
+    return detail::char_class(ch) == detail::kCharSpace;
+}
+
+/** @brief ASCII decimal digit. */
+constexpr bool is_digit_char(char ch) {
+    return detail::char_class(ch) == detail::kCharDigit;
+}
+
+/** @brief Character that may start an identifier ([A-Za-z_]). */
+constexpr bool is_identifier_start(char ch) {
+    return detail::char_class(ch) == detail::kCharAlpha;
+}
+
+/** @brief Character that may continue an identifier ([A-Za-z0-9_]). */
+constexpr bool is_identifier_char(char ch) {
+    return (detail::char_class(ch) & (detail::kCharAlpha | detail::kCharDigit)) != 0;
+}
+
+/** @brief Index of the first non-whitespace character at or after `pos`. */
+inline std::size_t skip_spaces(std::string_view text, std::size_t pos) {
+    const std::size_t stop = pos + detail::kInlineScan;
+    for (; pos < text.size() && pos < stop; ++pos) {
+        if (!is_space_char(text[pos])) {
+            return pos;
+        }
+    }
+    return detail::skip_spaces_bulk(text.data(), text.size(), pos);
+}
+
+/** @brief Index of the first character at or after `pos` outside [A-Za-z0-9_]. */
+inline std::size_t skip_identifier_chars(std::string_view text, std::size_t pos) {
+    const std::size_t stop = pos + detail::kInlineScan;
+    for (; pos < text.size() && pos < stop; ++pos) {
+        if (!is_identifier_char(text[pos])) {
+            return pos;
+        }
+    }
+    return detail::skip_identifier_chars_bulk(text.data(), text.size(), pos);
+}
+
+/** @brief Index of the first non-digit character at or after `pos`. */
+inline std::size_t skip_digits(std::string_view text, std::size_t pos) {
+    const std::size_t stop = pos + detail::kInlineScan;
+    for (; pos < text.size() && pos < stop; ++pos) {
+        if (!is_digit_char(text[pos])) {
+            return pos;
+        }
+    }
+    return detail::skip_digits_bulk(text.data(), text.size(), pos);
+}
+
+}  // namespace repl
@@ -1,70 +1,279 @@
 #pragma once
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
 #include <ostream>
-#include <span>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "repl/bytecode.hpp"
+#include "repl/dag.hpp"
 #include "repl/expression.hpp"
+#include "repl/jit.hpp"
+#include "repl/memo.hpp"
+#include "repl/reactive.hpp"
+#include "repl/registry.hpp"
 
 namespace repl {
 
-/** @brief Map of variable values. */
-using VariableMap = std::unordered_map<Identifier, double>;
+/** @brief Global variables in stable slots, one per symbol.
+ *
+ *  A variable's slot is its symbol's index, so it never moves and reading it
+ *  is an index load plus a definedness check. Storage grows with the symbol
+ *  table as new names are assigned. Each slot also counts its changes, so
+ *  memo tables can tell whether a global they depend on was reassigned.
+ */
+class VariableStore {
+public:
+    class const_iterator;
 
-/** @brief User-defined function data. */
+    /** @brief Value of `name`, or nullptr if it is not defined. */
+    const double* find(Identifier name) const {
+        const std::size_t slot = index_of(name);
+        if (slot < defined_.size() && defined_[slot] != 0) {
+            return &values_[slot];
+        }
+        return nullptr;
+    }
+
+    /** @brief Define `name` or overwrite its value. */
+    void set(Identifier name, double value) {
+        const std::size_t slot = index_of(name);
+        if (slot >= defined_.size()) {
+            values_.resize(slot + 1, 0.0);
+            defined_.resize(slot + 1, 0);
+        }
+        if (slot >= versions_.size()) {
+            versions_.resize(slot + 1, 0);
+        }
+        count_ += defined_[slot] == 0 ? 1 : 0;
+        defined_[slot] = 1;
+        values_[slot] = value;
+        ++versions_[slot];
+    }
+
+    /** @brief Number of times `name` was assigned or cleared. */
+    std::uint64_t version(Identifier name) const {
+        const std::size_t slot = index_of(name);
+        return slot < versions_.size() ? versions_[slot] : 0;
+    }
+
+    /** @brief Value of a defined variable.
+     *  @throws std::out_of_range if `name` is not defined.
+     */
+    double at(Identifier name) const;
+
+    /** @brief Undefine `name`; does nothing if it is not defined. */
+    void erase(Identifier name);
+
+    bool contains(Identifier name) const { return find(name) != nullptr; }
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    void clear();
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    std::vector<double> values_;
+    std::vector<std::uint8_t> defined_;
+    // Kept across clear(), so a version never repeats.
+    std::vector<std::uint64_t> versions_;
+    std::size_t count_ = 0;
+};
+
+/** @brief Iterates the defined variables as (symbol, value) pairs, in symbol order. */
+class VariableStore::const_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<Identifier, double>;
+    using difference_type = std::ptrdiff_t;
+
+    const_iterator() = default;
+    const_iterator(const VariableStore* store, std::size_t slot) : store_(store), slot_(slot) {
+        skip_undefined();
+    }
+
+    value_type operator*() const {
+        return {static_cast<Identifier>(slot_), store_->values_[slot_]};
+    }
+    const_iterator& operator++() {
+        ++slot_;
+        skip_undefined();
+        return *this;
+    }
+    const_iterator operator++(int) {
+        const_iterator copy = *this;
+        ++*this;
+        return copy;
+    }
+    bool operator==(const const_iterator& other) const { return slot_ == other.slot_; }
+
+private:
+    void skip_undefined() {
+        while (slot_ < store_->defined_.size() && store_->defined_[slot_] == 0) {
+            ++slot_;
+        }
+    }
+
+    const VariableStore* store_ = nullptr;
+    std::size_t slot_ = 0;
+};
+
+inline VariableStore::const_iterator VariableStore::begin() const {
+    return const_iterator{this, 0};
+}
+
+inline VariableStore::const_iterator VariableStore::end() const {
+    return const_iterator{this, defined_.size()};
+}
+
+/** @brief User-defined function data. The body is a canonical node in
+ *  State::dag with its parameters and locals resolved to `frame_size` frame
+ *  slots (see resolve_locals), and `code` is the same body compiled for the
+ *  bytecode engine. Under Engine::Jit, `calls` counts calls until the
+ *  function is hot and `native` then holds `code` translated to machine code;
+ *  redefining the function replaces the whole object, native code included.
+ *  `memo` is set when the function's results are cached (see MemoTable).
+ */
 struct FnObj {
     Identifiers params;
     ExpressionPtr expr;
+    Chunk code;
+    std::uint16_t frame_size = 0;
+    std::uint32_t calls = 0;
+    std::unique_ptr<NativeCode> native;
+    std::unique_ptr<MemoTable> memo;
 };
 
 /** @brief User-defined function table. */
 using UserFnMap = std::unordered_map<Identifier, FnObj>;
 
-/** @brief Built-in function callable signature. */
-using BuiltinFn = std::function<double(std::span<const double>)>;
-
-/** @brief Metadata for built-in functions. */
-struct BuiltinSpec {
-    Identifier name;
-    std::size_t arity;
-    std::string description;
-    BuiltinFn fn;
+/** @brief Evaluation engine used for top-level queries and user function calls. */
+enum class Engine {
+    Tree,      ///< Recursive walk over the AST.
+    Bytecode,  ///< Compile to bytecode and run it on the stack VM.
+    Jit,       ///< Tree walker, with hot user functions compiled to native code.
 };
 
-/** @brief Built-in function registry. */
-using BuiltinMap = std::unordered_map<Identifier, BuiltinSpec>;
+/** @brief Default limit on nested user function calls. */
+constexpr std::size_t kDefaultMaxCallDepth = 10000;
 
-/** @brief Constant registry. */
-using ConstantMap = std::unordered_map<Identifier, double>;
-
-/** @brief REPL evaluation state. */
+/** @brief REPL evaluation state.
+ *
+ *  User function bodies are hash-consed into `dag`, so identical subtrees are
+ *  stored once across all functions. Redefined functions leave their old body
+ *  there until the state is reset, which frees the whole store at once.
+ *
+ *  `bindings` holds the reactive variables, whose values are kept in `vars`.
+ *
+ *  `call_depth` counts the user calls in progress, in any engine. Calls in
+ *  tail position replace their caller's frame instead of nesting, so only
+ *  non-tail recursion approaches `max_call_depth`.
+ *
+ *  `error` is where the tree walker records the first error of the
+ *  evaluation in progress; it is empty between evaluations.
+ */
 struct State {
-    VariableMap vars;
+    VariableStore vars;
     UserFnMap fns;
+    ExpressionDag dag;
+    BindingGraph bindings;
     double last_result = 0.0;
     bool has_last_result = false;
+    Engine engine = Engine::Tree;
+    std::size_t max_call_depth = kDefaultMaxCallDepth;
+    std::size_t call_depth = 0;
+    /** @brief Bumped by every function definition. */
+    std::uint64_t fns_version = 0;
+    Error error;
 };
 
-/** @brief Stream printer for variable maps. */
-std::ostream& operator<<(std::ostream& os, const VariableMap& vars);
+/** @brief Copy of `state` that another thread can evaluate against while
+ *  `state` itself is only read.
+ *
+ *  Variables, functions and settings are copied. Memoized functions get
+ *  empty tables of the same capacity, native code is dropped, and Engine::Jit
+ *  becomes Engine::Tree. Function bodies still point into `state.dag`, so the
+ *  copy must not outlive `state` or be used after a function is redefined.
+ */
+State worker_copy(const State& state);
+
+/** @brief Read-only access to `state` for a thread running compiled bodies
+ *  on its behalf, as a reduction's workers do.
+ *
+ *  Globals, functions and settings are read from `state`, which must not
+ *  change while the view is in use, so views on several threads can share it
+ *  without copying it. Each view counts its own call depth, starting from
+ *  the caller's, and keeps private memo tables (see worker_memo()).
+ */
+struct WorkerView {
+    const State& state;
+    std::size_t call_depth = 0;
+    std::vector<std::pair<const FnObj*, std::unique_ptr<MemoTable>>> memos{};
+};
 
-/** @brief Access built-in function registry. */
-const BuiltinMap& builtin_functions();
+/** @brief `view`'s table for memoized function `fn`: empty, with the
+ *  capacity of `fn.memo`, the first time the view calls `fn`.
+ */
+MemoTable& worker_memo(WorkerView& view, const FnObj& fn);
 
-/** @brief Access built-in constants registry. */
-const ConstantMap& constants();
+/** @brief Error reporting that `state.max_call_depth` was exceeded. */
+Error call_depth_exceeded(const State& state);
 
-/** @brief Whether a name is reserved from assignment. */
-bool is_reserved_identifier(std::string_view name);
+/** @brief Count one nested user function call in `state.call_depth`.
+ *  @return false, counting nothing, if the call would exceed `state.max_call_depth`.
+ */
+inline bool enter_call(State& state) {
+    if (state.call_depth >= state.max_call_depth) {
+        return false;
+    }
+    ++state.call_depth;
+    return true;
+}
+
+/** @brief Count one nested user function call in `view.call_depth`.
+ *  @return false, counting nothing, if the call would exceed the state's limit.
+ */
+inline bool enter_call(WorkerView& view) {
+    if (view.call_depth >= view.state.max_call_depth) {
+        return false;
+    }
+    ++view.call_depth;
+    return true;
+}
+
+/** @brief Counts one nested user function call for the lifetime of the scope,
+ *  if entered() says the call was within the limit.
+ */
+class CallScope {
+public:
+    explicit CallScope(State& state) : state_(state), entered_(enter_call(state)) {}
+    ~CallScope() {
+        if (entered_) {
+            --state_.call_depth;
+        }
+    }
+
+    CallScope(const CallScope&) = delete;
+    CallScope& operator=(const CallScope&) = delete;
+
+    bool entered() const { return entered_; }
+
+private:
+    State& state_;
+    bool entered_;
+};
 
-/** @brief Whether a name matches a built-in function. */
-bool is_builtin_function(std::string_view name);
+/** @brief Stream printer for global variables. */
+std::ostream& operator<<(std::ostream& os, const VariableStore& vars);
 
-/** @brief Whether a name matches a constant. */
-bool is_constant(std::string_view name);
+/** @brief Symbol of the last-result name `_`. */
+Identifier last_result_symbol();
 
 }  // namespace repl
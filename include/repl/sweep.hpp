@@ -0,0 +1,52 @@
+#pragma once
+
+/** @file sweep.hpp
+ *  @brief Parallel evaluation of an expression over a grid of variable values.
+ */
+
+#include <cstddef>
+#include <span>
+
+#include "repl/evaluator.hpp"
+#include "repl/thread_pool.hpp"
+
+namespace repl {
+
+/** @brief Values of one swept variable: `count` evenly spaced points from
+ *  `first` to `last`, both included.
+ */
+struct SweepRange {
+    Identifier name;
+    double first;
+    double last;
+    std::size_t count;
+
+    /** @brief Point `index`; the last point is exactly `last`. */
+    double at(std::size_t index) const {
+        if (index + 1 >= count) {
+            return index == 0 ? first : last;
+        }
+        return first + (last - first) / static_cast<double>(count - 1) * static_cast<double>(index);
+    }
+};
+
+/** @brief Rows sweep() hands to a worker at a time. */
+constexpr std::size_t kSweepChunk = 4096;
+
+/** @brief Evaluate an optimized expression at every point of the grid spanned by `ranges`.
+ *
+ *  Rows are the points in row-major order: the last range varies fastest, so
+ *  row `i * ranges[1].count + j` of a two-range sweep binds `ranges[0].at(i)`
+ *  and `ranges[1].at(j)`. With no ranges there is one row.
+ *
+ *  The grid is cut into chunks of kSweepChunk rows, which the pool's workers
+ *  take in order and steal from each other; each chunk runs through
+ *  evaluate_batch(). `state` is only read: every worker evaluates against its
+ *  own worker_copy() of it. Results and errors are in row order and do not
+ *  depend on the number of workers.
+ *  @throws EvalError if a name repeats or the grid has more rows than fit in memory.
+ */
+BatchResult sweep(const Expression& expr, std::span<const SweepRange> ranges, const State& state,
+                  ThreadPool& pool = shared_pool());
+
+}  // namespace repl
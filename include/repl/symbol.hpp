@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace repl {
+
+/** @brief Dense interned identifier ID. IDs are assigned from 0 upwards. */
+enum class Symbol : std::uint32_t {};
+
+/** @brief Intern table mapping identifier names to dense symbol IDs.
+ *
+ *  Each distinct name is stored once; IDs and returned names stay valid for
+ *  the lifetime of the table. Interning is not thread-safe.
+ */
+class SymbolTable {
+public:
+    /** @brief Return the ID for a name, interning it on first use. */
+    Symbol intern(std::string_view name);
+    /** @brief Look up a name without interning it. */
+    std::optional<Symbol> find(std::string_view name) const;
+    /** @brief Name of an interned symbol. */
+    std::string_view name(Symbol symbol) const;
+    /** @brief Number of interned symbols. */
+    std::size_t size() const { return names_.size(); }
+
+private:
+    // Deque elements never move, so the views used as keys stay valid.
+    std::deque<std::string> names_;
+    std::unordered_map<std::string_view, Symbol> ids_;
+};
+
+/** @brief Session-wide symbol table shared by the tokenizer and state. */
+SymbolTable& symbols();
+
+/** @brief Intern a name in the session-wide symbol table. */
+inline Symbol intern(std::string_view name) {
+    return symbols().intern(name);
+}
+
+/** @brief Display name of a symbol from the session-wide symbol table. */
+inline std::string_view symbol_name(Symbol symbol) {
+    return symbols().name(symbol);
+}
+
+/** @brief Integer index of a symbol, for dense tables keyed by symbol. */
+constexpr std::size_t index_of(Symbol symbol) {
+    return static_cast<std::size_t>(symbol);
+}
+
+}  // namespace repl
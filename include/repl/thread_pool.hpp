@@ -0,0 +1,83 @@
+#pragma once
+
+/** @file thread_pool.hpp
+ *  @brief Work-stealing thread pool for data-parallel loops.
+ *
+ *  run() splits a loop's task indices into one contiguous range per worker.
+ *  A worker takes tasks from the front of its own range, in order, and when
+ *  that is empty steals the back half of another worker's range, so
+ *  uneven tasks balance out without a shared queue. The calling thread works
+ *  too, as worker 0.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace repl {
+
+class ThreadPool {
+public:
+    /** @brief Task body: `(task, worker)`, with `worker` in [0, size()). */
+    using Body = std::function<void(std::size_t task, std::size_t worker)>;
+
+    /** @brief Pool with `workers` workers, the caller included; 0 means one per
+     *  hardware thread.
+     */
+    explicit ThreadPool(std::size_t workers = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** @brief Number of workers, the calling thread included. */
+    std::size_t size() const { return queues_.size(); }
+
+    /** @brief Call `body` once for every task in [0, count) and wait for all of them.
+     *
+     *  Calls from inside a task, or from a second thread while a loop is
+     *  running, run their tasks serially on the calling thread as worker 0.
+     *  If a task throws, the remaining tasks are skipped and the first
+     *  exception is rethrown here.
+     */
+    void run(std::size_t count, const Body& body);
+
+private:
+    /** @brief Tasks [begin, end) not yet taken from one worker's share. */
+    struct Queue {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    void work(std::size_t worker);
+    bool take(std::size_t worker, std::size_t& task);
+    bool steal(std::size_t worker);
+    void worker_loop(std::size_t worker);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    std::size_t generation_ = 0;
+    std::size_t finished_ = 0;
+    bool stopping_ = false;
+
+    const Body* body_ = nullptr;
+    std::exception_ptr error_;
+    std::atomic<bool> failed_ = false;
+};
+
+/** @brief Process-wide pool with one worker per hardware thread, created on first use. */
+ThreadPool& shared_pool();
+
+}  // namespace repl
@@ -1,16 +1,21 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <expected>
 #include <ostream>
 #include <string>
 #include <string_view>
-#include <variant>
+#include <type_traits>
 #include <vector>
 
+#include "repl/errors.hpp"
+#include "repl/symbol.hpp"
+
 namespace repl {
 
 /** @brief Token categories produced by the tokenizer/lexer. */
-enum class TType {
+enum class TType : std::uint8_t {
     Number,
     Identifier,
     Plus,
@@ -30,32 +35,60 @@ enum class TType {
     GreaterEqual,
     Question,
     Colon,
+    ColonEquals,
     Comma,
 };
 
-/** @brief Identifier string type for variables and functions. */
-using Identifier = std::string;
+/** @brief Interned identifier type for variables and functions. */
+using Identifier = Symbol;
 /** @brief Parameter list type for user-defined functions. */
 using Identifiers = std::vector<Identifier>;
 
-/** @brief Represents a single token with optional payload. */
+/** @brief Compact token: type, source span, and inline payload.
+ *
+ *  Numbers carry their value and identifiers their interned symbol. Tokens do
+ *  not own any text; the source slice is available through Tokens::text.
+ */
 struct Token {
     TType type;
-    std::variant<std::monostate, double, Identifier> data;
+    std::uint16_t length;
+    std::uint32_t offset;
+    union {
+        double number;
+        Identifier symbol;
+    };
+};
 
-    /** @brief Create a numeric token. */
-    static Token number(double value);
-    /** @brief Create an identifier token. */
-    static Token identifier(Identifier name);
+static_assert(sizeof(Token) == 16);
+static_assert(std::is_trivially_copyable_v<Token>);
 
-    template <typename T>
-    const T& get() const {
-        return std::get<T>(data);
+/** @brief Token sequence produced by the lexer, plus the source it slices. */
+class Tokens {
+public:
+    Tokens() = default;
+    explicit Tokens(std::string_view source) : source_(source) {}
+
+    /** @brief Source text the tokens refer to. */
+    std::string_view source() const { return source_; }
+    /** @brief Source text covered by a token. */
+    std::string_view text(const Token& token) const {
+        return source_.substr(token.offset, token.length);
     }
-};
 
-/** @brief Token sequence produced by the lexer. */
-using Tokens = std::vector<Token>;
+    void reserve(std::size_t count) { tokens_.reserve(count); }
+    void push_back(const Token& token) { tokens_.push_back(token); }
+
+    std::size_t size() const { return tokens_.size(); }
+    bool empty() const { return tokens_.empty(); }
+    const Token& operator[](std::size_t index) const { return tokens_[index]; }
+    const Token& front() const { return tokens_.front(); }
+    std::vector<Token>::const_iterator begin() const { return tokens_.begin(); }
+    std::vector<Token>::const_iterator end() const { return tokens_.end(); }
+
+private:
+    std::string_view source_;
+    std::vector<Token> tokens_;
+};
 
 /** @brief Convert a token type to a display name. */
 std::string_view to_string(TType type);
@@ -64,36 +97,99 @@ std::ostream& operator<<(std::ostream& os, TType type);
 std::ostream& operator<<(std::ostream& os, const Token& token);
 std::ostream& operator<<(std::ostream& os, const Tokens& tokens);
 
+/** @brief On-demand lexer producing one token at a time from a source buffer.
+ *
+ *  The lexer borrows `input`, which must outlive it, and never allocates
+ *  apart from first-time identifier interning. Invalid input ends the token
+ *  sequence early and leaves the reason in error().
+ */
+class Lexer {
+public:
+    explicit Lexer(std::string_view input);
+
+    /** @brief Lex the next token into `token`; false at end of input or on an error. */
+    bool next(Token& token);
+    /** @brief Like next(), but skips number conversion and interning. */
+    bool skip(Token& token);
+
+    /** @brief Source text being lexed. */
+    std::string_view source() const { return input_; }
+    /** @brief Why lexing stopped before the end of the input; empty if it did not. */
+    const Error& error() const { return error_; }
+
+private:
+    template <bool Convert>
+    bool scan(Token& token);
+    bool scan_number(std::size_t start);
+    bool emit(Token& token, TType type, std::size_t start);
+    /** @brief Record `error` and end the token sequence; returns false. */
+    bool fail(const Error& error);
+    bool at(std::size_t pos, char expected) const {
+        return pos < input_.size() && input_[pos] == expected;
+    }
+
+    std::string_view input_;
+    std::size_t pos_;
+    Error error_;
+};
+
 /** @brief Tokenize a source string into tokens.
- *  @throws ParseError on unknown characters.
+ *
+ *  The result borrows `input`, which must outlive it. Identifiers are interned
+ *  into the session symbol table. Apart from first-time interning, tokenizing
+ *  performs a single right-sized allocation for the token buffer.
+ *  @return The tokens, or the first invalid token's error.
+ */
+std::expected<Tokens, Error> try_tokenize(std::string_view input);
+
+/** @brief try_tokenize() for callers that handle errors as exceptions.
+ *  @throws ParseError on invalid input.
  */
 Tokens tokenize(std::string_view input);
 
-/** @brief Lightweight stream for parsing tokens. */
+/** @brief Token stream for the parser, backed by a token buffer or a lexer.
+ *
+ *  A stream built from source text lexes on demand, one token ahead of the
+ *  parser, so no intermediate token buffer is materialized. Invalid input
+ *  makes the stream end where it starts, with the reason in error().
+ */
 class TokenStream {
 public:
     explicit TokenStream(const Tokens& tokens);
+    /** @brief Stream that lexes `source` lazily; `source` must outlive it. */
+    explicit TokenStream(std::string_view source);
 
-    /** @brief Peek at the current token without consuming it. */
+    /** @brief Peek at the current token without consuming it.
+     *  @throws ParseError if lexing failed here, std::underflow_error at the end.
+     */
     const Token& peek() const;
-    /** @brief Consume and return the current token. */
-    const Token& get();
+    /** @brief Consume and return the current token; throws as peek() does. */
+    Token get();
     /** @brief Consume the token if it matches the expected type. */
     bool match(TType type);
     /** @brief Consume the token or throw if it does not match.
      *  @throws std::underflow_error if the stream is empty.
      *  @throws ParseError if the type does not match.
      */
-    const Token& expect(TType type);
+    Token expect(TType type);
+    /** @brief Source text the stream's tokens refer to. */
+    std::string_view source() const;
+    /** @brief Source text covered by a token from this stream. */
+    std::string_view text(const Token& token) const;
 
-    /** @brief Remaining token count. */
-    std::size_t remaining() const;
-    /** @brief Whether the stream is exhausted. */
+    /** @brief Whether the stream is exhausted, at the end or at invalid input. */
     bool empty() const;
+    /** @brief Why a lexing stream ended before the end of its source; empty if it did not. */
+    const Error& error() const { return lexer_.error(); }
 
 private:
-    const Tokens& tokens_;
-    std::size_t pos_;
+    bool fill() const;
+
+    const Tokens* tokens_;
+    std::size_t index_;
+    mutable Lexer lexer_;
+    mutable Token lookahead_;
+    mutable bool has_lookahead_;
 };
 
 }  // namespace repl
@@ -0,0 +1,106 @@
+#include "repl/arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace repl {
+
+struct Arena::Block {
+    Block* next;
+    std::size_t size;
+
+    std::byte* begin() { return reinterpret_cast<std::byte*>(this + 1); }
+    std::byte* end() { return begin() + size; }
+};
+
+Arena::Arena(std::size_t first_block_size) : next_block_size_(first_block_size) {}
+
+Arena::~Arena() {
+    release();
+}
+
+Arena::Arena(Arena&& other) noexcept
+    : head_(std::exchange(other.head_, nullptr)),
+      current_(std::exchange(other.current_, nullptr)),
+      cursor_(std::exchange(other.cursor_, nullptr)),
+      limit_(std::exchange(other.limit_, nullptr)),
+      next_block_size_(other.next_block_size_),
+      capacity_(std::exchange(other.capacity_, 0)) {}
+
+Arena& Arena::operator=(Arena&& other) noexcept {
+    if (this != &other) {
+        release();
+        head_ = std::exchange(other.head_, nullptr);
+        current_ = std::exchange(other.current_, nullptr);
+        cursor_ = std::exchange(other.cursor_, nullptr);
+        limit_ = std::exchange(other.limit_, nullptr);
+        next_block_size_ = other.next_block_size_;
+        capacity_ = std::exchange(other.capacity_, 0);
+    }
+    return *this;
+}
+
+void Arena::enter(Block* block) {
+    current_ = block;
+    cursor_ = block->begin();
+    limit_ = block->end();
+}
+
+void* Arena::allocate_slow(std::size_t size, std::size_t alignment) {
+    // Move on to blocks kept by an earlier reset() before allocating a new one.
+    while (current_ && current_->next) {
+        enter(current_->next);
+        auto address = reinterpret_cast<std::uintptr_t>(cursor_);
+        auto aligned = (address + alignment - 1) & ~(std::uintptr_t{alignment} - 1);
+        if (aligned + size <= reinterpret_cast<std::uintptr_t>(limit_)) {
+            cursor_ = reinterpret_cast<std::byte*>(aligned + size);
+            return reinterpret_cast<void*>(aligned);
+        }
+    }
+
+    const std::size_t payload = std::max(next_block_size_, size + alignment);
+    void* raw = ::operator new(sizeof(Block) + payload);
+    auto* block = ::new (raw) Block{nullptr, payload};
+    if (current_) {
+        current_->next = block;
+    } else {
+        head_ = block;
+    }
+    capacity_ += payload;
+    next_block_size_ = std::min(next_block_size_ * 2, std::max(kMaxBlockSize, next_block_size_));
+    enter(block);
+    return allocate(size, alignment);
+}
+
+void Arena::reset() {
+    if (head_) {
+        enter(head_);
+    }
+}
+
+bool Arena::owns(const void* address) const {
+    const auto at = reinterpret_cast<std::uintptr_t>(address);
+    for (Block* block = head_; block; block = block->next) {
+        if (at >= reinterpret_cast<std::uintptr_t>(block->begin())
+            && at < reinterpret_cast<std::uintptr_t>(block->end())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Arena::release() {
+    Block* block = head_;
+    while (block) {
+        Block* next = block->next;
+        ::operator delete(block);
+        block = next;
+    }
+    head_ = nullptr;
+    current_ = nullptr;
+    cursor_ = nullptr;
+    limit_ = nullptr;
+    capacity_ = 0;
+}
+
+}  // namespace repl
@@ -0,0 +1,600 @@
+#include "repl/evaluator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <unordered_map>
+
+#include "repl/optimize.hpp"
+#include "repl/reactive.hpp"
+#include "repl/reduce.hpp"
+#include "repl/registry.hpp"
+
+namespace repl {
+
+namespace {
+
+/** @brief One value per lane of a chunk. */
+using Lanes = std::array<double, kBatchLanes>;
+/** @brief One bit per lane of a chunk. */
+using Mask = std::uint64_t;
+
+static_assert(kBatchLanes == std::numeric_limits<Mask>::digits);
+
+/** @brief Lanes per stack segment; a larger frame gets a segment of its own. */
+constexpr std::size_t kLaneSegmentSize = 256;
+
+/** @brief Nested user calls evaluated across lanes before the rest run per row. */
+constexpr std::size_t kBatchCallDepth = 16;
+
+/** @brief Frame of a user function evaluated across lanes; null slots at top level.
+ *
+ *  `live[slot]` marks the lanes in which an assigned local has been written;
+ *  parameters are live in every lane.
+ */
+struct BatchFrame {
+    Lanes* slots = nullptr;
+    Mask* live = nullptr;
+};
+
+/** @brief Temporaries and frames of a batch, carved from segments that never move. */
+class LaneStack {
+public:
+    struct Mark {
+        std::size_t segment = 0;
+        std::size_t top = 0;
+    };
+
+    Mark mark() const { return Mark{segment_, top_}; }
+    void release(Mark mark) {
+        segment_ = mark.segment;
+        top_ = mark.top;
+    }
+
+    /** @brief Push `size` columns of lanes, each with a mask. */
+    BatchFrame allocate(std::size_t size) {
+        if (segment_ == segments_.size() || top_ + size > segments_[segment_].lanes.size()) {
+            if (segment_ < segments_.size()) {
+                ++segment_;
+            }
+            if (segment_ == segments_.size()) {
+                segments_.emplace_back();
+            }
+            Segment& segment = segments_[segment_];
+            if (segment.lanes.size() < size) {
+                segment.lanes.resize(std::max(size, kLaneSegmentSize));
+                segment.live.resize(segment.lanes.size());
+            }
+            top_ = 0;
+        }
+        Segment& segment = segments_[segment_];
+        BatchFrame frame{segment.lanes.data() + top_, segment.live.data() + top_};
+        top_ += size;
+        return frame;
+    }
+
+    Lanes& temporary() { return *allocate(1).slots; }
+
+private:
+    struct Segment {
+        std::vector<Lanes> lanes;
+        std::vector<Mask> live;
+    };
+
+    std::vector<Segment> segments_;
+    std::size_t segment_ = 0;
+    std::size_t top_ = 0;
+};
+
+/** @brief Releases everything allocated on a LaneStack during the scope. */
+class LaneScope {
+public:
+    explicit LaneScope(LaneStack& stack) : stack_(stack), mark_(stack.mark()) {}
+    ~LaneScope() { stack_.release(mark_); }
+
+    LaneScope(const LaneScope&) = delete;
+    LaneScope& operator=(const LaneScope&) = delete;
+
+private:
+    LaneStack& stack_;
+    LaneStack::Mark mark_;
+};
+
+Mask bit(std::size_t lane) {
+    return Mask{1} << lane;
+}
+
+/** @brief Call `visit` with the index of each lane in `mask`, lowest first. */
+template <typename Visit>
+void for_each_lane(Mask mask, Visit visit) {
+    while (mask != 0) {
+        visit(static_cast<std::size_t>(std::countr_zero(mask)));
+        mask &= mask - 1;
+    }
+}
+
+/** @brief Lanes of `mask` whose value is zero. */
+Mask zero_lanes(const Lanes& values, Mask mask) {
+    Mask zero = 0;
+    for (std::size_t lane = 0; lane < kBatchLanes; ++lane) {
+        zero |= static_cast<Mask>(values[lane] == 0.0) << lane;
+    }
+    return zero & mask;
+}
+
+/** @brief Lanes of `mask` whose value is NaN or infinite. */
+Mask non_finite_lanes(const Lanes& values, Mask mask) {
+    Mask bad = 0;
+    for (std::size_t lane = 0; lane < kBatchLanes; ++lane) {
+        bad |= static_cast<Mask>(!std::isfinite(values[lane])) << lane;
+    }
+    return bad & mask;
+}
+
+/** @brief Evaluates one expression over chunks of rows.
+ *
+ *  Each eval() takes the lanes still running and returns those that finished
+ *  the node without error. A lane that fails is recorded with its message
+ *  and left out of every later step of the chunk, so evaluation order, and
+ *  therefore which error a row reports, matches the scalar walker.
+ */
+class Batch {
+public:
+    Batch(std::span<const BatchColumn> columns, State& state, BatchResult& result)
+        : columns_(columns), state_(state), result_(result) {
+        for (const BatchColumn& column : columns) {
+            column_names_.push_back(column.name);
+        }
+    }
+
+    /** @brief Evaluate rows [begin, begin + count) of `expr`, count <= kBatchLanes. */
+    void run(const Expression& expr, std::size_t begin, std::size_t count) {
+        begin_ = begin;
+        count_ = count;
+        failed_ = 0;
+        LaneScope scope{stack_};
+        Lanes& out = stack_.temporary();
+        const Mask rows = count == kBatchLanes ? ~Mask{0} : bit(count) - 1;
+        const Mask done = eval(expr, out, rows, BatchFrame{}, false);
+        for (std::size_t lane = 0; lane < count; ++lane) {
+            result_.values[begin + lane] =
+                (done & bit(lane)) != 0 ? out[lane] : std::numeric_limits<double>::quiet_NaN();
+        }
+        for_each_lane(failed_, [&](std::size_t lane) {
+            result_.errors.push_back(BatchError{begin + lane, errors_[lane]});
+        });
+    }
+
+private:
+    Mask eval(const Expression& expr, Lanes& out, Mask active, const BatchFrame& frame,
+              bool tail) {
+        switch (expr.type) {
+            case EType::Number:
+                out.fill(expr.get<double>());
+                return active;
+            case EType::Variable:
+                return load_variable(expr.get<Identifier>(), out, active);
+            case EType::Local: {
+                const auto& node = expr.get<LocalNode>();
+                return load_local(node.name, node.slot, out, active, frame);
+            }
+            case EType::Unary: {
+                const auto& node = expr.get<UnaryNode>();
+                const Mask done = eval(*node.right, out, active, frame, false);
+                if (node.op == TType::Minus) {
+                    for (double& value : out) {
+                        value = -value;
+                    }
+                }
+                return done;
+            }
+            case EType::Binary:
+                return eval_binary(expr.get<BinaryNode>(), out, active, frame);
+            case EType::FnCall:
+                return eval_call(expr.get<FnNode>(), out, active, frame, tail);
+            case EType::Builtin:
+                return eval_builtin(expr.get<BuiltinNode>(), out, active, frame);
+            case EType::Ternary:
+                return eval_ternary(expr.get<TernaryNode>(), out, active, frame, tail);
+            case EType::Power:
+                return eval_power(expr.get<PowerNode>(), out, active, frame);
+            case EType::Polynomial:
+                return eval_polynomial(expr.get<PolyNode>(), out, active, frame);
+            case EType::Reduce:
+                return eval_reduce(expr.get<ReduceNode>(), out, active, frame);
+        }
+        return fail(active, "Invalid expression type");
+    }
+
+    Mask load_variable(Identifier name, Lanes& out, Mask active) {
+        if (name == last_result_symbol()) {
+            if (!state_.has_last_result) {
+                return fail(active, "No previous result available for '_'");
+            }
+            out.fill(state_.last_result);
+            return active;
+        }
+        for (const BatchColumn& column : columns_) {
+            if (column.name == name) {
+                std::copy_n(column.values.begin() + static_cast<std::ptrdiff_t>(begin_), count_,
+                            out.begin());
+                std::fill(out.begin() + static_cast<std::ptrdiff_t>(count_), out.end(), 0.0);
+                return active;
+            }
+        }
+        const double* value = state_.vars.find(name);
+        if (!value) {
+            value = find_constant(name);
+        }
+        if (!value) {
+            return fail(active, std::format("Variable '{}' not defined", symbol_name(name)));
+        }
+        out.fill(*value);
+        return active;
+    }
+
+    Mask load_local(Identifier name, std::uint16_t slot, Lanes& out, Mask active,
+                    const BatchFrame& frame) {
+        out = frame.slots[slot];
+        // An assigned local read before its first assignment falls back to the global.
+        const Mask unset = active & ~frame.live[slot];
+        if (unset == 0) {
+            return active;
+        }
+        const double* value = state_.vars.find(name);
+        if (!value) {
+            return active &
+                   ~fail(unset, std::format("Variable '{}' not defined", symbol_name(name)));
+        }
+        for_each_lane(unset, [&](std::size_t lane) { out[lane] = *value; });
+        return active;
+    }
+
+    Mask eval_binary(const BinaryNode& node, Lanes& out, Mask active, const BatchFrame& frame) {
+        if (node.op == TType::Equals) {
+            return assign(node, out, active, frame);
+        }
+        LaneScope scope{stack_};
+        Lanes& rhs = stack_.temporary();
+        Mask done = active;
+        if (node.op == TType::Slash || node.op == TType::Percent) {
+            // The divisor is evaluated and checked first, as in the scalar walker.
+            done = eval(*node.right, rhs, done, frame, false);
+            const Mask zero = zero_lanes(rhs, done);
+            if (zero != 0) {
+                done &= ~fail(zero, node.op == TType::Slash ? "Division by zero"
+                                                            : "Modulo by zero");
+            }
+            done = done != 0 ? eval(*node.left, out, done, frame, false) : 0;
+        } else {
+            done = eval(*node.left, out, done, frame, false);
+            done = done != 0 ? eval(*node.right, rhs, done, frame, false) : 0;
+        }
+        apply(node.op, out, rhs);
+        if (node.op == TType::Caret) {
+            done &= ~fail(non_finite_lanes(out, done), "Domain error in '^'");
+        }
+        return done;
+    }
+
+    /** @brief out = out `op` rhs in every lane; one loop per operator, so each vectorizes. */
+    static void apply(TType op, Lanes& out, const Lanes& rhs) {
+        switch (op) {
+            case TType::Plus:
+                return combine(out, rhs, [](double a, double b) { return a + b; });
+            case TType::Minus:
+                return combine(out, rhs, [](double a, double b) { return a - b; });
+            case TType::Star:
+                return combine(out, rhs, [](double a, double b) { return a * b; });
+            case TType::Slash:
+                return combine(out, rhs, [](double a, double b) { return a / b; });
+            case TType::Percent:
+                return combine(out, rhs, [](double a, double b) { return std::fmod(a, b); });
+            case TType::Caret:
+                return combine(out, rhs, [](double a, double b) { return std::pow(a, b); });
+            case TType::Less:
+                return combine(out, rhs,
+                               [](double a, double b) -> double { return a < b; });
+            case TType::LessEqual:
+                return combine(out, rhs,
+                               [](double a, double b) -> double { return a <= b; });
+            case TType::Greater:
+                return combine(out, rhs,
+                               [](double a, double b) -> double { return a > b; });
+            case TType::GreaterEqual:
+                return combine(out, rhs,
+                               [](double a, double b) -> double { return a >= b; });
+            case TType::EqualEqual:
+                return combine(out, rhs,
+                               [](double a, double b) -> double { return a == b; });
+            case TType::BangEqual:
+                return combine(out, rhs,
+                               [](double a, double b) -> double { return a != b; });
+            default:
+                return;
+        }
+    }
+
+    template <typename Op>
+    static void combine(Lanes& out, const Lanes& rhs, Op op) {
+        for (std::size_t lane = 0; lane < kBatchLanes; ++lane) {
+            out[lane] = op(out[lane], rhs[lane]);
+        }
+    }
+
+    /** @brief Assignments write frame slots; globals are never written. */
+    Mask assign(const BinaryNode& node, Lanes& out, Mask active, const BatchFrame& frame) {
+        if (node.left->type == EType::Local) {
+            const std::uint16_t slot = node.left->get<LocalNode>().slot;
+            const Mask done = eval(*node.right, out, active, frame, false);
+            Lanes& target = frame.slots[slot];
+            for_each_lane(done, [&](std::size_t lane) { target[lane] = out[lane]; });
+            frame.live[slot] |= done;
+            return done;
+        }
+        if (node.left->type != EType::Variable) {
+            return fail(active, "Left side of '=' must be a variable name");
+        }
+        return fail(active, std::format("Variable '{}' cannot be assigned in a batch",
+                                        symbol_name(node.left->get<Identifier>())));
+    }
+
+    Mask eval_builtin(const BuiltinNode& node, Lanes& out, Mask active, const BatchFrame& frame) {
+        LaneScope scope{stack_};
+        Mask done = eval(*node.args[0], out, active, frame, false);
+        if (node.args[1]) {
+            Lanes& second = stack_.temporary();
+            done = done != 0 ? eval(*node.args[1], second, done, frame, false) : 0;
+            return apply_builtin(*node.spec, out, &second, out, done);
+        }
+        return apply_builtin(*node.spec, out, nullptr, out, done);
+    }
+
+    Mask apply_builtin(const BuiltinSpec& spec, const Lanes& first, const Lanes* second,
+                       Lanes& out, Mask active) {
+        if (second) {
+            spec.binary_array(first.data(), second->data(), out.data(), kBatchLanes);
+        } else {
+            spec.unary_array(first.data(), out.data(), kBatchLanes);
+        }
+        return active & ~fail(non_finite_lanes(out, active),
+                              std::format("Domain error in function '{}'", spec.name));
+    }
+
+    Mask eval_ternary(const TernaryNode& node, Lanes& out, Mask active, const BatchFrame& frame,
+                      bool tail) {
+        LaneScope scope{stack_};
+        Lanes& condition = stack_.temporary();
+        const Mask decided = eval(*node.condition, condition, active, frame, false);
+        const Mask otherwise = zero_lanes(condition, decided);
+        const Mask then = decided & ~otherwise;
+        Mask done = then != 0 ? eval(*node.then_branch, out, then, frame, tail) : 0;
+        if (otherwise != 0) {
+            Lanes& other = stack_.temporary();
+            const Mask rest = eval(*node.else_branch, other, otherwise, frame, tail);
+            for (std::size_t lane = 0; lane < kBatchLanes; ++lane) {
+                out[lane] = condition[lane] != 0.0 ? out[lane] : other[lane];
+            }
+            done |= rest;
+        }
+        return done;
+    }
+
+    Mask eval_power(const PowerNode& node, Lanes& out, Mask active, const BatchFrame& frame) {
+        const Mask done = eval(*node.base, out, active, frame, false);
+        if (node.kind == PowerNode::Kind::SquareRoot) {
+            for (double& value : out) {
+                value = square_root(value);
+            }
+        } else {
+            for (double& value : out) {
+                value = integer_power(value, node.exponent);
+            }
+        }
+        return done & ~fail(non_finite_lanes(out, done), "Domain error in '^'");
+    }
+
+    Mask eval_polynomial(const PolyNode& node, Lanes& out, Mask active, const BatchFrame& frame) {
+        LaneScope scope{stack_};
+        Lanes& x = stack_.temporary();
+        const Mask done = node.slot == kNoSlot
+                              ? load_variable(node.variable, x, active)
+                              : load_local(node.variable, node.slot, x, active, frame);
+        Mask outside = 0;
+        for (std::size_t lane = 0; lane < kBatchLanes; ++lane) {
+            outside |= static_cast<Mask>(!(std::fabs(x[lane]) <= node.limit())) << lane;
+            out[lane] = horner(node.coefficients, node.degree, x[lane]);
+        }
+        outside &= done;
+        if (outside == 0) {
+            return done;
+        }
+        Lanes& fallback = stack_.temporary();
+        const Mask rest = eval(*node.fallback, fallback, outside, frame, false);
+        for_each_lane(outside, [&](std::size_t lane) { out[lane] = fallback[lane]; });
+        return (done & ~outside) | rest;
+    }
+
+    Mask eval_call(const FnNode& node, Lanes& out, Mask active, const BatchFrame& frame,
+                   bool tail) {
+        if (const BuiltinSpec* spec = find_builtin(node.name)) {
+            if (node.args.size() != spec->arity) {
+                return fail(active, std::format("Function '{}' expects {} arguments, got {}",
+                                                symbol_name(node.name), spec->arity,
+                                                node.args.size()));
+            }
+            LaneScope scope{stack_};
+            Lanes* second = spec->arity == 2 ? &stack_.temporary() : nullptr;
+            Mask done = eval(*node.args[0], out, active, frame, false);
+            if (second) {
+                done = done != 0 ? eval(*node.args[1], *second, done, frame, false) : 0;
+            }
+            return apply_builtin(*spec, out, second, out, done);
+        }
+
+        auto it = state_.fns.find(node.name);
+        if (it == state_.fns.end()) {
+            return fail(active,
+                        std::format("Function '{}' not defined", symbol_name(node.name)));
+        }
+        FnObj& fn = it->second;
+        if (node.args.size() != fn.params.size()) {
+            return fail(active, std::format("Function '{}' expects {} arguments, got {}",
+                                            symbol_name(node.name), fn.params.size(),
+                                            node.args.size()));
+        }
+
+        LaneScope scope{stack_};
+        const BatchFrame callee = stack_.allocate(fn.frame_size);
+        const std::size_t param_count = fn.params.size();
+        Mask done = active;
+        for (std::size_t index = 0; index < param_count && done != 0; ++index) {
+            done = eval(*node.args[index], callee.slots[index], done, frame, false);
+        }
+        if (done == 0) {
+            return 0;
+        }
+        if (fn.memo || depth_ >= kBatchCallDepth) {
+            return call_per_row(fn, callee, out, done);
+        }
+
+        std::fill(callee.live, callee.live + param_count, ~Mask{0});
+        std::fill(callee.live + param_count, callee.live + fn.frame_size, Mask{0});
+        // A call in tail position does not count toward the depth, as in the walker.
+        if (!tail) {
+            if (state_.call_depth >= state_.max_call_depth) {
+                return fail(done, std::format("Maximum call depth of {} exceeded",
+                                              state_.max_call_depth));
+            }
+            ++state_.call_depth;
+        }
+        ++depth_;
+        done = eval(*fn.expr, out, done, callee, true);
+        --depth_;
+        if (!tail) {
+            --state_.call_depth;
+        }
+        return done;
+    }
+
+    /** @brief Evaluate the bounds and bound captures across lanes, then run
+     *  the reduction once per lane. Captures of a column take its value.
+     */
+    Mask eval_reduce(const ReduceNode& node, Lanes& out, Mask active, const BatchFrame& frame) {
+        LaneScope scope{stack_};
+        std::vector<const Expression*> inputs{node.lower(), node.upper()};
+        for (ExpressionPtr capture : node.captures()) {
+            if (is_bound_capture(*capture, column_names_)) {
+                inputs.push_back(capture);
+            }
+        }
+        const BatchFrame values = stack_.allocate(inputs.size());
+        Mask done = active;
+        for (std::size_t index = 0; index < inputs.size() && done != 0; ++index) {
+            done = eval(*inputs[index], values.slots[index], done, frame, false);
+        }
+        std::vector<double> row(inputs.size());
+        for_each_lane(done, [&](std::size_t lane) {
+            for (std::size_t index = 0; index < row.size(); ++index) {
+                row[index] = values.slots[index][lane];
+            }
+            const auto value = try_reduce(node, row.data(), state_, column_names_);
+            if (value) {
+                out[lane] = *value;
+            } else {
+                done &= ~fail(bit(lane), format_error(value.error()));
+            }
+        });
+        return done;
+    }
+
+    /** @brief Call `fn` through the scalar walker for each lane of `active`. */
+    Mask call_per_row(FnObj& fn, const BatchFrame& args, Lanes& out, Mask active) {
+        std::vector<double> row(fn.params.size());
+        for_each_lane(active, [&](std::size_t lane) {
+            for (std::size_t index = 0; index < row.size(); ++index) {
+                row[index] = args.slots[index][lane];
+            }
+            CallScope call{state_};
+            if (!call.entered()) {
+                active &= ~fail(bit(lane), format_error(call_depth_exceeded(state_)));
+                return;
+            }
+            const auto value = call_function(fn, row.data(), state_);
+            if (value) {
+                out[lane] = *value;
+            } else {
+                active &= ~fail(bit(lane), format_error(value.error()));
+            }
+        });
+        return active;
+    }
+
+    /** @brief Record `message` for the lanes of `lanes`; returns `lanes`. */
+    Mask fail(Mask lanes, std::string_view message) {
+        if (lanes == 0) {
+            return 0;
+        }
+        auto [it, inserted] = message_ids_.try_emplace(
+            std::string{message}, static_cast<std::uint32_t>(result_.messages.size()));
+        if (inserted) {
+            result_.messages.emplace_back(message);
+        }
+        for_each_lane(lanes, [&](std::size_t lane) { errors_[lane] = it->second; });
+        failed_ |= lanes;
+        return lanes;
+    }
+
+    std::span<const BatchColumn> columns_;
+    Identifiers column_names_;
+    State& state_;
+    BatchResult& result_;
+    LaneStack stack_;
+    std::unordered_map<std::string, std::uint32_t> message_ids_;
+    std::array<std::uint32_t, kBatchLanes> errors_{};
+    Mask failed_ = 0;
+    std::size_t begin_ = 0;
+    std::size_t count_ = 0;
+    /** @brief User calls evaluated across lanes that enclose the current node. */
+    std::size_t depth_ = 0;
+};
+
+}  // namespace
+
+BatchResult evaluate_batch(const Expression& expr, std::span<const BatchColumn> columns,
+                           State& state) {
+    if (is_binding(expr)) {
+        throw EvalError("Reactive bindings cannot be evaluated in a batch");
+    }
+    const std::size_t rows = columns.empty() ? 1 : columns.front().values.size();
+    for (std::size_t index = 0; index < columns.size(); ++index) {
+        if (columns[index].values.size() != rows) {
+            throw EvalError("Batch columns must have the same length");
+        }
+        for (std::size_t other = 0; other < index; ++other) {
+            if (columns[other].name == columns[index].name) {
+                throw EvalError(std::format("Duplicate batch column '{}'",
+                                            symbol_name(columns[index].name)));
+            }
+        }
+    }
+
+    BatchResult result;
+    result.values.resize(rows);
+    Batch batch{columns, state, result};
+    const std::size_t depth = state.call_depth;
+    try {
+        for (std::size_t begin = 0; begin < rows; begin += kBatchLanes) {
+            batch.run(expr, begin, std::min(kBatchLanes, rows - begin));
+        }
+    } catch (...) {
+        state.call_depth = depth;
+        throw;
+    }
+    return result;
+}
+
+}  // namespace repl
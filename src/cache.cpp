@@ -0,0 +1,78 @@
+#include "repl/cache.hpp"
+
+#include "repl/optimize.hpp"
+
+namespace repl {
+
+std::expected<CachedQuery*, Error> ExpressionCache::try_lookup(std::string_view source) {
+    if (auto it = index_.find(source); it != index_.end()) {
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->parsed;
+    }
+
+    ++misses_;
+    if (capacity_ == 0) {
+        uncached_.reset();
+        auto expr = try_parse(source, uncached_);
+        if (!expr) {
+            return std::unexpected(expr.error());
+        }
+        uncached_query_.expr = optimize(*expr, uncached_.arena);
+        uncached_query_.code.reset();
+        return &uncached_query_;
+    }
+
+    if (entries_.size() >= capacity_) {
+        // Recycle the least recently used entry for the new source.
+        auto last = std::prev(entries_.end());
+        index_.erase(last->source);
+        entries_.splice(entries_.begin(), entries_, last);
+    } else {
+        entries_.emplace_front();
+    }
+
+    Entry& entry = entries_.front();
+    entry.query.reset();
+    entry.source.assign(source);
+    entry.parsed.code.reset();
+    std::expected<ExpressionPtr, Error> expr;
+    try {
+        expr = try_parse(entry.source, entry.query);
+    } catch (...) {
+        entries_.pop_front();
+        throw;
+    }
+    if (!expr) {
+        entries_.pop_front();
+        return std::unexpected(expr.error());
+    }
+    entry.parsed.expr = optimize(*expr, entry.query.arena);
+    index_.emplace(entry.source, entries_.begin());
+    return &entry.parsed;
+}
+
+CachedQuery& ExpressionCache::lookup(std::string_view source) {
+    auto query = try_lookup(source);
+    if (!query) {
+        throw_error(query.error(), source);
+    }
+    return **query;
+}
+
+void ExpressionCache::set_capacity(std::size_t capacity) {
+    capacity_ = capacity;
+    while (entries_.size() > capacity_) {
+        index_.erase(entries_.back().source);
+        entries_.pop_back();
+    }
+}
+
+void ExpressionCache::clear() {
+    index_.clear();
+    entries_.clear();
+    hits_ = 0;
+    misses_ = 0;
+}
+
+}  // namespace repl
@@ -0,0 +1,502 @@
+#include "repl/bytecode.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+#include "repl/state.hpp"
+
+namespace repl {
+
+namespace {
+
+/** @brief Single-pass code generator mirroring the tree walker's evaluation order. */
+class Compiler {
+public:
+    Compiler(Chunk& chunk, std::uint16_t param_count, std::uint16_t frame_size,
+             bool record_positions)
+        : chunk_(chunk), frame_size_(frame_size), record_positions_(record_positions) {
+        chunk_.param_count = param_count;
+    }
+
+    /** @brief Give a slot to every pure node with more than one parent.
+     *
+     *  A node is pure if it contains no assignment and reads no slot that the
+     *  body assigns: during a call nothing else can change, so every
+     *  occurrence of such a node yields the same value or the same error.
+     *  The nodes are recorded in Chunk::shared and flagged `cached` for the
+     *  tree walker.
+     */
+    void collect_shared(Expression& body) {
+        assigned_.assign(frame_size_, false);
+        collect_assigned(body);
+        nodes_.clear();
+        analyze(body);
+        std::vector<Expression*> shared;
+        for (Expression* node : visit_order_) {
+            const NodeInfo& info = nodes_.at(node);
+            if (info.uses > 1 && info.pure && node->type != EType::Number &&
+                node->type != EType::Variable && node->type != EType::Local &&
+                frame_size_ + shared.size() < std::numeric_limits<std::uint16_t>::max()) {
+                // Cache slots follow the named ones; past the last slot
+                // index, shared nodes are recomputed instead.
+                shared.push_back(node);
+            }
+        }
+        // Slots in address order, so the walker finds a node's slot by bisection.
+        std::ranges::sort(shared);
+        for (Expression* node : shared) {
+            node->cached = true;
+            shared_.emplace(node, frame_size_ + chunk_.shared.size());
+            chunk_.shared.push_back(node);
+        }
+    }
+
+    void finish(const Expression& expr) {
+        chunk_.slot_count = static_cast<std::uint16_t>(frame_size_ + chunk_.shared.size());
+        emit_value(expr);
+        emit(Op::Return, 0, 0, -1);
+    }
+
+private:
+    struct NodeInfo {
+        std::uint32_t uses = 0;
+        bool pure = true;
+    };
+
+    /** @brief Mark the slots the body assigns, visiting each node once. */
+    void collect_assigned(const Expression& expr) {
+        if (!nodes_.emplace(&expr, NodeInfo{}).second) {
+            return;
+        }
+        switch (expr.type) {
+            case EType::Number:
+            case EType::Variable:
+            case EType::Local:
+                return;
+            case EType::Unary:
+                collect_assigned(*expr.get<UnaryNode>().right);
+                return;
+            case EType::Binary: {
+                const auto& node = expr.get<BinaryNode>();
+                if (node.op == TType::Equals && node.left->type == EType::Local) {
+                    assigned_[node.left->get<LocalNode>().slot] = true;
+                } else {
+                    collect_assigned(*node.left);
+                }
+                collect_assigned(*node.right);
+                return;
+            }
+            case EType::FnCall:
+                for (ExpressionPtr arg : expr.get<FnNode>().args) {
+                    collect_assigned(*arg);
+                }
+                return;
+            case EType::Builtin:
+                for (ExpressionPtr arg : expr.get<BuiltinNode>().args) {
+                    if (arg) {
+                        collect_assigned(*arg);
+                    }
+                }
+                return;
+            case EType::Ternary: {
+                const auto& node = expr.get<TernaryNode>();
+                collect_assigned(*node.condition);
+                collect_assigned(*node.then_branch);
+                collect_assigned(*node.else_branch);
+                return;
+            }
+            case EType::Power:
+                collect_assigned(*expr.get<PowerNode>().base);
+                return;
+            case EType::Polynomial:
+                collect_assigned(*expr.get<PolyNode>().fallback);
+                return;
+            case EType::Reduce: {
+                // The body is compiled on its own, with a frame of its own.
+                const auto& node = expr.get<ReduceNode>();
+                collect_assigned(*node.lower());
+                collect_assigned(*node.upper());
+                return;
+            }
+        }
+    }
+
+    bool is_assigned(std::uint16_t slot) const {
+        return slot != kNoSlot && assigned_[slot];
+    }
+
+    /** @brief Count parent edges per node, visiting each node once. */
+    bool analyze(Expression& expr) {
+        if (auto it = nodes_.find(&expr); it != nodes_.end()) {
+            ++it->second.uses;
+            return it->second.pure;
+        }
+        nodes_.emplace(&expr, NodeInfo{1, true});
+        visit_order_.push_back(&expr);
+
+        bool pure = true;
+        switch (expr.type) {
+            case EType::Number:
+                break;
+            case EType::Variable:
+                break;
+            case EType::Local:
+                pure = !is_assigned(expr.get<LocalNode>().slot);
+                break;
+            case EType::Unary:
+                pure = analyze(*expr.get<UnaryNode>().right);
+                break;
+            case EType::Binary: {
+                const auto& node = expr.get<BinaryNode>();
+                if (node.op == TType::Equals) {
+                    analyze(*node.right);
+                    pure = false;
+                } else {
+                    pure = analyze(*node.left) & analyze(*node.right);
+                }
+                break;
+            }
+            case EType::FnCall:
+                for (ExpressionPtr arg : expr.get<FnNode>().args) {
+                    pure = analyze(*arg) && pure;
+                }
+                break;
+            case EType::Builtin:
+                for (ExpressionPtr arg : expr.get<BuiltinNode>().args) {
+                    if (arg) {
+                        pure = analyze(*arg) && pure;
+                    }
+                }
+                break;
+            case EType::Ternary: {
+                const auto& node = expr.get<TernaryNode>();
+                pure = analyze(*node.condition) & analyze(*node.then_branch) &
+                       analyze(*node.else_branch);
+                break;
+            }
+            case EType::Power:
+                pure = analyze(*expr.get<PowerNode>().base);
+                break;
+            case EType::Polynomial: {
+                const auto& node = expr.get<PolyNode>();
+                pure = analyze(*node.fallback) && !is_assigned(node.slot);
+                break;
+            }
+            case EType::Reduce: {
+                const auto& node = expr.get<ReduceNode>();
+                pure = analyze(*node.lower()) & analyze(*node.upper());
+                for (ExpressionPtr capture : node.captures()) {
+                    if (capture->type == EType::Local) {
+                        pure = analyze(*capture) && pure;
+                    }
+                }
+                break;
+            }
+        }
+        nodes_.at(&expr).pure = pure;
+        return pure;
+    }
+
+    std::size_t emit(Op op, std::uint16_t slot, std::uint32_t operand, int stack_effect) {
+        depth_ += stack_effect;
+        chunk_.max_stack = std::max(chunk_.max_stack, static_cast<std::uint32_t>(depth_));
+        chunk_.code.push_back(Instruction{op, slot, operand});
+        if (record_positions_) {
+            chunk_.positions.push_back(position_);
+        }
+        return chunk_.code.size() - 1;
+    }
+
+    void emit_number(double value) {
+        emit(Op::Number, 0, static_cast<std::uint32_t>(chunk_.numbers.size()), 1);
+        chunk_.numbers.push_back(value);
+    }
+
+    /** @brief Emit code that fails with `error` in place of producing a value. */
+    void emit_throw(const Error& error) {
+        emit(Op::Throw, 0, static_cast<std::uint32_t>(chunk_.errors.size()), 1);
+        chunk_.errors.push_back(error);
+    }
+
+    void patch(std::size_t jump) {
+        chunk_.code[jump].operand = static_cast<std::uint32_t>(chunk_.code.size());
+    }
+
+    void forget_computed(std::size_t count) {
+        computed_.resize(count);
+    }
+
+    void emit_local(Identifier name, std::uint16_t slot) {
+        if (slot < chunk_.param_count) {
+            emit(Op::LoadParam, slot, 0, 1);
+        } else {
+            emit(Op::LoadLocal, slot, static_cast<std::uint32_t>(index_of(name)), 1);
+        }
+    }
+
+    void emit_variable(Identifier name) {
+        const auto symbol = static_cast<std::uint32_t>(index_of(name));
+        if (name == last_result_symbol()) {
+            emit(Op::LoadLast, 0, 0, 1);
+            return;
+        }
+        // Constants are read-only, so no variable can shadow them.
+        if (const double* value = find_constant(name)) {
+            emit_number(*value);
+            return;
+        }
+        emit(Op::LoadGlobal, 0, symbol, 1);
+    }
+
+    void emit_assignment(const BinaryNode& node) {
+        if (node.left->type == EType::Local) {
+            emit_value(*node.right);
+            emit(Op::StoreLocal, node.left->get<LocalNode>().slot, 0, 0);
+            return;
+        }
+        if (node.left->type != EType::Variable) {
+            emit_throw(make_error(ErrorCode::InvalidAssignment));
+            return;
+        }
+        const Identifier name = node.left->get<Identifier>();
+        if (is_reserved_identifier(name)) {
+            emit_throw(name_error(ErrorCode::ReadOnly, name));
+            return;
+        }
+        emit_value(*node.right);
+        emit(Op::StoreGlobal, 0, static_cast<std::uint32_t>(index_of(name)), 0);
+    }
+
+    void emit_binary(const BinaryNode& node) {
+        Op op;
+        switch (node.op) {
+            case TType::Equals:
+                emit_assignment(node);
+                return;
+            case TType::Slash:
+            case TType::Percent: {
+                // Divisor first, so a zero divisor is reported before the
+                // dividend is evaluated.
+                const bool divide = node.op == TType::Slash;
+                emit_value(*node.right);
+                emit(divide ? Op::CheckDivisor : Op::CheckModulus, 0, 0, 0);
+                emit_value(*node.left);
+                emit(divide ? Op::Divide : Op::Modulo, 0, 0, -1);
+                return;
+            }
+            case TType::Plus: op = Op::Add; break;
+            case TType::Minus: op = Op::Subtract; break;
+            case TType::Star: op = Op::Multiply; break;
+            case TType::Caret: op = Op::Power; break;
+            case TType::Less: op = Op::Less; break;
+            case TType::LessEqual: op = Op::LessEqual; break;
+            case TType::Greater: op = Op::Greater; break;
+            case TType::GreaterEqual: op = Op::GreaterEqual; break;
+            case TType::EqualEqual: op = Op::Equal; break;
+            case TType::BangEqual: op = Op::NotEqual; break;
+            default:
+                emit_throw(make_error(ErrorCode::InvalidOperator));
+                return;
+        }
+        emit_value(*node.left);
+        emit_value(*node.right);
+        emit(op, 0, 0, -1);
+    }
+
+    void emit_call(const FnNode& node) {
+        const auto argc = static_cast<std::uint16_t>(node.args.size());
+        if (const BuiltinSpec* found = find_builtin(node.name)) {
+            const BuiltinSpec& spec = *found;
+            if (node.args.size() != spec.arity) {
+                emit_throw(arity_error(node.name, spec.arity, node.args.size()));
+                return;
+            }
+            emit_builtin(spec, node.args[0], spec.arity > 1 ? node.args[1] : nullptr);
+            return;
+        }
+
+        // User functions bind late: they may be defined or redefined later.
+        emit(Op::PrepareCall, argc, static_cast<std::uint32_t>(index_of(node.name)), 0);
+        for (ExpressionPtr arg : node.args) {
+            emit_value(*arg);
+        }
+        emit(Op::Call, argc, 0, 1 - argc);
+    }
+
+    void emit_builtin(const BuiltinSpec& spec, const Expression* first,
+                      const Expression* second) {
+        emit_value(*first);
+        if (second) {
+            emit_value(*second);
+        }
+        emit(second ? Op::CallBinary : Op::CallUnary, 0,
+             static_cast<std::uint32_t>(chunk_.builtins.size()), second ? -1 : 0);
+        chunk_.builtins.push_back(&spec);
+    }
+
+    void emit_ternary(const TernaryNode& node) {
+        emit_value(*node.condition);
+        const std::size_t to_else = emit(Op::JumpIfZero, 0, 0, -1);
+        // Values cached inside a branch are not known to exist after it.
+        const std::size_t computed = computed_.size();
+        emit_value(*node.then_branch);
+        const std::size_t to_end = emit(Op::Jump, 0, 0, 0);
+        // Only one branch runs; the else branch starts from the same depth.
+        --depth_;
+        patch(to_else);
+        forget_computed(computed);
+        emit_value(*node.else_branch);
+        patch(to_end);
+        forget_computed(computed);
+    }
+
+    void emit_power(const PowerNode& node) {
+        emit_value(*node.base);
+        if (node.kind == PowerNode::Kind::SquareRoot) {
+            emit(Op::SquareRoot, 0, 0, 0);
+        } else {
+            emit(Op::IntegerPower, 0, static_cast<std::uint32_t>(node.exponent), 0);
+        }
+    }
+
+    void emit_polynomial(const PolyNode& node) {
+        const auto first = static_cast<std::uint32_t>(chunk_.numbers.size());
+        chunk_.numbers.insert(chunk_.numbers.end(), node.coefficients,
+                              node.coefficients + node.degree + 2);
+        if (node.slot == kNoSlot) {
+            emit_variable(node.variable);
+        } else {
+            emit_local(node.variable, node.slot);
+        }
+        emit(Op::Horner, static_cast<std::uint16_t>(node.degree), first, 0);
+        const std::size_t to_end = emit(Op::Jump, 0, 0, 0);
+        // Out of range, Horner pops x and the fallback tree computes the value.
+        --depth_;
+        const std::size_t computed = computed_.size();
+        emit_value(*node.fallback);
+        forget_computed(computed);
+        patch(to_end);
+    }
+
+    /** @brief Push the bounds and the captured locals, then reduce them. */
+    void emit_reduce(const ReduceNode& node) {
+        emit_value(*node.lower());
+        emit_value(*node.upper());
+        std::uint16_t count = 2;
+        for (ExpressionPtr capture : node.captures()) {
+            if (capture->type == EType::Local) {
+                emit_value(*capture);
+                ++count;
+            }
+        }
+        emit(Op::Reduce, count, static_cast<std::uint32_t>(chunk_.reductions.size()), 1 - count);
+        chunk_.reductions.push_back(&node);
+    }
+
+    void emit_value(const Expression& expr) {
+        // Instructions take the position of the innermost node that has one.
+        const std::uint32_t outer = std::exchange(
+            position_, expr.position == kNoPosition ? position_ : expr.position);
+        emit_cached(expr);
+        position_ = outer;
+    }
+
+    void emit_cached(const Expression& expr) {
+        if (auto it = shared_.find(&expr); it != shared_.end()) {
+            const auto slot = static_cast<std::uint16_t>(it->second);
+            if (std::ranges::find(computed_, &expr) != computed_.end()) {
+                // Every path here already filled the slot.
+                emit(Op::LoadLocal, slot, 0, 1);
+                return;
+            }
+            const std::size_t check = emit(Op::LoadCached, slot, 0, 0);
+            emit_node(expr);
+            emit(Op::StoreLocal, slot, 0, 0);
+            patch(check);
+            computed_.push_back(&expr);
+            return;
+        }
+        emit_node(expr);
+    }
+
+    void emit_node(const Expression& expr) {
+        switch (expr.type) {
+            case EType::Number:
+                emit_number(expr.get<double>());
+                return;
+            case EType::Variable:
+                emit_variable(expr.get<Identifier>());
+                return;
+            case EType::Local: {
+                const auto& node = expr.get<LocalNode>();
+                emit_local(node.name, node.slot);
+                return;
+            }
+            case EType::Unary: {
+                const auto& node = expr.get<UnaryNode>();
+                emit_value(*node.right);
+                if (node.op == TType::Minus) {
+                    emit(Op::Negate, 0, 0, 0);
+                }
+                return;
+            }
+            case EType::Binary:
+                emit_binary(expr.get<BinaryNode>());
+                return;
+            case EType::FnCall:
+                emit_call(expr.get<FnNode>());
+                return;
+            case EType::Builtin: {
+                const auto& node = expr.get<BuiltinNode>();
+                emit_builtin(*node.spec, node.args[0], node.args[1]);
+                return;
+            }
+            case EType::Ternary:
+                emit_ternary(expr.get<TernaryNode>());
+                return;
+            case EType::Power:
+                emit_power(expr.get<PowerNode>());
+                return;
+            case EType::Polynomial:
+                emit_polynomial(expr.get<PolyNode>());
+                return;
+            case EType::Reduce:
+                emit_reduce(expr.get<ReduceNode>());
+                return;
+        }
+        emit_throw(make_error(ErrorCode::InvalidExpression));
+    }
+
+    Chunk& chunk_;
+    std::uint16_t frame_size_;
+    std::vector<bool> assigned_;
+    std::unordered_map<const Expression*, NodeInfo> nodes_;
+    std::vector<Expression*> visit_order_;
+    std::unordered_map<const Expression*, std::size_t> shared_;
+    std::vector<const Expression*> computed_;
+    int depth_ = 0;
+    bool record_positions_;
+    std::uint32_t position_ = kNoPosition;
+};
+
+}  // namespace
+
+Chunk compile(const Expression& expr) {
+    Chunk chunk;
+    Compiler compiler{chunk, 0, 0, true};
+    compiler.finish(expr);
+    return chunk;
+}
+
+Chunk compile_function(Expression& body, std::uint16_t param_count,
+                       std::uint16_t frame_size) {
+    Chunk chunk;
+    Compiler compiler{chunk, param_count, frame_size, false};
+    compiler.collect_shared(body);
+    compiler.finish(body);
+    return chunk;
+}
+
+}  // namespace repl
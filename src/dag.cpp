@@ -0,0 +1,294 @@
+#include "repl/dag.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <utility>
+
+namespace repl {
+
+namespace {
+
+void mix(std::size_t& seed, std::size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+std::uint64_t next_id() {
+    static std::atomic<std::uint64_t> last{0};
+    return last.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+std::size_t pointer_hash(const Expression* expr) {
+    return std::hash<const Expression*>{}(expr);
+}
+
+/** @brief Coefficients plus the trailing limit. */
+std::span<const double> coefficients_of(const PolyNode& node) {
+    return {node.coefficients, node.degree + std::size_t{2}};
+}
+
+}  // namespace
+
+ExpressionDag::ExpressionDag() : id_(next_id()) {}
+
+// The source is left empty under a fresh id, so it never shares one with a store holding nodes.
+ExpressionDag::ExpressionDag(ExpressionDag&& other) noexcept
+    : arena_(std::move(other.arena_)),
+      nodes_(std::move(other.nodes_)),
+      scratch_(std::move(other.scratch_)),
+      id_(std::exchange(other.id_, next_id())) {
+    other.nodes_.clear();
+}
+
+ExpressionDag& ExpressionDag::operator=(ExpressionDag&& other) noexcept {
+    if (this != &other) {
+        arena_ = std::move(other.arena_);
+        nodes_ = std::move(other.nodes_);
+        scratch_ = std::move(other.scratch_);
+        id_ = std::exchange(other.id_, next_id());
+        other.nodes_.clear();
+    }
+    return *this;
+}
+
+std::size_t ExpressionDag::NodeHash::operator()(const Expression* expr) const {
+    std::size_t seed = static_cast<std::size_t>(expr->type);
+    switch (expr->type) {
+        case EType::Number:
+            mix(seed, std::hash<std::uint64_t>{}(std::bit_cast<std::uint64_t>(expr->get<double>())));
+            break;
+        case EType::Variable:
+            mix(seed, index_of(expr->get<Identifier>()));
+            break;
+        case EType::Local: {
+            const auto& node = expr->get<LocalNode>();
+            mix(seed, index_of(node.name));
+            mix(seed, node.slot);
+            break;
+        }
+        case EType::Unary: {
+            const auto& node = expr->get<UnaryNode>();
+            mix(seed, static_cast<std::size_t>(node.op));
+            mix(seed, pointer_hash(node.right));
+            break;
+        }
+        case EType::Binary: {
+            const auto& node = expr->get<BinaryNode>();
+            mix(seed, static_cast<std::size_t>(node.op));
+            mix(seed, pointer_hash(node.left));
+            mix(seed, pointer_hash(node.right));
+            break;
+        }
+        case EType::FnCall: {
+            const auto& node = expr->get<FnNode>();
+            mix(seed, index_of(node.name));
+            for (const Expression* arg : node.args) {
+                mix(seed, pointer_hash(arg));
+            }
+            break;
+        }
+        case EType::Reduce: {
+            const auto& node = expr->get<ReduceNode>();
+            mix(seed, static_cast<std::size_t>(node.kind));
+            mix(seed, index_of(node.variable));
+            for (const Expression* arg : node.args) {
+                mix(seed, pointer_hash(arg));
+            }
+            break;
+        }
+        case EType::Builtin: {
+            const auto& node = expr->get<BuiltinNode>();
+            mix(seed, std::hash<const BuiltinSpec*>{}(node.spec));
+            mix(seed, pointer_hash(node.args[0]));
+            mix(seed, pointer_hash(node.args[1]));
+            break;
+        }
+        case EType::Ternary: {
+            const auto& node = expr->get<TernaryNode>();
+            mix(seed, pointer_hash(node.condition));
+            mix(seed, pointer_hash(node.then_branch));
+            mix(seed, pointer_hash(node.else_branch));
+            break;
+        }
+        case EType::Power: {
+            const auto& node = expr->get<PowerNode>();
+            mix(seed, static_cast<std::size_t>(node.kind));
+            mix(seed, static_cast<std::size_t>(node.exponent));
+            mix(seed, pointer_hash(node.base));
+            break;
+        }
+        case EType::Polynomial: {
+            const auto& node = expr->get<PolyNode>();
+            mix(seed, index_of(node.variable));
+            mix(seed, node.slot);
+            for (double value : coefficients_of(node)) {
+                mix(seed, std::hash<std::uint64_t>{}(std::bit_cast<std::uint64_t>(value)));
+            }
+            mix(seed, pointer_hash(node.fallback));
+            break;
+        }
+    }
+    return seed;
+}
+
+bool ExpressionDag::NodeEqual::operator()(const Expression* lhs, const Expression* rhs) const {
+    if (lhs->type != rhs->type) {
+        return false;
+    }
+    switch (lhs->type) {
+        case EType::Number:
+            // Bitwise, so 0.0 and -0.0 stay distinct.
+            return std::bit_cast<std::uint64_t>(lhs->get<double>()) ==
+                   std::bit_cast<std::uint64_t>(rhs->get<double>());
+        case EType::Variable:
+            return lhs->get<Identifier>() == rhs->get<Identifier>();
+        case EType::Local: {
+            const auto& a = lhs->get<LocalNode>();
+            const auto& b = rhs->get<LocalNode>();
+            return a.name == b.name && a.slot == b.slot;
+        }
+        case EType::Unary: {
+            const auto& a = lhs->get<UnaryNode>();
+            const auto& b = rhs->get<UnaryNode>();
+            return a.op == b.op && a.right == b.right;
+        }
+        case EType::Binary: {
+            const auto& a = lhs->get<BinaryNode>();
+            const auto& b = rhs->get<BinaryNode>();
+            return a.op == b.op && a.left == b.left && a.right == b.right;
+        }
+        case EType::FnCall: {
+            const auto& a = lhs->get<FnNode>();
+            const auto& b = rhs->get<FnNode>();
+            return a.name == b.name && std::ranges::equal(a.args, b.args);
+        }
+        case EType::Reduce: {
+            const auto& a = lhs->get<ReduceNode>();
+            const auto& b = rhs->get<ReduceNode>();
+            return a.kind == b.kind && a.variable == b.variable &&
+                   std::ranges::equal(a.args, b.args);
+        }
+        case EType::Builtin: {
+            const auto& a = lhs->get<BuiltinNode>();
+            const auto& b = rhs->get<BuiltinNode>();
+            return a.spec == b.spec && a.args == b.args;
+        }
+        case EType::Ternary: {
+            const auto& a = lhs->get<TernaryNode>();
+            const auto& b = rhs->get<TernaryNode>();
+            return a.condition == b.condition && a.then_branch == b.then_branch &&
+                   a.else_branch == b.else_branch;
+        }
+        case EType::Power: {
+            const auto& a = lhs->get<PowerNode>();
+            const auto& b = rhs->get<PowerNode>();
+            return a.kind == b.kind && a.exponent == b.exponent && a.base == b.base;
+        }
+        case EType::Polynomial: {
+            const auto& a = lhs->get<PolyNode>();
+            const auto& b = rhs->get<PolyNode>();
+            return a.variable == b.variable && a.slot == b.slot && a.degree == b.degree &&
+                   a.fallback == b.fallback &&
+                   std::ranges::equal(coefficients_of(a), coefficients_of(b),
+                                      [](double x, double y) {
+                                          return std::bit_cast<std::uint64_t>(x) ==
+                                                 std::bit_cast<std::uint64_t>(y);
+                                      });
+        }
+    }
+    return false;
+}
+
+ExpressionPtr ExpressionDag::intern(const Expression& expr) {
+    // Build a candidate over canonical children, then look it up.
+    Expression candidate = expr;
+    switch (expr.type) {
+        case EType::Number:
+        case EType::Variable:
+        case EType::Local:
+            break;
+        case EType::Unary:
+            candidate.get<UnaryNode>().right = intern(*expr.get<UnaryNode>().right);
+            break;
+        case EType::Binary: {
+            auto& node = candidate.get<BinaryNode>();
+            node.left = intern(*node.left);
+            node.right = intern(*node.right);
+            break;
+        }
+        case EType::FnCall: {
+            auto& node = candidate.get<FnNode>();
+            const std::size_t base = scratch_.size();
+            for (const Expression* arg : node.args) {
+                ExpressionPtr canonical = intern(*arg);
+                scratch_.push_back(canonical);
+            }
+            node.args = ExpressionList{scratch_.data() + base, node.args.size()};
+            break;
+        }
+        case EType::Reduce: {
+            auto& node = candidate.get<ReduceNode>();
+            const std::size_t base = scratch_.size();
+            for (const Expression* arg : node.args) {
+                ExpressionPtr canonical = intern(*arg);
+                scratch_.push_back(canonical);
+            }
+            node.args = ExpressionList{scratch_.data() + base, node.args.size()};
+            break;
+        }
+        case EType::Builtin: {
+            auto& node = candidate.get<BuiltinNode>();
+            for (ExpressionPtr& arg : node.args) {
+                if (arg) {
+                    arg = intern(*arg);
+                }
+            }
+            break;
+        }
+        case EType::Ternary: {
+            auto& node = candidate.get<TernaryNode>();
+            node.condition = intern(*node.condition);
+            node.then_branch = intern(*node.then_branch);
+            node.else_branch = intern(*node.else_branch);
+            break;
+        }
+        case EType::Power:
+            candidate.get<PowerNode>().base = intern(*expr.get<PowerNode>().base);
+            break;
+        case EType::Polynomial:
+            candidate.get<PolyNode>().fallback = intern(*expr.get<PolyNode>().fallback);
+            break;
+    }
+
+    ExpressionPtr result;
+    if (auto it = nodes_.find(&candidate); it != nodes_.end()) {
+        result = const_cast<ExpressionPtr>(*it);
+    } else {
+        if (candidate.type == EType::FnCall) {
+            auto& node = candidate.get<FnNode>();
+            node.args = arena_.copy<ExpressionPtr>(node.args);
+        }
+        if (candidate.type == EType::Reduce) {
+            auto& node = candidate.get<ReduceNode>();
+            node.args = arena_.copy<ExpressionPtr>(node.args);
+        }
+        if (candidate.type == EType::Polynomial) {
+            auto& node = candidate.get<PolyNode>();
+            node.coefficients = arena_.copy<double>(coefficients_of(node)).data();
+        }
+        result = arena_.make<Expression>(candidate);
+        nodes_.insert(result);
+    }
+    if (expr.type == EType::FnCall) {
+        scratch_.resize(scratch_.size() - expr.get<FnNode>().args.size());
+    }
+    if (expr.type == EType::Reduce) {
+        scratch_.resize(scratch_.size() - expr.get<ReduceNode>().args.size());
+    }
+    return result;
+}
+
+}  // namespace repl
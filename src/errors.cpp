@@ -0,0 +1,171 @@
+#include "repl/errors.hpp"
+
+#include <format>
+
+#include "repl/registry.hpp"
+
+namespace repl {
+
+namespace {
+
+std::uint64_t limit_of(const Error& error) {
+    return (std::uint64_t{error.numbers[0]} << 32) | error.numbers[1];
+}
+
+std::string_view subject_name(const Error& error) {
+    return symbol_name(static_cast<Symbol>(error.subject));
+}
+
+std::string_view subject_token(const Error& error) {
+    return to_string(static_cast<TType>(error.subject));
+}
+
+std::string_view subject_reduction(const Error& error) {
+    return reduction_spec(static_cast<ReduceKind>(error.subject)).name;
+}
+
+/** @brief Source text of a rejected number literal. */
+std::string_view literal(const Error& error, std::string_view source) {
+    if (error.position >= source.size()) {
+        return {};
+    }
+    return source.substr(error.position, error.numbers[0]);
+}
+
+std::string format_message(const Error& error, std::string_view source) {
+    switch (error.code) {
+        case ErrorCode::None:
+            return "No error";
+        case ErrorCode::InputTooLong:
+            return "Input is too long to tokenize";
+        case ErrorCode::TokenTooLong:
+            return std::format("Token starting at position {} is too long", error.position);
+        case ErrorCode::MultipleDecimalPoints:
+            return std::format(
+                "Invalid number with multiple decimal points starting at position {}",
+                error.position);
+        case ErrorCode::MissingExponent:
+            return std::format(
+                "Invalid scientific notation at position {}: exponent requires digits",
+                error.position);
+        case ErrorCode::BangWithoutEquals:
+            return std::format("Unexpected '!' at position {}. Did you mean '!='?",
+                               error.position);
+        case ErrorCode::NumberOutOfRange:
+            return std::format("Number out of range: '{}'", literal(error, source));
+        case ErrorCode::InvalidNumber:
+            return std::format("Invalid number: '{}'", literal(error, source));
+        case ErrorCode::UnexpectedCharacter:
+            return std::format("Could not parse character '{}' at position {}",
+                               static_cast<char>(error.subject), error.position);
+        case ErrorCode::UnexpectedEnd:
+            return "Unexpected end of input while parsing unary expression";
+        case ErrorCode::ExpectedOperand:
+            return std::format("Could not parse expression starting with token '{}'",
+                               subject_token(error));
+        case ErrorCode::ExpectedColon:
+            return "Expected ':' in ternary expression";
+        case ErrorCode::UnclosedGroup:
+            return "Expected ')' to close expression";
+        case ErrorCode::ExpectedRParen:
+            return std::format("Expected ')' but found {}", subject_token(error));
+        case ErrorCode::UnclosedCall:
+            return "Expected ')' to close function call";
+        case ErrorCode::ExpectedSeparator:
+            return std::format("Expected ',' or ')' in function arguments but found {}",
+                               subject_token(error));
+        case ErrorCode::EmptyArgument:
+            return "Empty function argument";
+        case ErrorCode::TooDeep:
+            return std::format("Expression is nested too deeply (limit {})", limit_of(error));
+        case ErrorCode::ReductionVariable:
+            return std::format("First argument of '{}' must be a variable name",
+                               subject_reduction(error));
+        case ErrorCode::ReadOnlyBoundVariable:
+        case ErrorCode::ReadOnly:
+            return std::format("'{}' is read-only", subject_name(error));
+        case ErrorCode::InvalidParserState:
+            return "Invalid parser state";
+        case ErrorCode::UnexpectedToken:
+            return std::format("Unexpected token '{}'", subject_token(error));
+        case ErrorCode::DivisionByZero:
+            return "Division by zero";
+        case ErrorCode::ModuloByZero:
+            return "Modulo by zero";
+        case ErrorCode::PowerDomain:
+            return "Domain error in '^'";
+        case ErrorCode::BuiltinDomain:
+            return std::format("Domain error in function '{}'",
+                               (kBuiltins.begin() + error.subject)->name);
+        case ErrorCode::ReductionDomain:
+            return std::format("Domain error in function '{}'", subject_reduction(error));
+        case ErrorCode::UndefinedVariable:
+            return std::format("Variable '{}' not defined", subject_name(error));
+        case ErrorCode::NoLastResult:
+            return "No previous result available for '_'";
+        case ErrorCode::UndefinedFunction:
+            return std::format("Function '{}' not defined", subject_name(error));
+        case ErrorCode::ArityMismatch:
+            return std::format("Function '{}' expects {} arguments, got {}", subject_name(error),
+                               error.numbers[0], error.numbers[1]);
+        case ErrorCode::InvalidAssignment:
+            return "Left side of '=' must be a variable name";
+        case ErrorCode::InvalidOperator:
+            return "Invalid or unsupported operator type";
+        case ErrorCode::InvalidExpression:
+            return "Invalid expression type";
+        case ErrorCode::CallDepthExceeded:
+            return std::format("Maximum call depth of {} exceeded", limit_of(error));
+        case ErrorCode::InvalidDefinition:
+            return "Invalid function definition";
+        case ErrorCode::InvalidParameter:
+            return "Function parameters must be identifiers";
+        case ErrorCode::DuplicateParameter:
+            return std::format("Duplicate parameter '{}'", subject_name(error));
+        case ErrorCode::MissingBody:
+            return "Function definition is missing a body";
+        case ErrorCode::ReductionDefinition:
+            return std::format("'{}' with four arguments is a reduction and cannot be defined",
+                               subject_reduction(error));
+        case ErrorCode::TooManyLocals:
+            return "Function body has too many local variables";
+        case ErrorCode::NonFiniteBounds:
+            return std::format("Bounds of '{}' must be finite", subject_reduction(error));
+        case ErrorCode::TooManyTerms:
+            return std::format("Too many terms in '{}'", subject_reduction(error));
+        case ErrorCode::NoConvergence:
+            return "'integrate' did not converge";
+        case ErrorCode::BindingCycle:
+            return std::format("Binding '{}' would depend on itself", subject_name(error));
+        case ErrorCode::BindingAssigns:
+            return std::format("Binding '{}' cannot assign variables", subject_name(error));
+        case ErrorCode::BindingReadsLast:
+            return std::format("Binding '{}' cannot read '_'", subject_name(error));
+    }
+    return "Unknown error";
+}
+
+}  // namespace
+
+Error builtin_domain_error(const BuiltinSpec& spec) {
+    return Error{.code = ErrorCode::BuiltinDomain,
+                 .subject = static_cast<std::uint32_t>(&spec - &*kBuiltins.begin())};
+}
+
+std::string format_error(const Error& error, std::string_view source) {
+    if (error.binding != kNoBinding) {
+        return std::format("Could not update '{}': {}",
+                           symbol_name(static_cast<Symbol>(error.binding)),
+                           format_message(error, source));
+    }
+    return format_message(error, source);
+}
+
+void throw_error(const Error& error, std::string_view source) {
+    if (is_parse_error(error.code)) {
+        throw ParseError(error, format_error(error, source));
+    }
+    throw EvalError(error, format_error(error, source));
+}
+
+}  // namespace repl
@@ -1,16 +1,55 @@
 #include "repl/evaluator.hpp"
 
+#include "repl/memo.hpp"
+#include "repl/optimize.hpp"
+#include "repl/reactive.hpp"
+#include "repl/reduce.hpp"
+#include "repl/resolve.hpp"
+
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <expected>
 #include <format>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace repl {
 
 namespace {
 
+/** @brief Slots per frame stack segment; a larger frame gets a segment of its own. */
+constexpr std::size_t kFrameSegmentSlots = 4096;
+
+/** @brief Arguments up to this many are buffered on the C++ stack; more on the heap. */
+constexpr std::size_t kInlineArgs = 8;
+
+/** @brief Frame slots kept on the C++ stack by a recursive call; more go on the heap. */
+constexpr std::size_t kInlineFrameSlots = 8;
+
+/** @brief Nested user calls evaluated by C++ recursion before the walker
+ *  switches to its explicit stacks.
+ */
+constexpr std::size_t kRecursiveCallDepth = 64;
+
+/** @brief Frame of the user function being evaluated; null slots at top level.
+ *
+ *  `live` marks assigned locals that have been written; parameters are always
+ *  live, and an unwritten local reads the global of the same name. `shared`
+ *  lists the function's cached nodes (Chunk::shared), whose values live in
+ *  the slots from `cache_base` on once `live` marks them computed.
+ */
 struct EvalContext {
-    VariableMap* locals = nullptr;
-    bool allow_function_definition = false;
+    double* slots = nullptr;
+    std::uint8_t* live = nullptr;
+    std::span<const Expression* const> shared{};
+    std::uint16_t cache_base = 0;
 };
 
 std::string join_params(const Identifiers& params) {
@@ -19,116 +58,833 @@ std::string join_params(const Identifiers& params) {
         if (index > 0) {
             result += ", ";
         }
-        result += params[index];
+        result += symbol_name(params[index]);
     }
     return result;
 }
 
 double eval_value(Expression& expr, State& state, EvalContext& ctx);
 
-double require_finite(double value, std::string_view context) {
+/** @brief Whether the evaluation in progress has failed. */
+bool failed(const State& state) {
+    return static_cast<bool>(state.error);
+}
+
+/** @brief Record `error` at `position` as the evaluation's error, unless it
+ *  already failed, and return NaN to carry on with.
+ *
+ *  The walker does not unwind on an error: it finishes the expressions in
+ *  progress on NaN, but stores no variable or memo entry and starts no user
+ *  call or reduction once failed() holds.
+ */
+double fail(State& state, std::uint32_t position, Error error) {
+    if (!state.error) {
+        error.position = position;
+        state.error = error;
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+/** @brief Cache slot of `expr` in the current frame, or kNoSlot. */
+std::uint16_t cache_slot(const Expression& expr, const EvalContext& ctx) {
+    if (!expr.cached || ctx.shared.empty()) {
+        return kNoSlot;
+    }
+    const auto it = std::ranges::lower_bound(ctx.shared, &expr);
+    if (it == ctx.shared.end() || *it != &expr) {
+        return kNoSlot;
+    }
+    return static_cast<std::uint16_t>(ctx.cache_base + (it - ctx.shared.begin()));
+}
+
+/** @brief Whether `expr` is cached and already computed during this call. */
+bool computed(const Expression& expr, const EvalContext& ctx) {
+    const std::uint16_t slot = cache_slot(expr, ctx);
+    return slot != kNoSlot && ctx.live[slot] != 0;
+}
+
+/** @brief Heap stack of tree-walker frames, reused across calls on a thread.
+ *
+ *  Frames are carved from segments that never move, so a caller's slots stay
+ *  valid while its callees push frames above it. Deep recursion therefore
+ *  costs heap memory for its frames, not C++ stack.
+ */
+class FrameStack {
+public:
+    /** @brief Top of the stack, to release back to. */
+    struct Mark {
+        std::size_t segment = 0;
+        std::size_t top = 0;
+    };
+
+    Mark mark() const { return Mark{segment_, top_}; }
+
+    /** @brief Drop every frame allocated since `mark` was taken. */
+    void release(Mark mark) {
+        segment_ = mark.segment;
+        top_ = mark.top;
+    }
+
+    /** @brief Push a frame of `size` slots. */
+    EvalContext allocate(std::size_t size) {
+        if (segment_ == segments_.size() || top_ + size > segments_[segment_].slots.size()) {
+            if (segment_ < segments_.size()) {
+                ++segment_;
+            }
+            if (segment_ == segments_.size()) {
+                segments_.emplace_back();
+            }
+            // Segments above the top hold no live frames, so growing one is safe.
+            Segment& segment = segments_[segment_];
+            if (segment.slots.size() < size) {
+                segment.slots.resize(std::max(size, kFrameSegmentSlots));
+                segment.live.resize(segment.slots.size());
+            }
+            top_ = 0;
+        }
+        Segment& segment = segments_[segment_];
+        EvalContext frame{.slots = segment.slots.data() + top_, .live = segment.live.data() + top_};
+        top_ += size;
+        return frame;
+    }
+
+private:
+    struct Segment {
+        std::vector<double> slots;
+        std::vector<std::uint8_t> live;
+    };
+
+    std::vector<Segment> segments_;
+    std::size_t segment_ = 0;
+    std::size_t top_ = 0;
+};
+
+/** @brief `value`, the result of `^` at `position`, if it is finite. */
+double require_finite(double value, std::uint32_t position, State& state) {
     if (std::isnan(value) || std::isinf(value)) {
-        throw EvalError(std::format("Domain error in {}", context));
+        return fail(state, position, make_error(ErrorCode::PowerDomain));
     }
     return value;
 }
 
-double eval_binary(BinaryNode& node, State& state, EvalContext& ctx) {
-    switch (node.op) {
+/** @brief `left op right` for an operator that takes both operands as they are. */
+double apply_binary(const Expression& expr, TType op, double left, double right,
+                    State& state) {
+    switch (op) {
         case TType::Plus:
-            return eval_value(*node.left, state, ctx) + eval_value(*node.right, state, ctx);
+            return left + right;
         case TType::Minus:
-            return eval_value(*node.left, state, ctx) - eval_value(*node.right, state, ctx);
+            return left - right;
         case TType::Star:
-            return eval_value(*node.left, state, ctx) * eval_value(*node.right, state, ctx);
+            return left * right;
+        case TType::Slash:
+            return left / right;
+        case TType::Percent:
+            return std::fmod(left, right);
+        case TType::Caret:
+            return require_finite(std::pow(left, right), expr.position, state);
+        case TType::Less:
+            return left < right;
+        case TType::LessEqual:
+            return left <= right;
+        case TType::Greater:
+            return left > right;
+        case TType::GreaterEqual:
+            return left >= right;
+        case TType::EqualEqual:
+            return left == right;
+        case TType::BangEqual:
+            return left != right;
+        default:
+            return fail(state, expr.position, make_error(ErrorCode::InvalidOperator));
+    }
+}
+
+double eval_binary(Expression& expr, State& state, EvalContext& ctx) {
+    auto& node = expr.get<BinaryNode>();
+    switch (node.op) {
         case TType::Slash: {
             double rhs = eval_value(*node.right, state, ctx);
             if (rhs == 0.0) {
-                throw EvalError("Division by zero");
+                return fail(state, expr.position, make_error(ErrorCode::DivisionByZero));
             }
             return eval_value(*node.left, state, ctx) / rhs;
         }
         case TType::Percent: {
             double rhs = eval_value(*node.right, state, ctx);
             if (rhs == 0.0) {
-                throw EvalError("Modulo by zero");
+                return fail(state, expr.position, make_error(ErrorCode::ModuloByZero));
             }
             return std::fmod(eval_value(*node.left, state, ctx), rhs);
         }
-        case TType::Caret:
-            return require_finite(
-                std::pow(eval_value(*node.left, state, ctx),
-                         eval_value(*node.right, state, ctx)),
-                "'^'");
-        case TType::Less:
-            return eval_value(*node.left, state, ctx) < eval_value(*node.right, state, ctx);
-        case TType::LessEqual:
-            return eval_value(*node.left, state, ctx) <= eval_value(*node.right, state, ctx);
-        case TType::Greater:
-            return eval_value(*node.left, state, ctx) > eval_value(*node.right, state, ctx);
-        case TType::GreaterEqual:
-            return eval_value(*node.left, state, ctx) >= eval_value(*node.right, state, ctx);
-        case TType::EqualEqual:
-            return eval_value(*node.left, state, ctx) == eval_value(*node.right, state, ctx);
-        case TType::BangEqual:
-            return eval_value(*node.left, state, ctx) != eval_value(*node.right, state, ctx);
         case TType::Equals: {
+            if (node.left->type == EType::Local) {
+                const std::uint16_t slot = node.left->get<LocalNode>().slot;
+                double value = eval_value(*node.right, state, ctx);
+                ctx.slots[slot] = value;
+                ctx.live[slot] = 1;
+                return value;
+            }
             if (node.left->type != EType::Variable) {
-                throw EvalError("Left side of '=' must be a variable name");
+                return fail(state, expr.position, make_error(ErrorCode::InvalidAssignment));
             }
             const auto& name = node.left->get<Identifier>();
             if (is_reserved_identifier(name)) {
-                throw EvalError(std::format("'{}' is read-only", name));
+                return fail(state, expr.position, name_error(ErrorCode::ReadOnly, name));
             }
             double value = eval_value(*node.right, state, ctx);
-            if (ctx.locals) {
-                (*ctx.locals)[name] = value;
-            } else {
-                state.vars[name] = value;
+            if (!failed(state)) {
+                state.vars.set(name, value);
             }
             return value;
         }
-        default:
-            throw EvalError("Invalid or unsupported operator type");
+        default: {
+            // Left before right, as the VM and the explicit walker do: passing
+            // both calls straight to the operator would leave the order (and so
+            // which side effect or error comes first) to the compiler.
+            const double left = eval_value(*node.left, state, ctx);
+            const double right = eval_value(*node.right, state, ctx);
+            return apply_binary(expr, node.op, left, right, state);
+        }
+    }
+}
+
+/** @brief `value`, the result of `spec` called at `position`, if it is finite. */
+double require_builtin_finite(double value, const BuiltinSpec& spec, std::uint32_t position,
+                              State& state) {
+    if (!std::isfinite(value)) {
+        return fail(state, position, builtin_domain_error(spec));
+    }
+    return value;
+}
+
+/** @brief Direct call through the bound function pointer; no lookup or arity check. */
+double eval_builtin(Expression& expr, State& state, EvalContext& ctx) {
+    auto& node = expr.get<BuiltinNode>();
+    const BuiltinSpec& spec = *node.spec;
+    const double first = eval_value(*node.args[0], state, ctx);
+    if (!node.args[1]) {
+        return require_builtin_finite(spec.unary(first), spec, expr.position, state);
     }
+    return require_builtin_finite(spec.binary(first, eval_value(*node.args[1], state, ctx)),
+                                  spec, expr.position, state);
 }
 
-double eval_function_call(FnNode& node, State& state, EvalContext& ctx) {
-    const auto& builtins = builtin_functions();
-    if (auto it = builtins.find(node.name); it != builtins.end()) {
-        const BuiltinSpec& spec = it->second;
-        if (node.args.size() != spec.arity) {
-            throw EvalError(std::format("Function '{}' expects {} arguments, got {}",
-                                        node.name, spec.arity, node.args.size()));
+/** @brief Evaluated arguments of a tail call, held until the caller's frame is reused. */
+class ArgBuffer {
+public:
+    const double* evaluate(ExpressionList args, State& state, EvalContext& ctx) {
+        double* values = inline_.data();
+        if (args.size() > kInlineArgs) {
+            heap_.resize(args.size());
+            values = heap_.data();
         }
-        std::vector<double> args;
-        args.reserve(node.args.size());
-        for (const auto& arg : node.args) {
-            args.push_back(eval_value(*arg, state, ctx));
+        for (std::size_t index = 0; index < args.size(); ++index) {
+            values[index] = eval_value(*args[index], state, ctx);
         }
-        return require_finite(spec.fn(args),
-                              std::format("function '{}'", node.name));
+        return values;
     }
 
+private:
+    std::array<double, kInlineArgs> inline_;
+    std::vector<double> heap_;
+};
+
+/** @brief User function `expr` calls, or nullptr, having failed, if there is
+ *  none of its name and arity.
+ */
+FnObj* find_function(const Expression& expr, State& state) {
+    const auto& node = expr.get<FnNode>();
     auto it = state.fns.find(node.name);
     if (it == state.fns.end()) {
-        throw EvalError(std::format("Function '{}' not defined", node.name));
+        fail(state, expr.position, name_error(ErrorCode::UndefinedFunction, node.name));
+        return nullptr;
     }
-
-    const FnObj& fn_obj = it->second;
+    FnObj& fn_obj = it->second;
     if (node.args.size() != fn_obj.params.size()) {
-        throw EvalError(std::format("Function '{}' expects {} arguments, got {}",
-                                    node.name, fn_obj.params.size(), node.args.size()));
+        fail(state, expr.position,
+             arity_error(node.name, fn_obj.params.size(), node.args.size()));
+        return nullptr;
+    }
+    return &fn_obj;
+}
+
+/** @brief Whether `expr` calls `spec` with the right number of arguments; fails if not. */
+bool check_builtin_arity(const BuiltinSpec& spec, const Expression& expr, State& state) {
+    const auto& node = expr.get<FnNode>();
+    if (node.args.size() != spec.arity) {
+        fail(state, expr.position, arity_error(node.name, spec.arity, node.args.size()));
+        return false;
+    }
+    return true;
+}
+
+/** @brief `fn`'s memo table, ready for lookups, or nullptr if its results are not cached now. */
+MemoTable* ready_memo(const FnObj& fn, const State& state) {
+    return fn.memo && fn.memo->validate(fn, state) ? fn.memo.get() : nullptr;
+}
+
+/** @brief Task::step that stores the value on top of the stack in the node's cache slot. */
+constexpr std::uint32_t kStoreCached = std::numeric_limits<std::uint32_t>::max();
+
+/** @brief Pending step of a function body on the walker's task stack. */
+struct Task {
+    /** @brief Node to continue, or null to return from the innermost call. */
+    ExpressionPtr node = nullptr;
+    /** @brief Callee of a user call whose arguments are being evaluated. */
+    FnObj* callee = nullptr;
+    std::uint32_t step = 0;
+};
+
+/** @brief Caller frame, restored when its callee returns. */
+struct CallRecord {
+    EvalContext ctx;
+    FrameStack::Mark mark;
+};
+
+/** @brief Result of a memoized call to cache when the call returns. */
+struct PendingMemo {
+    MemoTable* memo;
+    MemoTable::Key key;
+    /** @brief Index of the call's CallRecord. */
+    std::size_t call;
+};
+
+/** @brief Explicit stacks of the walker, reused across calls on a thread. */
+struct Walker {
+    std::vector<Task> tasks;
+    std::vector<double> values;
+    std::vector<CallRecord> calls;
+    std::vector<PendingMemo> memos;
+    FrameStack frames;
+};
+
+Walker& walker() {
+    thread_local Walker instance;
+    return instance;
+}
+
+/** @brief Returns the walker's stacks, the call depth, and the engine to where
+ *  a run found them, also when it fails. Runs nest when native code calls
+ *  back into the walker; each works above the stacks of the one below.
+ */
+class WalkerScope {
+public:
+    WalkerScope(Walker& walker, State& state)
+        : walker_(walker),
+          state_(state),
+          tasks_(walker.tasks.size()),
+          values_(walker.values.size()),
+          calls_(walker.calls.size()),
+          memos_(walker.memos.size()),
+          mark_(walker.frames.mark()),
+          depth_(state.call_depth),
+          engine_(state.engine) {}
+
+    ~WalkerScope() {
+        walker_.tasks.resize(tasks_);
+        walker_.values.resize(values_);
+        walker_.calls.resize(calls_);
+        walker_.memos.resize(memos_);
+        walker_.frames.release(mark_);
+        state_.call_depth = depth_;
+        state_.engine = engine_;
     }
 
-    VariableMap locals;
-    locals.reserve(fn_obj.params.size());
-    for (std::size_t index = 0; index < fn_obj.params.size(); ++index) {
-        locals[fn_obj.params[index]] = eval_value(*node.args[index], state, ctx);
+    WalkerScope(const WalkerScope&) = delete;
+    WalkerScope& operator=(const WalkerScope&) = delete;
+
+    /** @brief Size of the task stack when the run's entry function returns. */
+    std::size_t base() const { return tasks_; }
+    /** @brief Frame stack top below the run's entry frame. */
+    FrameStack::Mark mark() const { return mark_; }
+
+private:
+    Walker& walker_;
+    State& state_;
+    std::size_t tasks_;
+    std::size_t values_;
+    std::size_t calls_;
+    std::size_t memos_;
+    FrameStack::Mark mark_;
+    std::size_t depth_;
+    Engine engine_;
+};
+
+/** @brief Slots a frame of `fn` needs: its parameters and locals, then its cached nodes. */
+std::size_t frame_slots(const FnObj& fn) {
+    return fn.code.slot_count;
+}
+
+/** @brief Start a call of `fn` in `frame`, whose parameter slots are filled:
+ *  locals and cached nodes are not yet computed.
+ */
+void start_frame(EvalContext& frame, const FnObj& fn) {
+    const std::size_t param_count = fn.params.size();
+    std::fill(frame.live, frame.live + param_count, std::uint8_t{1});
+    std::fill(frame.live + param_count, frame.live + frame_slots(fn), std::uint8_t{0});
+    frame.shared = fn.code.shared;
+    frame.cache_base = fn.frame_size;
+}
+
+EvalContext enter_frame(FrameStack& frames, const FnObj& fn, const double* args) {
+    EvalContext frame = frames.allocate(frame_slots(fn));
+    std::copy_n(args, fn.params.size(), frame.slots);
+    start_frame(frame, fn);
+    return frame;
+}
+
+/** @brief Run a user function on the Walker's explicit stacks.
+ *
+ *  Subtrees without user calls are evaluated recursively by eval_value().
+ *  Everything on a path to a user call is driven from the task stack instead,
+ *  so recursion below this point costs heap memory rather than C++ stack. A
+ *  call whose continuation is a return (the body, or a branch of a ternary in
+ *  tail position) replaces the current frame instead of pushing one.
+ *
+ *  Under Engine::Jit each function entered is offered to tier_up(), except
+ *  the first when `try_native` is false because the caller already did. If
+ *  native code bails out, the rest of the run stays in the walker, which
+ *  records the error the native code detected. A failed run stops at once.
+ */
+double run_iterative(FnObj& fn, const double* args, State& state, bool try_native) {
+    Walker& w = walker();
+    WalkerScope scope{w, state};
+    if (try_native && state.engine == Engine::Jit && tier_up(fn)) {
+        if (auto value = fn.native->run(args, state)) {
+            return *value;
+        }
+        state.engine = Engine::Tree;
     }
 
-    EvalContext local_ctx{&locals, false};
-    return eval_value(*fn_obj.expr, state, local_ctx);
+    EvalContext ctx = enter_frame(w.frames, fn, args);
+    w.tasks.push_back(Task{fn.expr});
+    const auto push = [&w](ExpressionPtr node) { w.tasks.push_back(Task{node}); };
+    const auto pop = [&w] {
+        const double value = w.values.back();
+        w.values.pop_back();
+        return value;
+    };
+
+    while (w.tasks.size() > scope.base()) {
+        if (failed(state)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        const Task task = w.tasks.back();
+        w.tasks.pop_back();
+        if (!task.node) {
+            if (!w.memos.empty() && w.memos.back().call == w.calls.size() - 1) {
+                w.memos.back().memo->insert(w.memos.back().key, w.values.back());
+                w.memos.pop_back();
+            }
+            ctx = w.calls.back().ctx;
+            w.frames.release(w.calls.back().mark);
+            w.calls.pop_back();
+            --state.call_depth;
+            continue;
+        }
+        Expression& expr = *task.node;
+        if (!expr.calls) {
+            w.values.push_back(eval_value(expr, state, ctx));
+            continue;
+        }
+        if (task.step == kStoreCached) {
+            const std::uint16_t slot = cache_slot(expr, ctx);
+            ctx.slots[slot] = w.values.back();
+            ctx.live[slot] = 1;
+            continue;
+        }
+        if (task.step == 0) {
+            if (const std::uint16_t slot = cache_slot(expr, ctx); slot != kNoSlot) {
+                if (ctx.live[slot] != 0) {
+                    w.values.push_back(ctx.slots[slot]);
+                    continue;
+                }
+                // Stays below the node's own tasks, so a call in it is not a tail call.
+                w.tasks.push_back(Task{&expr, nullptr, kStoreCached});
+            }
+        }
+
+        switch (expr.type) {
+            case EType::Unary: {
+                auto& node = expr.get<UnaryNode>();
+                if (task.step == 0) {
+                    w.tasks.push_back(Task{&expr, nullptr, 1});
+                    push(node.right);
+                } else if (node.op != TType::Plus) {
+                    w.values.back() = -w.values.back();
+                }
+                break;
+            }
+            case EType::Binary: {
+                auto& node = expr.get<BinaryNode>();
+                if (task.step == 0) {
+                    switch (node.op) {
+                        case TType::Slash:
+                        case TType::Percent:
+                            // The divisor runs and is checked before the dividend.
+                            w.tasks.push_back(Task{&expr, nullptr, 1});
+                            push(node.right);
+                            break;
+                        case TType::Equals:
+                            if (node.left->type != EType::Local) {
+                                if (node.left->type != EType::Variable) {
+                                    fail(state, expr.position,
+                                         make_error(ErrorCode::InvalidAssignment));
+                                    continue;
+                                }
+                                const auto& name = node.left->get<Identifier>();
+                                if (is_reserved_identifier(name)) {
+                                    fail(state, expr.position,
+                                         name_error(ErrorCode::ReadOnly, name));
+                                    continue;
+                                }
+                            }
+                            w.tasks.push_back(Task{&expr, nullptr, 2});
+                            push(node.right);
+                            break;
+                        case TType::Plus:
+                        case TType::Minus:
+                        case TType::Star:
+                        case TType::Caret:
+                        case TType::Less:
+                        case TType::LessEqual:
+                        case TType::Greater:
+                        case TType::GreaterEqual:
+                        case TType::EqualEqual:
+                        case TType::BangEqual:
+                            w.tasks.push_back(Task{&expr, nullptr, 2});
+                            push(node.right);
+                            push(node.left);
+                            break;
+                        default:
+                            fail(state, expr.position, make_error(ErrorCode::InvalidOperator));
+                            continue;
+                    }
+                    break;
+                }
+                if (task.step == 1) {
+                    if (w.values.back() == 0.0) {
+                        fail(state, expr.position,
+                             make_error(node.op == TType::Slash ? ErrorCode::DivisionByZero
+                                                                : ErrorCode::ModuloByZero));
+                        continue;
+                    }
+                    w.tasks.push_back(Task{&expr, nullptr, 3});
+                    push(node.left);
+                    break;
+                }
+                if (node.op == TType::Equals) {
+                    if (node.left->type == EType::Local) {
+                        const std::uint16_t slot = node.left->get<LocalNode>().slot;
+                        ctx.slots[slot] = w.values.back();
+                        ctx.live[slot] = 1;
+                    } else {
+                        state.vars.set(node.left->get<Identifier>(), w.values.back());
+                    }
+                    break;
+                }
+                // Step 3 pops the dividend over the divisor; step 2 pops right over left.
+                const double top = pop();
+                const double below = w.values.back();
+                const double left = task.step == 3 ? top : below;
+                const double right = task.step == 3 ? below : top;
+                w.values.back() = apply_binary(expr, node.op, left, right, state);
+                break;
+            }
+            case EType::Builtin: {
+                auto& node = expr.get<BuiltinNode>();
+                if (task.step == 0) {
+                    w.tasks.push_back(Task{&expr, nullptr, 1});
+                    if (node.args[1]) {
+                        push(node.args[1]);
+                    }
+                    push(node.args[0]);
+                } else if (!node.args[1]) {
+                    w.values.back() = require_builtin_finite(node.spec->unary(w.values.back()),
+                                                             *node.spec, expr.position, state);
+                } else {
+                    const double second = pop();
+                    w.values.back() =
+                        require_builtin_finite(node.spec->binary(w.values.back(), second),
+                                               *node.spec, expr.position, state);
+                }
+                break;
+            }
+            case EType::Ternary: {
+                auto& node = expr.get<TernaryNode>();
+                if (task.step == 0) {
+                    w.tasks.push_back(Task{&expr, nullptr, 1});
+                    push(node.condition);
+                } else {
+                    // The branch takes the ternary's place, keeping tail position.
+                    push(pop() != 0.0 ? node.then_branch : node.else_branch);
+                }
+                break;
+            }
+            case EType::Power: {
+                auto& node = expr.get<PowerNode>();
+                if (task.step == 0) {
+                    w.tasks.push_back(Task{&expr, nullptr, 1});
+                    push(node.base);
+                } else {
+                    const double base = w.values.back();
+                    w.values.back() = require_finite(node.kind == PowerNode::Kind::SquareRoot
+                                                         ? square_root(base)
+                                                         : integer_power(base, node.exponent),
+                                                     expr.position, state);
+                }
+                break;
+            }
+            case EType::FnCall: {
+                auto& node = expr.get<FnNode>();
+                if (task.step == 0) {
+                    FnObj* callee = nullptr;
+                    if (const BuiltinSpec* spec = find_builtin(node.name)) {
+                        if (!check_builtin_arity(*spec, expr, state)) {
+                            continue;
+                        }
+                    } else if (callee = find_function(expr, state); !callee) {
+                        continue;
+                    }
+                    w.tasks.push_back(Task{&expr, callee, 1});
+                    for (auto it = node.args.rbegin(); it != node.args.rend(); ++it) {
+                        push(*it);
+                    }
+                    break;
+                }
+                const std::size_t count = node.args.size();
+                if (!task.callee) {
+                    const BuiltinSpec& spec = *find_builtin(node.name);
+                    const double value = require_builtin_finite(
+                        call_builtin(spec, w.values.data() + w.values.size() - count), spec,
+                        expr.position, state);
+                    w.values.resize(w.values.size() - count);
+                    w.values.push_back(value);
+                    break;
+                }
+
+                FnObj& callee = *task.callee;
+                MemoTable* memo = ready_memo(callee, state);
+                MemoTable::Key key{};
+                if (memo) {
+                    std::copy_n(w.values.end() - static_cast<std::ptrdiff_t>(count), count,
+                                key.begin());
+                    if (auto value = memo->find(key)) {
+                        w.values.resize(w.values.size() - count);
+                        w.values.push_back(*value);
+                        break;
+                    }
+                }
+                // A memoized call must return here to store its result.
+                const bool tail =
+                    !memo && (w.tasks.size() == scope.base() || !w.tasks.back().node);
+                if (!tail && !enter_call(state)) {
+                    fail(state, expr.position, call_depth_exceeded(state));
+                    continue;
+                }
+                if (state.engine == Engine::Jit && tier_up(callee)) {
+                    auto value =
+                        callee.native->run(w.values.data() + w.values.size() - count, state);
+                    if (value) {
+                        if (!tail) {
+                            --state.call_depth;
+                        }
+                        if (memo) {
+                            memo->insert(key, *value);
+                        }
+                        w.values.resize(w.values.size() - count);
+                        w.values.push_back(*value);
+                        break;
+                    }
+                    state.engine = Engine::Tree;
+                }
+                if (tail) {
+                    w.frames.release(w.tasks.size() == scope.base() ? scope.mark()
+                                                                    : w.calls.back().mark);
+                } else {
+                    if (memo) {
+                        w.memos.push_back(PendingMemo{memo, key, w.calls.size()});
+                    }
+                    w.calls.push_back(CallRecord{ctx, w.frames.mark()});
+                    w.tasks.push_back(Task{});
+                }
+                ctx = enter_frame(w.frames, callee, w.values.data() + w.values.size() - count);
+                w.values.resize(w.values.size() - count);
+                push(callee.expr);
+                break;
+            }
+            case EType::Number:
+            case EType::Variable:
+            case EType::Local:
+            case EType::Polynomial:
+            case EType::Reduce:
+                w.values.push_back(eval_value(expr, state, ctx));
+                break;
+        }
+    }
+    return w.values.back();
+}
+
+/** @brief Slots for one recursive call: up to kInlineFrameSlots on the C++ stack, more on the heap. */
+struct Frame {
+    explicit Frame(std::size_t size) { reserve(size); }
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    /** @brief Make room for at least `size` slots; their contents are not kept. */
+    void reserve(std::size_t size) {
+        if (size > kInlineFrameSlots && heap_slots.size() < size) {
+            heap_slots.resize(size);
+            heap_live.resize(size);
+            ctx = EvalContext{.slots = heap_slots.data(), .live = heap_live.data()};
+        }
+    }
+
+    std::array<double, kInlineFrameSlots> inline_slots;
+    std::array<std::uint8_t, kInlineFrameSlots> inline_live;
+    std::vector<double> heap_slots;
+    std::vector<std::uint8_t> heap_live;
+    EvalContext ctx{.slots = inline_slots.data(), .live = inline_live.data()};
+};
+
+/** @brief Switches State::engine to `engine` for the lifetime of the scope. */
+class EngineScope {
+public:
+    EngineScope(State& state, Engine engine) : state_(state), engine_(state.engine) {
+        state.engine = engine;
+    }
+    ~EngineScope() { state_.engine = engine_; }
+
+    EngineScope(const EngineScope&) = delete;
+    EngineScope& operator=(const EngineScope&) = delete;
+
+private:
+    State& state_;
+    Engine engine_;
+};
+
+/** @brief Run a user function whose arguments fill the first slots of
+ *  `frame`; the caller has already counted the call in State::call_depth.
+ *
+ *  Up to kRecursiveCallDepth nested calls, the body is evaluated recursively,
+ *  which is the fastest way through shallow calls. Deeper calls switch to
+ *  run_iterative(), so the C++ stack stays bounded however deep user
+ *  recursion goes. Either way a call in tail position, reached from the body
+ *  through ternary branches, reuses the frame and does not count toward
+ *  State::max_call_depth.
+ */
+double run_function(FnObj& fn, Frame& frame, State& state, bool try_native) {
+    if (state.call_depth > kRecursiveCallDepth) {
+        return run_iterative(fn, frame.ctx.slots, state, try_native);
+    }
+    FnObj* current = &fn;
+    while (true) {
+        if (try_native && state.engine == Engine::Jit && tier_up(*current)) {
+            if (auto value = current->native->run(frame.ctx.slots, state)) {
+                return *value;
+            }
+            // Finish in the walker alone, which records the error native code detected.
+            EngineScope engine{state, Engine::Tree};
+            return run_function(*current, frame, state, false);
+        }
+        EvalContext& ctx = frame.ctx;
+        start_frame(ctx, *current);
+
+        Expression* node = current->expr;
+        while (node->type == EType::Ternary && !computed(*node, ctx)) {
+            auto& ternary = node->get<TernaryNode>();
+            node = eval_value(*ternary.condition, state, ctx) != 0.0 ? ternary.then_branch
+                                                                      : ternary.else_branch;
+        }
+        if (node->type != EType::FnCall || find_builtin(node->get<FnNode>().name) ||
+            computed(*node, ctx)) {
+            return eval_value(*node, state, ctx);
+        }
+        auto& call = node->get<FnNode>();
+        current = find_function(*node, state);
+        if (!current || failed(state)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        if (current->memo) {
+            // A memoized call must return here to store its result.
+            return eval_value(*node, state, ctx);
+        }
+        ArgBuffer args;
+        const double* values = args.evaluate(call.args, state, ctx);
+        if (failed(state)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        frame.reserve(frame_slots(*current));
+        std::copy_n(values, current->params.size(), frame.ctx.slots);
+        try_native = true;
+    }
+}
+
+/** @brief Run memoized `fn` on the arguments in `frame`, answering from its
+ *  table when it can. If the body runs, `count_call` counts the call in
+ *  State::call_depth; native callers have counted it already.
+ */
+double run_memoized(FnObj& fn, Frame& frame, State& state, bool count_call,
+                    std::uint32_t position) {
+    MemoTable* memo = ready_memo(fn, state);
+    MemoTable::Key key{};
+    if (memo) {
+        std::copy_n(frame.ctx.slots, fn.params.size(), key.begin());
+        if (auto value = memo->find(key)) {
+            return *value;
+        }
+    }
+    std::optional<CallScope> call;
+    if (count_call && !call.emplace(state).entered()) {
+        return fail(state, position, call_depth_exceeded(state));
+    }
+    const double value = run_function(fn, frame, state, true);
+    if (memo && !failed(state)) {
+        memo->insert(key, value);
+    }
+    return value;
+}
+
+double eval_function_call(Expression& expr, State& state, EvalContext& ctx) {
+    auto& node = expr.get<FnNode>();
+    if (const BuiltinSpec* found = find_builtin(node.name)) {
+        const BuiltinSpec& spec = *found;
+        if (!check_builtin_arity(spec, expr, state)) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        std::array<double, kMaxBuiltinArity> args{};
+        for (std::size_t index = 0; index < node.args.size(); ++index) {
+            args[index] = eval_value(*node.args[index], state, ctx);
+        }
+        return require_builtin_finite(call_builtin(spec, args.data()), spec, expr.position,
+                                      state);
+    }
+
+    FnObj* fn_obj = find_function(expr, state);
+    if (!fn_obj) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    Frame frame{frame_slots(*fn_obj)};
+    for (std::size_t index = 0; index < fn_obj->params.size(); ++index) {
+        frame.ctx.slots[index] = eval_value(*node.args[index], state, ctx);
+    }
+    if (failed(state)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double value;
+    if (fn_obj->memo) {
+        value = run_memoized(*fn_obj, frame, state, true, expr.position);
+    } else if (CallScope call{state}; call.entered()) {
+        value = run_function(*fn_obj, frame, state, true);
+    } else {
+        return fail(state, expr.position, call_depth_exceeded(state));
+    }
+    if (!ctx.slots && failed(state)) {
+        // The error happened inside the function; the query only knows where it called it.
+        state.error.position = expr.position;
+    }
+    return value;
 }
 
 double eval_ternary(TernaryNode& node, State& state, EvalContext& ctx) {
@@ -139,58 +895,151 @@ double eval_ternary(TernaryNode& node, State& state, EvalContext& ctx) {
     return eval_value(*node.else_branch, state, ctx);
 }
 
-double eval_value(Expression& expr, State& state, EvalContext& ctx) {
+double eval_global(Identifier name, std::uint32_t position, State& state) {
+    if (const double* value = state.vars.find(name)) {
+        return *value;
+    }
+    return fail(state, position, name_error(ErrorCode::UndefinedVariable, name));
+}
+
+double eval_local(const LocalNode& node, std::uint32_t position, State& state,
+                  const EvalContext& ctx) {
+    if (ctx.live[node.slot] != 0) {
+        return ctx.slots[node.slot];
+    }
+    // An assigned local read before its first assignment falls back to the global.
+    return eval_global(node.name, position, state);
+}
+
+double eval_variable(Identifier name, std::uint32_t position, State& state) {
+    if (name == last_result_symbol()) {
+        if (!state.has_last_result) {
+            return fail(state, position, make_error(ErrorCode::NoLastResult));
+        }
+        return state.last_result;
+    }
+    if (const double* value = state.vars.find(name)) {
+        return *value;
+    }
+    if (const double* value = find_constant(name)) {
+        return *value;
+    }
+    return fail(state, position, name_error(ErrorCode::UndefinedVariable, name));
+}
+
+double eval_power(Expression& expr, State& state, EvalContext& ctx) {
+    auto& node = expr.get<PowerNode>();
+    double base = eval_value(*node.base, state, ctx);
+    return require_finite(node.kind == PowerNode::Kind::SquareRoot
+                              ? square_root(base)
+                              : integer_power(base, node.exponent),
+                          expr.position, state);
+}
+
+double eval_polynomial(Expression& expr, State& state, EvalContext& ctx) {
+    auto& node = expr.get<PolyNode>();
+    double x = node.slot == kNoSlot
+                   ? eval_variable(node.variable, expr.position, state)
+                   : eval_local(LocalNode{node.variable, node.slot}, expr.position, state, ctx);
+    if (std::fabs(x) <= node.limit()) {
+        return horner(node.coefficients, node.degree, x);
+    }
+    return eval_value(*node.fallback, state, ctx);
+}
+
+/** @brief Evaluate the bounds and captured locals, then run the reduction's closure. */
+double eval_reduce(Expression& expr, State& state, EvalContext& ctx) {
+    auto& node = expr.get<ReduceNode>();
+    std::vector<double> values;
+    values.reserve(node.args.size() - 1);
+    values.push_back(eval_value(*node.lower(), state, ctx));
+    values.push_back(eval_value(*node.upper(), state, ctx));
+    for (ExpressionPtr capture : node.captures()) {
+        if (capture->type == EType::Local) {
+            values.push_back(eval_value(*capture, state, ctx));
+        }
+    }
+    if (failed(state)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    const auto value = try_reduce(node, values.data(), state);
+    if (!value) {
+        return fail(state, expr.position, value.error());
+    }
+    return *value;
+}
+
+double eval_node(Expression& expr, State& state, EvalContext& ctx) {
     switch (expr.type) {
         case EType::Number:
             return expr.get<double>();
-        case EType::Variable: {
-            const auto& name = expr.get<Identifier>();
-            if (ctx.locals) {
-                auto it = ctx.locals->find(name);
-                if (it != ctx.locals->end()) {
-                    return it->second;
-                }
-            }
-            if (name == "_") {
-                if (!state.has_last_result) {
-                    throw EvalError("No previous result available for '_'");
-                }
-                return state.last_result;
-            }
-            auto var_it = state.vars.find(name);
-            if (var_it != state.vars.end()) {
-                return var_it->second;
-            }
-            const auto& values = constants();
-            if (auto const_it = values.find(name); const_it != values.end()) {
-                return const_it->second;
-            }
-            throw EvalError(std::format("Variable '{}' not defined", name));
-        }
+        case EType::Variable:
+            return eval_variable(expr.get<Identifier>(), expr.position, state);
+        case EType::Local:
+            return eval_local(expr.get<LocalNode>(), expr.position, state, ctx);
         case EType::Unary: {
             auto& node = expr.get<UnaryNode>();
             double value = eval_value(*node.right, state, ctx);
             return node.op == TType::Plus ? value : -value;
         }
         case EType::Binary:
-            return eval_binary(expr.get<BinaryNode>(), state, ctx);
+            return eval_binary(expr, state, ctx);
         case EType::FnCall:
-            return eval_function_call(expr.get<FnNode>(), state, ctx);
+            return eval_function_call(expr, state, ctx);
+        case EType::Builtin:
+            return eval_builtin(expr, state, ctx);
         case EType::Ternary:
             return eval_ternary(expr.get<TernaryNode>(), state, ctx);
+        case EType::Power:
+            return eval_power(expr, state, ctx);
+        case EType::Polynomial:
+            return eval_polynomial(expr, state, ctx);
+        case EType::Reduce:
+            return eval_reduce(expr, state, ctx);
     }
 
-    throw EvalError("Invalid expression type");
+    return fail(state, expr.position, make_error(ErrorCode::InvalidExpression));
 }
 
-EvalResult define_function(BinaryNode& node, State& state) {
+/** @brief Evaluate `expr`, or reload it if this call has already computed it.
+ *
+ *  Nodes a function body reaches through several parents (Chunk::shared)
+ *  are computed once per call, like in the VM; a failed computation is not
+ *  kept, since the evaluation stops with its error anyway.
+ */
+double eval_value(Expression& expr, State& state, EvalContext& ctx) {
+    if (expr.cached) [[unlikely]] {
+        if (const std::uint16_t slot = cache_slot(expr, ctx); slot != kNoSlot) {
+            if (ctx.live[slot] == 0) {
+                ctx.slots[slot] = eval_node(expr, state, ctx);
+                ctx.live[slot] = failed(state) ? 0 : 1;
+            }
+            return ctx.slots[slot];
+        }
+    }
+    return eval_node(expr, state, ctx);
+}
+
+/** @brief `error` found at `position` of a query. */
+std::unexpected<Error> error_at(std::uint32_t position, Error error) {
+    error.position = position;
+    return std::unexpected(error);
+}
+
+std::expected<EvalResult, Error> define_function(Expression& expr, State& state) {
+    auto& node = expr.get<BinaryNode>();
+    if (node.left->type == EType::Reduce) {
+        return error_at(node.left->position,
+                        reduction_error(ErrorCode::ReductionDefinition,
+                                        node.left->get<ReduceNode>().kind));
+    }
     if (node.left->type != EType::FnCall) {
-        throw EvalError("Invalid function definition");
+        return error_at(expr.position, make_error(ErrorCode::InvalidDefinition));
     }
 
     auto& fn_node = node.left->get<FnNode>();
     if (is_reserved_identifier(fn_node.name)) {
-        throw EvalError(std::format("'{}' is read-only", fn_node.name));
+        return error_at(node.left->position, name_error(ErrorCode::ReadOnly, fn_node.name));
     }
 
     Identifiers params;
@@ -199,53 +1048,227 @@ EvalResult define_function(BinaryNode& node, State& state) {
 
     for (const auto& arg : fn_node.args) {
         if (arg->type != EType::Variable) {
-            throw EvalError("Function parameters must be identifiers");
+            return error_at(arg->position, make_error(ErrorCode::InvalidParameter));
         }
         const auto& name = arg->get<Identifier>();
         if (is_reserved_identifier(name)) {
-            throw EvalError(std::format("'{}' is read-only", name));
+            return error_at(arg->position, name_error(ErrorCode::ReadOnly, name));
         }
         if (!seen.insert(name).second) {
-            throw EvalError(std::format("Duplicate parameter '{}'", name));
+            return error_at(arg->position, name_error(ErrorCode::DuplicateParameter, name));
         }
         params.push_back(name);
     }
 
     if (!node.right) {
-        throw EvalError("Function definition is missing a body");
+        return error_at(expr.position, make_error(ErrorCode::MissingBody));
     }
 
-    state.fns[fn_node.name] = FnObj{params, std::move(node.right)};
+    const auto frame_size = resolve_locals(*node.right, params);
+    if (!frame_size) {
+        return error_at(expr.position, frame_size.error());
+    }
+    ExpressionPtr body = state.dag.intern(*node.right);
+    Chunk code =
+        compile_function(*body, static_cast<std::uint16_t>(params.size()), *frame_size);
+    // Memoization survives redefinition and is switched on for tree recursion.
+    auto [slot, inserted] = state.fns.try_emplace(fn_node.name);
+    const bool memoize = params.size() <= kMaxMemoArity &&
+                         (slot->second.memo || recurses_repeatedly(*body, fn_node.name));
+    FnObj previous = std::exchange(
+        slot->second, FnObj{params, body, std::move(code), *frame_size, 0, nullptr,
+                            memoize ? std::make_unique<MemoTable>(params.size()) : nullptr});
+    ++state.fns_version;
+
+    // Bindings that call functions may now read other globals; a definition
+    // that would make one depend on itself is undone.
+    if (auto relinked = state.bindings.relink_callers(state); !relinked) {
+        if (inserted) {
+            state.fns.erase(slot);
+        } else {
+            slot->second = std::move(previous);
+        }
+        ++state.fns_version;
+        return std::unexpected(relinked.error());
+    }
+    if (auto updated = state.bindings.recompute_callers(state); !updated) {
+        return std::unexpected(updated.error());
+    }
 
     return EvalResult{std::nullopt,
-                      std::format("Defined {}({})", fn_node.name, join_params(params))};
+                      std::format("Defined {}({})", symbol_name(fn_node.name),
+                                  join_params(params))};
+}
+
+bool is_definition(const Expression& expr) {
+    if (expr.type != EType::Binary) {
+        return false;
+    }
+    const auto& node = expr.get<BinaryNode>();
+    return node.op == TType::Equals && node.left &&
+           (node.left->type == EType::FnCall || node.left->type == EType::Reduce);
+}
+
+/** @brief Result of a query that produced `value`. */
+std::expected<EvalResult, Error> value_result(const std::expected<double, Error>& value) {
+    if (!value) {
+        return std::unexpected(value.error());
+    }
+    return EvalResult{*value, std::nullopt};
 }
 
 }  // namespace
 
-EvalResult evaluate(Expression& expr, State& state) {
-    EvalContext ctx{nullptr, true};
+std::expected<double, Error> call_function(FnObj& fn, const double* args, State& state) {
+    Frame frame{frame_slots(fn)};
+    std::copy_n(args, fn.params.size(), frame.ctx.slots);
+    const double value = fn.memo ? run_memoized(fn, frame, state, false, kNoPosition)
+                                 : run_function(fn, frame, state, false);
+    if (failed(state)) {
+        // Positions inside the body do not point into the caller's query.
+        Error error = std::exchange(state.error, Error{});
+        error.position = kNoPosition;
+        return std::unexpected(error);
+    }
+    return value;
+}
 
-    if (expr.type == EType::Binary) {
-        auto& node = expr.get<BinaryNode>();
-        if (node.op == TType::Equals && node.left && node.left->type == EType::FnCall) {
-            return define_function(node, state);
-        }
+std::expected<EvalResult, Error> try_evaluate(Expression& expr, State& state) {
+    if (is_definition(expr)) {
+        return define_function(expr, state);
+    }
+    if (is_binding(expr)) {
+        const auto& node = expr.get<BinaryNode>();
+        return value_result(
+            state.bindings.define(node.left->get<Identifier>(), *node.right, state));
+    }
+
+    if (state.engine == Engine::Bytecode) {
+        return value_result(execute(compile(expr), state));
     }
 
-    double value = eval_value(expr, state, ctx);
+    EvalContext ctx{};
+    const double value = eval_value(expr, state, ctx);
+    if (failed(state)) {
+        return std::unexpected(std::exchange(state.error, Error{}));
+    }
     return EvalResult{value, std::nullopt};
 }
 
-EvalResult process_query(std::string_view input, State& state) {
-    Tokens tokens = tokenize(input);
-    ExpressionPtr expr = parse(tokens);
-    EvalResult result = evaluate(*expr, state);
-    if (result.value) {
-        state.last_result = *result.value;
+EvalResult evaluate(Expression& expr, State& state) {
+    auto result = try_evaluate(expr, state);
+    if (!result) {
+        throw_error(result.error());
+    }
+    return std::move(*result);
+}
+
+namespace {
+
+std::expected<EvalResult, Error> record_result(std::expected<EvalResult, Error> result,
+                                               State& state) {
+    if (result && result->value) {
+        state.last_result = *result->value;
         state.has_last_result = true;
     }
     return result;
 }
 
+/** @brief Run a top-level query through `run`, then recompute the bindings
+ *  downstream of the globals it assigned, also when it fails partway.
+ */
+template <typename Run>
+std::expected<EvalResult, Error> run_query(const Expression& expr, State& state, Run run) {
+    if (state.bindings.empty()) {
+        return record_result(run(), state);
+    }
+    Identifiers assigned = assigned_globals(expr);
+    std::vector<std::uint64_t> versions;
+    versions.reserve(assigned.size());
+    for (Identifier name : assigned) {
+        versions.push_back(state.vars.version(name));
+    }
+    // Only names the query actually wrote, e.g. not the untaken branch of a ternary.
+    auto changed = [&] {
+        std::size_t kept = 0;
+        for (std::size_t index = 0; index < assigned.size(); ++index) {
+            if (state.vars.version(assigned[index]) != versions[index]) {
+                assigned[kept++] = assigned[index];
+            }
+        }
+        assigned.resize(kept);
+        return std::span<const Identifier>{assigned};
+    };
+
+    auto result = run();
+    // On failure the query's own error is the one to report.
+    auto updated = state.bindings.assigned(changed(), state);
+    if (!result) {
+        return result;
+    }
+    if (!updated) {
+        return std::unexpected(updated.error());
+    }
+    return record_result(std::move(result), state);
+}
+
+std::expected<EvalResult, Error> evaluate_query(Expression& expr, State& state) {
+    return run_query(expr, state, [&] { return try_evaluate(expr, state); });
+}
+
+/** @brief `result`, or its error thrown with the message for `input`. */
+EvalResult value_or_throw(std::expected<EvalResult, Error> result, std::string_view input) {
+    if (!result) {
+        throw_error(result.error(), input);
+    }
+    return std::move(*result);
+}
+
+}  // namespace
+
+std::expected<EvalResult, Error> try_process_query(std::string_view input, State& state) {
+    QueryContext ctx;
+    return try_process_query(input, state, ctx);
+}
+
+std::expected<EvalResult, Error> try_process_query(std::string_view input, State& state,
+                                                   QueryContext& ctx) {
+    ctx.reset();
+    auto expr = try_parse(input, ctx);
+    if (!expr) {
+        return std::unexpected(expr.error());
+    }
+    return evaluate_query(*optimize(*expr, ctx.arena), state);
+}
+
+std::expected<EvalResult, Error> try_process_query(std::string_view input, State& state,
+                                                   ExpressionCache& cache) {
+    auto found = cache.try_lookup(input);
+    if (!found) {
+        return std::unexpected(found.error());
+    }
+    CachedQuery& query = **found;
+    if (state.engine == Engine::Bytecode && !is_definition(*query.expr) &&
+        !is_binding(*query.expr)) {
+        if (!query.code) {
+            query.code = compile(*query.expr);
+        }
+        return run_query(*query.expr, state,
+                         [&] { return value_result(execute(*query.code, state)); });
+    }
+    return evaluate_query(*query.expr, state);
+}
+
+EvalResult process_query(std::string_view input, State& state) {
+    return value_or_throw(try_process_query(input, state), input);
+}
+
+EvalResult process_query(std::string_view input, State& state, QueryContext& ctx) {
+    return value_or_throw(try_process_query(input, state, ctx), input);
+}
+
+EvalResult process_query(std::string_view input, State& state, ExpressionCache& cache) {
+    return value_or_throw(try_process_query(input, state, cache), input);
+}
+
 }  // namespace repl
@@ -1,7 +1,14 @@
 #include "repl/expression.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <format>
-#include <functional>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "repl/state.hpp"
 
 namespace repl {
 
@@ -13,251 +20,793 @@ std::ostream& operator<<(std::ostream& os, EType type) {
         case EType::Binary: return os << "Binary Expression";
         case EType::FnCall: return os << "FunctionCall";
         case EType::Ternary: return os << "Ternary Expression";
+        case EType::Power: return os << "Power";
+        case EType::Polynomial: return os << "Polynomial";
+        case EType::Local: return os << "Local";
+        case EType::Builtin: return os << "BuiltinCall";
+        case EType::Reduce: return os << "Reduction";
     }
     return os << "Unknown";
 }
 
-ExpressionPtr make_number(double value) {
-    auto expr = std::make_unique<Expression>();
-    expr->type = EType::Number;
-    expr->data = value;
-    return expr;
+namespace {
+
+std::uint32_t height_of(ExpressionPtr child) {
+    return child->height + 1;
 }
 
-ExpressionPtr make_variable(Identifier name) {
-    auto expr = std::make_unique<Expression>();
-    expr->type = EType::Variable;
-    expr->data = std::move(name);
-    return expr;
+}  // namespace
+
+ExpressionPtr make_number(Arena& arena, double value) {
+    return arena.make<Expression>(EType::Number, 1u, value);
 }
 
-ExpressionPtr make_unary(TType op, ExpressionPtr right) {
-    auto expr = std::make_unique<Expression>();
-    expr->type = EType::Unary;
-    expr->data = UnaryNode{.op = op, .right = std::move(right)};
-    return expr;
+ExpressionPtr make_variable(Arena& arena, Identifier name) {
+    return arena.make<Expression>(EType::Variable, 1u, name);
 }
 
-ExpressionPtr make_binary(TType op, ExpressionPtr left, ExpressionPtr right) {
-    auto expr = std::make_unique<Expression>();
-    expr->type = EType::Binary;
-    expr->data = BinaryNode{.op = op, .left = std::move(left), .right = std::move(right)};
-    return expr;
+ExpressionPtr make_unary(Arena& arena, TType op, ExpressionPtr right) {
+    return arena.make<Expression>(EType::Unary, height_of(right),
+                                  UnaryNode{.op = op, .right = right});
 }
 
-ExpressionPtr make_fn_call(Identifier name, ExpressionList args) {
-    auto expr = std::make_unique<Expression>();
-    expr->type = EType::FnCall;
-    expr->data = FnNode{.name = std::move(name), .args = std::move(args)};
-    return expr;
+ExpressionPtr make_binary(Arena& arena, TType op, ExpressionPtr left, ExpressionPtr right) {
+    return arena.make<Expression>(EType::Binary, std::max(height_of(left), height_of(right)),
+                                  BinaryNode{.op = op, .left = left, .right = right});
+}
+
+ExpressionPtr make_fn_call(Arena& arena, Identifier name, ExpressionList args) {
+    std::uint32_t height = 1;
+    for (ExpressionPtr arg : args) {
+        height = std::max(height, height_of(arg));
+    }
+    return arena.make<Expression>(EType::FnCall, height, FnNode{.name = name, .args = args});
 }
 
-ExpressionPtr make_ternary(ExpressionPtr condition, ExpressionPtr then_branch,
+ExpressionPtr make_ternary(Arena& arena, ExpressionPtr condition, ExpressionPtr then_branch,
                            ExpressionPtr else_branch) {
-    auto expr = std::make_unique<Expression>();
-    expr->type = EType::Ternary;
-    expr->data = TernaryNode{.condition = std::move(condition),
-                             .then_branch = std::move(then_branch),
-                             .else_branch = std::move(else_branch)};
-    return expr;
+    const std::uint32_t height = std::max(
+        {height_of(condition), height_of(then_branch), height_of(else_branch)});
+    return arena.make<Expression>(EType::Ternary, height,
+                                  TernaryNode{.condition = condition,
+                                              .then_branch = then_branch,
+                                              .else_branch = else_branch});
 }
 
-namespace {
+ExpressionPtr make_power(Arena& arena, PowerNode::Kind kind, std::int32_t exponent,
+                         ExpressionPtr base) {
+    return arena.make<Expression>(EType::Power, height_of(base),
+                                  PowerNode{.kind = kind, .exponent = exponent, .base = base});
+}
+
+ExpressionPtr make_builtin_call(Arena& arena, const BuiltinSpec& spec, ExpressionPtr first,
+                                ExpressionPtr second) {
+    std::uint32_t height = height_of(first);
+    if (second) {
+        height = std::max(height, height_of(second));
+    }
+    return arena.make<Expression>(EType::Builtin, height,
+                                  BuiltinNode{.spec = &spec, .args = {first, second}});
+}
 
-ExpressionPtr parse_assignment(TokenStream& stream);
+ExpressionPtr make_reduce(Arena& arena, ReduceKind kind, Identifier variable,
+                          ExpressionList args) {
+    std::uint32_t height = 1;
+    for (ExpressionPtr arg : args) {
+        height = std::max(height, height_of(arg));
+    }
+    return arena.make<Expression>(EType::Reduce, height,
+                                  ReduceNode{.variable = variable, .kind = kind, .args = args});
+}
 
-ExpressionList parse_fn_args(TokenStream& stream) {
-    stream.expect(TType::LParen);
+ExpressionPtr make_polynomial(Arena& arena, Identifier variable,
+                              std::span<const double> coefficients, ExpressionPtr fallback) {
+    const auto degree = static_cast<std::uint16_t>(coefficients.size() - 2);
+    return arena.make<Expression>(EType::Polynomial, height_of(fallback),
+                                  PolyNode{.variable = variable,
+                                           .slot = kNoSlot,
+                                           .degree = degree,
+                                           .coefficients = coefficients.data(),
+                                           .fallback = fallback});
+}
 
-    std::vector<Tokens> token_sets;
-    token_sets.emplace_back();
-    int paren_depth = 0;
+namespace {
 
-    while (!stream.empty()) {
-        if (stream.peek().type == TType::RParen && paren_depth == 0) {
-            break;
-        }
+std::string_view op_text(TType op) {
+    switch (op) {
+        case TType::Plus: return "+";
+        case TType::Minus: return "-";
+        case TType::Star: return "*";
+        case TType::Slash: return "/";
+        case TType::Percent: return "%";
+        case TType::Caret: return "^";
+        case TType::Equals: return "=";
+        case TType::ColonEquals: return ":=";
+        case TType::EqualEqual: return "==";
+        case TType::BangEqual: return "!=";
+        case TType::Less: return "<";
+        case TType::LessEqual: return "<=";
+        case TType::Greater: return ">";
+        case TType::GreaterEqual: return ">=";
+        default: return to_string(op);
+    }
+}
 
-        const Token& token = stream.get();
-        if (token.type == TType::LParen) {
-            ++paren_depth;
-        } else if (token.type == TType::RParen) {
-            if (paren_depth == 0) {
-                throw ParseError("Unexpected ')' inside function arguments");
+void format_node(std::ostream& os, const Expression& expr, std::size_t indent) {
+    os << std::string(indent * 2, ' ');
+    switch (expr.type) {
+        case EType::Number:
+            os << expr.get<double>() << '\n';
+            return;
+        case EType::Variable:
+            os << symbol_name(expr.get<Identifier>()) << '\n';
+            return;
+        case EType::Local:
+            os << symbol_name(expr.get<LocalNode>().name) << '\n';
+            return;
+        case EType::Unary: {
+            const auto& node = expr.get<UnaryNode>();
+            os << "unary " << op_text(node.op) << '\n';
+            format_node(os, *node.right, indent + 1);
+            return;
+        }
+        case EType::Binary: {
+            const auto& node = expr.get<BinaryNode>();
+            os << op_text(node.op) << '\n';
+            format_node(os, *node.left, indent + 1);
+            format_node(os, *node.right, indent + 1);
+            return;
+        }
+        case EType::FnCall: {
+            const auto& node = expr.get<FnNode>();
+            os << "call " << symbol_name(node.name) << '\n';
+            for (ExpressionPtr arg : node.args) {
+                format_node(os, *arg, indent + 1);
             }
-            --paren_depth;
+            return;
         }
-
-        if (token.type == TType::Comma && paren_depth == 0) {
-            token_sets.emplace_back();
-            continue;
+        case EType::Builtin: {
+            const auto& node = expr.get<BuiltinNode>();
+            os << "call " << node.spec->name << '\n';
+            for (std::size_t index = 0; index < node.spec->arity; ++index) {
+                format_node(os, *node.args[index], indent + 1);
+            }
+            return;
+        }
+        case EType::Ternary: {
+            const auto& node = expr.get<TernaryNode>();
+            os << "?:\n";
+            format_node(os, *node.condition, indent + 1);
+            format_node(os, *node.then_branch, indent + 1);
+            format_node(os, *node.else_branch, indent + 1);
+            return;
+        }
+        case EType::Power: {
+            const auto& node = expr.get<PowerNode>();
+            if (node.kind == PowerNode::Kind::SquareRoot) {
+                os << "sqrt\n";
+            } else {
+                os << '^' << node.exponent << '\n';
+            }
+            format_node(os, *node.base, indent + 1);
+            return;
+        }
+        case EType::Reduce: {
+            const auto& node = expr.get<ReduceNode>();
+            os << reduction_spec(node.kind).name << ' ' << symbol_name(node.variable) << '\n';
+            format_node(os, *node.lower(), indent + 1);
+            format_node(os, *node.upper(), indent + 1);
+            format_node(os, *node.body(), indent + 1);
+            return;
+        }
+        case EType::Polynomial: {
+            const auto& node = expr.get<PolyNode>();
+            os << "horner " << symbol_name(node.variable) << ':';
+            for (std::size_t index = 0; index <= node.degree; ++index) {
+                os << (index == 0 ? " " : ", ") << node.coefficients[index];
+            }
+            os << '\n';
+            return;
         }
-        token_sets.back().push_back(token);
     }
+}
 
-    if (stream.empty()) {
-        throw ParseError("Expected ')' to close function call");
-    }
-    stream.get();
+}  // namespace
 
-    if (token_sets.size() == 1 && token_sets.front().empty()) {
-        return {};
+std::string format_tree(const Expression& expr) {
+    std::ostringstream out;
+    format_node(out, expr, 0);
+    std::string text = out.str();
+    if (!text.empty()) {
+        text.pop_back();
     }
+    return text;
+}
+
+namespace {
 
-    ExpressionList args;
-    args.reserve(token_sets.size());
-    for (const auto& tokens : token_sets) {
-        if (tokens.empty()) {
-            throw ParseError("Empty function argument");
+/** @brief Copy of `expr` with cloned children, but no position. */
+ExpressionPtr clone_node(const Expression& expr, Arena& arena) {
+    switch (expr.type) {
+        case EType::Number:
+            return make_number(arena, expr.get<double>());
+        case EType::Variable:
+            return make_variable(arena, expr.get<Identifier>());
+        case EType::Local:
+            return arena.make<Expression>(expr);
+        case EType::Unary: {
+            const auto& node = expr.get<UnaryNode>();
+            return make_unary(arena, node.op, clone(*node.right, arena));
+        }
+        case EType::Binary: {
+            const auto& node = expr.get<BinaryNode>();
+            ExpressionPtr left = clone(*node.left, arena);
+            return make_binary(arena, node.op, left, clone(*node.right, arena));
+        }
+        case EType::FnCall: {
+            const auto& node = expr.get<FnNode>();
+            ExpressionList args = arena.copy<ExpressionPtr>(node.args);
+            for (ExpressionPtr& arg : args) {
+                arg = clone(*arg, arena);
+            }
+            return make_fn_call(arena, node.name, args);
+        }
+        case EType::Reduce: {
+            const auto& node = expr.get<ReduceNode>();
+            ExpressionList args = arena.copy<ExpressionPtr>(node.args);
+            for (ExpressionPtr& arg : args) {
+                arg = clone(*arg, arena);
+            }
+            return make_reduce(arena, node.kind, node.variable, args);
+        }
+        case EType::Builtin: {
+            const auto& node = expr.get<BuiltinNode>();
+            ExpressionPtr first = clone(*node.args[0], arena);
+            ExpressionPtr second = node.args[1] ? clone(*node.args[1], arena) : nullptr;
+            return make_builtin_call(arena, *node.spec, first, second);
+        }
+        case EType::Ternary: {
+            const auto& node = expr.get<TernaryNode>();
+            ExpressionPtr condition = clone(*node.condition, arena);
+            ExpressionPtr then_branch = clone(*node.then_branch, arena);
+            return make_ternary(arena, condition, then_branch, clone(*node.else_branch, arena));
+        }
+        case EType::Power: {
+            const auto& node = expr.get<PowerNode>();
+            return make_power(arena, node.kind, node.exponent, clone(*node.base, arena));
+        }
+        case EType::Polynomial: {
+            const auto& node = expr.get<PolyNode>();
+            auto coefficients = arena.copy<double>({node.coefficients, node.degree + std::size_t{2}});
+            ExpressionPtr copy = make_polynomial(arena, node.variable, coefficients,
+                                                 clone(*node.fallback, arena));
+            copy->get<PolyNode>().slot = node.slot;
+            return copy;
         }
-        args.push_back(parse(tokens));
     }
+    throw ParseError("Invalid expression type");
+}
+
+}  // namespace
+
+ExpressionPtr clone(const Expression& expr, Arena& arena) {
+    ExpressionPtr copy = clone_node(expr, arena);
+    copy->position = expr.position;
+    return copy;
+}
 
-    return args;
+namespace {
+
+/** @brief Precedence levels, lowest to highest. Unary operators bind tighter than all. */
+enum class Precedence : std::uint8_t {
+    None,
+    Assignment,
+    Ternary,
+    Equality,
+    Relational,
+    Additive,
+    Term,
+    Power,
+};
+
+/** @brief Infix binding: `left` is the operator's own precedence and `right`
+ *  the minimum precedence accepted for its right operand. Right-associative
+ *  operators use right == left; left-associative ones one level higher.
+ */
+struct InfixOp {
+    Precedence left = Precedence::None;
+    Precedence right = Precedence::None;
+};
+
+constexpr std::size_t kTokenTypeCount = static_cast<std::size_t>(TType::Comma) + 1;
+
+constexpr std::array<InfixOp, kTokenTypeCount> make_infix_table() {
+    std::array<InfixOp, kTokenTypeCount> table{};
+    auto left_assoc = [&table](TType op, Precedence precedence) {
+        auto next = static_cast<Precedence>(static_cast<std::uint8_t>(precedence) + 1);
+        table[static_cast<std::size_t>(op)] = {precedence, next};
+    };
+    auto right_assoc = [&table](TType op, Precedence precedence) {
+        table[static_cast<std::size_t>(op)] = {precedence, precedence};
+    };
+
+    right_assoc(TType::Equals, Precedence::Assignment);
+    right_assoc(TType::Question, Precedence::Ternary);
+    left_assoc(TType::EqualEqual, Precedence::Equality);
+    left_assoc(TType::BangEqual, Precedence::Equality);
+    left_assoc(TType::Less, Precedence::Relational);
+    left_assoc(TType::LessEqual, Precedence::Relational);
+    left_assoc(TType::Greater, Precedence::Relational);
+    left_assoc(TType::GreaterEqual, Precedence::Relational);
+    left_assoc(TType::Plus, Precedence::Additive);
+    left_assoc(TType::Minus, Precedence::Additive);
+    left_assoc(TType::Star, Precedence::Term);
+    left_assoc(TType::Slash, Precedence::Term);
+    left_assoc(TType::Percent, Precedence::Term);
+    right_assoc(TType::Caret, Precedence::Power);
+    return table;
+}
+
+constexpr std::array<InfixOp, kTokenTypeCount> kInfixOps = make_infix_table();
+
+constexpr InfixOp infix_op(TType type) {
+    return kInfixOps[static_cast<std::size_t>(type)];
+}
+
+/** @brief Precedence floor for the operand a frame is waiting on. */
+Precedence operand_floor(const ParseFrame& frame) {
+    switch (frame.kind) {
+        case ParseFrame::Kind::Infix:
+            return infix_op(frame.op).right;
+        case ParseFrame::Kind::TernaryThen:
+        case ParseFrame::Kind::TernaryElse:
+            return Precedence::Ternary;
+        default:
+            return Precedence::Assignment;
+    }
 }
 
-ExpressionPtr parse_primary(TokenStream& stream) {
-    if (stream.empty()) {
-        throw ParseError("Unexpected end of input while parsing expression");
+/** @brief Precedence climber driven by explicit stacks instead of recursion.
+ *
+ *  Pending operators and brackets live on `ctx.frames` and finished subtrees
+ *  on `ctx.scratch`, so native stack use is constant and heap use grows with
+ *  the input. Both the frame stack and the height of every built node are
+ *  capped at `ctx.max_depth`.
+ */
+class Parser {
+public:
+    Parser(TokenStream& stream, QueryContext& ctx)
+        : stream_(stream), ctx_(ctx), frames_(ctx.frames), operands_(ctx.scratch) {
+        frames_.clear();
+        operands_.clear();
     }
 
-    const Token& current = stream.get();
-    switch (current.type) {
-        case TType::Number:
-            return make_number(current.get<double>());
-        case TType::Identifier: {
-            Identifier id = current.get<Identifier>();
-            if (!stream.empty() && stream.peek().type == TType::LParen) {
-                return make_fn_call(std::move(id), parse_fn_args(stream));
+    /** @brief Parse one expression; null on failure, with the reason in error(). */
+    ExpressionPtr run() {
+        while (true) {
+            if (!parse_operand()) {
+                if (error_) {
+                    return nullptr;
+                }
+                continue;
             }
-            return make_variable(std::move(id));
+            if (!parse_operators()) {
+                if (!error_ && stream_.error()) {
+                    fail(stream_.error());
+                }
+                if (error_) {
+                    return nullptr;
+                }
+                ExpressionPtr expr = pop_operand();
+                if (binding_) {
+                    ExpressionPtr name =
+                        at(make_variable(ctx_.arena, binding_->symbol), binding_->offset);
+                    return at(make_binary(ctx_.arena, TType::ColonEquals, name, expr),
+                              binding_->offset);
+                }
+                return expr;
+            }
+        }
+    }
+
+    const Error& error() const { return error_; }
+
+private:
+    /** @brief Consume prefix operators and one primary.
+     *  @return false if a frame was opened and another operand is needed
+     *  first, or on an error.
+     */
+    bool parse_operand() {
+        if (stream_.empty()) {
+            return fail(make_error(ErrorCode::UnexpectedEnd, end_position()));
+        }
+
+        const TType next = stream_.peek().type;
+        if (next == TType::Plus || next == TType::Minus) {
+            const Token op = stream_.get();
+            push_frame({.kind = ParseFrame::Kind::Unary, .op = next, .position = op.offset});
+            return false;
+        }
+
+        Token current = stream_.get();
+        switch (current.type) {
+            case TType::Number:
+                return push_operand(at(make_number(ctx_.arena, current.number), current.offset));
+            case TType::Identifier:
+                if (!stream_.empty() && stream_.peek().type == TType::LParen) {
+                    stream_.get();
+                    if (stream_.match(TType::RParen)) {
+                        ExpressionPtr call = make_call(current.symbol, current.offset, {});
+                        return call && push_operand(call);
+                    }
+                    push_frame({.kind = ParseFrame::Kind::Call,
+                                .name = current.symbol,
+                                .base = operands_.size(),
+                                .position = current.offset});
+                    expect_argument();
+                    return false;
+                }
+                if (frames_.empty() && operands_.empty() && !binding_ && !stream_.empty() &&
+                    stream_.peek().type == TType::ColonEquals) {
+                    // `name :=` opens a reactive binding; it only starts an expression.
+                    stream_.get();
+                    binding_ = current;
+                    return false;
+                }
+                return push_operand(
+                    at(make_variable(ctx_.arena, current.symbol), current.offset));
+            case TType::LParen:
+                push_frame({.kind = ParseFrame::Kind::Group, .position = current.offset});
+                return false;
+            default:
+                return fail(
+                    token_error(ErrorCode::ExpectedOperand, current.type, current.offset));
         }
-        case TType::LParen: {
-            ExpressionPtr result = parse_assignment(stream);
-            if (stream.empty()) {
-                throw ParseError("Expected ')' to close expression");
+    }
+
+    /** @brief Fold a finished operand into pending frames and extend it with
+     *  infix operators.
+     *  @return true if another operand is needed, false once the whole
+     *  expression is complete or on an error.
+     */
+    bool parse_operators() {
+        while (true) {
+            // Prefix operators bind tighter than any infix operator.
+            while (!frames_.empty() && frames_.back().kind == ParseFrame::Kind::Unary) {
+                const ParseFrame frame = frames_.back();
+                frames_.pop_back();
+                ExpressionPtr right = pop_operand();
+                if (!push_operand(at(make_unary(ctx_.arena, frame.op, right), frame.position))) {
+                    return false;
+                }
+            }
+
+            if (!stream_.empty()) {
+                const TType op = stream_.peek().type;
+                const InfixOp info = infix_op(op);
+                const Precedence floor =
+                    frames_.empty() ? Precedence::Assignment : operand_floor(frames_.back());
+                if (info.left != Precedence::None && info.left >= floor) {
+                    const Token token = stream_.get();
+                    return push_frame({.kind = op == TType::Question
+                                                   ? ParseFrame::Kind::TernaryThen
+                                                   : ParseFrame::Kind::Infix,
+                                       .op = op,
+                                       .position = token.offset});
+                }
+            }
+
+            if (frames_.empty()) {
+                return false;
+            }
+            if (close_frame()) {
+                return true;
             }
-            const Token& closing = stream.get();
-            if (closing.type != TType::RParen) {
-                throw ParseError(std::format("Expected ')' but found {}",
-                                             to_string(closing.type)));
+            if (error_) {
+                return false;
             }
-            return result;
         }
-        default:
-            throw ParseError(std::format(
-                "Could not parse expression starting with token '{}'", to_string(current.type)));
     }
-}
 
-ExpressionPtr parse_unary(TokenStream& stream) {
-    if (stream.empty()) {
-        throw ParseError("Unexpected end of input while parsing unary expression");
+    /** @brief Complete the innermost frame now that its operand cannot grow.
+     *  @return true if the frame needs another operand before it completes;
+     *  false once it completed, or on an error.
+     */
+    bool close_frame() {
+        ParseFrame& frame = frames_.back();
+        switch (frame.kind) {
+            case ParseFrame::Kind::Infix: {
+                const ParseFrame closed = frame;
+                frames_.pop_back();
+                ExpressionPtr right = pop_operand();
+                ExpressionPtr left = pop_operand();
+                push_operand(
+                    at(make_binary(ctx_.arena, closed.op, left, right), closed.position));
+                return false;
+            }
+            case ParseFrame::Kind::TernaryThen: {
+                if (stream_.empty()) {
+                    return fail(make_error(ErrorCode::ExpectedColon, end_position()));
+                }
+                const Token colon = stream_.get();
+                if (colon.type != TType::Colon) {
+                    return fail(make_error(ErrorCode::ExpectedColon, colon.offset));
+                }
+                frame.kind = ParseFrame::Kind::TernaryElse;
+                return true;
+            }
+            case ParseFrame::Kind::TernaryElse: {
+                const std::uint32_t position = frame.position;
+                frames_.pop_back();
+                ExpressionPtr else_branch = pop_operand();
+                ExpressionPtr then_branch = pop_operand();
+                ExpressionPtr condition = pop_operand();
+                push_operand(at(make_ternary(ctx_.arena, condition, then_branch, else_branch),
+                                position));
+                return false;
+            }
+            case ParseFrame::Kind::Group: {
+                if (stream_.empty()) {
+                    return fail(make_error(ErrorCode::UnclosedGroup, end_position()));
+                }
+                Token closing = stream_.get();
+                if (closing.type != TType::RParen) {
+                    return fail(
+                        token_error(ErrorCode::ExpectedRParen, closing.type, closing.offset));
+                }
+                frames_.pop_back();
+                return false;
+            }
+            case ParseFrame::Kind::Call: {
+                if (stream_.empty()) {
+                    return fail(make_error(ErrorCode::UnclosedCall, end_position()));
+                }
+                Token separator = stream_.get();
+                if (separator.type == TType::Comma) {
+                    return expect_argument();
+                }
+                if (separator.type != TType::RParen) {
+                    return fail(token_error(ErrorCode::ExpectedSeparator, separator.type,
+                                            separator.offset));
+                }
+                const Identifier name = frame.name;
+                const std::size_t base = frame.base;
+                const std::uint32_t position = frame.position;
+                frames_.pop_back();
+                std::span<const ExpressionPtr> collected{operands_.data() + base,
+                                                         operands_.size() - base};
+                ExpressionList args = ctx_.arena.copy(collected);
+                operands_.resize(base);
+                ExpressionPtr call = make_call(name, position, args);
+                if (call) {
+                    push_operand(call);
+                }
+                return false;
+            }
+            case ParseFrame::Kind::Unary:
+                break;
+        }
+        return fail(make_error(ErrorCode::InvalidParserState));
     }
 
-    if (stream.peek().type == TType::Plus || stream.peek().type == TType::Minus) {
-        TType op = stream.get().type;
-        return make_unary(op, parse_unary(stream));
+    /** @brief Call node, or a ReduceNode if this is a four-argument call of a
+     *  reduction form; null on an error.
+     */
+    ExpressionPtr make_call(Identifier name, std::uint32_t position, ExpressionList args) {
+        const ReductionSpec* spec = find_reduction(name);
+        if (!spec || args.size() != 4) {
+            return at(make_fn_call(ctx_.arena, name, args), position);
+        }
+        if (args[0]->type != EType::Variable) {
+            Error error = reduction_error(ErrorCode::ReductionVariable, spec->kind);
+            error.position = args[0]->position;
+            fail(error);
+            return nullptr;
+        }
+        const Identifier variable = args[0]->get<Identifier>();
+        if (is_reserved_identifier(variable)) {
+            Error error = name_error(ErrorCode::ReadOnlyBoundVariable, variable);
+            error.position = args[0]->position;
+            fail(error);
+            return nullptr;
+        }
+        Identifiers captures;
+        collect_captures(*args[3], variable, captures);
+        std::vector<ExpressionPtr> operands{args[1], args[2], args[3]};
+        for (Identifier capture : captures) {
+            operands.push_back(make_variable(ctx_.arena, capture));
+        }
+        return at(make_reduce(ctx_.arena, spec->kind, variable,
+                              ctx_.arena.copy<ExpressionPtr>(operands)),
+                  position);
     }
 
-    return parse_primary(stream);
-}
-
-using TTypes = std::vector<TType>;
+    /** @brief Append each name `expr` reads or assigns, other than `variable`
+     *  and reserved names, to `names` once. A nested reduction contributes its
+     *  bounds and captures.
+     */
+    static void collect_captures(const Expression& expr, Identifier variable, Identifiers& names) {
+        const auto add = [&](Identifier name) {
+            if (name != variable && !is_reserved_identifier(name) &&
+                std::ranges::find(names, name) == names.end()) {
+                names.push_back(name);
+            }
+        };
+        switch (expr.type) {
+            case EType::Number:
+                return;
+            case EType::Variable:
+                add(expr.get<Identifier>());
+                return;
+            case EType::Local:
+                add(expr.get<LocalNode>().name);
+                return;
+            case EType::Unary:
+                collect_captures(*expr.get<UnaryNode>().right, variable, names);
+                return;
+            case EType::Binary: {
+                const auto& node = expr.get<BinaryNode>();
+                collect_captures(*node.left, variable, names);
+                collect_captures(*node.right, variable, names);
+                return;
+            }
+            case EType::FnCall:
+                for (ExpressionPtr arg : expr.get<FnNode>().args) {
+                    collect_captures(*arg, variable, names);
+                }
+                return;
+            case EType::Builtin:
+                for (ExpressionPtr arg : expr.get<BuiltinNode>().args) {
+                    if (arg) {
+                        collect_captures(*arg, variable, names);
+                    }
+                }
+                return;
+            case EType::Ternary: {
+                const auto& node = expr.get<TernaryNode>();
+                collect_captures(*node.condition, variable, names);
+                collect_captures(*node.then_branch, variable, names);
+                collect_captures(*node.else_branch, variable, names);
+                return;
+            }
+            case EType::Power:
+                collect_captures(*expr.get<PowerNode>().base, variable, names);
+                return;
+            case EType::Polynomial: {
+                const auto& node = expr.get<PolyNode>();
+                add(node.variable);
+                collect_captures(*node.fallback, variable, names);
+                return;
+            }
+            case EType::Reduce: {
+                const auto& node = expr.get<ReduceNode>();
+                collect_captures(*node.lower(), variable, names);
+                collect_captures(*node.upper(), variable, names);
+                for (ExpressionPtr capture : node.captures()) {
+                    collect_captures(*capture, variable, names);
+                }
+                return;
+            }
+        }
+    }
 
-enum class Associativity { Left, Right };
+    bool expect_argument() {
+        if (stream_.empty()) {
+            return fail(make_error(ErrorCode::UnclosedCall, end_position()));
+        }
+        const Token& next = stream_.peek();
+        if (next.type == TType::Comma || next.type == TType::RParen) {
+            return fail(make_error(ErrorCode::EmptyArgument, next.offset));
+        }
+        return true;
+    }
 
-ExpressionPtr abstract_parse(TokenStream& stream,
-                             const std::function<ExpressionPtr(TokenStream&)>& parser,
-                             const std::function<bool(const Token&)>& is_operator,
-                             Associativity assoc,
-                             ExpressionPtr left = nullptr) {
-    if (!left) {
-        left = parser(stream);
+    bool push_frame(const ParseFrame& frame) {
+        if (frames_.size() >= ctx_.max_depth) {
+            return fail_too_deep(frame.position);
+        }
+        frames_.push_back(frame);
+        return true;
     }
 
-    while (!stream.empty() && is_operator(stream.peek())) {
-        TType op = stream.get().type;
-        if (assoc == Associativity::Right) {
-            ExpressionPtr right = abstract_parse(stream, parser, is_operator, assoc, nullptr);
-            return make_binary(op, std::move(left), std::move(right));
+    bool push_operand(ExpressionPtr expr) {
+        if (expr->height > ctx_.max_depth) {
+            return fail_too_deep(expr->position);
         }
+        operands_.push_back(expr);
+        return true;
+    }
 
-        ExpressionPtr right = parser(stream);
-        left = make_binary(op, std::move(left), std::move(right));
+    ExpressionPtr pop_operand() {
+        ExpressionPtr expr = operands_.back();
+        operands_.pop_back();
+        return expr;
     }
 
-    return left;
-}
+    static ExpressionPtr at(ExpressionPtr expr, std::uint32_t position) {
+        expr->position = position;
+        return expr;
+    }
 
-ExpressionPtr abstract_parse(TokenStream& stream,
-                             const std::function<ExpressionPtr(TokenStream&)>& parser,
-                             const TTypes& operators,
-                             Associativity assoc = Associativity::Left) {
-    auto valid_operator = [&operators](const Token& token) {
-        for (const auto& op : operators) {
-            if (token.type == op) {
-                return true;
-            }
+    std::uint32_t end_position() const {
+        return static_cast<std::uint32_t>(stream_.source().size());
+    }
+
+    /** @brief Record `error` unless one was recorded already; returns false.
+     *
+     *  A stream whose lexer failed ends at the rejected input, so a lexing
+     *  error takes the place of what the parser made of that early end.
+     */
+    bool fail(const Error& error) {
+        if (!error_) {
+            error_ = stream_.error() ? stream_.error() : error;
         }
         return false;
-    };
-    return abstract_parse(stream, parser, valid_operator, assoc, nullptr);
-}
+    }
 
-ExpressionPtr parse_power(TokenStream& stream) {
-    return abstract_parse(stream, parse_unary, {TType::Caret}, Associativity::Right);
-}
+    bool fail_too_deep(std::uint32_t position) {
+        Error error = limit_error(ErrorCode::TooDeep, ctx_.max_depth);
+        error.position = position;
+        return fail(error);
+    }
 
-ExpressionPtr parse_term(TokenStream& stream) {
-    return abstract_parse(stream, parse_power, {TType::Star, TType::Slash, TType::Percent});
+    TokenStream& stream_;
+    QueryContext& ctx_;
+    std::vector<ParseFrame>& frames_;
+    std::vector<ExpressionPtr>& operands_;
+    /** @brief Name token of a `name :=` binding the expression defines. */
+    std::optional<Token> binding_;
+    Error error_;
+};
+
+/** @brief The parsed expression, or its error as a ParseError. */
+ExpressionPtr parsed_or_throw(const std::expected<ExpressionPtr, Error>& expr,
+                              std::string_view source) {
+    if (!expr) {
+        throw_error(expr.error(), source);
+    }
+    return *expr;
 }
 
-ExpressionPtr parse_additive(TokenStream& stream) {
-    return abstract_parse(stream, parse_term, {TType::Plus, TType::Minus});
+std::expected<ExpressionPtr, Error> parse_all(TokenStream& stream, QueryContext& ctx) {
+    auto expr = try_parse(stream, ctx);
+    if (expr && !stream.empty()) {
+        const Token& next = stream.peek();
+        return std::unexpected{token_error(ErrorCode::UnexpectedToken, next.type, next.offset)};
+    }
+    return expr;
 }
 
-ExpressionPtr parse_relational(TokenStream& stream) {
-    return abstract_parse(stream, parse_additive,
-                          {TType::Less, TType::LessEqual, TType::Greater, TType::GreaterEqual});
-}
+}  // namespace
 
-ExpressionPtr parse_equality(TokenStream& stream) {
-    return abstract_parse(stream, parse_relational, {TType::EqualEqual, TType::BangEqual});
+std::expected<ExpressionPtr, Error> try_parse(TokenStream& stream, QueryContext& ctx) {
+    Parser parser{stream, ctx};
+    if (ExpressionPtr expr = parser.run()) {
+        return expr;
+    }
+    return std::unexpected{parser.error()};
 }
 
-ExpressionPtr parse_ternary(TokenStream& stream) {
-    ExpressionPtr condition = parse_equality(stream);
-    if (!stream.empty() && stream.peek().type == TType::Question) {
-        stream.get();
-        ExpressionPtr then_branch = parse_ternary(stream);
-        if (stream.empty() || stream.get().type != TType::Colon) {
-            throw ParseError("Expected ':' in ternary expression");
-        }
-        ExpressionPtr else_branch = parse_ternary(stream);
-        return make_ternary(std::move(condition), std::move(then_branch),
-                            std::move(else_branch));
-    }
-    return condition;
+std::expected<ExpressionPtr, Error> try_parse(const Tokens& tokens, QueryContext& ctx) {
+    TokenStream stream{tokens};
+    return parse_all(stream, ctx);
 }
 
-ExpressionPtr parse_assignment(TokenStream& stream) {
-    return abstract_parse(stream, parse_ternary, {TType::Equals}, Associativity::Right);
+std::expected<ExpressionPtr, Error> try_parse(std::string_view source, QueryContext& ctx) {
+    TokenStream stream{source};
+    return parse_all(stream, ctx);
 }
 
-}  // namespace
+ExpressionPtr parse(TokenStream& stream, QueryContext& ctx) {
+    return parsed_or_throw(try_parse(stream, ctx), stream.source());
+}
 
-ExpressionPtr parse(TokenStream& stream) {
-    return parse_assignment(stream);
+ExpressionPtr parse(const Tokens& tokens, QueryContext& ctx) {
+    return parsed_or_throw(try_parse(tokens, ctx), tokens.source());
 }
 
-ExpressionPtr parse(const Tokens& tokens) {
-    TokenStream stream{tokens};
-    ExpressionPtr expr = parse(stream);
-    if (!stream.empty()) {
-        throw ParseError(std::format("Unexpected token '{}'", to_string(stream.peek().type)));
-    }
-    return expr;
+ExpressionPtr parse(std::string_view source, QueryContext& ctx) {
+    return parsed_or_throw(try_parse(source, ctx), source);
 }
 
 }  // namespace repl
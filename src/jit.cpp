@@ -0,0 +1,961 @@
+#include "repl/jit.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "repl/evaluator.hpp"
+#include "repl/optimize.hpp"
+#include "repl/state.hpp"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__))
+#define REPL_JIT_X86_64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define REPL_JIT_X86_64 0
+#endif
+
+namespace repl {
+
+#if REPL_JIT_X86_64
+
+namespace {
+
+/** @brief What native code sees of the session; `result` is written on success. */
+struct JitContext {
+    State* state;
+    double result;
+};
+
+/** @brief Native entry: (slots, live flags, context) -> 0 on success, else bail out. */
+using NativeEntry = int (*)(double*, std::uint8_t*, JitContext*);
+
+constexpr int kBail = 1;
+
+// Runtime helpers called from native code. They never throw: any error is
+// reported as kBail and left for the tree walker to record.
+
+int load_last(JitContext* ctx, double* out) {
+    if (!ctx->state->has_last_result) {
+        return kBail;
+    }
+    *out = ctx->state->last_result;
+    return 0;
+}
+
+int load_global(JitContext* ctx, std::uint32_t symbol, double* out) {
+    if (const double* value = ctx->state->vars.find(static_cast<Identifier>(symbol))) {
+        *out = *value;
+        return 0;
+    }
+    return kBail;
+}
+
+/** @brief Nested call_user() frames allowed on one thread's C++ stack.
+ *
+ *  Past this, call_user() bails and the outermost caller re-runs the call in
+ *  the tree walker, whose recursion lives on the heap.
+ */
+constexpr std::size_t kMaxNativeNesting = 256;
+
+thread_local std::size_t native_nesting = 0;
+
+int invoke_user(JitContext* ctx, std::uint32_t symbol, double* args, std::uint32_t argc) {
+    // Nothing may unwind through native frames; only allocation failure still throws here.
+    try {
+        State& state = *ctx->state;
+        auto it = state.fns.find(static_cast<Identifier>(symbol));
+        if (it == state.fns.end() || it->second.params.size() != argc) {
+            return kBail;
+        }
+        FnObj& fn = it->second;
+        // Native code makes no tail calls, so it may bail at a depth the walker would not reach.
+        CallScope call{state};
+        if (!call.entered()) {
+            return kBail;
+        }
+        // Memoized functions go through call_function(), which consults the table.
+        if (!fn.memo && tier_up(fn)) {
+            // No re-run here: the outermost caller re-runs once in the tree walker.
+            auto value = fn.native->run(args, state);
+            if (!value) {
+                return kBail;
+            }
+            args[0] = *value;
+            return 0;
+        }
+        const auto value = call_function(fn, args, state);
+        if (!value) {
+            return kBail;
+        }
+        args[0] = *value;
+        return 0;
+    } catch (...) {
+        return kBail;
+    }
+}
+
+/** @brief Call user function `symbol` on `argc` arguments; the result replaces args[0]. */
+int call_user(JitContext* ctx, std::uint32_t symbol, double* args, std::uint32_t argc) {
+    if (native_nesting == kMaxNativeNesting) {
+        return kBail;
+    }
+    ++native_nesting;
+    const int status = invoke_user(ctx, symbol, args, argc);
+    --native_nesting;
+    return status;
+}
+
+/** @brief General-purpose registers by encoding. */
+enum Reg : std::uint8_t {
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RBX = 3,
+    RSP = 4,
+    RBP = 5,
+    RSI = 6,
+    RDI = 7,
+    R12 = 12,
+    R13 = 13,
+};
+
+/** @brief Minimal x86-64 encoder for the instructions the translator needs.
+ *
+ *  Memory operands are always `[base + disp32]`. Jumps are rel32 to labels
+ *  bound later; calls reserve 12 bytes and are linked once the code's final
+ *  address is known (see link()).
+ */
+class Assembler {
+public:
+    using Label = std::size_t;
+
+    Label new_label() {
+        labels_.push_back(kUnbound);
+        return labels_.size() - 1;
+    }
+
+    void bind(Label label) { labels_[label] = code_.size(); }
+
+    const std::vector<std::uint8_t>& code() const { return code_; }
+
+    void byte(std::uint8_t value) { code_.push_back(value); }
+
+    void bytes(std::initializer_list<std::uint8_t> values) {
+        code_.insert(code_.end(), values.begin(), values.end());
+    }
+
+    void imm32(std::uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            byte(static_cast<std::uint8_t>(value >> shift));
+        }
+    }
+
+    void imm64(std::uint64_t value) {
+        imm32(static_cast<std::uint32_t>(value));
+        imm32(static_cast<std::uint32_t>(value >> 32));
+    }
+
+    void push(Reg reg) {
+        if (reg >= 8) {
+            byte(0x41);
+        }
+        byte(static_cast<std::uint8_t>(0x50 + (reg & 7)));
+    }
+
+    void pop(Reg reg) {
+        if (reg >= 8) {
+            byte(0x41);
+        }
+        byte(static_cast<std::uint8_t>(0x58 + (reg & 7)));
+    }
+
+    void ret() { byte(0xC3); }
+
+    /** @brief mov dst, src (64-bit registers). */
+    void mov(Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(0x89);
+        modrm_reg(src, dst);
+    }
+
+    /** @brief mov dst, imm64. */
+    void mov_imm(Reg dst, std::uint64_t value) {
+        rex(true, RAX, dst);
+        byte(static_cast<std::uint8_t>(0xB8 + (dst & 7)));
+        imm64(value);
+    }
+
+    /** @brief mov dst32, imm32 (zero-extends). */
+    void mov_imm32(Reg dst, std::uint32_t value) {
+        byte(static_cast<std::uint8_t>(0xB8 + (dst & 7)));
+        imm32(value);
+    }
+
+    /** @brief mov dst, [base + disp]. */
+    void load(Reg dst, Reg base, std::int32_t disp) {
+        rex(true, dst, base);
+        byte(0x8B);
+        modrm_mem(dst, base, disp);
+    }
+
+    /** @brief mov [base + disp], src. */
+    void store(Reg base, std::int32_t disp, Reg src) {
+        rex(true, src, base);
+        byte(0x89);
+        modrm_mem(src, base, disp);
+    }
+
+    /** @brief lea dst, [base + disp]. */
+    void lea(Reg dst, Reg base, std::int32_t disp) {
+        rex(true, dst, base);
+        byte(0x8D);
+        modrm_mem(dst, base, disp);
+    }
+
+    /** @brief op dst, src for the 64-bit ALU ops (0x21 and, 0x31 xor, 0x39 cmp). */
+    void alu(std::uint8_t opcode, Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(opcode);
+        modrm_reg(src, dst);
+    }
+
+    void test32(Reg dst, Reg src) {
+        byte(0x85);
+        modrm_reg(src, dst);
+    }
+
+    void xor32(Reg dst, Reg src) {
+        byte(0x31);
+        modrm_reg(src, dst);
+    }
+
+    /** @brief cmp byte [base + disp], imm8. */
+    void cmp_byte(Reg base, std::int32_t disp, std::uint8_t value) {
+        rex(false, RAX, base);
+        byte(0x80);
+        modrm_mem(static_cast<Reg>(7), base, disp);
+        byte(value);
+    }
+
+    /** @brief mov byte [base + disp], imm8. */
+    void store_byte(Reg base, std::int32_t disp, std::uint8_t value) {
+        rex(false, RAX, base);
+        byte(0xC6);
+        modrm_mem(RAX, base, disp);
+        byte(value);
+    }
+
+    /** @brief Scalar double op `xmm, [base + disp]` with a mandatory prefix. */
+    void sse_mem(std::uint8_t prefix, std::uint8_t opcode, int xmm, Reg base, std::int32_t disp) {
+        byte(prefix);
+        rex(false, static_cast<Reg>(xmm), base);
+        bytes({0x0F, opcode});
+        modrm_mem(static_cast<Reg>(xmm), base, disp);
+    }
+
+    /** @brief Scalar double op `xmm_dst, xmm_src` with a mandatory prefix. */
+    void sse_reg(std::uint8_t prefix, std::uint8_t opcode, int dst, int src) {
+        bytes({prefix, 0x0F, opcode});
+        modrm_reg(static_cast<Reg>(dst), static_cast<Reg>(src));
+    }
+
+    void movsd_load(int xmm, Reg base, std::int32_t disp) { sse_mem(0xF2, 0x10, xmm, base, disp); }
+    void movsd_store(Reg base, std::int32_t disp, int xmm) { sse_mem(0xF2, 0x11, xmm, base, disp); }
+
+    /** @brief movq xmm, gpr. */
+    void movq_to_xmm(int xmm, Reg gpr) {
+        byte(0x66);
+        rex(true, static_cast<Reg>(xmm), gpr);
+        bytes({0x0F, 0x6E});
+        modrm_reg(static_cast<Reg>(xmm), gpr);
+    }
+
+    /** @brief movq gpr, xmm. */
+    void movq_from_xmm(Reg gpr, int xmm) {
+        byte(0x66);
+        rex(true, static_cast<Reg>(xmm), gpr);
+        bytes({0x0F, 0x7E});
+        modrm_reg(static_cast<Reg>(xmm), gpr);
+    }
+
+    /** @brief vfmadd213sd dst, src, [base + disp]: dst = dst * src + [base + disp], rounded once.
+     *  Only xmm0-xmm7 and legacy base registers are encodable here.
+     */
+    void vfmadd213sd(int dst, int src, Reg base, std::int32_t disp) {
+        // Three-byte VEX: inverted R/X/B, map 0F38; W1, inverted vvvv, LIG, pp = 66.
+        bytes({0xC4, 0xE2, static_cast<std::uint8_t>(0x81 | ((~src & 0xF) << 3)), 0xA9});
+        modrm_mem(static_cast<Reg>(dst), base, disp);
+    }
+
+    /** @brief cmpsd xmm, [base + disp], predicate. */
+    void cmpsd(int xmm, Reg base, std::int32_t disp, std::uint8_t predicate) {
+        sse_mem(0xF2, 0xC2, xmm, base, disp);
+        byte(predicate);
+    }
+
+    void jmp(Label label) {
+        byte(0xE9);
+        fixup(label);
+    }
+
+    /** @brief jcc rel32; `condition` is the low nibble of the 0x0F 0x8x opcode. */
+    void jcc(std::uint8_t condition, Label label) {
+        bytes({0x0F, static_cast<std::uint8_t>(0x80 | condition)});
+        fixup(label);
+    }
+
+    /** @brief Call an absolute address; linked to a rel32 call when in range. */
+    void call(const void* target) {
+        calls_.push_back(CallSite{code_.size(), std::bit_cast<std::uintptr_t>(target)});
+        code_.resize(code_.size() + kCallSize, 0x90);
+    }
+
+    /** @brief Resolve labels; false if one was never bound. */
+    bool resolve_labels() {
+        for (const auto& [offset, label] : fixups_) {
+            if (labels_[label] == kUnbound) {
+                return false;
+            }
+            const auto rel = static_cast<std::int64_t>(labels_[label]) -
+                             static_cast<std::int64_t>(offset + 4);
+            write32(offset, static_cast<std::uint32_t>(static_cast<std::int32_t>(rel)));
+        }
+        return true;
+    }
+
+    /** @brief Write the call sites for code placed at `base`. */
+    void link(std::uint8_t* out, std::uintptr_t base) const {
+        for (const CallSite& site : calls_) {
+            std::uint8_t* at = out + site.offset;
+            const auto next = static_cast<std::int64_t>(base + site.offset + kCallSize);
+            const auto rel = static_cast<std::int64_t>(site.target) - next;
+            if (rel >= std::numeric_limits<std::int32_t>::min() &&
+                rel <= std::numeric_limits<std::int32_t>::max()) {
+                // 7-byte nop, then call rel32.
+                const std::array<std::uint8_t, 7> nop{0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00};
+                std::memcpy(at, nop.data(), nop.size());
+                at[7] = 0xE8;
+                const auto rel32 = static_cast<std::uint32_t>(static_cast<std::int32_t>(rel));
+                std::memcpy(at + 8, &rel32, sizeof rel32);
+            } else {
+                // mov rax, imm64; call rax.
+                at[0] = 0x48;
+                at[1] = 0xB8;
+                const std::uint64_t target = site.target;
+                std::memcpy(at + 2, &target, sizeof target);
+                at[10] = 0xFF;
+                at[11] = 0xD0;
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t kUnbound = std::numeric_limits<std::size_t>::max();
+    static constexpr std::size_t kCallSize = 12;
+
+    struct CallSite {
+        std::size_t offset;
+        std::uintptr_t target;
+    };
+
+    void rex(bool wide, Reg reg, Reg rm) {
+        std::uint8_t value = 0x40;
+        if (wide) {
+            value |= 0x08;
+        }
+        if (reg >= 8) {
+            value |= 0x04;
+        }
+        if (rm >= 8) {
+            value |= 0x01;
+        }
+        if (value != 0x40) {
+            byte(value);
+        }
+    }
+
+    void modrm_reg(Reg reg, Reg rm) {
+        byte(static_cast<std::uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+    void modrm_mem(Reg reg, Reg base, std::int32_t disp) {
+        byte(static_cast<std::uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        if ((base & 7) == RSP) {
+            byte(0x24);  // SIB: base only.
+        }
+        imm32(static_cast<std::uint32_t>(disp));
+    }
+
+    void fixup(Label label) {
+        fixups_.emplace_back(code_.size(), label);
+        imm32(0);
+    }
+
+    void write32(std::size_t offset, std::uint32_t value) {
+        std::memcpy(code_.data() + offset, &value, sizeof value);
+    }
+
+    std::vector<std::uint8_t> code_;
+    std::vector<std::size_t> labels_;
+    std::vector<std::pair<std::size_t, Label>> fixups_;
+    std::vector<CallSite> calls_;
+};
+
+// Condition codes for jcc.
+constexpr std::uint8_t kBelow = 0x2;
+constexpr std::uint8_t kEqual = 0x4;
+constexpr std::uint8_t kNotEqual = 0x5;
+constexpr std::uint8_t kParity = 0xA;
+
+// SSE opcodes (prefix F2 unless noted).
+constexpr std::uint8_t kMovsd = 0x10;
+constexpr std::uint8_t kAddsd = 0x58;
+constexpr std::uint8_t kMulsd = 0x59;
+constexpr std::uint8_t kSubsd = 0x5C;
+constexpr std::uint8_t kDivsd = 0x5E;
+constexpr std::uint8_t kSqrtsd = 0x51;
+constexpr std::uint8_t kAndpd = 0x54;    // prefix 66
+constexpr std::uint8_t kXorpd = 0x57;    // prefix 66
+constexpr std::uint8_t kUcomisd = 0x2E;  // prefix 66
+
+constexpr std::uint64_t kExponentMask = 0x7FF0000000000000ULL;
+constexpr std::uint64_t kSignMask = 0x8000000000000000ULL;
+
+/** @brief Stack depth before each instruction, or -1 where unreachable. */
+std::optional<std::vector<int>> stack_depths(const Chunk& chunk) {
+    const std::size_t count = chunk.code.size();
+    std::vector<int> depth(count, -1);
+    std::vector<std::size_t> pending{0};
+    depth[0] = 0;
+    auto reach = [&](std::size_t target, int value) {
+        if (target >= count || value < 0 || static_cast<std::uint32_t>(value) > chunk.max_stack) {
+            return false;
+        }
+        if (depth[target] == -1) {
+            depth[target] = value;
+            pending.push_back(target);
+            return true;
+        }
+        return depth[target] == value;
+    };
+
+    while (!pending.empty()) {
+        const std::size_t index = pending.back();
+        pending.pop_back();
+        const Instruction& ins = chunk.code[index];
+        const int d = depth[index];
+        bool ok = true;
+        switch (ins.op) {
+            case Op::Number:
+            case Op::LoadLast:
+            case Op::LoadParam:
+            case Op::LoadLocal:
+            case Op::LoadGlobal:
+            case Op::Throw:
+                ok = reach(index + 1, d + 1);
+                break;
+            case Op::LoadCached:
+                ok = reach(index + 1, d) && reach(ins.operand, d + 1);
+                break;
+            case Op::StoreLocal:
+            case Op::Negate:
+            case Op::CheckDivisor:
+            case Op::CheckModulus:
+            case Op::IntegerPower:
+            case Op::SquareRoot:
+            case Op::CallUnary:
+                ok = d >= 1 && reach(index + 1, d);
+                break;
+            case Op::PrepareCall:
+                ok = reach(index + 1, d);
+                break;
+            case Op::Horner:
+                ok = d >= 1 && reach(index + 1, d) && reach(index + 2, d - 1);
+                break;
+            case Op::Add:
+            case Op::Subtract:
+            case Op::Multiply:
+            case Op::Divide:
+            case Op::Modulo:
+            case Op::Power:
+            case Op::Less:
+            case Op::LessEqual:
+            case Op::Greater:
+            case Op::GreaterEqual:
+            case Op::Equal:
+            case Op::NotEqual:
+            case Op::CallBinary:
+                ok = d >= 2 && reach(index + 1, d - 1);
+                break;
+            case Op::Jump:
+                ok = reach(ins.operand, d);
+                break;
+            case Op::JumpIfZero:
+                ok = d >= 1 && reach(index + 1, d - 1) && reach(ins.operand, d - 1);
+                break;
+            case Op::Call:
+                ok = d >= ins.slot && reach(index + 1, d - ins.slot + 1);
+                break;
+            case Op::Return:
+                ok = d >= 1;
+                break;
+            case Op::StoreGlobal:
+            case Op::Reduce:
+                // Function bodies assign locals only, and reductions run their
+                // own closures; either stays interpreted.
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            return std::nullopt;
+        }
+    }
+    return depth;
+}
+
+/** @brief Translates one chunk; see NativeCode for the frame and bail-out contract.
+ *
+ *  Registers: rbx = slots (operand stack follows them), r12 = live flags,
+ *  r13 = JitContext. Three pushes in the prologue keep rsp 16-byte aligned
+ *  for calls.
+ */
+class Translator {
+public:
+    Translator(const Chunk& chunk, std::vector<double>& data) : chunk_(chunk), data_(data) {}
+
+    bool run() {
+        auto depths = stack_depths(chunk_);
+        if (!depths) {
+            return false;
+        }
+        // Each Call belongs to the closest unmatched PrepareCall before it.
+        std::vector<std::uint32_t> prepared;
+        std::vector<std::uint32_t> callee(chunk_.code.size(), 0);
+        for (std::size_t index = 0; index < chunk_.code.size(); ++index) {
+            const Instruction& ins = chunk_.code[index];
+            if (ins.op == Op::PrepareCall) {
+                prepared.push_back(ins.operand);
+            } else if (ins.op == Op::Call) {
+                if (prepared.empty()) {
+                    return false;
+                }
+                callee[index] = prepared.back();
+                prepared.pop_back();
+            }
+        }
+
+        data_ = chunk_.numbers;
+        labels_.resize(chunk_.code.size() + 1);
+        for (auto& label : labels_) {
+            label = asm_.new_label();
+        }
+        bail_ = asm_.new_label();
+        exit_ = asm_.new_label();
+
+        asm_.push(RBX);
+        asm_.push(R12);
+        asm_.push(R13);
+        asm_.mov(RBX, RDI);
+        asm_.mov(R12, RSI);
+        asm_.mov(R13, RDX);
+
+        for (std::size_t index = 0; index < chunk_.code.size(); ++index) {
+            asm_.bind(labels_[index]);
+            if ((*depths)[index] >= 0) {
+                emit(index, (*depths)[index], callee[index]);
+            }
+        }
+        asm_.bind(labels_.back());
+
+        asm_.bind(bail_);
+        asm_.mov_imm32(RAX, kBail);
+        asm_.bind(exit_);
+        asm_.pop(R13);
+        asm_.pop(R12);
+        asm_.pop(RBX);
+        asm_.ret();
+        return asm_.resolve_labels();
+    }
+
+    const Assembler& assembler() const { return asm_; }
+
+private:
+    /** @brief Displacement of operand stack entry `index` from rbx. */
+    std::int32_t stack(int index) const {
+        return static_cast<std::int32_t>((chunk_.slot_count + index) * sizeof(double));
+    }
+
+    static std::int32_t slot(std::uint16_t index) {
+        return static_cast<std::int32_t>(index * sizeof(double));
+    }
+
+    void copy(std::int32_t to, std::int32_t from) {
+        asm_.load(RAX, RBX, from);
+        asm_.store(RBX, to, RAX);
+    }
+
+    /** @brief Bail out unless xmm0 is finite. */
+    void check_finite() {
+        asm_.movq_from_xmm(RAX, 0);
+        asm_.mov_imm(RCX, kExponentMask);
+        asm_.alu(0x21, RAX, RCX);
+        asm_.alu(0x39, RAX, RCX);
+        asm_.jcc(kEqual, bail_);
+    }
+
+    /** @brief Jump to `target` if xmm0 == 0.0 (a NaN is not zero). */
+    void jump_if_zero(Assembler::Label target) {
+        auto skip = asm_.new_label();
+        asm_.sse_reg(0x66, kXorpd, 1, 1);
+        asm_.sse_reg(0x66, kUcomisd, 0, 1);
+        asm_.jcc(kParity, skip);
+        asm_.jcc(kEqual, target);
+        asm_.bind(skip);
+    }
+
+    /** @brief Call a helper taking (ctx, ...) and bail out on a non-zero status. */
+    void call_helper(const void* helper) {
+        asm_.mov(RDI, R13);
+        asm_.call(helper);
+        asm_.test32(RAX, RAX);
+        asm_.jcc(kNotEqual, bail_);
+    }
+
+    void emit(std::size_t index, int d, std::uint32_t callee) {
+        const Instruction& ins = chunk_.code[index];
+        switch (ins.op) {
+            case Op::Number:
+                asm_.mov_imm(RAX, std::bit_cast<std::uint64_t>(chunk_.numbers[ins.operand]));
+                asm_.store(RBX, stack(d), RAX);
+                return;
+            case Op::LoadLast:
+                asm_.lea(RSI, RBX, stack(d));
+                call_helper(reinterpret_cast<const void*>(&load_last));
+                return;
+            case Op::LoadParam:
+                copy(stack(d), slot(ins.slot));
+                return;
+            case Op::LoadLocal: {
+                auto global = asm_.new_label();
+                auto done = asm_.new_label();
+                asm_.cmp_byte(R12, ins.slot, 0);
+                asm_.jcc(kEqual, global);
+                copy(stack(d), slot(ins.slot));
+                asm_.jmp(done);
+                asm_.bind(global);
+                emit_load_global(ins.operand, d);
+                asm_.bind(done);
+                return;
+            }
+            case Op::LoadGlobal:
+                emit_load_global(ins.operand, d);
+                return;
+            case Op::LoadCached:
+                asm_.cmp_byte(R12, ins.slot, 0);
+                asm_.jcc(kEqual, labels_[index + 1]);
+                copy(stack(d), slot(ins.slot));
+                asm_.jmp(labels_[ins.operand]);
+                return;
+            case Op::StoreLocal:
+                copy(slot(ins.slot), stack(d - 1));
+                asm_.store_byte(R12, ins.slot, 1);
+                return;
+            case Op::StoreGlobal:
+            case Op::Reduce:
+                return;
+            case Op::Negate:
+                asm_.load(RAX, RBX, stack(d - 1));
+                asm_.mov_imm(RCX, kSignMask);
+                asm_.alu(0x31, RAX, RCX);
+                asm_.store(RBX, stack(d - 1), RAX);
+                return;
+            case Op::Add:
+            case Op::Subtract:
+            case Op::Multiply: {
+                const std::uint8_t opcode = ins.op == Op::Add        ? kAddsd
+                                            : ins.op == Op::Subtract ? kSubsd
+                                                                     : kMulsd;
+                asm_.movsd_load(0, RBX, stack(d - 2));
+                asm_.sse_mem(0xF2, opcode, 0, RBX, stack(d - 1));
+                asm_.movsd_store(RBX, stack(d - 2), 0);
+                return;
+            }
+            case Op::CheckDivisor:
+            case Op::CheckModulus:
+                asm_.movsd_load(0, RBX, stack(d - 1));
+                jump_if_zero(bail_);
+                return;
+            case Op::Divide:
+                // (b a -> a / b): the divisor is below the dividend.
+                asm_.movsd_load(0, RBX, stack(d - 1));
+                asm_.sse_mem(0xF2, kDivsd, 0, RBX, stack(d - 2));
+                asm_.movsd_store(RBX, stack(d - 2), 0);
+                return;
+            case Op::Modulo:
+                asm_.movsd_load(0, RBX, stack(d - 1));
+                asm_.movsd_load(1, RBX, stack(d - 2));
+                asm_.call(reinterpret_cast<const void*>(
+                    static_cast<double (*)(double, double)>(&std::fmod)));
+                asm_.movsd_store(RBX, stack(d - 2), 0);
+                return;
+            case Op::Power:
+                asm_.movsd_load(0, RBX, stack(d - 2));
+                asm_.movsd_load(1, RBX, stack(d - 1));
+                asm_.call(reinterpret_cast<const void*>(
+                    static_cast<double (*)(double, double)>(&std::pow)));
+                check_finite();
+                asm_.movsd_store(RBX, stack(d - 2), 0);
+                return;
+            case Op::IntegerPower:
+                asm_.movsd_load(0, RBX, stack(d - 1));
+                asm_.mov_imm32(RDI, ins.operand);
+                asm_.call(reinterpret_cast<const void*>(&integer_power));
+                check_finite();
+                asm_.movsd_store(RBX, stack(d - 1), 0);
+                return;
+            case Op::SquareRoot:
+                // sqrt(x) + 0.0, as square_root() computes it.
+                asm_.sse_mem(0xF2, kSqrtsd, 0, RBX, stack(d - 1));
+                asm_.sse_reg(0x66, kXorpd, 1, 1);
+                asm_.sse_reg(0xF2, kAddsd, 0, 1);
+                check_finite();
+                asm_.movsd_store(RBX, stack(d - 1), 0);
+                return;
+            case Op::Horner: {
+                const double* coefficients = data_.data() + ins.operand;
+                asm_.movsd_load(0, RBX, stack(d - 1));
+                asm_.mov_imm(RAX, ~kSignMask);
+                asm_.movq_to_xmm(1, RAX);
+                asm_.sse_reg(0x66, kAndpd, 1, 0);
+                asm_.mov_imm(RAX, std::bit_cast<std::uint64_t>(coefficients[ins.slot + 1]));
+                asm_.movq_to_xmm(2, RAX);
+                // limit < |x|, or x is NaN: the fallback after the next instruction runs.
+                asm_.sse_reg(0x66, kUcomisd, 2, 1);
+                asm_.jcc(kBelow, labels_[index + 2]);
+                if (has_fma_) {
+                    // Same single-rounding steps as horner(), without the libm call.
+                    asm_.sse_reg(0xF2, kMovsd, 1, 0);
+                    asm_.mov_imm(RAX, std::bit_cast<std::uint64_t>(coefficients));
+                    asm_.movsd_load(0, RAX, 0);
+                    for (std::uint32_t power = 1; power <= ins.slot; ++power) {
+                        asm_.vfmadd213sd(0, 1, RAX, slot(static_cast<std::uint16_t>(power)));
+                    }
+                } else {
+                    asm_.mov_imm(RDI, std::bit_cast<std::uint64_t>(coefficients));
+                    asm_.mov_imm32(RSI, ins.slot);
+                    asm_.call(reinterpret_cast<const void*>(&horner));
+                }
+                asm_.movsd_store(RBX, stack(d - 1), 0);
+                return;
+            }
+            case Op::Less:
+            case Op::LessEqual:
+            case Op::Greater:
+            case Op::GreaterEqual:
+            case Op::Equal:
+            case Op::NotEqual:
+                emit_comparison(ins.op, d);
+                return;
+            case Op::Jump:
+                asm_.jmp(labels_[ins.operand]);
+                return;
+            case Op::JumpIfZero:
+                asm_.movsd_load(0, RBX, stack(d - 1));
+                jump_if_zero(labels_[ins.operand]);
+                return;
+            case Op::CallUnary: {
+                const BuiltinSpec& spec = *chunk_.builtins[ins.operand];
+                asm_.movsd_load(0, RBX, stack(d - 1));
+                asm_.call(reinterpret_cast<const void*>(spec.unary));
+                check_finite();
+                asm_.movsd_store(RBX, stack(d - 1), 0);
+                return;
+            }
+            case Op::CallBinary: {
+                const BuiltinSpec& spec = *chunk_.builtins[ins.operand];
+                asm_.movsd_load(0, RBX, stack(d - 2));
+                asm_.movsd_load(1, RBX, stack(d - 1));
+                asm_.call(reinterpret_cast<const void*>(spec.binary));
+                check_finite();
+                asm_.movsd_store(RBX, stack(d - 2), 0);
+                return;
+            }
+            case Op::PrepareCall:
+                // Resolved with the call: on any error the tree walker re-runs
+                // the whole call, so the order of checks does not matter here.
+                return;
+            case Op::Call:
+                asm_.mov_imm32(RSI, callee);
+                asm_.lea(RDX, RBX, stack(d - ins.slot));
+                asm_.mov_imm32(RCX, ins.slot);
+                call_helper(reinterpret_cast<const void*>(&call_user));
+                return;
+            case Op::Throw:
+                asm_.jmp(bail_);
+                return;
+            case Op::Return:
+                asm_.movsd_load(0, RBX, stack(d - 1));
+                asm_.movsd_store(R13, offsetof(JitContext, result), 0);
+                asm_.xor32(RAX, RAX);
+                asm_.jmp(exit_);
+                return;
+        }
+    }
+
+    void emit_load_global(std::uint32_t symbol, int d) {
+        asm_.mov_imm32(RSI, symbol);
+        asm_.lea(RDX, RBX, stack(d));
+        call_helper(reinterpret_cast<const void*>(&load_global));
+    }
+
+    /** @brief a OP b as 1.0 or 0.0, with the VM's NaN behavior, via a cmpsd mask. */
+    void emit_comparison(Op op, int d) {
+        // cmpsd predicates: 0 eq, 1 lt, 2 le, 4 neq (true when unordered).
+        const bool swapped = op == Op::Greater || op == Op::GreaterEqual;
+        std::uint8_t predicate = 0;
+        switch (op) {
+            case Op::Less:
+            case Op::Greater: predicate = 1; break;
+            case Op::LessEqual:
+            case Op::GreaterEqual: predicate = 2; break;
+            case Op::NotEqual: predicate = 4; break;
+            default: break;
+        }
+        asm_.movsd_load(0, RBX, stack(swapped ? d - 1 : d - 2));
+        asm_.cmpsd(0, RBX, stack(swapped ? d - 2 : d - 1), predicate);
+        asm_.mov_imm(RAX, std::bit_cast<std::uint64_t>(1.0));
+        asm_.movq_to_xmm(1, RAX);
+        asm_.sse_reg(0x66, kAndpd, 0, 1);
+        asm_.movsd_store(RBX, stack(d - 2), 0);
+    }
+
+    const Chunk& chunk_;
+    std::vector<double>& data_;
+    Assembler asm_;
+    std::vector<Assembler::Label> labels_;
+    Assembler::Label bail_ = 0;
+    Assembler::Label exit_ = 0;
+    bool has_fma_ = __builtin_cpu_supports("fma");
+};
+
+/** @brief Hint for mmap: near the builtins, so their calls fit in rel32. */
+void* placement_hint() {
+    const auto anchor = reinterpret_cast<std::uintptr_t>(
+        static_cast<double (*)(double, double)>(&std::pow));
+    const std::uintptr_t page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    if (anchor < (std::uintptr_t{1} << 29)) {
+        return nullptr;
+    }
+    return reinterpret_cast<void*>((anchor & ~(page - 1)) - (std::uintptr_t{1} << 28));
+}
+
+}  // namespace
+
+bool jit_supported() {
+    return true;
+}
+
+std::unique_ptr<NativeCode> jit_compile(const Chunk& chunk) {
+    if (chunk.code.empty()) {
+        return nullptr;
+    }
+    std::unique_ptr<NativeCode> native{new NativeCode};
+    Translator translator{chunk, native->data_};
+    if (!translator.run()) {
+        return nullptr;
+    }
+    const std::vector<std::uint8_t>& code = translator.assembler().code();
+
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t size = (code.size() + page - 1) / page * page;
+    void* memory = mmap(placement_hint(), size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    native->memory_ = memory;
+    native->mapped_size_ = size;
+    auto* bytes = static_cast<std::uint8_t*>(memory);
+    std::memcpy(bytes, code.data(), code.size());
+    translator.assembler().link(bytes, reinterpret_cast<std::uintptr_t>(memory));
+    // Writable or executable, never both.
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        return nullptr;
+    }
+    native->code_size_ = code.size();
+    native->param_count_ = chunk.param_count;
+    native->slot_count_ = chunk.slot_count;
+    native->frame_size_ = chunk.slot_count + chunk.max_stack;
+    return native;
+}
+
+NativeCode::~NativeCode() {
+    if (memory_) {
+        munmap(memory_, mapped_size_);
+    }
+}
+
+std::optional<double> NativeCode::run(const double* args, State& state) const {
+    constexpr std::size_t kInlineCells = 32;
+    if (frame_size_ > kInlineCells) {
+        std::vector<double> frame(frame_size_);
+        std::vector<std::uint8_t> live(slot_count_);
+        return enter(frame.data(), live.data(), args, state);
+    }
+    std::array<double, kInlineCells> frame;
+    // Cleared with a few wide stores; a variable-length memset costs more than most bodies.
+    std::array<std::uint8_t, kInlineCells> live{};
+    return enter(frame.data(), live.data(), args, state);
+}
+
+std::optional<double> NativeCode::enter(double* frame, std::uint8_t* live, const double* args,
+                                        State& state) const {
+    std::copy_n(args, param_count_, frame);
+    JitContext ctx{&state, 0.0};
+    const auto entry = reinterpret_cast<NativeEntry>(memory_);
+    if (entry(frame, live, &ctx) != 0) {
+        return std::nullopt;
+    }
+    return ctx.result;
+}
+
+#else
+
+bool jit_supported() {
+    return false;
+}
+
+std::unique_ptr<NativeCode> jit_compile(const Chunk&) {
+    return nullptr;
+}
+
+NativeCode::~NativeCode() = default;
+
+std::optional<double> NativeCode::run(const double*, State&) const {
+    return std::nullopt;
+}
+
+std::optional<double> NativeCode::enter(double*, std::uint8_t*, const double*, State&) const {
+    return std::nullopt;
+}
+
+#endif
+
+bool tier_up(FnObj& fn) {
+    if (!fn.native && ++fn.calls == kJitThreshold) {
+        fn.native = jit_compile(fn.code);
+    }
+    return fn.native != nullptr;
+}
+
+}  // namespace repl
@@ -0,0 +1,479 @@
+#include "repl/kernels.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+
+#include "repl/registry.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define REPL_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#else
+#define REPL_KERNELS_X86 0
+#endif
+
+namespace repl {
+
+namespace {
+
+template <UnaryFn Fn>
+void map_unary(const double* in, double* out, std::size_t count) {
+    for (std::size_t index = 0; index < count; ++index) {
+        out[index] = Fn(in[index]);
+    }
+}
+
+template <BinaryFn Fn>
+void map_binary(const double* first, const double* second, double* out, std::size_t count) {
+    for (std::size_t index = 0; index < count; ++index) {
+        out[index] = Fn(first[index], second[index]);
+    }
+}
+
+/** @brief Kernels that have packed forms; the rest always use map_unary/map_binary. */
+struct Dispatch {
+    KernelIsa isa;
+    UnaryArrayFn sin;
+    UnaryArrayFn cos;
+    UnaryArrayFn tan;
+    UnaryArrayFn atan;
+    UnaryArrayFn exp;
+    UnaryArrayFn ln;
+    UnaryArrayFn log;
+    UnaryArrayFn log2;
+    UnaryArrayFn sqrt;
+    UnaryArrayFn abs;
+    UnaryArrayFn floor;
+    UnaryArrayFn ceil;
+    UnaryArrayFn round;
+    UnaryArrayFn trunc;
+    UnaryArrayFn sign;
+    BinaryArrayFn atan2;
+    BinaryArrayFn min;
+    BinaryArrayFn max;
+    BinaryArrayFn hypot;
+};
+
+Dispatch scalar_dispatch() {
+    return {KernelIsa::Scalar,
+            map_unary<std::sin>,
+            map_unary<std::cos>,
+            map_unary<std::tan>,
+            map_unary<std::atan>,
+            map_unary<std::exp>,
+            map_unary<std::log>,
+            map_unary<std::log10>,
+            map_unary<std::log2>,
+            map_unary<std::sqrt>,
+            map_unary<std::fabs>,
+            map_unary<std::floor>,
+            map_unary<std::ceil>,
+            map_unary<std::round>,
+            map_unary<std::trunc>,
+            map_unary<detail::sign>,
+            map_binary<std::atan2>,
+            map_binary<detail::min>,
+            map_binary<detail::max>,
+            map_binary<detail::hypot>};
+}
+
+#if REPL_KERNELS_X86
+
+// Constants of the packed kernels, from fdlibm and FreeBSD msun. A hi/lo pair
+// splits a constant so that its high part times a small integer is exact.
+constexpr double kMinNormal = std::numeric_limits<double>::min();
+constexpr double kMaxFinite = std::numeric_limits<double>::max();
+
+/** @brief exp() arguments beyond this can overflow or give subnormal results. */
+constexpr double kExpLimit = 708.39;
+constexpr double kInvLn2 = 1.44269504088896338700e+00;
+constexpr double kLn2Hi = 6.93147180369123816490e-01;
+constexpr double kLn2Lo = 1.90821492927058770002e-10;
+constexpr double kExpP[] = {1.66666666666666019037e-01, -2.77777777770155933842e-03,
+                            6.61375632143793436117e-05, -1.65339022054652515390e-06,
+                            4.13813679705723846039e-08};
+
+constexpr double kSqrt2 = std::numbers::sqrt2;
+/** @brief Lg2, Lg4, Lg6 and Lg1, Lg3, Lg5, Lg7 of k_log.h. */
+constexpr double kLogOdd[] = {3.999999999940941908e-01, 2.222219843214978396e-01,
+                              1.531383769920937332e-01};
+constexpr double kLogEven[] = {6.666666666666735130e-01, 2.857142874366239149e-01,
+                               1.818357216161805012e-01, 1.479819860511658591e-01};
+constexpr double kInvLn2Hi = 1.44269504072144627571e+00;
+constexpr double kInvLn2Lo = 1.67517131648865118353e-10;
+constexpr double kInvLn10Hi = 4.34294481878168880939e-01;
+constexpr double kInvLn10Lo = 2.50829467116452752298e-11;
+constexpr double kLog10Of2Hi = 3.01029995663611771306e-01;
+constexpr double kLog10Of2Lo = 3.69423907715893078616e-13;
+
+/** @brief Largest argument the three-step pi/2 reduction handles exactly. */
+constexpr double kTrigLimit = 0x1p19 * std::numbers::pi / 2;
+constexpr double kInvPio2 = 6.36619772367581382433e-01;
+/** @brief pi/2 in three 33-bit parts, and the tail after each. */
+constexpr double kPio2[] = {1.57079632673412561417e+00, 6.07710050630396597660e-11,
+                            2.02226624871116645580e-21};
+constexpr double kPio2Tail[] = {6.07710050650619224932e-11, 2.02226624879595063154e-21,
+                                8.47842766036889956997e-32};
+constexpr double kSin1 = -1.66666666666666324348e-01;
+constexpr double kSinHead[] = {8.33333333332248946124e-03, -1.98412698298579493134e-04,
+                               2.75573137070700676789e-06};
+constexpr double kSinTail[] = {-2.50507602534068634195e-08, 1.58969099521155010221e-10};
+constexpr double kCosHead[] = {4.16666666666666019037e-02, -1.38888888888741095749e-03,
+                               2.48015872894767294178e-05};
+constexpr double kCosTail[] = {-2.75573143513906633035e-07, 2.08757232129817482790e-09,
+                               -1.13596475577881948265e-11};
+
+/** @brief atan(0.5), atan(1), atan(1.5) and atan(inf), as hi + lo. */
+constexpr double kAtanHi[] = {4.63647609000806093515e-01, 7.85398163397448278999e-01,
+                              9.82793723247329054082e-01, 1.57079632679489655800e+00};
+constexpr double kAtanLo[] = {2.26987774529616870924e-17, 3.06161699786838301793e-17,
+                              1.39033110312309984516e-17, 6.12323399573676603587e-17};
+/** @brief aT[0], aT[2], ..., aT[10] and aT[1], aT[3], ..., aT[9] of s_atan.c. */
+constexpr double kAtanEven[] = {3.33333333333329318027e-01, 1.42857142725034663711e-01,
+                                9.09088713343650656196e-02, 6.66107313738753120669e-02,
+                                4.97687799461593236017e-02, 1.62858201153657823623e-02};
+constexpr double kAtanOdd[] = {-1.99999999998764832476e-01, -1.11111104054623557880e-01,
+                               -7.69187620504482999495e-02, -5.83357013379057348645e-02,
+                               -3.65315727442169155270e-02};
+constexpr double kPi = 3.1415926535897931160e+00;
+constexpr double kPiLo = 1.2246467991473531772e-16;
+constexpr double kAtan2MinRatio = 0x1p-60;
+constexpr double kAtan2MaxRatio = 0x1p60;
+
+constexpr double kHypotMax = 0x1p500;
+constexpr double kHypotMin = 0x1p-500;
+
+/** @brief SSE2 primitives, part of the x86-64 baseline. */
+struct Sse2 {
+    using V = __m128d;
+    static constexpr std::size_t kWidth = 2;
+    static constexpr KernelIsa kIsa = KernelIsa::SSE2;
+
+    static V set(double value) { return _mm_set1_pd(value); }
+    static V bits(std::uint64_t value) {
+        return _mm_castsi128_pd(_mm_set1_epi64x(static_cast<long long>(value)));
+    }
+    static V load(const double* data) { return _mm_loadu_pd(data); }
+    static void store(double* data, V value) { _mm_storeu_pd(data, value); }
+
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm_div_pd(a, b); }
+    /** @brief a * b + c, rounded twice. */
+    static V fma(V a, V b, V c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static V sqrt(V a) { return _mm_sqrt_pd(a); }
+    static V min(V a, V b) { return _mm_min_pd(a, b); }
+    static V max(V a, V b) { return _mm_max_pd(a, b); }
+
+    static V bit_and(V a, V b) { return _mm_and_pd(a, b); }
+    static V bit_or(V a, V b) { return _mm_or_pd(a, b); }
+    /** @brief ~a & b. */
+    static V bit_andnot(V a, V b) { return _mm_andnot_pd(a, b); }
+    static V bit_xor(V a, V b) { return _mm_xor_pd(a, b); }
+    static V shift_left_52(V a) {
+        return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(a), 52));
+    }
+    static V shift_right_52(V a) {
+        return _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(a), 52));
+    }
+
+    static V less(V a, V b) { return _mm_cmplt_pd(a, b); }
+    static V less_equal(V a, V b) { return _mm_cmple_pd(a, b); }
+    static V equal(V a, V b) { return _mm_cmpeq_pd(a, b); }
+    /** @brief !(a <= b), true when either is NaN. */
+    static V not_less_equal(V a, V b) { return _mm_cmpnle_pd(a, b); }
+    static V unordered(V a, V b) { return _mm_cmpunord_pd(a, b); }
+    static V select(V mask, V a, V b) {
+        return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+    }
+    static int lanes(V mask) { return _mm_movemask_pd(mask); }
+
+    static V trunc(V x) {
+        // Round |x| < 2^52 to an integer by adding and removing 2^52, step
+        // down where that rounded up, and restore the sign.
+        const V sign = bits(0x8000000000000000ULL);
+        const V magnitude = _mm_andnot_pd(sign, x);
+        const V big = set(0x1p52);
+        V rounded = sub(add(magnitude, big), big);
+        rounded = sub(rounded, bit_and(less(magnitude, rounded), set(1.0)));
+        rounded = bit_or(rounded, bit_and(sign, x));
+        return select(less(magnitude, big), rounded, x);
+    }
+};
+
+namespace sse2 {
+using Isa = Sse2;
+#include "kernels.inc"
+}  // namespace sse2
+
+// Everything up to the matching pop may use AVX2 and FMA; it only runs once
+// cpu_has_avx2_fma() has said so.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+/** @brief AVX2 primitives, with fused multiply-add. */
+struct Avx2 {
+    using V = __m256d;
+    static constexpr std::size_t kWidth = 4;
+    static constexpr KernelIsa kIsa = KernelIsa::AVX2;
+
+    static V set(double value) { return _mm256_set1_pd(value); }
+    static V bits(std::uint64_t value) {
+        return _mm256_castsi256_pd(_mm256_set1_epi64x(static_cast<long long>(value)));
+    }
+    static V load(const double* data) { return _mm256_loadu_pd(data); }
+    static void store(double* data, V value) { _mm256_storeu_pd(data, value); }
+
+    static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static V fma(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+    static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    static V min(V a, V b) { return _mm256_min_pd(a, b); }
+    static V max(V a, V b) { return _mm256_max_pd(a, b); }
+
+    static V bit_and(V a, V b) { return _mm256_and_pd(a, b); }
+    static V bit_or(V a, V b) { return _mm256_or_pd(a, b); }
+    static V bit_andnot(V a, V b) { return _mm256_andnot_pd(a, b); }
+    static V bit_xor(V a, V b) { return _mm256_xor_pd(a, b); }
+    static V shift_left_52(V a) {
+        return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(a), 52));
+    }
+    static V shift_right_52(V a) {
+        return _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(a), 52));
+    }
+
+    static V less(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static V less_equal(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+    static V equal(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static V not_less_equal(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_NLE_UQ); }
+    static V unordered(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_UNORD_Q); }
+    static V select(V mask, V a, V b) { return _mm256_blendv_pd(b, a, mask); }
+    static int lanes(V mask) { return _mm256_movemask_pd(mask); }
+
+    static V trunc(V x) { return _mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+};
+
+namespace avx2 {
+using Isa = Avx2;
+#include "kernels.inc"
+}  // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+bool cpu_has_avx2_fma() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!fma || !osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0 && __builtin_cpu_supports("fma") != 0;
+#endif
+}
+
+#endif  // REPL_KERNELS_X86
+
+Dispatch make_dispatch(KernelIsa isa) {
+    switch (isa) {
+#if REPL_KERNELS_X86
+        case KernelIsa::AVX2:
+            return avx2::dispatch_table();
+        case KernelIsa::SSE2:
+            return sse2::dispatch_table();
+#endif
+        default:
+            return scalar_dispatch();
+    }
+}
+
+Dispatch& dispatch() {
+    static Dispatch current = make_dispatch(detected_kernel_isa());
+    return current;
+}
+
+}  // namespace
+
+std::string_view to_string(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::Scalar: return "scalar";
+        case KernelIsa::SSE2: return "sse2";
+        case KernelIsa::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+KernelIsa detected_kernel_isa() {
+#if REPL_KERNELS_X86
+    static const KernelIsa detected = cpu_has_avx2_fma() ? KernelIsa::AVX2 : KernelIsa::SSE2;
+    return detected;
+#else
+    return KernelIsa::Scalar;
+#endif
+}
+
+KernelIsa kernel_isa() {
+    return dispatch().isa;
+}
+
+KernelIsa set_kernel_isa(KernelIsa isa) {
+    if (static_cast<int>(isa) > static_cast<int>(detected_kernel_isa())) {
+        isa = detected_kernel_isa();
+    }
+    dispatch() = make_dispatch(isa);
+    return isa;
+}
+
+namespace kernels {
+
+void sin(const double* in, double* out, std::size_t count) {
+    dispatch().sin(in, out, count);
+}
+
+void cos(const double* in, double* out, std::size_t count) {
+    dispatch().cos(in, out, count);
+}
+
+void tan(const double* in, double* out, std::size_t count) {
+    dispatch().tan(in, out, count);
+}
+
+void asin(const double* in, double* out, std::size_t count) {
+    map_unary<std::asin>(in, out, count);
+}
+
+void acos(const double* in, double* out, std::size_t count) {
+    map_unary<std::acos>(in, out, count);
+}
+
+void atan(const double* in, double* out, std::size_t count) {
+    dispatch().atan(in, out, count);
+}
+
+void sinh(const double* in, double* out, std::size_t count) {
+    map_unary<std::sinh>(in, out, count);
+}
+
+void cosh(const double* in, double* out, std::size_t count) {
+    map_unary<std::cosh>(in, out, count);
+}
+
+void tanh(const double* in, double* out, std::size_t count) {
+    map_unary<std::tanh>(in, out, count);
+}
+
+void asinh(const double* in, double* out, std::size_t count) {
+    map_unary<std::asinh>(in, out, count);
+}
+
+void acosh(const double* in, double* out, std::size_t count) {
+    map_unary<std::acosh>(in, out, count);
+}
+
+void atanh(const double* in, double* out, std::size_t count) {
+    map_unary<std::atanh>(in, out, count);
+}
+
+void sqrt(const double* in, double* out, std::size_t count) {
+    dispatch().sqrt(in, out, count);
+}
+
+void cbrt(const double* in, double* out, std::size_t count) {
+    map_unary<std::cbrt>(in, out, count);
+}
+
+void exp(const double* in, double* out, std::size_t count) {
+    dispatch().exp(in, out, count);
+}
+
+void ln(const double* in, double* out, std::size_t count) {
+    dispatch().ln(in, out, count);
+}
+
+void log(const double* in, double* out, std::size_t count) {
+    dispatch().log(in, out, count);
+}
+
+void log2(const double* in, double* out, std::size_t count) {
+    dispatch().log2(in, out, count);
+}
+
+void abs(const double* in, double* out, std::size_t count) {
+    dispatch().abs(in, out, count);
+}
+
+void floor(const double* in, double* out, std::size_t count) {
+    dispatch().floor(in, out, count);
+}
+
+void ceil(const double* in, double* out, std::size_t count) {
+    dispatch().ceil(in, out, count);
+}
+
+void round(const double* in, double* out, std::size_t count) {
+    dispatch().round(in, out, count);
+}
+
+void trunc(const double* in, double* out, std::size_t count) {
+    dispatch().trunc(in, out, count);
+}
+
+void sign(const double* in, double* out, std::size_t count) {
+    dispatch().sign(in, out, count);
+}
+
+void pow(const double* first, const double* second, double* out, std::size_t count) {
+    map_binary<std::pow>(first, second, out, count);
+}
+
+void fmod(const double* first, const double* second, double* out, std::size_t count) {
+    map_binary<std::fmod>(first, second, out, count);
+}
+
+void atan2(const double* first, const double* second, double* out, std::size_t count) {
+    dispatch().atan2(first, second, out, count);
+}
+
+void min(const double* first, const double* second, double* out, std::size_t count) {
+    dispatch().min(first, second, out, count);
+}
+
+void max(const double* first, const double* second, double* out, std::size_t count) {
+    dispatch().max(first, second, out, count);
+}
+
+void hypot(const double* first, const double* second, double* out, std::size_t count) {
+    dispatch().hypot(first, second, out, count);
+}
+
+}  // namespace kernels
+
+}  // namespace repl
@@ -1,12 +1,20 @@
 #include <algorithm>
 #include <cctype>
+#include <charconv>
 #include <cstdlib>
+#include <format>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #if !defined(REPL_USE_LINENOISE)
@@ -25,14 +33,16 @@
 
 #include "repl/evaluator.hpp"
 #include "repl/errors.hpp"
+#include "repl/optimize.hpp"
 #include "repl/state.hpp"
+#include "repl/sweep.hpp"
 
 namespace repl::detail {
 
 constexpr std::string_view kHistoryFile = ".repl_history";
 constexpr std::size_t kHistoryMax = 200;
 
-std::string trim(std::string_view input) {
+std::string_view trim(std::string_view input) {
     std::size_t start = 0;
     while (start < input.size() && std::isspace(static_cast<unsigned char>(input[start])) != 0) {
         ++start;
@@ -43,10 +53,10 @@ std::string trim(std::string_view input) {
         --end;
     }
 
-    return std::string{input.substr(start, end - start)};
+    return input.substr(start, end - start);
 }
 
-std::string strip_comments(std::string_view input) {
+std::string_view strip_comments(std::string_view input) {
     std::string_view line = input;
     std::size_t hash_pos = line.find('#');
     std::size_t slash_pos = line.find("//");
@@ -68,22 +78,41 @@ void clear_screen() {
     std::cout << "\033[2J\033[H" << std::flush;
 }
 
+template <typename Map>
+std::vector<std::pair<std::string_view, Identifier>> sorted_names(const Map& map) {
+    std::vector<std::pair<std::string_view, Identifier>> names;
+    names.reserve(map.size());
+    for (const auto& [symbol, _] : map) {
+        names.emplace_back(symbol_name(symbol), symbol);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+/** @brief Registry entries in name order. */
+template <typename Table>
+auto sorted_entries(const Table& table) {
+    std::vector<const std::remove_cvref_t<decltype(*table.begin())>*> entries;
+    entries.reserve(table.size());
+    for (const auto& entry : table) {
+        entries.push_back(&entry);
+    }
+    std::ranges::sort(entries, {}, [](const auto* entry) { return entry->name; });
+    return entries;
+}
+
 std::string format_variables(const State& state) {
     if (state.vars.empty()) {
         return "No user variables defined.";
     }
 
-    std::vector<std::string> names;
-    names.reserve(state.vars.size());
-    for (const auto& [name, _] : state.vars) {
-        names.push_back(name);
-    }
-    std::sort(names.begin(), names.end());
-
     std::ostringstream out;
     out << "Variables:";
-    for (const auto& name : names) {
-        out << "\n  " << name << " = " << state.vars.at(name);
+    for (const auto& [name, symbol] : sorted_names(state.vars)) {
+        out << "\n  " << name << " = " << state.vars.at(symbol);
+        if (state.bindings.find(symbol)) {
+            out << "  (reactive)";
+        }
     }
     return out.str();
 }
@@ -93,23 +122,16 @@ std::string format_functions(const State& state) {
         return "No user functions defined.";
     }
 
-    std::vector<std::string> names;
-    names.reserve(state.fns.size());
-    for (const auto& [name, _] : state.fns) {
-        names.push_back(name);
-    }
-    std::sort(names.begin(), names.end());
-
     std::ostringstream out;
     out << "Functions:";
-    for (const auto& name : names) {
-        const auto& fn = state.fns.at(name);
+    for (const auto& [name, symbol] : sorted_names(state.fns)) {
+        const auto& fn = state.fns.at(symbol);
         out << "\n  " << name << '(';
         for (std::size_t index = 0; index < fn.params.size(); ++index) {
             if (index > 0) {
                 out << ", ";
             }
-            out << fn.params[index];
+            out << symbol_name(fn.params[index]);
         }
         out << ')';
     }
@@ -117,36 +139,22 @@ std::string format_functions(const State& state) {
 }
 
 std::string format_constants() {
-    const auto& values = constants();
-    std::vector<std::string> names;
-    names.reserve(values.size());
-    for (const auto& [name, _] : values) {
-        names.push_back(name);
-    }
-    std::sort(names.begin(), names.end());
-
     std::ostringstream out;
     out << "Constants:";
-    for (const auto& name : names) {
-        out << "\n  " << name << " = " << values.at(name);
+    for (const ConstantSpec* constant : sorted_entries(kConstants)) {
+        out << "\n  " << constant->name << " = " << constant->value;
     }
     return out.str();
 }
 
 std::string format_builtins() {
-    const auto& builtins = builtin_functions();
-    std::vector<std::string> names;
-    names.reserve(builtins.size());
-    for (const auto& [name, _] : builtins) {
-        names.push_back(name);
-    }
-    std::sort(names.begin(), names.end());
-
     std::ostringstream out;
     out << "Built-in functions:";
-    for (const auto& name : names) {
-        const auto& spec = builtins.at(name);
-        out << "\n  " << name << '/' << spec.arity << " - " << spec.description;
+    for (const BuiltinSpec* spec : sorted_entries(kBuiltins)) {
+        out << "\n  " << spec->name << '/' << spec->arity << " - " << spec->description;
+    }
+    for (const ReductionSpec* spec : sorted_entries(kReductions)) {
+        out << "\n  " << spec->name << "(var, lower, upper, body) - " << spec->description;
     }
     return out.str();
 }
@@ -162,6 +170,11 @@ std::string help_text() {
     out << "\n  clear           Clear the screen";
     out << "\n  reset           Clear variables and functions";
     out << "\n  history         Show recent inputs";
+    out << "\n  cache [n]       Show parse cache stats or set its capacity";
+    out << "\n  memo [off] [fn] Show memo tables, or cache a function's results";
+    out << "\n  batch <csv> <e> Evaluate an expression for every row of a CSV file";
+    out << "\n  sweep <r> <e>   Tabulate an expression over ranges x=first:last:count";
+    out << "\n  ast <expr|fn>   Show the optimized tree of an expression or function";
     out << "\n  load <file>     Run a script file";
     out << "\n  exit | quit     Exit the REPL";
     out << "\n\nExpressions:";
@@ -169,6 +182,8 @@ std::string help_text() {
     out << "\n  <  <=  >  >=  ==  !=";
     out << "\n  a ? b : c";
     out << "\n  f(x) = x * x";
+    out << "\n  area := w * h   (recomputed when w or h changes)";
+    out << "\n  sum(i, 1, n, body)   prod(i, 1, n, body)   integrate(x, a, b, body)";
     out << "\n  _   (last result)";
     return out.str();
 }
@@ -189,7 +204,7 @@ bool starts_with(std::string_view input, std::string_view prefix) {
     return input.size() >= prefix.size() && input.substr(0, prefix.size()) == prefix;
 }
 
-bool run_script(const std::string& path, State& state) {
+bool run_script(const std::string& path, State& state, ExpressionCache& cache) {
     std::ifstream file(path);
     if (!file) {
         throw CommandError("Could not open script file");
@@ -199,19 +214,25 @@ bool run_script(const std::string& path, State& state) {
     std::size_t line_no = 0;
     while (std::getline(file, line)) {
         ++line_no;
-        std::string processed = strip_comments(line);
+        std::string_view processed = strip_comments(line);
         if (processed.empty()) {
             continue;
         }
+        std::string error;
         try {
-            EvalResult result = process_query(processed, state);
-            if (result.info) {
-                std::cout << *result.info << '\n';
-            } else if (result.value) {
-                std::cout << *result.value << '\n';
+            const auto result = try_process_query(processed, state, cache);
+            if (!result) {
+                error = format_error(result.error(), processed);
+            } else if (result->info) {
+                std::cout << *result->info << '\n';
+            } else if (result->value) {
+                std::cout << *result->value << '\n';
             }
         } catch (const std::exception& e) {
-            std::cerr << "Script error (line " << line_no << "): " << e.what() << '\n';
+            error = e.what();
+        }
+        if (!error.empty()) {
+            std::cerr << "Script error (line " << line_no << "): " << error << '\n';
             return false;
         }
     }
@@ -219,7 +240,338 @@ bool run_script(const std::string& path, State& state) {
     return true;
 }
 
-bool handle_command(const std::string& line, State& state,
+std::string format_cache(const ExpressionCache& cache) {
+    std::ostringstream out;
+    out << "Expression cache: " << cache.size() << '/' << cache.capacity() << " entries, "
+        << cache.hits() << " hits, " << cache.misses() << " misses";
+    return out.str();
+}
+
+/** @brief Capacity argument of `cache <n>`; empty for anything else, so
+ *  expressions such as `cache = 2` still reach the evaluator.
+ */
+std::optional<std::size_t> cache_capacity_argument(std::string_view line) {
+    if (!starts_with(line, "cache ")) {
+        return std::nullopt;
+    }
+    std::string_view text = trim(line.substr(6));
+    std::size_t value = 0;
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || ec != std::errc{} || ptr != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::string format_memo(const State& state) {
+    std::ostringstream out;
+    out << "Memoized functions:";
+    bool any = false;
+    for (const auto& [name, symbol] : sorted_names(state.fns)) {
+        const MemoTable* memo = state.fns.at(symbol).memo.get();
+        if (!memo) {
+            continue;
+        }
+        any = true;
+        const std::size_t lookups = memo->hits() + memo->misses();
+        const double rate = lookups == 0 ? 0.0 : 100.0 * static_cast<double>(memo->hits()) /
+                                                     static_cast<double>(lookups);
+        out << "\n  " << name << ": " << memo->size() << '/' << memo->capacity()
+            << " entries, " << memo->hits() << " hits, " << memo->misses() << " misses ("
+            << std::format("{:.1f}", rate) << "% hit rate), "
+            << std::format("{:.1f}", static_cast<double>(memo->memory_bytes()) / 1024.0)
+            << " KiB";
+    }
+    return any ? out.str() : "No memoized functions.";
+}
+
+/** @brief Argument of `memo <fn>` or `memo off <fn>`. */
+struct MemoArgument {
+    std::string_view name;
+    bool enable;
+};
+
+bool is_identifier(std::string_view text) {
+    const auto word = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+    };
+    return !text.empty() && std::isdigit(static_cast<unsigned char>(text.front())) == 0 &&
+           std::all_of(text.begin(), text.end(), word);
+}
+
+/** @brief Argument of `memo <fn>` or `memo off <fn>`; empty for anything else,
+ *  so expressions such as `memo = 2` still reach the evaluator.
+ */
+std::optional<MemoArgument> memo_argument(std::string_view line) {
+    if (!starts_with(line, "memo ")) {
+        return std::nullopt;
+    }
+    std::string_view text = trim(line.substr(5));
+    bool enable = true;
+    if (starts_with(text, "off ")) {
+        text = trim(text.substr(4));
+        enable = false;
+    }
+    if (!is_identifier(text)) {
+        return std::nullopt;
+    }
+    return MemoArgument{text, enable};
+}
+
+void set_memo(State& state, const MemoArgument& argument) {
+    auto symbol = symbols().find(argument.name);
+    auto it = symbol ? state.fns.find(*symbol) : state.fns.end();
+    if (it == state.fns.end()) {
+        throw CommandError(std::format("Function '{}' not defined", argument.name));
+    }
+    FnObj& fn = it->second;
+    if (!argument.enable) {
+        fn.memo.reset();
+        return;
+    }
+    if (fn.params.size() > kMaxMemoArity) {
+        throw CommandError(
+            std::format("Functions with more than {} parameters cannot be memoized",
+                        kMaxMemoArity));
+    }
+    if (!fn.memo) {
+        fn.memo = std::make_unique<MemoTable>(fn.params.size());
+    }
+}
+
+/** @brief Columns of a CSV file whose header row names the variables. */
+struct BatchTable {
+    std::vector<Identifier> names;
+    std::vector<std::vector<double>> values;
+};
+
+std::vector<std::string_view> split_fields(std::string_view line) {
+    std::vector<std::string_view> fields;
+    while (true) {
+        const std::size_t comma = line.find(',');
+        fields.push_back(trim(line.substr(0, comma)));
+        if (comma == std::string_view::npos) {
+            return fields;
+        }
+        line.remove_prefix(comma + 1);
+    }
+}
+
+BatchTable read_table(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw CommandError("Could not open batch file");
+    }
+
+    BatchTable table;
+    std::string line;
+    std::size_t line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        if (trim(line).empty()) {
+            continue;
+        }
+        const std::vector<std::string_view> fields = split_fields(line);
+        if (table.names.empty()) {
+            for (std::string_view field : fields) {
+                if (!is_identifier(field)) {
+                    throw CommandError(std::format("Invalid column name '{}'", field));
+                }
+                table.names.push_back(intern(field));
+            }
+            table.values.resize(fields.size());
+            continue;
+        }
+        if (fields.size() != table.names.size()) {
+            throw CommandError(std::format("Line {}: expected {} values, got {}", line_no,
+                                           table.names.size(), fields.size()));
+        }
+        for (std::size_t index = 0; index < fields.size(); ++index) {
+            std::string_view field = fields[index];
+            double value = 0.0;
+            auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+            if (field.empty() || ec != std::errc{} || ptr != field.data() + field.size()) {
+                throw CommandError(std::format("Line {}: invalid number '{}'", line_no, field));
+            }
+            table.values[index].push_back(value);
+        }
+    }
+    if (table.names.empty()) {
+        throw CommandError("Batch file has no header row");
+    }
+    return table;
+}
+
+/** @brief Arguments of `batch <file> <expr>`. */
+struct BatchArgument {
+    std::string_view path;
+    std::string_view expr;
+};
+
+/** @brief Arguments of `batch <file> <expr>`; empty for anything else, so
+ *  expressions such as `batch * 2` still reach the evaluator.
+ */
+std::optional<BatchArgument> batch_argument(std::string_view line) {
+    if (!starts_with(line, "batch ")) {
+        return std::nullopt;
+    }
+    std::string_view text = trim(line.substr(6));
+    const std::size_t split = text.find_first_of(" \t");
+    if (split == std::string_view::npos) {
+        return std::nullopt;
+    }
+    const char first = text.front();
+    if (std::isalnum(static_cast<unsigned char>(first)) == 0 && first != '.' && first != '/' &&
+        first != '_' && first != '~') {
+        return std::nullopt;
+    }
+    return BatchArgument{text.substr(0, split), trim(text.substr(split))};
+}
+
+/** @brief Print one line per row: its value, or `error: <message>`. */
+void run_batch(const BatchArgument& argument, State& state) {
+    const BatchTable table = read_table(std::string{argument.path});
+    QueryContext ctx;
+    const Expression& expr = *optimize(parse(argument.expr, ctx), ctx.arena);
+
+    std::vector<BatchColumn> columns;
+    columns.reserve(table.names.size());
+    for (std::size_t index = 0; index < table.names.size(); ++index) {
+        columns.push_back(BatchColumn{table.names[index], table.values[index]});
+    }
+    const BatchResult result = evaluate_batch(expr, columns, state);
+
+    auto error = result.errors.begin();
+    for (std::size_t row = 0; row < result.values.size(); ++row) {
+        if (error != result.errors.end() && error->row == row) {
+            std::cout << "error: " << result.messages[error->message] << '\n';
+            ++error;
+        } else {
+            std::cout << result.values[row] << '\n';
+        }
+    }
+}
+
+/** @brief Arguments of `sweep <x=first:last:count>... <expr>`. */
+struct SweepArgument {
+    std::vector<SweepRange> ranges;
+    std::string_view expr;
+};
+
+/** @brief Range written `name=first:last:count`, or empty if `text` is not one. */
+std::optional<SweepRange> parse_sweep_range(std::string_view text) {
+    const std::size_t equals = text.find('=');
+    const std::size_t colon = text.find(':');
+    const std::size_t second = colon == std::string_view::npos ? colon : text.find(':', colon + 1);
+    if (equals == std::string_view::npos || second == std::string_view::npos || colon < equals ||
+        !is_identifier(text.substr(0, equals))) {
+        return std::nullopt;
+    }
+    const auto number = [](std::string_view field, auto& value) {
+        auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+        return !field.empty() && ec == std::errc{} && ptr == field.data() + field.size();
+    };
+    SweepRange range{intern(text.substr(0, equals)), 0.0, 0.0, 0};
+    if (!number(text.substr(equals + 1, colon - equals - 1), range.first) ||
+        !number(text.substr(colon + 1, second - colon - 1), range.last) ||
+        !number(text.substr(second + 1), range.count)) {
+        return std::nullopt;
+    }
+    return range;
+}
+
+/** @brief Arguments of `sweep <ranges> <expr>`; empty for anything else, so
+ *  expressions such as `sweep * 2` still reach the evaluator.
+ */
+std::optional<SweepArgument> sweep_argument(std::string_view line) {
+    if (!starts_with(line, "sweep ")) {
+        return std::nullopt;
+    }
+    SweepArgument argument;
+    std::string_view text = trim(line.substr(6));
+    while (!text.empty()) {
+        const std::size_t split = text.find_first_of(" \t");
+        auto range = parse_sweep_range(text.substr(0, split));
+        if (!range) {
+            break;
+        }
+        argument.ranges.push_back(*range);
+        text = split == std::string_view::npos ? std::string_view{} : trim(text.substr(split));
+    }
+    if (argument.ranges.empty() || text.empty()) {
+        return std::nullopt;
+    }
+    argument.expr = text;
+    return argument;
+}
+
+/** @brief Print the grid as CSV: one column per range, then the value or `error: <message>`. */
+void run_sweep(const SweepArgument& argument, const State& state) {
+    for (const SweepRange& range : argument.ranges) {
+        if (range.count == 0) {
+            throw CommandError(
+                std::format("Sweep range '{}' needs at least one point", symbol_name(range.name)));
+        }
+    }
+    QueryContext ctx;
+    const Expression& expr = *optimize(parse(argument.expr, ctx), ctx.arena);
+    const BatchResult result = sweep(expr, argument.ranges, state);
+
+    std::ostringstream out;
+    for (const SweepRange& range : argument.ranges) {
+        out << symbol_name(range.name) << ',';
+    }
+    out << "value\n";
+    std::vector<std::size_t> digits(argument.ranges.size());
+    auto error = result.errors.begin();
+    for (std::size_t row = 0; row < result.values.size(); ++row) {
+        for (std::size_t index = 0; index < digits.size(); ++index) {
+            out << argument.ranges[index].at(digits[index]) << ',';
+        }
+        if (error != result.errors.end() && error->row == row) {
+            out << "error: " << result.messages[error->message] << '\n';
+            ++error;
+        } else {
+            out << result.values[row] << '\n';
+        }
+        for (std::size_t index = digits.size(); index-- > 0;) {
+            if (++digits[index] < argument.ranges[index].count) {
+                break;
+            }
+            digits[index] = 0;
+        }
+    }
+    std::cout << out.str();
+}
+
+/** @brief Argument of `ast <expr>` or `ast <fn>`; empty for anything else,
+ *  so expressions such as `ast = 5` or `ast + 1` still reach the evaluator.
+ */
+std::optional<std::string_view> ast_argument(std::string_view line) {
+    if (!starts_with(line, "ast ")) {
+        return std::nullopt;
+    }
+    std::string_view text = trim(line.substr(4));
+    // An operator, `=` or `:=` makes `ast` the operand of an expression.
+    constexpr std::string_view kOperators = "+-*/%^=<>!?:";
+    if (text.empty() || kOperators.find(text.front()) != std::string_view::npos) {
+        return std::nullopt;
+    }
+    return text;
+}
+
+/** @brief Optimized tree of a user function's body, or of an expression. */
+std::string format_ast(std::string_view text, const State& state) {
+    if (auto symbol = symbols().find(text)) {
+        if (auto it = state.fns.find(*symbol); it != state.fns.end()) {
+            return format_tree(*it->second.expr);
+        }
+    }
+    QueryContext ctx;
+    return format_tree(*optimize(parse(text, ctx), ctx.arena));
+}
+
+bool handle_command(std::string_view line, State& state, ExpressionCache& cache,
                     std::vector<std::string>& history) {
     if (line == "exit" || line == "quit") {
         return false;
@@ -252,22 +604,83 @@ bool handle_command(const std::string& line, State& state,
         print_history(history);
         return true;
     }
+    if (line == "cache") {
+        std::cout << format_cache(cache) << '\n';
+        return true;
+    }
+    if (auto capacity = cache_capacity_argument(line)) {
+        cache.set_capacity(*capacity);
+        std::cout << format_cache(cache) << '\n';
+        return true;
+    }
+    if (line == "memo") {
+        std::cout << format_memo(state) << '\n';
+        return true;
+    }
+    if (auto argument = memo_argument(line)) {
+        set_memo(state, *argument);
+        std::cout << format_memo(state) << '\n';
+        return true;
+    }
+    if (auto argument = batch_argument(line)) {
+        run_batch(*argument, state);
+        return true;
+    }
+    if (auto argument = sweep_argument(line)) {
+        run_sweep(*argument, state);
+        return true;
+    }
+    if (auto argument = ast_argument(line)) {
+        std::cout << format_ast(*argument, state) << '\n';
+        return true;
+    }
     if (line == "reset") {
+        const Engine engine = state.engine;
+        const std::size_t max_call_depth = state.max_call_depth;
         state = State{};
+        state.engine = engine;
+        state.max_call_depth = max_call_depth;
         std::cout << "State cleared." << '\n';
         return true;
     }
     if (starts_with(line, "load ")) {
-        std::string path = trim(line.substr(5));
+        std::string path{trim(line.substr(5))};
         if (path.empty()) {
             throw CommandError("Usage: load <file>");
         }
-        run_script(path, state);
+        run_script(path, state, cache);
         return true;
     }
     return true;
 }
 
+constexpr std::string_view kUsage = "Usage: repl [--engine=tree|vm|jit] [--max-call-depth=N]";
+constexpr std::string_view kMaxCallDepthOption = "--max-call-depth=";
+
+/** @brief Apply command-line options to the initial state. */
+void parse_options(std::span<char* const> args, State& state) {
+    for (std::string_view arg : args) {
+        if (arg == "--engine=tree") {
+            state.engine = Engine::Tree;
+        } else if (arg == "--engine=vm") {
+            state.engine = Engine::Bytecode;
+        } else if (arg == "--engine=jit") {
+            state.engine = Engine::Jit;
+        } else if (starts_with(arg, kMaxCallDepthOption)) {
+            std::string_view text = arg.substr(kMaxCallDepthOption.size());
+            std::size_t value = 0;
+            auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (text.empty() || ec != std::errc{} || ptr != text.data() + text.size() ||
+                value == 0) {
+                throw CommandError(std::format("Invalid call depth '{}'", text));
+            }
+            state.max_call_depth = value;
+        } else {
+            throw CommandError(std::format("Unknown option '{}'", arg));
+        }
+    }
+}
+
 bool is_interactive() {
 #if defined(_WIN32)
     return _isatty(_fileno(stdin)) != 0;
@@ -299,9 +712,19 @@ bool read_line(std::string& out, bool use_linenoise, bool interactive) {
 
 }  // namespace repl::detail
 
-int main() {
+int main(int argc, char** argv) {
     repl::State state;
+    try {
+        repl::detail::parse_options(
+            std::span<char* const>{argv + 1, static_cast<std::size_t>(argc - 1)}, state);
+    } catch (const repl::CommandError& e) {
+        std::cerr << e.what() << '\n' << repl::detail::kUsage << '\n';
+        return 1;
+    }
+
+    repl::ExpressionCache cache;
     std::vector<std::string> history;
+    std::string input;
 
     const bool interactive = repl::detail::is_interactive();
     const bool use_linenoise = interactive && REPL_USE_LINENOISE;
@@ -320,12 +743,11 @@ int main() {
     }
 
     while (true) {
-        std::string input;
         if (!repl::detail::read_line(input, use_linenoise, interactive)) {
             break;
         }
 
-        std::string processed = repl::detail::strip_comments(input);
+        std::string_view processed = repl::detail::strip_comments(input);
         if (processed.empty()) {
             continue;
         }
@@ -346,19 +768,28 @@ int main() {
             }
             if (processed == "help" || processed == "vars" || processed == "fns" ||
                 processed == "consts" || processed == "builtins" || processed == "history" ||
-                processed == "reset" || processed == "clear" ||
-                repl::detail::starts_with(processed, "load ")) {
-                if (!repl::detail::handle_command(processed, state, history)) {
+                processed == "reset" || processed == "clear" || processed == "cache" ||
+                processed == "memo" || repl::detail::memo_argument(processed) ||
+                repl::detail::batch_argument(processed) ||
+                repl::detail::sweep_argument(processed) ||
+                repl::detail::starts_with(processed, "load ") ||
+                repl::detail::ast_argument(processed) ||
+                repl::detail::cache_capacity_argument(processed)) {
+                if (!repl::detail::handle_command(processed, state, cache, history)) {
                     break;
                 }
                 continue;
             }
 
-            repl::EvalResult result = repl::process_query(processed, state);
-            if (result.info) {
-                std::cout << *result.info << '\n';
-            } else if (result.value) {
-                std::cout << *result.value << '\n';
+            const auto result = repl::try_process_query(processed, state, cache);
+            if (!result) {
+                std::cerr << (repl::is_parse_error(result.error().code) ? "Parse error: "
+                                                                        : "Evaluation error: ")
+                          << repl::format_error(result.error(), processed) << '\n';
+            } else if (result->info) {
+                std::cout << *result->info << '\n';
+            } else if (result->value) {
+                std::cout << *result->value << '\n';
             }
         } catch (const repl::CommandError& e) {
             std::cerr << "Command error: " << e.what() << '\n';
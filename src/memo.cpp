@@ -0,0 +1,290 @@
+#include "repl/memo.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <unordered_set>
+
+#include "repl/registry.hpp"
+#include "repl/state.hpp"
+
+namespace repl {
+
+namespace {
+
+/** @brief Globals and user functions a function body reaches. */
+class Dependencies {
+public:
+    /** @brief Walk `fn` and every user function it calls, transitively. */
+    void collect(const FnObj& fn, const State& state) {
+        pending_.push_back(&fn);
+        while (!pending_.empty()) {
+            const FnObj* next = pending_.back();
+            pending_.pop_back();
+            param_count_ = next->params.size();
+            visit(*next->expr, state);
+        }
+    }
+
+    /** @brief Walk a top-level expression and every user function it calls. */
+    void collect(const Expression& expr, const State& state) {
+        param_count_ = 0;
+        visit(expr, state);
+        while (!pending_.empty()) {
+            const FnObj* next = pending_.back();
+            pending_.pop_back();
+            param_count_ = next->params.size();
+            visit(*next->expr, state);
+        }
+    }
+
+    /** @brief Whether a user function was called, defined or not. */
+    bool calls() const { return !visited_.empty(); }
+
+    /** @brief Whether any reached body reads `_`. */
+    bool reads_last_result() const { return reads_last_result_; }
+
+    /** @brief Reached global names, sorted and unique. */
+    std::vector<Identifier> globals() {
+        std::sort(globals_.begin(), globals_.end());
+        globals_.erase(std::unique(globals_.begin(), globals_.end()), globals_.end());
+        return globals_;
+    }
+
+private:
+    void read(Identifier name) {
+        if (name == last_result_symbol()) {
+            reads_last_result_ = true;
+        } else {
+            globals_.push_back(name);
+        }
+    }
+
+    /** @brief A frame slot reads the global of its name only if it is an
+     *  assigned local read before its first assignment.
+     */
+    void read_slot(Identifier name, std::uint16_t slot) {
+        if (slot == kNoSlot || slot >= param_count_) {
+            read(name);
+        }
+    }
+
+    void visit(const Expression& expr, const State& state) {
+        switch (expr.type) {
+            case EType::Number:
+                return;
+            case EType::Variable:
+                read(expr.get<Identifier>());
+                return;
+            case EType::Local: {
+                const auto& node = expr.get<LocalNode>();
+                read_slot(node.name, node.slot);
+                return;
+            }
+            case EType::Unary:
+                visit(*expr.get<UnaryNode>().right, state);
+                return;
+            case EType::Binary: {
+                const auto& node = expr.get<BinaryNode>();
+                visit(*node.left, state);
+                visit(*node.right, state);
+                return;
+            }
+            case EType::FnCall: {
+                const auto& node = expr.get<FnNode>();
+                if (!find_builtin(node.name) && visited_.insert(node.name).second) {
+                    if (auto it = state.fns.find(node.name); it != state.fns.end()) {
+                        pending_.push_back(&it->second);
+                    }
+                }
+                for (ExpressionPtr arg : node.args) {
+                    visit(*arg, state);
+                }
+                return;
+            }
+            case EType::Builtin:
+                for (ExpressionPtr arg : expr.get<BuiltinNode>().args) {
+                    if (arg) {
+                        visit(*arg, state);
+                    }
+                }
+                return;
+            case EType::Ternary: {
+                const auto& node = expr.get<TernaryNode>();
+                visit(*node.condition, state);
+                visit(*node.then_branch, state);
+                visit(*node.else_branch, state);
+                return;
+            }
+            case EType::Power:
+                visit(*expr.get<PowerNode>().base, state);
+                return;
+            case EType::Polynomial: {
+                const auto& node = expr.get<PolyNode>();
+                read_slot(node.variable, node.slot);
+                visit(*node.fallback, state);
+                return;
+            }
+            case EType::Reduce: {
+                // Every name in the body counts as a global, the bound variable
+                // included; an extra name only empties the table more often.
+                for (ExpressionPtr arg : expr.get<ReduceNode>().args) {
+                    visit(*arg, state);
+                }
+                return;
+            }
+        }
+    }
+
+    std::vector<const FnObj*> pending_;
+    std::unordered_set<Identifier> visited_;
+    std::vector<Identifier> globals_;
+    std::size_t param_count_ = 0;
+    bool reads_last_result_ = false;
+};
+
+std::size_t count_calls(const Expression& expr, Identifier name) {
+    switch (expr.type) {
+        case EType::Number:
+        case EType::Variable:
+        case EType::Local:
+            return 0;
+        case EType::Unary:
+            return count_calls(*expr.get<UnaryNode>().right, name);
+        case EType::Binary: {
+            const auto& node = expr.get<BinaryNode>();
+            return count_calls(*node.left, name) + count_calls(*node.right, name);
+        }
+        case EType::FnCall: {
+            const auto& node = expr.get<FnNode>();
+            std::size_t count = node.name == name ? 1 : 0;
+            for (ExpressionPtr arg : node.args) {
+                count += count_calls(*arg, name);
+            }
+            return count;
+        }
+        case EType::Builtin: {
+            std::size_t count = 0;
+            for (ExpressionPtr arg : expr.get<BuiltinNode>().args) {
+                count += arg ? count_calls(*arg, name) : 0;
+            }
+            return count;
+        }
+        case EType::Ternary: {
+            const auto& node = expr.get<TernaryNode>();
+            return count_calls(*node.condition, name) + count_calls(*node.then_branch, name) +
+                   count_calls(*node.else_branch, name);
+        }
+        case EType::Power:
+            return count_calls(*expr.get<PowerNode>().base, name);
+        case EType::Polynomial:
+            return count_calls(*expr.get<PolyNode>().fallback, name);
+        case EType::Reduce: {
+            std::size_t count = 0;
+            for (ExpressionPtr arg : expr.get<ReduceNode>().args) {
+                count += count_calls(*arg, name);
+            }
+            return count;
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+MemoTable::MemoTable(std::size_t arity, std::size_t capacity)
+    : arity_(arity), capacity_(std::bit_ceil(std::max<std::size_t>(capacity, 2))) {}
+
+GlobalReads global_reads(const Expression& expr, const State& state) {
+    Dependencies dependencies;
+    dependencies.collect(expr, state);
+    return GlobalReads{dependencies.globals(), dependencies.reads_last_result(),
+                       dependencies.calls()};
+}
+
+bool MemoTable::validate(const FnObj& fn, const State& state) {
+    if (fns_version_ != state.fns_version) {
+        Dependencies dependencies;
+        dependencies.collect(fn, state);
+        pure_ = !dependencies.reads_last_result();
+        globals_.clear();
+        for (Identifier name : dependencies.globals()) {
+            globals_.emplace_back(name, state.vars.version(name));
+        }
+        fns_version_ = state.fns_version;
+        clear();
+        return pure_;
+    }
+    if (!pure_) {
+        return false;
+    }
+    bool stale = false;
+    for (auto& [name, version] : globals_) {
+        const std::uint64_t current = state.vars.version(name);
+        stale = stale || current != version;
+        version = current;
+    }
+    if (stale) {
+        clear();
+    }
+    return true;
+}
+
+std::size_t MemoTable::index_of(const Key& key) const {
+    std::uint64_t hash = 0;
+    for (std::size_t index = 0; index < arity_; ++index) {
+        hash = (hash ^ std::bit_cast<std::uint64_t>(key[index])) * 0x9E3779B97F4A7C15ULL;
+    }
+    // The high bits of a multiplicative hash mix every input bit; the low
+    // bits of small integers' doubles are all zero.
+    return static_cast<std::size_t>(hash >> (64 - std::countr_zero(capacity_)));
+}
+
+bool MemoTable::matches(std::size_t index, const Key& key) const {
+    return used_[index] != 0 &&
+           std::memcmp(keys_.data() + index * arity_, key.data(), arity_ * sizeof(double)) == 0;
+}
+
+std::optional<double> MemoTable::find(const Key& key) {
+    if (size_ != 0) {
+        const std::size_t index = index_of(key);
+        if (matches(index, key)) {
+            ++hits_;
+            return values_[index];
+        }
+    }
+    ++misses_;
+    return std::nullopt;
+}
+
+void MemoTable::insert(const Key& key, double value) {
+    if (used_.empty()) {
+        keys_.resize(capacity_ * arity_);
+        values_.resize(capacity_);
+        used_.resize(capacity_);
+    }
+    const std::size_t index = index_of(key);
+    size_ += used_[index] == 0 ? 1 : 0;
+    used_[index] = 1;
+    std::copy_n(key.begin(), arity_, keys_.begin() + static_cast<std::ptrdiff_t>(index * arity_));
+    values_[index] = value;
+}
+
+void MemoTable::clear() {
+    if (size_ != 0) {
+        std::fill(used_.begin(), used_.end(), std::uint8_t{0});
+        size_ = 0;
+    }
+}
+
+std::size_t MemoTable::memory_bytes() const {
+    return sizeof(*this) + keys_.capacity() * sizeof(double) +
+           values_.capacity() * sizeof(double) + used_.capacity() +
+           globals_.capacity() * sizeof(globals_[0]);
+}
+
+bool recurses_repeatedly(const Expression& body, Identifier name) {
+    return count_calls(body, name) > 1;
+}
+
+}  // namespace repl
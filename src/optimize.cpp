@@ -0,0 +1,546 @@
+#include "repl/optimize.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <span>
+
+#include "repl/state.hpp"
+
+namespace repl {
+
+namespace {
+
+std::optional<double> number_of(const Expression& expr) {
+    if (expr.type == EType::Number) {
+        return expr.get<double>();
+    }
+    return std::nullopt;
+}
+
+void set_number(Expression& expr, double value) {
+    expr = Expression{EType::Number, 1, value, true, expr.position};
+}
+
+/** @brief Fold a binary operator over two literals; empty if it would fail. */
+std::optional<double> fold_binary(TType op, double lhs, double rhs) {
+    switch (op) {
+        case TType::Plus: return lhs + rhs;
+        case TType::Minus: return lhs - rhs;
+        case TType::Star: return lhs * rhs;
+        case TType::Slash:
+            if (rhs == 0.0) {
+                return std::nullopt;
+            }
+            return lhs / rhs;
+        case TType::Percent:
+            if (rhs == 0.0) {
+                return std::nullopt;
+            }
+            return std::fmod(lhs, rhs);
+        case TType::Caret: {
+            double value = std::pow(lhs, rhs);
+            if (!std::isfinite(value)) {
+                return std::nullopt;
+            }
+            return value;
+        }
+        case TType::Less: return lhs < rhs;
+        case TType::LessEqual: return lhs <= rhs;
+        case TType::Greater: return lhs > rhs;
+        case TType::GreaterEqual: return lhs >= rhs;
+        case TType::EqualEqual: return lhs == rhs;
+        case TType::BangEqual: return lhs != rhs;
+        default: return std::nullopt;
+    }
+}
+
+/** @brief Registry entry for a builtin call with the right number of arguments. */
+const BuiltinSpec* builtin_for(const FnNode& node) {
+    const BuiltinSpec* spec = find_builtin(node.name);
+    if (!spec || node.args.size() != spec->arity) {
+        return nullptr;
+    }
+    return spec;
+}
+
+/** @brief Fold a builtin call over literal arguments; empty if it would fail. */
+std::optional<double> fold_builtin(const BuiltinSpec& spec, ExpressionList args) {
+    std::array<double, kMaxBuiltinArity> values{};
+    for (std::size_t index = 0; index < args.size(); ++index) {
+        auto value = number_of(*args[index]);
+        if (!value) {
+            return std::nullopt;
+        }
+        values[index] = *value;
+    }
+    double value = call_builtin(spec, values.data());
+    if (!std::isfinite(value)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::uint32_t child_height(ExpressionPtr child) {
+    return child->height + 1;
+}
+
+ExpressionPtr fold(ExpressionPtr expr) {
+    switch (expr->type) {
+        case EType::Number:
+            return expr;
+        case EType::Variable: {
+            // Constants are read-only, so no local or global can shadow them.
+            if (const double* value = find_constant(expr->get<Identifier>())) {
+                set_number(*expr, *value);
+            }
+            return expr;
+        }
+        case EType::Unary: {
+            auto& node = expr->get<UnaryNode>();
+            node.right = fold(node.right);
+            if (auto value = number_of(*node.right)) {
+                set_number(*expr, node.op == TType::Minus ? -*value : *value);
+                return expr;
+            }
+            expr->height = child_height(node.right);
+            return expr;
+        }
+        case EType::Binary: {
+            auto& node = expr->get<BinaryNode>();
+            if (node.op == TType::Equals || node.op == TType::ColonEquals) {
+                // The target (a name, or a call being defined) stays as written.
+                node.right = fold(node.right);
+            } else {
+                node.left = fold(node.left);
+                node.right = fold(node.right);
+                auto lhs = number_of(*node.left);
+                auto rhs = number_of(*node.right);
+                if (lhs && rhs) {
+                    if (auto value = fold_binary(node.op, *lhs, *rhs)) {
+                        set_number(*expr, *value);
+                        return expr;
+                    }
+                }
+            }
+            expr->height = std::max(child_height(node.left), child_height(node.right));
+            return expr;
+        }
+        case EType::FnCall: {
+            auto& node = expr->get<FnNode>();
+            std::uint32_t height = 1;
+            for (ExpressionPtr& arg : node.args) {
+                arg = fold(arg);
+                height = std::max(height, child_height(arg));
+            }
+            expr->height = height;
+            const BuiltinSpec* spec = builtin_for(node);
+            if (!spec) {
+                // User functions stay late-bound; a wrong builtin arity fails at run time.
+                return expr;
+            }
+            if (auto value = fold_builtin(*spec, node.args)) {
+                set_number(*expr, *value);
+                return expr;
+            }
+            ExpressionPtr second = spec->arity > 1 ? node.args[1] : nullptr;
+            *expr = Expression{EType::Builtin, height, BuiltinNode{spec, {node.args[0], second}},
+                               true, expr->position};
+            return expr;
+        }
+        case EType::Ternary: {
+            auto& node = expr->get<TernaryNode>();
+            node.condition = fold(node.condition);
+            if (auto condition = number_of(*node.condition)) {
+                return fold(*condition != 0.0 ? node.then_branch : node.else_branch);
+            }
+            node.then_branch = fold(node.then_branch);
+            node.else_branch = fold(node.else_branch);
+            expr->height = std::max({child_height(node.condition), child_height(node.then_branch),
+                                     child_height(node.else_branch)});
+            return expr;
+        }
+        case EType::Reduce: {
+            // Captures stay names: the body binds them when it is compiled.
+            auto& node = expr->get<ReduceNode>();
+            node.args[0] = fold(node.args[0]);
+            node.args[1] = fold(node.args[1]);
+            node.args[2] = fold(node.args[2]);
+            std::uint32_t height = 1;
+            for (ExpressionPtr arg : node.args) {
+                height = std::max(height, child_height(arg));
+            }
+            expr->height = height;
+            return expr;
+        }
+        case EType::Power:
+        case EType::Polynomial:
+        case EType::Local:
+        case EType::Builtin:
+            // Already reduced, resolved, or bound: the tree has been optimized before.
+            return expr;
+    }
+    return expr;
+}
+
+/** @brief Polynomial view of a subtree: its variable, degree, and the highest
+ *  exponent any `^` in it raises the variable to. `has_sum` is set once a
+ *  `+` or `-` joins two terms; below a `*` or `/` there is none, so the
+ *  subtree is a sum of terms `c * x ^ k` exactly as written.
+ */
+struct Shape {
+    std::optional<Identifier> variable;
+    std::uint32_t degree = 0;
+    std::uint32_t max_exponent = 0;
+    bool has_sum = false;
+};
+
+/** @brief One written term `coefficient * x ^ power`. */
+struct Monomial {
+    double coefficient = 1.0;
+    std::uint32_t power = 0;
+};
+
+/** @brief Coefficients of a polynomial, lowest power first. */
+using Coefficients = std::array<double, kMaxPolynomialDegree + 1>;
+
+/** @brief Literal integer exponent in [min, max], if `expr` is one. */
+std::optional<std::int32_t> integer_exponent(const Expression& expr, std::int32_t min,
+                                             std::int32_t max) {
+    auto value = number_of(expr);
+    if (!value || *value != std::trunc(*value) || *value < min || *value > max) {
+        return std::nullopt;
+    }
+    return static_cast<std::int32_t>(*value);
+}
+
+/** @brief Divisor whose reciprocal is exact: a power of two with a normal reciprocal. */
+std::optional<double> exact_reciprocal(const Expression& expr) {
+    auto value = number_of(expr);
+    if (!value || *value == 0.0 || !std::isfinite(*value)) {
+        return std::nullopt;
+    }
+    int exponent = 0;
+    if (std::abs(std::frexp(*value, &exponent)) != 0.5) {
+        return std::nullopt;
+    }
+    const double reciprocal = 1.0 / *value;
+    if (!std::isnormal(reciprocal)) {
+        return std::nullopt;
+    }
+    return reciprocal;
+}
+
+/** @brief Strength reduction over a folded tree.
+ *
+ *  One bottom-up walk: a subtree with a polynomial shape is left as written
+ *  while its parent may still extend it, and becomes a PolyNode once the
+ *  parent cannot, so the largest polynomial subtree is the one replaced.
+ *  Nothing is allocated outside the arena.
+ */
+class Reducer {
+public:
+    explicit Reducer(Arena& arena) : arena_(arena) {}
+
+    ExpressionPtr run(ExpressionPtr expr) {
+        const std::optional<Shape> shape = reduce(expr);
+        return finish(expr, shape);
+    }
+
+private:
+    /** @brief Shape of `expr`, or empty after rewriting it: a subtree with a
+     *  shape is left for finish(), which its parent calls if it has none.
+     */
+    std::optional<Shape> reduce(ExpressionPtr& expr) {
+        switch (expr->type) {
+            case EType::Number:
+                return Shape{};
+            case EType::Variable:
+                return Shape{expr->get<Identifier>(), 1, 0, false};
+            case EType::Unary: {
+                auto& node = expr->get<UnaryNode>();
+                if (std::optional<Shape> shape = reduce(node.right)) {
+                    return shape;
+                }
+                expr->height = child_height(node.right);
+                return std::nullopt;
+            }
+            case EType::Binary:
+                return reduce_binary(expr);
+            case EType::FnCall: {
+                std::uint32_t height = 1;
+                for (ExpressionPtr& arg : expr->get<FnNode>().args) {
+                    arg = finish(arg, reduce(arg));
+                    height = std::max(height, child_height(arg));
+                }
+                expr->height = height;
+                return std::nullopt;
+            }
+            case EType::Builtin: {
+                auto& node = expr->get<BuiltinNode>();
+                std::uint32_t height = 1;
+                for (std::size_t index = 0; index < node.spec->arity; ++index) {
+                    node.args[index] = finish(node.args[index], reduce(node.args[index]));
+                    height = std::max(height, child_height(node.args[index]));
+                }
+                expr->height = height;
+                return std::nullopt;
+            }
+            case EType::Ternary: {
+                auto& node = expr->get<TernaryNode>();
+                node.condition = finish(node.condition, reduce(node.condition));
+                node.then_branch = finish(node.then_branch, reduce(node.then_branch));
+                node.else_branch = finish(node.else_branch, reduce(node.else_branch));
+                expr->height = std::max({child_height(node.condition),
+                                         child_height(node.then_branch),
+                                         child_height(node.else_branch)});
+                return std::nullopt;
+            }
+            case EType::Reduce: {
+                // Captures stay names: the body binds them when it is compiled.
+                auto& node = expr->get<ReduceNode>();
+                std::uint32_t height = 1;
+                for (std::size_t index = 0; index < node.args.size(); ++index) {
+                    if (index < 3) {
+                        node.args[index] = finish(node.args[index], reduce(node.args[index]));
+                    }
+                    height = std::max(height, child_height(node.args[index]));
+                }
+                expr->height = height;
+                return std::nullopt;
+            }
+            case EType::Power:
+            case EType::Polynomial:
+            case EType::Local:
+                return std::nullopt;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<Shape> reduce_binary(ExpressionPtr& expr) {
+        auto& node = expr->get<BinaryNode>();
+        if (node.op == TType::Equals || node.op == TType::ColonEquals) {
+            node.right = finish(node.right, reduce(node.right));
+            expr->height = std::max(child_height(node.left), child_height(node.right));
+            return std::nullopt;
+        }
+        const std::optional<Shape> lhs = reduce(node.left);
+        const std::optional<Shape> rhs = reduce(node.right);
+        if (lhs && rhs) {
+            if (std::optional<Shape> shape = combine(node, *lhs, *rhs)) {
+                return shape;
+            }
+        }
+        node.left = finish(node.left, lhs);
+        node.right = finish(node.right, rhs);
+        expr = rewrite_binary(expr);
+        return std::nullopt;
+    }
+
+    /** @brief Shape of `node` over operands of shapes `lhs` and `rhs`, if it has one. */
+    static std::optional<Shape> combine(const BinaryNode& node, const Shape& lhs,
+                                        const Shape& rhs) {
+        if (lhs.variable && rhs.variable && *lhs.variable != *rhs.variable) {
+            return std::nullopt;
+        }
+        Shape shape{lhs.variable ? lhs.variable : rhs.variable, 0,
+                    std::max(lhs.max_exponent, rhs.max_exponent), lhs.has_sum || rhs.has_sum};
+        switch (node.op) {
+            case TType::Plus:
+            case TType::Minus:
+                shape.degree = std::max(lhs.degree, rhs.degree);
+                shape.has_sum = true;
+                return shape;
+            case TType::Star:
+                // Multiplying out a product of sums loses the accuracy of the
+                // written factors near their roots, so only terms multiply.
+                if (shape.has_sum) {
+                    return std::nullopt;
+                }
+                shape.degree = lhs.degree + rhs.degree;
+                break;
+            case TType::Slash:
+                if (shape.has_sum || rhs.variable
+                    || number_of(*node.right).value_or(0.0) == 0.0) {
+                    return std::nullopt;
+                }
+                shape.degree = lhs.degree;
+                break;
+            case TType::Caret: {
+                const auto kMax = static_cast<std::int32_t>(kMaxPolynomialDegree);
+                auto exponent = integer_exponent(*node.right, 0, kMax);
+                if (node.left->type != EType::Variable || !exponent) {
+                    return std::nullopt;
+                }
+                shape.degree = static_cast<std::uint32_t>(*exponent);
+                shape.max_exponent = std::max(shape.max_exponent, shape.degree);
+                break;
+            }
+            default:
+                return std::nullopt;
+        }
+        if (shape.degree > kMaxPolynomialDegree) {
+            return std::nullopt;
+        }
+        return shape;
+    }
+
+    /** @brief `expr` rewritten, as a PolyNode if its shape makes one worthwhile. */
+    ExpressionPtr finish(ExpressionPtr expr, const std::optional<Shape>& shape) {
+        if (!shape) {
+            return expr;
+        }
+        if (shape->variable && shape->degree >= 2 && shape->has_sum) {
+            if (ExpressionPtr poly = make_horner(expr, *shape)) {
+                return poly;
+            }
+        }
+        // Nothing below a shape without a worthwhile polynomial has one either.
+        return rewrite(expr);
+    }
+
+    /** @brief The term a subtree without a sum multiplies out to. */
+    static Monomial monomial(const Expression& expr) {
+        switch (expr.type) {
+            case EType::Number:
+                return Monomial{expr.get<double>(), 0};
+            case EType::Variable:
+                return Monomial{1.0, 1};
+            case EType::Unary: {
+                const auto& node = expr.get<UnaryNode>();
+                Monomial term = monomial(*node.right);
+                if (node.op == TType::Minus) {
+                    term.coefficient = -term.coefficient;
+                }
+                return term;
+            }
+            case EType::Binary: {
+                const auto& node = expr.get<BinaryNode>();
+                if (node.op == TType::Caret) {
+                    return Monomial{1.0, static_cast<std::uint32_t>(node.right->get<double>())};
+                }
+                Monomial term = monomial(*node.left);
+                if (node.op == TType::Slash) {
+                    term.coefficient /= node.right->get<double>();
+                    return term;
+                }
+                const Monomial factor = monomial(*node.right);
+                return Monomial{term.coefficient * factor.coefficient, term.power + factor.power};
+            }
+            default:
+                return Monomial{};
+        }
+    }
+
+    /** @brief Add the written terms of a polynomial subtree, times `sign`, to `terms`. */
+    static void add_terms(const Expression& expr, double sign, Coefficients& terms) {
+        if (expr.type == EType::Unary) {
+            const auto& node = expr.get<UnaryNode>();
+            add_terms(*node.right, node.op == TType::Minus ? -sign : sign, terms);
+            return;
+        }
+        if (expr.type == EType::Binary) {
+            const auto& node = expr.get<BinaryNode>();
+            if (node.op == TType::Plus || node.op == TType::Minus) {
+                add_terms(*node.left, sign, terms);
+                add_terms(*node.right, node.op == TType::Minus ? -sign : sign, terms);
+                return;
+            }
+        }
+        const Monomial term = monomial(expr);
+        terms[term.power] += sign * term.coefficient;
+    }
+
+    /** @brief Replace a polynomial subtree with a PolyNode, if worthwhile and safe. */
+    ExpressionPtr make_horner(ExpressionPtr expr, const Shape& shape) {
+        Coefficients terms{};
+        add_terms(*expr, 1.0, terms);
+        std::size_t degree = shape.degree;
+        while (degree > 0 && terms[degree] == 0.0) {
+            --degree;
+        }
+        if (!std::all_of(terms.begin(), terms.begin() + degree + 1,
+                         [](double term) { return std::isfinite(term); })) {
+            return nullptr;
+        }
+
+        // Outside the limit some `x ^ k` in the original overflows, which is
+        // an error, or x is not finite; the original tree handles both.
+        double limit = std::numeric_limits<double>::max();
+        if (shape.max_exponent > 0) {
+            const double exponent = shape.max_exponent;
+            limit = std::pow(limit, 1.0 / exponent);
+            while (!std::isfinite(std::pow(limit, exponent))) {
+                limit = std::nextafter(limit, 0.0);
+            }
+        }
+
+        std::array<double, kMaxPolynomialDegree + 2> values{};
+        std::reverse_copy(terms.begin(), terms.begin() + degree + 1, values.begin());
+        values[degree + 1] = limit;
+        auto coefficients =
+            arena_.copy<double>(std::span<const double>{values.data(), degree + 2});
+        ExpressionPtr poly = make_polynomial(arena_, *shape.variable, coefficients, expr);
+        poly->position = expr->position;
+        return poly;
+    }
+
+    /** @brief Strength-reduce a subtree that holds no polynomial worth replacing. */
+    ExpressionPtr rewrite(ExpressionPtr expr) {
+        switch (expr->type) {
+            case EType::Unary: {
+                auto& node = expr->get<UnaryNode>();
+                node.right = rewrite(node.right);
+                expr->height = child_height(node.right);
+                return expr;
+            }
+            case EType::Binary: {
+                auto& node = expr->get<BinaryNode>();
+                node.left = rewrite(node.left);
+                node.right = rewrite(node.right);
+                return rewrite_binary(expr);
+            }
+            default:
+                return expr;
+        }
+    }
+
+    /** @brief Strength-reduce a binary node whose operands are rewritten. */
+    ExpressionPtr rewrite_binary(ExpressionPtr expr) {
+        auto& node = expr->get<BinaryNode>();
+        if (node.op == TType::Caret) {
+            ExpressionPtr power = nullptr;
+            if (auto exponent = integer_exponent(*node.right, -kMaxReducedExponent,
+                                                 kMaxReducedExponent)) {
+                power = make_power(arena_, PowerNode::Kind::Integer, *exponent, node.left);
+            } else if (number_of(*node.right) == 0.5) {
+                power = make_power(arena_, PowerNode::Kind::SquareRoot, 0, node.left);
+            }
+            if (power) {
+                power->position = expr->position;
+                return power;
+            }
+        }
+        if (node.op == TType::Slash) {
+            // The divisor is a literal, so evaluating it first is unobservable.
+            if (auto reciprocal = exact_reciprocal(*node.right)) {
+                node.op = TType::Star;
+                set_number(*node.right, *reciprocal);
+            }
+        }
+        expr->height = std::max(child_height(node.left), child_height(node.right));
+        return expr;
+    }
+
+    Arena& arena_;
+};
+
+}  // namespace
+
+ExpressionPtr optimize(ExpressionPtr expr, Arena& arena) {
+    return Reducer{arena}.run(fold(expr));
+}
+
+}  // namespace repl
@@ -0,0 +1,293 @@
+#include "repl/reactive.hpp"
+
+#include <algorithm>
+#include <expected>
+
+#include "repl/errors.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/memo.hpp"
+#include "repl/registry.hpp"
+#include "repl/state.hpp"
+
+namespace repl {
+
+namespace {
+
+void collect_assigned(const Expression& expr, Identifiers& names) {
+    switch (expr.type) {
+        case EType::Number:
+        case EType::Variable:
+        case EType::Local:
+            return;
+        case EType::Unary:
+            collect_assigned(*expr.get<UnaryNode>().right, names);
+            return;
+        case EType::Binary: {
+            const auto& node = expr.get<BinaryNode>();
+            if (node.op == TType::Equals && node.left->type == EType::Variable) {
+                const Identifier name = node.left->get<Identifier>();
+                if (std::ranges::find(names, name) == names.end()) {
+                    names.push_back(name);
+                }
+            } else if (node.op != TType::ColonEquals) {
+                collect_assigned(*node.left, names);
+            }
+            collect_assigned(*node.right, names);
+            return;
+        }
+        case EType::FnCall:
+            for (ExpressionPtr arg : expr.get<FnNode>().args) {
+                collect_assigned(*arg, names);
+            }
+            return;
+        case EType::Builtin:
+            for (ExpressionPtr arg : expr.get<BuiltinNode>().args) {
+                if (arg) {
+                    collect_assigned(*arg, names);
+                }
+            }
+            return;
+        case EType::Ternary: {
+            const auto& node = expr.get<TernaryNode>();
+            collect_assigned(*node.condition, names);
+            collect_assigned(*node.then_branch, names);
+            collect_assigned(*node.else_branch, names);
+            return;
+        }
+        case EType::Power:
+            collect_assigned(*expr.get<PowerNode>().base, names);
+            return;
+        case EType::Polynomial:
+            collect_assigned(*expr.get<PolyNode>().fallback, names);
+            return;
+        case EType::Reduce: {
+            const auto& node = expr.get<ReduceNode>();
+            collect_assigned(*node.lower(), names);
+            collect_assigned(*node.upper(), names);
+            return;
+        }
+    }
+}
+
+/** @brief Value of `binding`. Its errors carry no position: the canonical
+ *  nodes of its definition may have been parsed from another query.
+ */
+std::expected<double, Error> evaluate_binding(const BindingGraph::Binding& binding,
+                                              State& state) {
+    if (state.engine == Engine::Bytecode) {
+        auto value = execute(binding.code, state);
+        if (!value) {
+            value.error().position = kNoPosition;
+        }
+        return value;
+    }
+    auto result = try_evaluate(*binding.expr, state);
+    if (!result) {
+        result.error().position = kNoPosition;
+        return std::unexpected(result.error());
+    }
+    return *result->value;
+}
+
+bool is_assignment(const Expression& expr) {
+    return expr.type == EType::Binary && expr.get<BinaryNode>().op == TType::Equals;
+}
+
+}  // namespace
+
+bool is_binding(const Expression& expr) {
+    return expr.type == EType::Binary && expr.get<BinaryNode>().op == TType::ColonEquals;
+}
+
+Identifiers assigned_globals(const Expression& expr) {
+    Identifiers names;
+    collect_assigned(expr, names);
+    return names;
+}
+
+std::expected<double, Error> BindingGraph::define(Identifier name, const Expression& expr,
+                                                  State& state) {
+    if (is_reserved_identifier(name)) {
+        return std::unexpected(name_error(ErrorCode::ReadOnly, name));
+    }
+    // A function definition assigns no variable, but would run as one on every update.
+    if (!assigned_globals(expr).empty() || is_assignment(expr)) {
+        return std::unexpected(name_error(ErrorCode::BindingAssigns, name));
+    }
+    GlobalReads reads = global_reads(expr, state);
+    if (reads.last_result) {
+        return std::unexpected(name_error(ErrorCode::BindingReadsLast, name));
+    }
+    if (reaches(name, reads.globals)) {
+        return std::unexpected(name_error(ErrorCode::BindingCycle, name));
+    }
+
+    auto binding = std::make_unique<Binding>();
+    binding->expr = state.dag.intern(expr);
+    binding->code = compile(*binding->expr);
+    binding->reads = std::move(reads.globals);
+    binding->calls = reads.calls;
+    const auto value = evaluate_binding(*binding, state);
+    if (!value) {
+        return value;
+    }
+
+    unbind(name);
+    link(name, binding->reads);
+    if (binding->calls) {
+        callers_.push_back(name);
+    }
+    node(name).binding = std::move(binding);
+    ++count_;
+    state.vars.set(name, *value);
+
+    const Identifier changed[] = {name};
+    search(changed);
+    if (auto updated = recompute(changed, state); !updated) {
+        return std::unexpected(updated.error());
+    }
+    return value;
+}
+
+std::expected<void, Error> BindingGraph::assigned(std::span<const Identifier> names,
+                                                  State& state) {
+    for (Identifier name : names) {
+        unbind(name);
+    }
+    search(names);
+    return recompute(names, state);
+}
+
+std::expected<void, Error> BindingGraph::relink_callers(const State& state) {
+    std::vector<Identifiers> previous;
+    previous.reserve(callers_.size());
+    for (Identifier caller : callers_) {
+        GlobalReads reads = global_reads(*find(caller)->expr, state);
+        if (reads.last_result) {
+            return std::unexpected(name_error(ErrorCode::BindingReadsLast, caller));
+        }
+        previous.push_back(std::move(reads.globals));
+    }
+
+    // Swap every caller's edges at once, then look for a cycle through any of them.
+    auto swap_reads = [&] {
+        for (std::size_t index = 0; index < callers_.size(); ++index) {
+            Binding& binding = *node(callers_[index]).binding;
+            unlink(callers_[index], binding.reads);
+            std::swap(binding.reads, previous[index]);
+            link(callers_[index], binding.reads);
+        }
+    };
+    swap_reads();
+    for (Identifier caller : callers_) {
+        if (reaches(caller, find(caller)->reads)) {
+            swap_reads();
+            return std::unexpected(name_error(ErrorCode::BindingCycle, caller));
+        }
+    }
+    return {};
+}
+
+std::expected<void, Error> BindingGraph::recompute_callers(State& state) {
+    search(callers_);
+    return recompute({}, state);
+}
+
+BindingGraph::Node& BindingGraph::node(Identifier name) {
+    const std::size_t index = index_of(name);
+    if (index >= nodes_.size()) {
+        nodes_.resize(index + 1);
+    }
+    return nodes_[index];
+}
+
+void BindingGraph::link(Identifier name, std::span<const Identifier> reads) {
+    for (Identifier read : reads) {
+        node(read).dependents.push_back(name);
+    }
+}
+
+void BindingGraph::unlink(Identifier name, std::span<const Identifier> reads) {
+    for (Identifier read : reads) {
+        Identifiers& dependents = node(read).dependents;
+        dependents.erase(std::ranges::find(dependents, name));
+    }
+}
+
+void BindingGraph::unbind(Identifier name) {
+    const std::size_t index = index_of(name);
+    if (index >= nodes_.size() || !nodes_[index].binding) {
+        return;
+    }
+    std::unique_ptr<Binding> binding = std::move(nodes_[index].binding);
+    unlink(name, binding->reads);
+    if (binding->calls) {
+        callers_.erase(std::ranges::find(callers_, name));
+    }
+    --count_;
+}
+
+void BindingGraph::search(std::span<const Identifier> sources) {
+    ++searches_;
+    order_.clear();
+    for (Identifier source : sources) {
+        const std::size_t index = index_of(source);
+        if (index >= nodes_.size() || nodes_[index].mark == searches_) {
+            continue;
+        }
+        nodes_[index].mark = searches_;
+        stack_.emplace_back(source, 0);
+        while (!stack_.empty()) {
+            const auto [current, next] = stack_.back();
+            const Identifiers& dependents = nodes_[index_of(current)].dependents;
+            if (next == dependents.size()) {
+                order_.push_back(current);
+                stack_.pop_back();
+                continue;
+            }
+            ++stack_.back().second;
+            Node& child = nodes_[index_of(dependents[next])];
+            if (child.mark != searches_) {
+                child.mark = searches_;
+                stack_.emplace_back(dependents[next], 0);
+            }
+        }
+    }
+}
+
+bool BindingGraph::reaches(Identifier name, std::span<const Identifier> reads) {
+    node(name);
+    const Identifier sources[] = {name};
+    search(sources);
+    return std::ranges::any_of(reads, [&](Identifier read) {
+        const std::size_t index = index_of(read);
+        return index < nodes_.size() && nodes_[index].mark == searches_;
+    });
+}
+
+std::expected<void, Error> BindingGraph::recompute(std::span<const Identifier> skip,
+                                                   State& state) {
+    Error failure;
+    for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+        const Binding* binding = find(*it);
+        if (!binding || std::ranges::find(skip, *it) != skip.end()) {
+            continue;
+        }
+        const auto value = evaluate_binding(*binding, state);
+        if (value) {
+            state.vars.set(*it, *value);
+            continue;
+        }
+        state.vars.erase(*it);
+        if (!failure) {
+            failure = value.error();
+            failure.binding = static_cast<std::uint32_t>(*it);
+        }
+    }
+    if (failure) {
+        return std::unexpected(failure);
+    }
+    return {};
+}
+
+}  // namespace repl
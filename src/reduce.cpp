@@ -0,0 +1,555 @@
+#include "repl/reduce.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <expected>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "repl/arena.hpp"
+#include "repl/bytecode.hpp"
+#include "repl/dag.hpp"
+#include "repl/errors.hpp"
+#include "repl/registry.hpp"
+#include "repl/resolve.hpp"
+#include "repl/state.hpp"
+
+namespace repl {
+
+namespace {
+
+/** @brief A reduction's body, resolved with its parameters and compiled. */
+struct Closure {
+    Arena arena;
+    ExpressionDag dag;
+    Chunk code;
+    /** @brief Runner kept between uses on the owning thread; empty while lent out. */
+    std::optional<ChunkRunner> spare;
+};
+
+struct CachedClosure {
+    const ReduceNode* node;
+    Identifiers params;
+    std::unique_ptr<Closure> closure;
+    /** @brief Whether the node lives in the state's DAG or in a kept closure. */
+    bool kept;
+};
+
+/** @brief Closures compiled on this thread, keyed by node address.
+ *
+ *  A node in a function body or a binding lives in State::dag, and so do the
+ *  nodes of a closure compiled from it, until the state is reset: its
+ *  closure is kept and found again by every later call. Other nodes, as in a
+ *  top-level query, may be freed once the outermost reduction returns, so
+ *  their closures are dropped when its scope closes; a nested reduction
+ *  still compiles once, not once per outer point. Kept closures are dropped
+ *  when a scope opens on another store or function table: a redefinition
+ *  makes the old bodies unreachable.
+ */
+struct ClosureCache {
+    std::size_t depth = 0;
+    std::uint64_t dag = 0;
+    std::uint64_t fns_version = 0;
+    std::vector<CachedClosure> entries;
+};
+
+thread_local ClosureCache closure_cache;
+
+class CacheScope {
+public:
+    explicit CacheScope(const State& state) {
+        if (closure_cache.depth++ == 0
+            && (closure_cache.dag != state.dag.id()
+                || closure_cache.fns_version != state.fns_version)) {
+            closure_cache.entries.clear();
+            closure_cache.dag = state.dag.id();
+            closure_cache.fns_version = state.fns_version;
+        }
+    }
+    ~CacheScope() {
+        if (--closure_cache.depth == 0) {
+            std::erase_if(closure_cache.entries,
+                          [](const CachedClosure& entry) { return !entry.kept; });
+        }
+    }
+
+    CacheScope(const CacheScope&) = delete;
+    CacheScope& operator=(const CacheScope&) = delete;
+};
+
+/** @brief Whether `node` outlives the query running on `state`. */
+bool outlives_query(const ReduceNode& node, const State& state) {
+    return state.dag.owns(&node)
+           || std::ranges::any_of(closure_cache.entries, [&](const CachedClosure& entry) {
+                  return entry.kept && entry.closure->dag.owns(&node);
+              });
+}
+
+/** @brief Compiled body of `node` with `params`, from this thread's cache if it is there. */
+std::expected<Closure*, Error> closure_for(const ReduceNode& node, Identifiers params,
+                                           const State& state) {
+    for (CachedClosure& entry : closure_cache.entries) {
+        if (entry.node == &node && entry.params == params) {
+            return entry.closure.get();
+        }
+    }
+    auto closure = std::make_unique<Closure>();
+    Expression& body = *clone(*node.body(), closure->arena);
+    const auto frame_size = resolve_locals(body, params);
+    if (!frame_size) {
+        return std::unexpected(frame_size.error());
+    }
+    Expression& canonical = *closure->dag.intern(body);
+    closure->code =
+        compile_function(canonical, static_cast<std::uint16_t>(params.size()), *frame_size);
+    const bool kept = outlives_query(node, state);
+    closure_cache.entries.push_back(
+        CachedClosure{&node, std::move(params), std::move(closure), kept});
+    return closure_cache.entries.back().closure.get();
+}
+
+/** @brief What one worker needs to call the body: a runner, an argument
+ *  buffer, and its view of the state.
+ */
+struct Worker {
+    std::optional<ChunkRunner> runner;
+    std::optional<WorkerView> view;
+    std::vector<double> args;
+};
+
+/** @brief The body as one task calls it, keeping the task's first error. */
+class TaskBody {
+public:
+    explicit TaskBody(Worker& worker) : worker_(worker) {}
+
+    /** @brief The body at `x`; NaN once the task has failed. */
+    double operator()(double x) {
+        if (error_) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        worker_.args[0] = x;
+        const auto value = (*worker_.runner)(worker_.args.data(), *worker_.view);
+        if (!value) {
+            error_ = value.error();
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return *value;
+    }
+
+    /** @brief Fail the task with `error` unless it has failed already. */
+    void fail(const Error& error) {
+        if (!error_) {
+            error_ = error;
+        }
+    }
+
+    bool failed() const { return static_cast<bool>(error_); }
+    const Error& error() const { return error_; }
+
+private:
+    Worker& worker_;
+    Error error_;
+};
+
+/** @brief Body evaluation for a fixed set of tasks run on a thread pool.
+ *
+ *  Worker 0 is the calling thread. Each worker evaluates against a
+ *  WorkerView of the caller's state, made on its first task, so the workers
+ *  share globals and functions and keep their own call depth and memo
+ *  tables. The first failing task's error is returned, and later tasks are
+ *  skipped once one has failed.
+ */
+class Workers {
+public:
+    Workers(Closure& closure, const State& state, std::size_t depth, const double* captures,
+            std::size_t capture_count, ThreadPool& pool)
+        : closure_(closure),
+          state_(state),
+          depth_(depth),
+          pool_(pool),
+          workers_(pool.size()) {
+        for (Worker& worker : workers_) {
+            worker.args.assign(1 + capture_count, 0.0);
+            std::copy_n(captures, capture_count, worker.args.begin() + 1);
+        }
+        if (closure.spare) {
+            workers_[0].runner = std::move(closure.spare);
+            closure.spare.reset();
+        }
+    }
+
+    ~Workers() {
+        if (!closure_.spare) {
+            closure_.spare = std::move(workers_[0].runner);
+        }
+    }
+
+    Workers(const Workers&) = delete;
+    Workers& operator=(const Workers&) = delete;
+
+    /** @brief Call `task(index, body)` for each task, where `body` is a TaskBody;
+     *  a task stops early once `body` has failed.
+     */
+    template <typename Task>
+    std::expected<void, Error> run(std::size_t count, Task&& task) {
+        std::atomic<std::size_t> failed = count;
+        std::mutex mutex;
+        Error error;
+        pool_.run(count, [&](std::size_t index, std::size_t id) {
+            if (index > failed.load(std::memory_order_relaxed)) {
+                return;
+            }
+            CacheScope scope{state_};
+            Worker& worker = workers_[id];
+            if (!worker.view) {
+                worker.view.emplace(WorkerView{state_, depth_});
+            }
+            if (!worker.runner) {
+                worker.runner.emplace(closure_.code);
+            }
+            TaskBody body{worker};
+            task(index, body);
+            if (body.failed()) {
+                const std::lock_guard lock{mutex};
+                if (index < failed.load(std::memory_order_relaxed)) {
+                    failed.store(index, std::memory_order_relaxed);
+                    error = body.error();
+                }
+            }
+        });
+        if (failed.load() != count) {
+            return std::unexpected(error);
+        }
+        return {};
+    }
+
+private:
+    Closure& closure_;
+    const State& state_;
+    std::size_t depth_;
+    ThreadPool& pool_;
+    std::vector<Worker> workers_;
+};
+
+/** @brief Neumaier's compensated sum. */
+struct CompensatedSum {
+    double sum = 0.0;
+    double compensation = 0.0;
+
+    void add(double value) {
+        const double total = sum + value;
+        if (std::abs(sum) >= std::abs(value)) {
+            compensation += (sum - total) + value;
+        } else {
+            compensation += (value - total) + sum;
+        }
+        sum = total;
+    }
+
+    double value() const { return sum + compensation; }
+};
+
+/** @brief Compensated product: `product + error` tracks the exact product,
+ *  with each rounding error recovered by a fused multiply-add.
+ */
+struct CompensatedProduct {
+    double product = 1.0;
+    double error = 0.0;
+
+    void multiply(double value) {
+        const double rounded = product * value;
+        error = error * value + std::fma(product, value, -rounded);
+        product = rounded;
+    }
+
+    void multiply(const CompensatedProduct& other) {
+        const double rounded = product * other.product;
+        error = std::fma(product, other.product, -rounded) + product * other.error
+                + error * other.product;
+        product = rounded;
+    }
+
+    double value() const { return product + error; }
+};
+
+Error domain_error(const ReduceNode& node) {
+    return reduction_error(ErrorCode::ReductionDomain, node.kind);
+}
+
+/** @brief `value` as the reduction's result once every task has succeeded. */
+std::expected<double, Error> finished(const ReduceNode& node,
+                                      const std::expected<void, Error>& run, double value) {
+    if (!run) {
+        return std::unexpected(run.error());
+    }
+    if (!std::isfinite(value)) {
+        return std::unexpected(domain_error(node));
+    }
+    return value;
+}
+
+/** @brief Number of points from `lower` to `upper` in steps of one. */
+std::expected<std::uint64_t, Error> point_count(const ReduceNode& node, double lower,
+                                                double upper) {
+    const double span = std::floor(upper - lower);
+    if (span < 0.0) {
+        return 0;
+    }
+    if (!(span < static_cast<double>(kMaxReducePoints))) {
+        return std::unexpected(reduction_error(ErrorCode::TooManyTerms, node.kind));
+    }
+    return static_cast<std::uint64_t>(span) + 1;
+}
+
+std::size_t task_count(std::uint64_t points) {
+    return static_cast<std::size_t>((points + kReduceChunk - 1) / kReduceChunk);
+}
+
+std::expected<double, Error> sum(const ReduceNode& node, double lower, std::uint64_t points,
+                                 Workers& workers) {
+    std::vector<CompensatedSum> partials(task_count(points));
+    const auto run = workers.run(partials.size(), [&](std::size_t task, TaskBody& body) {
+        const std::uint64_t begin = std::uint64_t{task} * kReduceChunk;
+        const std::uint64_t end = std::min<std::uint64_t>(points, begin + kReduceChunk);
+        CompensatedSum partial;
+        for (std::uint64_t index = begin; index < end && !body.failed(); ++index) {
+            partial.add(body(lower + static_cast<double>(index)));
+        }
+        partials[task] = partial;
+    });
+    CompensatedSum total;
+    double compensation = 0.0;
+    for (const CompensatedSum& partial : partials) {
+        total.add(partial.sum);
+        compensation += partial.compensation;
+    }
+    return finished(node, run, total.value() + compensation);
+}
+
+std::expected<double, Error> product(const ReduceNode& node, double lower,
+                                     std::uint64_t points, Workers& workers) {
+    std::vector<CompensatedProduct> partials(task_count(points));
+    const auto run = workers.run(partials.size(), [&](std::size_t task, TaskBody& body) {
+        const std::uint64_t begin = std::uint64_t{task} * kReduceChunk;
+        const std::uint64_t end = std::min<std::uint64_t>(points, begin + kReduceChunk);
+        CompensatedProduct partial;
+        for (std::uint64_t index = begin; index < end && !body.failed(); ++index) {
+            partial.multiply(body(lower + static_cast<double>(index)));
+        }
+        partials[task] = partial;
+    });
+    CompensatedProduct total;
+    for (const CompensatedProduct& partial : partials) {
+        total.multiply(partial);
+    }
+    return finished(node, run, total.value());
+}
+
+// 15-point Kronrod nodes and weights with the embedded 7-point Gauss weights,
+// as in QUADPACK's qk15. Nodes run from the end of the interval to its centre;
+// the Gauss nodes are the odd-indexed ones and the centre.
+constexpr std::array<double, 8> kKronrodNodes = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.0};
+constexpr std::array<double, 8> kKronrodWeights = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+constexpr std::array<double, 4> kGaussWeights = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+/** @brief Integral of the body over [a, b] with its error estimate. */
+struct Segment {
+    double a;
+    double b;
+    double value;
+    double error;
+    bool final = false;
+};
+
+/** @brief Gauss-Kronrod 15-point rule with QUADPACK's error estimate. */
+template <typename Body>
+Segment gauss_kronrod(double a, double b, Body& body) {
+    const double center = 0.5 * (a + b);
+    const double half = 0.5 * (b - a);
+    const double f_center = body(center);
+    double gauss = f_center * kGaussWeights[3];
+    double kronrod = f_center * kKronrodWeights[7];
+    double absolute = std::abs(kronrod);
+    std::array<double, 7> left{};
+    std::array<double, 7> right{};
+    for (std::size_t index = 0; index < 7; ++index) {
+        const double offset = half * kKronrodNodes[index];
+        left[index] = body(center - offset);
+        right[index] = body(center + offset);
+        const double pair = left[index] + right[index];
+        kronrod += kKronrodWeights[index] * pair;
+        absolute += kKronrodWeights[index] * (std::abs(left[index]) + std::abs(right[index]));
+        if (index % 2 == 1) {
+            gauss += kGaussWeights[index / 2] * pair;
+        }
+    }
+    const double mean = 0.5 * kronrod;
+    double spread = kKronrodWeights[7] * std::abs(f_center - mean);
+    for (std::size_t index = 0; index < 7; ++index) {
+        spread += kKronrodWeights[index]
+                  * (std::abs(left[index] - mean) + std::abs(right[index] - mean));
+    }
+    absolute *= std::abs(half);
+    spread *= std::abs(half);
+    double error = std::abs((kronrod - gauss) * half);
+    if (spread != 0.0 && error != 0.0) {
+        error = spread * std::min(1.0, std::pow(200.0 * error / spread, 1.5));
+    }
+    constexpr double kEpsilon = std::numeric_limits<double>::epsilon();
+    if (absolute > std::numeric_limits<double>::min() / (50.0 * kEpsilon)) {
+        error = std::max(50.0 * kEpsilon * absolute, error);
+    }
+    return Segment{a, b, kronrod * half, error};
+}
+
+/** @brief Integral over [a, b] by adaptive bisection of the segment with the
+ *  largest error; failures go to `body`.
+ */
+double integrate_piece(const ReduceNode& node, double a, double b, TaskBody& body) {
+    std::vector<Segment> segments{gauss_kronrod(a, b, body)};
+    for (std::size_t splits = 0; !body.failed(); ++splits) {
+        CompensatedSum value;
+        double error = 0.0;
+        for (const Segment& segment : segments) {
+            value.add(segment.value);
+            error += segment.error;
+        }
+        if (!std::isfinite(value.value()) || !std::isfinite(error)) {
+            body.fail(domain_error(node));
+            break;
+        }
+        const double tolerance =
+            std::max(kIntegralAbsTolerance / static_cast<double>(kIntegralPieces),
+                     kIntegralRelTolerance * std::abs(value.value()));
+        if (error <= tolerance) {
+            return value.value();
+        }
+        auto worst = segments.end();
+        for (auto it = segments.begin(); it != segments.end(); ++it) {
+            if (!it->final && (worst == segments.end() || it->error > worst->error)) {
+                worst = it;
+            }
+        }
+        if (worst == segments.end() || splits == kMaxIntegralSplits) {
+            body.fail(make_error(ErrorCode::NoConvergence));
+            break;
+        }
+        const double middle = 0.5 * (worst->a + worst->b);
+        if (middle == worst->a || middle == worst->b) {
+            worst->final = true;
+            continue;
+        }
+        const double end = worst->b;
+        *worst = gauss_kronrod(worst->a, middle, body);
+        segments.push_back(gauss_kronrod(middle, end, body));
+    }
+    return 0.0;
+}
+
+std::expected<double, Error> integral(const ReduceNode& node, double lower, double upper,
+                                      Workers& workers) {
+    std::array<double, kIntegralPieces> pieces{};
+    const double width = (upper - lower) / static_cast<double>(kIntegralPieces);
+    const std::size_t tasks = lower == upper ? 0 : kIntegralPieces;
+    const auto run = workers.run(tasks, [&](std::size_t task, TaskBody& body) {
+        const double a = lower + width * static_cast<double>(task);
+        const double b = task + 1 == kIntegralPieces
+                             ? upper
+                             : lower + width * static_cast<double>(task + 1);
+        pieces[task] = integrate_piece(node, a, b, body);
+    });
+    CompensatedSum total;
+    for (double piece : pieces) {
+        total.add(piece);
+    }
+    return finished(node, run, total.value());
+}
+
+}  // namespace
+
+bool is_bound_capture(const Expression& capture, std::span<const Identifier> columns) {
+    if (capture.type == EType::Local) {
+        return true;
+    }
+    return capture.type == EType::Variable
+           && std::ranges::find(columns, capture.get<Identifier>()) != columns.end();
+}
+
+namespace {
+
+/** @brief try_reduce() with the workers' call depth starting at `depth`. */
+std::expected<double, Error> run_reduction(const ReduceNode& node, const double* values,
+                                           const State& state, std::size_t depth,
+                                           std::span<const Identifier> columns,
+                                           ThreadPool& pool) {
+    const double lower = values[0];
+    const double upper = values[1];
+    if (!std::isfinite(lower) || !std::isfinite(upper)) {
+        return std::unexpected(reduction_error(ErrorCode::NonFiniteBounds, node.kind));
+    }
+
+    Identifiers params{node.variable};
+    for (ExpressionPtr capture : node.captures()) {
+        if (is_bound_capture(*capture, columns)) {
+            params.push_back(capture->type == EType::Local ? capture->get<LocalNode>().name
+                                                           : capture->get<Identifier>());
+        }
+    }
+    const std::size_t capture_count = params.size() - 1;
+
+    CacheScope scope{state};
+    const auto closure = closure_for(node, std::move(params), state);
+    if (!closure) {
+        return std::unexpected(closure.error());
+    }
+    Workers workers{**closure, state, depth, values + 2, capture_count, pool};
+    if (node.kind == ReduceKind::Integral) {
+        return integral(node, lower, upper, workers);
+    }
+    const auto points = point_count(node, lower, upper);
+    if (!points) {
+        return std::unexpected(points.error());
+    }
+    return node.kind == ReduceKind::Sum ? sum(node, lower, *points, workers)
+                                        : product(node, lower, *points, workers);
+}
+
+}  // namespace
+
+std::expected<double, Error> try_reduce(const ReduceNode& node, const double* values,
+                                        const State& state, std::span<const Identifier> columns,
+                                        ThreadPool& pool) {
+    return run_reduction(node, values, state, state.call_depth, columns, pool);
+}
+
+std::expected<double, Error> try_reduce(const ReduceNode& node, const double* values,
+                                        WorkerView& view, ThreadPool& pool) {
+    return run_reduction(node, values, view.state, view.call_depth, {}, pool);
+}
+
+double reduce(const ReduceNode& node, const double* values, const State& state,
+              std::span<const Identifier> columns, ThreadPool& pool) {
+    const auto value = try_reduce(node, values, state, columns, pool);
+    if (!value) {
+        throw_error(value.error());
+    }
+    return *value;
+}
+
+}  // namespace repl
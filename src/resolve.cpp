@@ -0,0 +1,226 @@
+#include "repl/resolve.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include "repl/state.hpp"
+
+namespace repl {
+
+namespace {
+
+class Resolver {
+public:
+    explicit Resolver(std::span<const Identifier> params) : slots_(params.begin(), params.end()) {}
+
+    /** @brief Give every name assigned in the body a slot after the parameters. */
+    void collect(const Expression& expr) {
+        switch (expr.type) {
+            case EType::Number:
+            case EType::Variable:
+            case EType::Local:
+                return;
+            case EType::Unary:
+                collect(*expr.get<UnaryNode>().right);
+                return;
+            case EType::Binary: {
+                const auto& node = expr.get<BinaryNode>();
+                if (node.op == TType::Equals) {
+                    if (auto name = target_name(*node.left)) {
+                        if (!find_slot(*name)) {
+                            slots_.push_back(*name);
+                        }
+                    }
+                } else {
+                    collect(*node.left);
+                }
+                collect(*node.right);
+                return;
+            }
+            case EType::FnCall:
+                for (ExpressionPtr arg : expr.get<FnNode>().args) {
+                    collect(*arg);
+                }
+                return;
+            case EType::Builtin:
+                for (ExpressionPtr arg : expr.get<BuiltinNode>().args) {
+                    if (arg) {
+                        collect(*arg);
+                    }
+                }
+                return;
+            case EType::Ternary: {
+                const auto& node = expr.get<TernaryNode>();
+                collect(*node.condition);
+                collect(*node.then_branch);
+                collect(*node.else_branch);
+                return;
+            }
+            case EType::Power:
+                collect(*expr.get<PowerNode>().base);
+                return;
+            case EType::Polynomial:
+                collect(*expr.get<PolyNode>().fallback);
+                return;
+            case EType::Reduce: {
+                // Assignments in the body are local to the body.
+                const auto& node = expr.get<ReduceNode>();
+                collect(*node.lower());
+                collect(*node.upper());
+                return;
+            }
+        }
+    }
+
+    /** @brief Rewrite references to slotted names into Local nodes and mark
+     *  which subtrees call user functions.
+     *  @return Whether `expr` may call a user function.
+     */
+    bool bind(Expression& expr) {
+        expr.calls = bind_children(expr);
+        return expr.calls;
+    }
+
+    std::size_t size() const { return slots_.size(); }
+
+private:
+    bool bind_children(Expression& expr) {
+        switch (expr.type) {
+            case EType::Number:
+                return false;
+            case EType::Variable: {
+                const Identifier name = expr.get<Identifier>();
+                if (auto slot = find_slot(name)) {
+                    expr.type = EType::Local;
+                    expr.data = LocalNode{name, *slot};
+                }
+                return false;
+            }
+            case EType::Local: {
+                auto& node = expr.get<LocalNode>();
+                node.slot = *find_slot(node.name);
+                return false;
+            }
+            case EType::Unary:
+                return bind(*expr.get<UnaryNode>().right);
+            case EType::Binary: {
+                auto& node = expr.get<BinaryNode>();
+                const bool left = bind(*node.left);
+                return bind(*node.right) || left;
+            }
+            case EType::FnCall:
+                // Includes builtin names with the wrong arity, which fail when reached.
+                for (ExpressionPtr arg : expr.get<FnNode>().args) {
+                    bind(*arg);
+                }
+                return true;
+            case EType::Builtin: {
+                bool calls = false;
+                for (ExpressionPtr arg : expr.get<BuiltinNode>().args) {
+                    if (arg && bind(*arg)) {
+                        calls = true;
+                    }
+                }
+                return calls;
+            }
+            case EType::Ternary: {
+                auto& node = expr.get<TernaryNode>();
+                const bool condition = bind(*node.condition);
+                const bool then_branch = bind(*node.then_branch);
+                return bind(*node.else_branch) || condition || then_branch;
+            }
+            case EType::Power:
+                return bind(*expr.get<PowerNode>().base);
+            case EType::Polynomial: {
+                auto& node = expr.get<PolyNode>();
+                node.slot = find_slot(node.variable).value_or(kNoSlot);
+                return bind(*node.fallback);
+            }
+            case EType::Reduce: {
+                // The body is resolved on its own when the reduction runs; only
+                // the bounds and captures see this frame.
+                const auto& node = expr.get<ReduceNode>();
+                const bool lower = bind(*node.lower());
+                bool calls = bind(*node.upper()) || lower;
+                for (ExpressionPtr capture : node.captures()) {
+                    bind(*capture);
+                }
+                return contains_call(*node.body()) || calls;
+            }
+        }
+        return true;
+    }
+
+    /** @brief Whether an unresolved subtree contains a call that is not a bound builtin. */
+    static bool contains_call(const Expression& expr) {
+        switch (expr.type) {
+            case EType::Number:
+            case EType::Variable:
+            case EType::Local:
+                return false;
+            case EType::Unary:
+                return contains_call(*expr.get<UnaryNode>().right);
+            case EType::Binary: {
+                const auto& node = expr.get<BinaryNode>();
+                return contains_call(*node.left) || contains_call(*node.right);
+            }
+            case EType::FnCall:
+                return true;
+            case EType::Builtin: {
+                const auto& node = expr.get<BuiltinNode>();
+                return contains_call(*node.args[0]) ||
+                       (node.args[1] && contains_call(*node.args[1]));
+            }
+            case EType::Ternary: {
+                const auto& node = expr.get<TernaryNode>();
+                return contains_call(*node.condition) || contains_call(*node.then_branch) ||
+                       contains_call(*node.else_branch);
+            }
+            case EType::Power:
+                return contains_call(*expr.get<PowerNode>().base);
+            case EType::Polynomial:
+                return contains_call(*expr.get<PolyNode>().fallback);
+            case EType::Reduce:
+                return std::ranges::any_of(expr.get<ReduceNode>().args,
+                                           [](ExpressionPtr arg) { return contains_call(*arg); });
+        }
+        return true;
+    }
+
+    /** @brief Name an assignment writes locally; reserved names are left to fail. */
+    static std::optional<Identifier> target_name(const Expression& target) {
+        if (target.type == EType::Local) {
+            return target.get<LocalNode>().name;
+        }
+        if (target.type == EType::Variable && !is_reserved_identifier(target.get<Identifier>())) {
+            return target.get<Identifier>();
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::uint16_t> find_slot(Identifier name) const {
+        auto it = std::find(slots_.begin(), slots_.end(), name);
+        if (it == slots_.end()) {
+            return std::nullopt;
+        }
+        return static_cast<std::uint16_t>(it - slots_.begin());
+    }
+
+    std::vector<Identifier> slots_;
+};
+
+}  // namespace
+
+std::expected<std::uint16_t, Error> resolve_locals(Expression& body,
+                                                   std::span<const Identifier> params) {
+    Resolver resolver{params};
+    resolver.collect(body);
+    if (resolver.size() >= kNoSlot) {
+        return std::unexpected(make_error(ErrorCode::TooManyLocals));
+    }
+    resolver.bind(body);
+    return static_cast<std::uint16_t>(resolver.size());
+}
+
+}  // namespace repl
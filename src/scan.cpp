@@ -0,0 +1,264 @@
+#include "repl/scan.hpp"
+
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define REPL_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define REPL_TARGET_AVX2
+#else
+#define REPL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define REPL_SCAN_X86 0
+#endif
+
+namespace repl {
+
+namespace {
+
+/** @brief Character runs the bulk scanners can skip. */
+enum class Run {
+    Spaces,
+    Identifier,
+    Digits,
+};
+
+template <Run Kind>
+bool in_run(char ch) {
+    if constexpr (Kind == Run::Spaces) {
+        return is_space_char(ch);
+    } else if constexpr (Kind == Run::Identifier) {
+        return is_identifier_char(ch);
+    } else {
+        return is_digit_char(ch);
+    }
+}
+
+template <Run Kind>
+std::size_t skip_scalar(const char* data, std::size_t size, std::size_t pos) {
+    while (pos < size && in_run<Kind>(data[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+#if REPL_SCAN_X86
+
+// SSE2 is part of the x86-64 baseline, so no runtime check is needed. Classes
+// are computed with unsigned range compares: (x - lo) <= (hi - lo).
+__m128i in_range_sse2(__m128i chunk, char lo, char hi) {
+    __m128i shifted = _mm_sub_epi8(chunk, _mm_set1_epi8(lo));
+    __m128i limit = _mm_set1_epi8(static_cast<char>(hi - lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, limit), shifted);
+}
+
+template <Run Kind>
+__m128i classify_sse2(__m128i chunk) {
+    if constexpr (Kind == Run::Spaces) {
+        return _mm_or_si128(in_range_sse2(chunk, '\t', '\r'),
+                            _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+    } else if constexpr (Kind == Run::Identifier) {
+        __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        __m128i alpha = in_range_sse2(lower, 'a', 'z');
+        __m128i digit = in_range_sse2(chunk, '0', '9');
+        __m128i under = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'));
+        return _mm_or_si128(_mm_or_si128(alpha, digit), under);
+    } else {
+        return in_range_sse2(chunk, '0', '9');
+    }
+}
+
+template <Run Kind>
+std::size_t skip_sse2(const char* data, std::size_t size, std::size_t pos) {
+    while (pos + 16 <= size) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        auto outside = ~static_cast<unsigned>(_mm_movemask_epi8(classify_sse2<Kind>(chunk)));
+        outside &= 0xFFFFu;
+        if (outside != 0) {
+            return pos + static_cast<std::size_t>(std::countr_zero(outside));
+        }
+        pos += 16;
+    }
+    return skip_scalar<Kind>(data, size, pos);
+}
+
+// AVX2 classifies with a nibble lookup table: class = lo[c & 0xF] & hi[c >> 4].
+// Bits: 0x01 digit, 0x02 [A-O a-o], 0x04 [P-Z p-z], 0x08 '_', 0x10 \t..\r, 0x20 ' '.
+constexpr std::uint8_t kNibbleDigit = 0x01;
+constexpr std::uint8_t kNibbleAlpha = 0x02 | 0x04 | 0x08;
+constexpr std::uint8_t kNibbleSpace = 0x10 | 0x20;
+
+struct NibbleTables {
+    alignas(32) std::uint8_t lo[32];
+    alignas(32) std::uint8_t hi[32];
+};
+
+constexpr NibbleTables make_nibble_tables() {
+    NibbleTables tables{};
+    for (int half = 0; half < 2; ++half) {
+        for (int nibble = 0; nibble < 16; ++nibble) {
+            std::uint8_t lo = 0;
+            lo |= nibble <= 9 ? 0x01 : 0;
+            lo |= nibble >= 1 ? 0x02 : 0;
+            lo |= nibble <= 0xA ? 0x04 : 0;
+            lo |= nibble == 0xF ? 0x08 : 0;
+            lo |= (nibble >= 0x9 && nibble <= 0xD) ? 0x10 : 0;
+            lo |= nibble == 0 ? 0x20 : 0;
+            tables.lo[half * 16 + nibble] = lo;
+        }
+        std::uint8_t* hi = tables.hi + half * 16;
+        hi[0x0] = 0x10;
+        hi[0x2] = 0x20;
+        hi[0x3] = 0x01;
+        hi[0x4] = 0x02;
+        hi[0x5] = 0x04 | 0x08;
+        hi[0x6] = 0x02;
+        hi[0x7] = 0x04;
+    }
+    return tables;
+}
+
+constexpr NibbleTables kNibbleTables = make_nibble_tables();
+
+template <Run Kind>
+constexpr std::uint8_t nibble_mask() {
+    if constexpr (Kind == Run::Spaces) {
+        return kNibbleSpace;
+    } else if constexpr (Kind == Run::Identifier) {
+        return kNibbleAlpha | kNibbleDigit;
+    } else {
+        return kNibbleDigit;
+    }
+}
+
+template <Run Kind>
+REPL_TARGET_AVX2 std::size_t skip_avx2(const char* data, std::size_t size, std::size_t pos) {
+    const __m256i lo_table =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(kNibbleTables.lo));
+    const __m256i hi_table =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(kNibbleTables.hi));
+    const __m256i low_bits = _mm256_set1_epi8(0x0F);
+    const __m256i wanted = _mm256_set1_epi8(static_cast<char>(nibble_mask<Kind>()));
+    const __m256i zero = _mm256_setzero_si256();
+
+    while (pos + 32 <= size) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        __m256i lo = _mm256_and_si256(chunk, low_bits);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(chunk, 4), low_bits);
+        __m256i classes = _mm256_and_si256(_mm256_shuffle_epi8(lo_table, lo),
+                                           _mm256_shuffle_epi8(hi_table, hi));
+        __m256i outside = _mm256_cmpeq_epi8(_mm256_and_si256(classes, wanted), zero);
+        auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(outside));
+        if (mask != 0) {
+            return pos + static_cast<std::size_t>(std::countr_zero(mask));
+        }
+        pos += 32;
+    }
+    return skip_sse2<Kind>(data, size, pos);
+}
+
+bool cpu_has_avx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif  // REPL_SCAN_X86
+
+using SkipFn = std::size_t (*)(const char*, std::size_t, std::size_t);
+
+struct Dispatch {
+    ScanIsa isa;
+    SkipFn spaces;
+    SkipFn identifier;
+    SkipFn digits;
+};
+
+Dispatch make_dispatch(ScanIsa isa) {
+    switch (isa) {
+#if REPL_SCAN_X86
+        case ScanIsa::AVX2:
+            return {isa, skip_avx2<Run::Spaces>, skip_avx2<Run::Identifier>,
+                    skip_avx2<Run::Digits>};
+        case ScanIsa::SSE2:
+            return {isa, skip_sse2<Run::Spaces>, skip_sse2<Run::Identifier>,
+                    skip_sse2<Run::Digits>};
+#endif
+        default:
+            return {ScanIsa::Scalar, skip_scalar<Run::Spaces>, skip_scalar<Run::Identifier>,
+                    skip_scalar<Run::Digits>};
+    }
+}
+
+Dispatch& dispatch() {
+    static Dispatch current = make_dispatch(detected_scan_isa());
+    return current;
+}
+
+}  // namespace
+
+std::string_view to_string(ScanIsa isa) {
+    switch (isa) {
+        case ScanIsa::Scalar: return "scalar";
+        case ScanIsa::SSE2: return "sse2";
+        case ScanIsa::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+ScanIsa detected_scan_isa() {
+#if REPL_SCAN_X86
+    static const ScanIsa detected = cpu_has_avx2() ? ScanIsa::AVX2 : ScanIsa::SSE2;
+    return detected;
+#else
+    return ScanIsa::Scalar;
+#endif
+}
+
+ScanIsa scan_isa() {
+    return dispatch().isa;
+}
+
+ScanIsa set_scan_isa(ScanIsa isa) {
+    if (static_cast<int>(isa) > static_cast<int>(detected_scan_isa())) {
+        isa = detected_scan_isa();
+    }
+    dispatch() = make_dispatch(isa);
+    return isa;
+}
+
+namespace detail {
+
+std::size_t skip_spaces_bulk(const char* data, std::size_t size, std::size_t pos) {
+    return dispatch().spaces(data, size, pos);
+}
+
+std::size_t skip_identifier_chars_bulk(const char* data, std::size_t size, std::size_t pos) {
+    return dispatch().identifier(data, size, pos);
+}
+
+std::size_t skip_digits_bulk(const char* data, std::size_t size, std::size_t pos) {
+    return dispatch().digits(data, size, pos);
+}
+
+}  // namespace detail
+
+}  // namespace repl
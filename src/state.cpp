@@ -1,125 +1,90 @@
 #include "repl/state.hpp"
 
-#include <cmath>
-#include <numbers>
-#include <utility>
+#include <format>
+#include <stdexcept>
+
+#include "repl/errors.hpp"
 
 namespace repl {
 
-std::ostream& operator<<(std::ostream& os, const VariableMap& vars) {
+double VariableStore::at(Identifier name) const {
+    if (const double* value = find(name)) {
+        return *value;
+    }
+    throw std::out_of_range("Variable is not defined");
+}
+
+void VariableStore::erase(Identifier name) {
+    const std::size_t slot = index_of(name);
+    if (slot < defined_.size() && defined_[slot] != 0) {
+        defined_[slot] = 0;
+        ++versions_[slot];
+        --count_;
+    }
+}
+
+void VariableStore::clear() {
+    for (std::size_t slot = 0; slot < defined_.size(); ++slot) {
+        versions_[slot] += defined_[slot];
+    }
+    values_.clear();
+    defined_.clear();
+    count_ = 0;
+}
+
+std::ostream& operator<<(std::ostream& os, const VariableStore& vars) {
     if (vars.empty()) {
         return os << "{}";
     }
     os << '{';
     auto it = vars.begin();
-    os << it->first << ": " << it->second;
+    os << symbol_name((*it).first) << ": " << (*it).second;
     ++it;
     for (; it != vars.end(); ++it) {
-        os << ", " << it->first << ": " << it->second;
+        os << ", " << symbol_name((*it).first) << ": " << (*it).second;
     }
     return os << '}';
 }
 
-namespace {
-
-BuiltinSpec make_unary(std::string name, std::string description,
-                       double (*fn)(double)) {
-    return BuiltinSpec{std::move(name), 1, std::move(description),
-                       [fn](std::span<const double> args) { return fn(args[0]); }};
-}
-
-BuiltinSpec make_binary(std::string name, std::string description,
-                        double (*fn)(double, double)) {
-    return BuiltinSpec{std::move(name), 2, std::move(description),
-                       [fn](std::span<const double> args) { return fn(args[0], args[1]); }};
-}
-
-}  // namespace
-
-const BuiltinMap& builtin_functions() {
-    static const BuiltinMap builtins = [] {
-        BuiltinMap map;
-
-        auto add = [&map](BuiltinSpec spec) {
-            map.emplace(spec.name, std::move(spec));
-        };
-
-        add(make_unary("sin", "Sine (radians)", std::sin));
-        add(make_unary("cos", "Cosine (radians)", std::cos));
-        add(make_unary("tan", "Tangent (radians)", std::tan));
-        add(make_unary("asin", "Inverse sine", std::asin));
-        add(make_unary("acos", "Inverse cosine", std::acos));
-        add(make_unary("atan", "Inverse tangent", std::atan));
-
-        add(make_unary("sinh", "Hyperbolic sine", std::sinh));
-        add(make_unary("cosh", "Hyperbolic cosine", std::cosh));
-        add(make_unary("tanh", "Hyperbolic tangent", std::tanh));
-        add(make_unary("asinh", "Inverse hyperbolic sine", std::asinh));
-        add(make_unary("acosh", "Inverse hyperbolic cosine", std::acosh));
-        add(make_unary("atanh", "Inverse hyperbolic tangent", std::atanh));
-
-        add(make_unary("sqrt", "Square root", std::sqrt));
-        add(make_unary("cbrt", "Cube root", std::cbrt));
-        add(make_unary("exp", "Exponential (e^x)", std::exp));
-        add(make_unary("ln", "Natural logarithm", std::log));
-        add(make_unary("log", "Base-10 logarithm", std::log10));
-        add(make_unary("log2", "Base-2 logarithm", std::log2));
-        add(make_unary("abs", "Absolute value", std::fabs));
-        add(make_unary("floor", "Round down", std::floor));
-        add(make_unary("ceil", "Round up", std::ceil));
-        add(make_unary("round", "Round to nearest", std::round));
-        add(make_unary("trunc", "Truncate fractional part", std::trunc));
-        add(make_unary("sign", "Sign (-1, 0, or 1)",
-                       +[](double x) -> double {
-                           if (x > 0.0) {
-                               return 1.0;
-                           }
-                           if (x < 0.0) {
-                               return -1.0;
-                           }
-                           return 0.0;
-                       }));
-
-        add(make_binary("pow", "Power", std::pow));
-        add(make_binary("fmod", "Floating-point modulo", std::fmod));
-        add(make_binary("atan2", "Quadrant-aware arctangent", std::atan2));
-        add(make_binary("min", "Minimum of two values",
-                        +[](double a, double b) { return std::fmin(a, b); }));
-        add(make_binary("max", "Maximum of two values",
-                        +[](double a, double b) { return std::fmax(a, b); }));
-        add(make_binary("hypot", "Euclidean distance sqrt(a^2 + b^2)",
-                        +[](double a, double b) { return std::hypot(a, b); }));
-
-        return map;
-    }();
-
-    return builtins;
-}
-
-const ConstantMap& constants() {
-    static const ConstantMap values = {
-        {"pi", std::numbers::pi_v<double>},
-        {"e", std::numbers::e_v<double>},
-        {"tau", std::numbers::pi_v<double> * 2.0},
-    };
-    return values;
+State worker_copy(const State& state) {
+    State copy;
+    copy.vars = state.vars;
+    for (const auto& [name, fn] : state.fns) {
+        FnObj& target = copy.fns[name];
+        target.params = fn.params;
+        target.expr = fn.expr;
+        target.code = fn.code;
+        target.frame_size = fn.frame_size;
+        if (fn.memo) {
+            target.memo = std::make_unique<MemoTable>(fn.memo->arity(), fn.memo->capacity());
+        }
+    }
+    copy.last_result = state.last_result;
+    copy.has_last_result = state.has_last_result;
+    copy.engine = state.engine == Engine::Jit ? Engine::Tree : state.engine;
+    copy.max_call_depth = state.max_call_depth;
+    copy.fns_version = state.fns_version;
+    return copy;
 }
 
-bool is_reserved_identifier(std::string_view name) {
-    if (name == "_") {
-        return true;
+MemoTable& worker_memo(WorkerView& view, const FnObj& fn) {
+    for (auto& [owner, memo] : view.memos) {
+        if (owner == &fn) {
+            return *memo;
+        }
     }
-    return is_constant(name) || is_builtin_function(name);
+    view.memos.emplace_back(&fn,
+                            std::make_unique<MemoTable>(fn.memo->arity(), fn.memo->capacity()));
+    return *view.memos.back().second;
 }
 
-bool is_builtin_function(std::string_view name) {
-    const auto& builtins = builtin_functions();
-    return builtins.find(std::string{name}) != builtins.end();
+Error call_depth_exceeded(const State& state) {
+    return limit_error(ErrorCode::CallDepthExceeded, state.max_call_depth);
 }
 
-bool is_constant(std::string_view name) {
-    const auto& values = constants();
-    return values.find(std::string{name}) != values.end();
+Identifier last_result_symbol() {
+    static const Identifier symbol = intern("_");
+    return symbol;
 }
 
 }  // namespace repl
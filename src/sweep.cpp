@@ -0,0 +1,129 @@
+#include "repl/sweep.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "repl/errors.hpp"
+#include "repl/state.hpp"
+
+namespace repl {
+
+namespace {
+
+/** @brief Number of grid points, after checking that names are distinct. */
+std::size_t grid_rows(std::span<const SweepRange> ranges) {
+    const std::size_t limit = std::vector<double>{}.max_size();
+    std::size_t rows = 1;
+    for (std::size_t index = 0; index < ranges.size(); ++index) {
+        for (std::size_t other = 0; other < index; ++other) {
+            if (ranges[other].name == ranges[index].name) {
+                throw EvalError(std::format("Duplicate sweep variable '{}'",
+                                            symbol_name(ranges[index].name)));
+            }
+        }
+        const std::size_t count = ranges[index].count;
+        if (count != 0 && rows > limit / count) {
+            throw EvalError("Sweep grid is too large");
+        }
+        rows *= count;
+    }
+    return rows;
+}
+
+/** @brief Per-worker state, created by the worker on its first chunk. */
+struct Worker {
+    std::optional<State> state;
+    std::vector<std::vector<double>> columns;
+    std::vector<BatchColumn> views;
+};
+
+/** @brief Failed rows of one chunk; `message` indexes the chunk's own list. */
+struct ChunkErrors {
+    std::vector<BatchError> errors;
+    std::vector<std::string> messages;
+};
+
+/** @brief Fill `worker`'s columns with grid rows [begin, begin + count). */
+void fill_columns(std::span<const SweepRange> ranges, std::size_t begin, std::size_t count,
+                  Worker& worker) {
+    // Digits of `begin` in the grid's mixed radix, least significant last.
+    std::vector<std::size_t> digits(ranges.size());
+    std::size_t rest = begin;
+    for (std::size_t index = ranges.size(); index-- > 0;) {
+        digits[index] = rest % ranges[index].count;
+        rest /= ranges[index].count;
+    }
+    worker.columns.resize(ranges.size());
+    for (std::vector<double>& column : worker.columns) {
+        column.resize(count);
+    }
+    for (std::size_t row = 0; row < count; ++row) {
+        for (std::size_t index = 0; index < ranges.size(); ++index) {
+            worker.columns[index][row] = ranges[index].at(digits[index]);
+        }
+        for (std::size_t index = ranges.size(); index-- > 0;) {
+            if (++digits[index] < ranges[index].count) {
+                break;
+            }
+            digits[index] = 0;
+        }
+    }
+    worker.views.clear();
+    for (std::size_t index = 0; index < ranges.size(); ++index) {
+        worker.views.push_back(BatchColumn{ranges[index].name, worker.columns[index]});
+    }
+}
+
+}  // namespace
+
+BatchResult sweep(const Expression& expr, std::span<const SweepRange> ranges, const State& state,
+                  ThreadPool& pool) {
+    const std::size_t rows = grid_rows(ranges);
+    const std::size_t chunks = (rows + kSweepChunk - 1) / kSweepChunk;
+
+    BatchResult result;
+    result.values.resize(rows);
+    std::vector<Worker> workers(pool.size());
+    std::vector<ChunkErrors> chunk_errors(chunks);
+
+    pool.run(chunks, [&](std::size_t chunk, std::size_t index) {
+        Worker& worker = workers[index];
+        if (!worker.state) {
+            worker.state.emplace(worker_copy(state));
+        }
+        const std::size_t begin = chunk * kSweepChunk;
+        const std::size_t count = std::min(kSweepChunk, rows - begin);
+        fill_columns(ranges, begin, count, worker);
+        BatchResult part = evaluate_batch(expr, worker.views, *worker.state);
+        std::copy(part.values.begin(), part.values.end(), result.values.begin() + begin);
+        if (!part.errors.empty()) {
+            for (BatchError& error : part.errors) {
+                error.row += begin;
+            }
+            chunk_errors[chunk] = ChunkErrors{std::move(part.errors), std::move(part.messages)};
+        }
+    });
+
+    // Chunks are merged in order, so messages are numbered by first occurrence.
+    std::unordered_map<std::string, std::uint32_t> message_ids;
+    for (const ChunkErrors& chunk : chunk_errors) {
+        for (const BatchError& error : chunk.errors) {
+            const std::string& message = chunk.messages[error.message];
+            auto [it, inserted] =
+                message_ids.try_emplace(message, static_cast<std::uint32_t>(message_ids.size()));
+            if (inserted) {
+                result.messages.push_back(message);
+            }
+            result.errors.push_back(BatchError{error.row, it->second});
+        }
+    }
+    return result;
+}
+
+}  // namespace repl
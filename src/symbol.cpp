@@ -0,0 +1,56 @@
+#include "repl/symbol.hpp"
+
+#include "repl/errors.hpp"
+#include "repl/registry.hpp"
+
+#include <limits>
+
+namespace repl {
+
+Symbol SymbolTable::intern(std::string_view name) {
+    if (auto it = ids_.find(name); it != ids_.end()) {
+        return it->second;
+    }
+    if (names_.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        throw ParseError("Too many distinct identifiers");
+    }
+    auto symbol = static_cast<Symbol>(names_.size());
+    const std::string& stored = names_.emplace_back(name);
+    ids_.emplace(std::string_view{stored}, symbol);
+    return symbol;
+}
+
+std::optional<Symbol> SymbolTable::find(std::string_view name) const {
+    if (auto it = ids_.find(name); it != ids_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+std::string_view SymbolTable::name(Symbol symbol) const {
+    return names_[index_of(symbol)];
+}
+
+void intern_registry(SymbolTable& table) {
+    for (const BuiltinSpec& spec : kBuiltins) {
+        table.intern(spec.name);
+    }
+    for (const ConstantSpec& spec : kConstants) {
+        table.intern(spec.name);
+    }
+    table.intern("_");
+    for (const ReductionSpec& spec : kReductions) {
+        table.intern(spec.name);
+    }
+}
+
+SymbolTable& symbols() {
+    static SymbolTable table = [] {
+        SymbolTable registry;
+        intern_registry(registry);
+        return registry;
+    }();
+    return table;
+}
+
+}  // namespace repl
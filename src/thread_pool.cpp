@@ -0,0 +1,161 @@
+#include "repl/thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace repl {
+
+namespace {
+
+/** @brief Pool whose task the current thread is running, if any. */
+thread_local const ThreadPool* current_pool = nullptr;
+
+}  // namespace
+
+ThreadPool::ThreadPool(std::size_t workers) {
+    if (workers == 0) {
+        workers = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    for (std::size_t worker = 0; worker < workers; ++worker) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    threads_.reserve(workers - 1);
+    for (std::size_t worker = 1; worker < workers; ++worker) {
+        threads_.emplace_back([this, worker] { worker_loop(worker); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    start_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::run(std::size_t count, const Body& body) {
+    std::unique_lock run_lock{run_mutex_, std::defer_lock};
+    if (count == 0 || threads_.empty() || current_pool == this || !run_lock.try_lock()) {
+        for (std::size_t task = 0; task < count; ++task) {
+            body(task, 0);
+        }
+        return;
+    }
+
+    body_ = &body;
+    failed_ = false;
+    const std::size_t workers = size();
+    for (std::size_t worker = 0; worker < workers; ++worker) {
+        Queue& queue = *queues_[worker];
+        std::lock_guard lock{queue.mutex};
+        queue.begin = count * worker / workers;
+        queue.end = count * (worker + 1) / workers;
+    }
+    {
+        std::lock_guard lock{mutex_};
+        finished_ = 0;
+        ++generation_;
+    }
+    start_.notify_all();
+
+    work(0);
+    std::unique_lock lock{mutex_};
+    done_.wait(lock, [this] { return finished_ == threads_.size(); });
+    body_ = nullptr;
+    if (error_) {
+        std::exception_ptr error = std::exchange(error_, nullptr);
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::work(std::size_t worker) {
+    const ThreadPool* outer = std::exchange(current_pool, this);
+    while (true) {
+        std::size_t task = 0;
+        if (!take(worker, task)) {
+            if (!steal(worker)) {
+                break;
+            }
+            continue;
+        }
+        if (failed_.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        try {
+            (*body_)(task, worker);
+        } catch (...) {
+            std::lock_guard lock{mutex_};
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            failed_ = true;
+        }
+    }
+    current_pool = outer;
+}
+
+bool ThreadPool::take(std::size_t worker, std::size_t& task) {
+    Queue& queue = *queues_[worker];
+    std::lock_guard lock{queue.mutex};
+    if (queue.begin == queue.end) {
+        return false;
+    }
+    task = queue.begin++;
+    return true;
+}
+
+bool ThreadPool::steal(std::size_t worker) {
+    const std::size_t workers = size();
+    for (std::size_t offset = 1; offset < workers; ++offset) {
+        Queue& victim = *queues_[(worker + offset) % workers];
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        {
+            std::lock_guard lock{victim.mutex};
+            const std::size_t remaining = victim.end - victim.begin;
+            if (remaining == 0) {
+                continue;
+            }
+            end = victim.end;
+            begin = end - (remaining + 1) / 2;
+            victim.end = begin;
+        }
+        // Nobody steals from this worker meanwhile: its range is empty.
+        Queue& own = *queues_[worker];
+        std::lock_guard lock{own.mutex};
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(std::size_t worker) {
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock{mutex_};
+            start_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+        }
+        work(worker);
+        {
+            std::lock_guard lock{mutex_};
+            ++finished_;
+        }
+        done_.notify_one();
+    }
+}
+
+ThreadPool& shared_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+}  // namespace repl
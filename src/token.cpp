@@ -1,22 +1,18 @@
 #include "repl/token.hpp"
 
 #include "repl/errors.hpp"
+#include "repl/scan.hpp"
 
-#include <cctype>
+#include <array>
+#include <charconv>
 #include <format>
-#include <sstream>
+#include <limits>
 #include <stdexcept>
+#include <system_error>
+#include <utility>
 
 namespace repl {
 
-Token Token::number(double value) {
-    return Token{TType::Number, value};
-}
-
-Token Token::identifier(Identifier name) {
-    return Token{TType::Identifier, std::move(name)};
-}
-
 std::string_view to_string(TType type) {
     switch (type) {
         case TType::Number: return "Number";
@@ -38,6 +34,7 @@ std::string_view to_string(TType type) {
         case TType::GreaterEqual: return "GreaterEqual";
         case TType::Question: return "Question";
         case TType::Colon: return "Colon";
+        case TType::ColonEquals: return "ColonEquals";
         case TType::Comma: return "Comma";
     }
     return "Unknown";
@@ -50,10 +47,10 @@ std::ostream& operator<<(std::ostream& os, TType type) {
 std::ostream& operator<<(std::ostream& os, const Token& token) {
     os << token.type;
     if (token.type == TType::Number) {
-        os << '[' << token.get<double>() << ']';
+        os << '[' << token.number << ']';
     }
     if (token.type == TType::Identifier) {
-        os << '[' << token.get<Identifier>() << ']';
+        os << '[' << symbol_name(token.symbol) << ']';
     }
     return os;
 }
@@ -71,197 +68,240 @@ std::ostream& operator<<(std::ostream& os, const Tokens& tokens) {
 
 namespace {
 
-bool is_digit(char ch) {
-    return std::isdigit(static_cast<unsigned char>(ch)) != 0;
+/** @brief Token type + 1 for characters that always form a token on their own. */
+constexpr std::array<std::uint8_t, 256> make_single_char_tokens() {
+    std::array<std::uint8_t, 256> table{};
+    auto set = [&table](char ch, TType type) {
+        table[static_cast<unsigned char>(ch)] = static_cast<std::uint8_t>(type) + 1;
+    };
+    set('+', TType::Plus);
+    set('-', TType::Minus);
+    set('*', TType::Star);
+    set('/', TType::Slash);
+    set('%', TType::Percent);
+    set('^', TType::Caret);
+    set('(', TType::LParen);
+    set(')', TType::RParen);
+    set(',', TType::Comma);
+    set('?', TType::Question);
+    return table;
 }
 
-bool is_alpha(char ch) {
-    return std::isalpha(static_cast<unsigned char>(ch)) != 0;
-}
+constexpr std::array<std::uint8_t, 256> kSingleCharTokens = make_single_char_tokens();
 
-bool is_alnum(char ch) {
-    return std::isalnum(static_cast<unsigned char>(ch)) != 0;
+std::uint32_t position_of(std::size_t pos) {
+    return static_cast<std::uint32_t>(pos);
 }
 
 }  // namespace
 
-Tokens tokenize(std::string_view input) {
-    Tokens result;
-    result.reserve(input.size());
+Lexer::Lexer(std::string_view input) : input_(input), pos_(0) {
+    if (input.size() > std::numeric_limits<std::uint32_t>::max()) {
+        fail(make_error(ErrorCode::InputTooLong));
+    }
+}
 
-    for (std::size_t pos = 0; pos < input.size(); ++pos) {
-        char c = input[pos];
-        if (std::isspace(static_cast<unsigned char>(c)) != 0) {
-            continue;
-        }
+bool Lexer::next(Token& token) {
+    return scan<true>(token);
+}
 
-        if (c == '+') {
-            result.push_back({TType::Plus, {}});
-            continue;
-        }
-        if (c == '-') {
-            result.push_back({TType::Minus, {}});
-            continue;
-        }
-        if (c == '*') {
-            result.push_back({TType::Star, {}});
-            continue;
-        }
-        if (c == '/') {
-            result.push_back({TType::Slash, {}});
-            continue;
-        }
-        if (c == '%') {
-            result.push_back({TType::Percent, {}});
-            continue;
-        }
-        if (c == '^') {
-            result.push_back({TType::Caret, {}});
-            continue;
-        }
-        if (c == '(') {
-            result.push_back({TType::LParen, {}});
-            continue;
-        }
-        if (c == ')') {
-            result.push_back({TType::RParen, {}});
-            continue;
-        }
-        if (c == ',') {
-            result.push_back({TType::Comma, {}});
-            continue;
+bool Lexer::skip(Token& token) {
+    return scan<false>(token);
+}
+
+bool Lexer::fail(const Error& error) {
+    error_ = error;
+    pos_ = input_.size();
+    return false;
+}
+
+bool Lexer::emit(Token& token, TType type, std::size_t start) {
+    if (pos_ - start > std::numeric_limits<std::uint16_t>::max()) [[unlikely]] {
+        return fail(make_error(ErrorCode::TokenTooLong, position_of(start)));
+    }
+    token.type = type;
+    token.length = static_cast<std::uint16_t>(pos_ - start);
+    token.offset = position_of(start);
+    token.number = 0.0;
+    return true;
+}
+
+bool Lexer::scan_number(std::size_t start) {
+    pos_ = skip_digits(input_, pos_);
+    if (at(pos_, '.')) {
+        pos_ = skip_digits(input_, pos_ + 1);
+        if (at(pos_, '.')) {
+            return fail(make_error(ErrorCode::MultipleDecimalPoints, position_of(start)));
         }
-        if (c == '?') {
-            result.push_back({TType::Question, {}});
-            continue;
+    }
+
+    // Scientific notation: [eE][+-]?digits
+    if (at(pos_, 'e') || at(pos_, 'E')) {
+        std::size_t exp_marker = pos_;
+        ++pos_;
+        if (at(pos_, '+') || at(pos_, '-')) {
+            ++pos_;
         }
-        if (c == ':') {
-            result.push_back({TType::Colon, {}});
-            continue;
+        if (pos_ >= input_.size() || !is_digit_char(input_[pos_])) {
+            return fail(make_error(ErrorCode::MissingExponent, position_of(exp_marker)));
         }
+        pos_ = skip_digits(input_, pos_);
+    }
+    return true;
+}
 
-        if (c == '=') {
-            if (pos + 1 < input.size() && input[pos + 1] == '=') {
-                result.push_back({TType::EqualEqual, {}});
-                ++pos;
-            } else {
-                result.push_back({TType::Equals, {}});
-            }
-            continue;
-        }
-        if (c == '!') {
-            if (pos + 1 < input.size() && input[pos + 1] == '=') {
-                result.push_back({TType::BangEqual, {}});
-                ++pos;
-            } else {
-                throw ParseError(std::format(
-                    "Unexpected '!' at position {}. Did you mean '!='?", pos));
+template <bool Convert>
+bool Lexer::scan(Token& token) {
+    pos_ = skip_spaces(input_, pos_);
+    if (pos_ >= input_.size()) {
+        return false;
+    }
+
+    const std::size_t start = pos_;
+    const char c = input_[pos_++];
+    if (std::uint8_t single = kSingleCharTokens[static_cast<unsigned char>(c)]; single != 0) {
+        return emit(token, static_cast<TType>(single - 1), start);
+    }
+
+    switch (c) {
+        case '=':
+            if (at(pos_, '=')) {
+                ++pos_;
+                return emit(token, TType::EqualEqual, start);
             }
-            continue;
-        }
-        if (c == '<') {
-            if (pos + 1 < input.size() && input[pos + 1] == '=') {
-                result.push_back({TType::LessEqual, {}});
-                ++pos;
-            } else {
-                result.push_back({TType::Less, {}});
+            return emit(token, TType::Equals, start);
+        case ':':
+            if (at(pos_, '=')) {
+                ++pos_;
+                return emit(token, TType::ColonEquals, start);
             }
-            continue;
-        }
-        if (c == '>') {
-            if (pos + 1 < input.size() && input[pos + 1] == '=') {
-                result.push_back({TType::GreaterEqual, {}});
-                ++pos;
-            } else {
-                result.push_back({TType::Greater, {}});
+            return emit(token, TType::Colon, start);
+        case '!':
+            if (!at(pos_, '=')) {
+                return fail(make_error(ErrorCode::BangWithoutEquals, position_of(start)));
             }
-            continue;
-        }
-
-        if (is_digit(c) || (c == '.' && pos + 1 < input.size() && is_digit(input[pos + 1]))) {
-            std::size_t start = pos;
-            bool seen_dot = false;
-
-            while (pos < input.size()) {
-                char current = input[pos];
-                if (current == '.') {
-                    if (seen_dot) {
-                        throw ParseError(std::format(
-                            "Invalid number with multiple decimal points starting at position {}",
-                            start));
-                    }
-                    seen_dot = true;
-                    ++pos;
-                    continue;
-                }
-                if (!is_digit(current)) {
-                    break;
-                }
-                ++pos;
+            ++pos_;
+            return emit(token, TType::BangEqual, start);
+        case '<':
+            if (at(pos_, '=')) {
+                ++pos_;
+                return emit(token, TType::LessEqual, start);
             }
-
-            // Scientific notation: [eE][+-]?digits
-            if (pos < input.size() && (input[pos] == 'e' || input[pos] == 'E')) {
-                std::size_t exp_marker = pos;
-                ++pos;
-                if (pos < input.size() && (input[pos] == '+' || input[pos] == '-')) {
-                    ++pos;
-                }
-                if (pos >= input.size() || !is_digit(input[pos])) {
-                    throw ParseError(std::format(
-                        "Invalid scientific notation at position {}: exponent requires digits",
-                        exp_marker));
-                }
-                while (pos < input.size() && is_digit(input[pos])) {
-                    ++pos;
-                }
+            return emit(token, TType::Less, start);
+        case '>':
+            if (at(pos_, '=')) {
+                ++pos_;
+                return emit(token, TType::GreaterEqual, start);
             }
+            return emit(token, TType::Greater, start);
+        default:
+            break;
+    }
 
-            std::string number_text{input.substr(start, pos - start)};
-            try {
-                result.push_back(Token::number(std::stod(number_text)));
-            } catch (const std::out_of_range&) {
-                throw ParseError(std::format("Number out of range: '{}'", number_text));
-            } catch (const std::invalid_argument&) {
-                throw ParseError(std::format("Invalid number: '{}'", number_text));
+    if (is_digit_char(c) || (c == '.' && pos_ < input_.size() && is_digit_char(input_[pos_]))) {
+        pos_ = start;
+        if (!scan_number(start) || !emit(token, TType::Number, start)) {
+            return false;
+        }
+        if constexpr (Convert) {
+            const char* first = input_.data() + start;
+            const char* last = input_.data() + pos_;
+            auto [ptr, ec] = std::from_chars(first, last, token.number);
+            if (ec != std::errc{} || ptr != last) {
+                Error error = make_error(ec == std::errc::result_out_of_range
+                                             ? ErrorCode::NumberOutOfRange
+                                             : ErrorCode::InvalidNumber,
+                                         position_of(start));
+                error.numbers[0] = token.length;
+                return fail(error);
             }
-            --pos;
-            continue;
         }
+        return true;
+    }
 
-        if (is_alpha(c) || c == '_') {
-            std::size_t start = pos;
-            while (pos < input.size() && (is_alnum(input[pos]) || input[pos] == '_')) {
-                ++pos;
-            }
-            result.push_back(Token::identifier(std::string{input.substr(start, pos - start)}));
-            --pos;
-            continue;
+    if (is_identifier_start(c)) {
+        pos_ = skip_identifier_chars(input_, pos_);
+        if (!emit(token, TType::Identifier, start)) {
+            return false;
+        }
+        if constexpr (Convert) {
+            token.symbol = intern(input_.substr(start, pos_ - start));
         }
+        return true;
+    }
 
-        throw ParseError(std::format(
-            "Could not parse character '{}' at position {}", c, pos));
+    Error error = make_error(ErrorCode::UnexpectedCharacter, position_of(start));
+    error.subject = static_cast<unsigned char>(c);
+    return fail(error);
+}
+
+std::expected<Tokens, Error> try_tokenize(std::string_view input) {
+    // Counting pass first so the token buffer is allocated exactly once.
+    std::size_t count = 0;
+    Token token{};
+    Lexer counter{input};
+    while (counter.skip(token)) {
+        ++count;
+    }
+    if (counter.error()) {
+        return std::unexpected{counter.error()};
     }
 
+    Tokens result{input};
+    result.reserve(count);
+    Lexer lexer{input};
+    while (lexer.next(token)) {
+        result.push_back(token);
+    }
+    if (lexer.error()) {
+        return std::unexpected{lexer.error()};
+    }
     return result;
 }
 
-TokenStream::TokenStream(const Tokens& tokens) : tokens_(tokens), pos_(0) {}
+Tokens tokenize(std::string_view input) {
+    auto tokens = try_tokenize(input);
+    if (!tokens) {
+        throw_error(tokens.error(), input);
+    }
+    return std::move(*tokens);
+}
+
+TokenStream::TokenStream(const Tokens& tokens)
+    : tokens_(&tokens), index_(0), lexer_(tokens.source()), lookahead_{}, has_lookahead_(false) {}
+
+TokenStream::TokenStream(std::string_view source)
+    : tokens_(nullptr), index_(0), lexer_(source), lookahead_{}, has_lookahead_(false) {}
+
+bool TokenStream::fill() const {
+    if (!has_lookahead_) {
+        has_lookahead_ = lexer_.next(lookahead_);
+    }
+    return has_lookahead_;
+}
 
 const Token& TokenStream::peek() const {
     if (empty()) {
+        if (error()) {
+            throw_error(error(), source());
+        }
         throw std::underflow_error("Cannot peek empty token stream");
     }
-    return tokens_[pos_];
+    return tokens_ ? (*tokens_)[index_] : lookahead_;
 }
 
-const Token& TokenStream::get() {
+Token TokenStream::get() {
     if (empty()) {
+        if (error()) {
+            throw_error(error(), source());
+        }
         throw std::underflow_error("Cannot get from empty token stream");
     }
-    const auto& current = tokens_[pos_];
-    ++pos_;
-    return current;
+    if (tokens_) {
+        return (*tokens_)[index_++];
+    }
+    has_lookahead_ = false;
+    return lookahead_;
 }
 
 bool TokenStream::match(TType type) {
@@ -272,7 +312,7 @@ bool TokenStream::match(TType type) {
     return false;
 }
 
-const Token& TokenStream::expect(TType type) {
+Token TokenStream::expect(TType type) {
     if (empty()) {
         throw std::underflow_error("Cannot read from empty token stream");
     }
@@ -283,12 +323,16 @@ const Token& TokenStream::expect(TType type) {
     return get();
 }
 
-std::size_t TokenStream::remaining() const {
-    return tokens_.size() - pos_;
+std::string_view TokenStream::source() const {
+    return lexer_.source();
+}
+
+std::string_view TokenStream::text(const Token& token) const {
+    return source().substr(token.offset, token.length);
 }
 
 bool TokenStream::empty() const {
-    return remaining() == 0;
+    return tokens_ ? index_ >= tokens_->size() : !fill();
 }
 
 }  // namespace repl
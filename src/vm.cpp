@@ -0,0 +1,430 @@
+#include "repl/bytecode.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#include "repl/optimize.hpp"
+#include "repl/reduce.hpp"
+#include "repl/state.hpp"
+
+namespace repl {
+
+namespace {
+
+/** @brief Where a user call resumes its caller. */
+struct ReturnAddress {
+    const Chunk* chunk;
+    const Instruction* ip;
+    std::size_t frame;
+};
+
+/** @brief Result of a memoized call to cache when the call returns. */
+struct PendingMemo {
+    MemoTable* memo;
+    MemoTable::Key key;
+    /** @brief Index of the call's return address. */
+    std::size_t call;
+};
+
+}  // namespace
+
+/** @brief Value stack, pending callees and return addresses, reused across runs. */
+struct Machine {
+    /** @brief Frames as [slots | operands], each frame starting at its caller's arguments. */
+    std::vector<double> stack;
+    /** @brief Per stack cell: whether an assigned-local slot has been written. */
+    std::vector<std::uint8_t> live;
+    std::vector<const FnObj*> callees;
+    std::vector<ReturnAddress> calls;
+    std::vector<PendingMemo> memos;
+};
+
+namespace {
+
+Identifier symbol_at(std::uint32_t operand) {
+    return static_cast<Identifier>(operand);
+}
+
+/** @brief `error` at the position of the top-level instruction running:
+ *  `ip` follows the failing one, unless that is inside a user call.
+ */
+std::unexpected<Error> fail(Error error, const Chunk& entry, const Machine& machine,
+                            const Instruction* ip) {
+    if (!entry.positions.empty()) {
+        const Instruction* at = machine.calls.empty() ? ip : machine.calls.front().ip;
+        error.position = entry.positions[static_cast<std::size_t>(at - 1 - entry.code.data())];
+    }
+    return std::unexpected(error);
+}
+
+/** @brief Whether the instruction at `ip`, after any jumps, returns. */
+bool returns(const Instruction* code, const Instruction* ip) {
+    while (ip->op == Op::Jump) {
+        ip = code + ip->operand;
+    }
+    return ip->op == Op::Return;
+}
+
+enum class MemoLookup { Off, Miss, Hit };
+
+/** @brief Look up a call to `fn`, whose `count` arguments end at `sp`, in its memo table.
+ *
+ *  On a hit the result replaces the first argument. On a miss the call is
+ *  queued in `machine.memos`, and Return caches its result.
+ */
+MemoLookup lookup_memo(Machine& machine, MemoTable& memo, const FnObj& fn, const State& state,
+                       double* sp, std::size_t count) {
+    if (!memo.validate(fn, state)) {
+        return MemoLookup::Off;
+    }
+    MemoTable::Key key{};
+    std::copy(sp - count, sp, key.begin());
+    if (auto value = memo.find(key)) {
+        sp[-static_cast<std::ptrdiff_t>(count)] = *value;
+        return MemoLookup::Hit;
+    }
+    machine.memos.push_back(PendingMemo{&memo, key, machine.calls.size()});
+    return MemoLookup::Miss;
+}
+
+/** @brief The state a run reads globals and functions from. */
+const State& shared_state(const State& state) {
+    return state;
+}
+
+const State& shared_state(const WorkerView& view) {
+    return view.state;
+}
+
+/** @brief Table that caches `fn`'s results in this run, if `fn` is memoized. */
+MemoTable* memo_of(const FnObj& fn, State&) {
+    return fn.memo.get();
+}
+
+MemoTable* memo_of(const FnObj& fn, WorkerView& view) {
+    return fn.memo ? &worker_memo(view, fn) : nullptr;
+}
+
+/** @brief Make room for `chunk` in the frame at stack index `frame`, whose
+ *  parameters are already in place, and mark its assigned locals unwritten.
+ */
+void reserve_frame(Machine& machine, const Chunk& chunk, std::size_t frame) {
+    const std::size_t needed = frame + chunk.slot_count + chunk.max_stack;
+    if (machine.stack.size() < needed) {
+        machine.stack.resize(needed);
+        machine.live.resize(needed);
+    }
+    std::uint8_t* live = machine.live.data() + frame;
+    std::fill(live + chunk.param_count, live + chunk.slot_count, std::uint8_t{0});
+}
+
+/** @brief Run `entry` in the frame at the bottom of the stack: a top-level
+ *  chunk, or a function body whose arguments are already in place.
+ *
+ *  User calls do not recurse: the caller's return address goes on
+ *  `machine.calls` and the loop continues in the callee, so the depth of user
+ *  recursion is bounded by State::max_call_depth rather than the C++ stack. A
+ *  call in tail position of a function body replaces the frame with the
+ *  callee's instead, so tail recursion runs in constant space and does not
+ *  count toward the limit.
+ */
+template <typename Context>
+std::expected<double, Error> run(const Chunk& entry, Context& context, Machine& machine) {
+    const State& state = shared_state(context);
+    std::size_t frame = 0;
+    const Chunk* chunk = &entry;
+    reserve_frame(machine, *chunk, frame);
+    double* slots = machine.stack.data();
+    std::uint8_t* live = machine.live.data();
+    double* sp = slots + chunk->slot_count;
+    const Instruction* code = chunk->code.data();
+    const Instruction* ip = code;
+
+    while (true) {
+        const Instruction ins = *ip++;
+        switch (ins.op) {
+            case Op::Number:
+                *sp++ = chunk->numbers[ins.operand];
+                break;
+            case Op::LoadLast:
+                if (!state.has_last_result) {
+                    return fail(make_error(ErrorCode::NoLastResult), entry, machine, ip);
+                }
+                *sp++ = state.last_result;
+                break;
+            case Op::LoadParam:
+                *sp++ = slots[ins.slot];
+                break;
+            case Op::LoadLocal:
+                if (live[ins.slot] != 0) {
+                    *sp++ = slots[ins.slot];
+                    break;
+                }
+                [[fallthrough]];
+            case Op::LoadGlobal: {
+                const double* value = state.vars.find(symbol_at(ins.operand));
+                if (!value) {
+                    return fail(name_error(ErrorCode::UndefinedVariable, symbol_at(ins.operand)),
+                                entry, machine, ip);
+                }
+                *sp++ = *value;
+                break;
+            }
+            case Op::LoadCached:
+                if (live[ins.slot] != 0) {
+                    *sp++ = slots[ins.slot];
+                    ip = code + ins.operand;
+                }
+                break;
+            case Op::StoreLocal:
+                slots[ins.slot] = sp[-1];
+                live[ins.slot] = 1;
+                break;
+            case Op::StoreGlobal:
+                // Only top-level chunks assign globals, and a view never runs one.
+                if constexpr (std::is_same_v<Context, State>) {
+                    context.vars.set(symbol_at(ins.operand), sp[-1]);
+                }
+                break;
+            case Op::Negate:
+                sp[-1] = -sp[-1];
+                break;
+            case Op::Add:
+                --sp;
+                sp[-1] = sp[-1] + sp[0];
+                break;
+            case Op::Subtract:
+                --sp;
+                sp[-1] = sp[-1] - sp[0];
+                break;
+            case Op::Multiply:
+                --sp;
+                sp[-1] = sp[-1] * sp[0];
+                break;
+            case Op::CheckDivisor:
+                if (sp[-1] == 0.0) {
+                    return fail(make_error(ErrorCode::DivisionByZero), entry, machine, ip);
+                }
+                break;
+            case Op::CheckModulus:
+                if (sp[-1] == 0.0) {
+                    return fail(make_error(ErrorCode::ModuloByZero), entry, machine, ip);
+                }
+                break;
+            case Op::Divide:
+                --sp;
+                sp[-1] = sp[0] / sp[-1];
+                break;
+            case Op::Modulo:
+                --sp;
+                sp[-1] = std::fmod(sp[0], sp[-1]);
+                break;
+            case Op::Power: {
+                --sp;
+                const double value = std::pow(sp[-1], sp[0]);
+                if (!std::isfinite(value)) {
+                    return fail(make_error(ErrorCode::PowerDomain), entry, machine, ip);
+                }
+                sp[-1] = value;
+                break;
+            }
+            case Op::IntegerPower: {
+                const double value =
+                    integer_power(sp[-1], static_cast<std::int32_t>(ins.operand));
+                if (!std::isfinite(value)) {
+                    return fail(make_error(ErrorCode::PowerDomain), entry, machine, ip);
+                }
+                sp[-1] = value;
+                break;
+            }
+            case Op::SquareRoot: {
+                const double value = square_root(sp[-1]);
+                if (!std::isfinite(value)) {
+                    return fail(make_error(ErrorCode::PowerDomain), entry, machine, ip);
+                }
+                sp[-1] = value;
+                break;
+            }
+            case Op::Horner: {
+                const double* coefficients = chunk->numbers.data() + ins.operand;
+                if (std::fabs(sp[-1]) <= coefficients[ins.slot + 1]) {
+                    sp[-1] = horner(coefficients, ins.slot, sp[-1]);
+                } else {
+                    --sp;
+                    ++ip;
+                }
+                break;
+            }
+            case Op::Less:
+                --sp;
+                sp[-1] = sp[-1] < sp[0];
+                break;
+            case Op::LessEqual:
+                --sp;
+                sp[-1] = sp[-1] <= sp[0];
+                break;
+            case Op::Greater:
+                --sp;
+                sp[-1] = sp[-1] > sp[0];
+                break;
+            case Op::GreaterEqual:
+                --sp;
+                sp[-1] = sp[-1] >= sp[0];
+                break;
+            case Op::Equal:
+                --sp;
+                sp[-1] = sp[-1] == sp[0];
+                break;
+            case Op::NotEqual:
+                --sp;
+                sp[-1] = sp[-1] != sp[0];
+                break;
+            case Op::Jump:
+                ip = code + ins.operand;
+                break;
+            case Op::JumpIfZero:
+                if (*--sp == 0.0) {
+                    ip = code + ins.operand;
+                }
+                break;
+            case Op::CallUnary: {
+                const BuiltinSpec& spec = *chunk->builtins[ins.operand];
+                const double value = spec.unary(sp[-1]);
+                if (!std::isfinite(value)) {
+                    return fail(builtin_domain_error(spec), entry, machine, ip);
+                }
+                sp[-1] = value;
+                break;
+            }
+            case Op::CallBinary: {
+                const BuiltinSpec& spec = *chunk->builtins[ins.operand];
+                --sp;
+                const double value = spec.binary(sp[-1], sp[0]);
+                if (!std::isfinite(value)) {
+                    return fail(builtin_domain_error(spec), entry, machine, ip);
+                }
+                sp[-1] = value;
+                break;
+            }
+            case Op::PrepareCall: {
+                const Identifier name = symbol_at(ins.operand);
+                auto it = state.fns.find(name);
+                if (it == state.fns.end()) {
+                    return fail(name_error(ErrorCode::UndefinedFunction, name), entry, machine,
+                                ip);
+                }
+                const FnObj& fn = it->second;
+                if (ins.slot != fn.params.size()) {
+                    return fail(arity_error(name, fn.params.size(), ins.slot), entry, machine,
+                                ip);
+                }
+                machine.callees.push_back(&fn);
+                break;
+            }
+            case Op::Call: {
+                const FnObj* fn = machine.callees.back();
+                machine.callees.pop_back();
+                MemoTable* memo = memo_of(*fn, context);
+                const MemoLookup lookup =
+                    memo ? lookup_memo(machine, *memo, *fn, state, sp, ins.slot) : MemoLookup::Off;
+                if (lookup == MemoLookup::Hit) {
+                    sp -= ins.slot - 1;
+                    break;
+                }
+                // A memoized call must return here to store its result.
+                if (lookup == MemoLookup::Off && !machine.calls.empty() && returns(code, ip)) {
+                    std::copy(sp - ins.slot, sp, slots);
+                } else {
+                    if (!enter_call(context)) {
+                        return fail(call_depth_exceeded(state), entry, machine, ip);
+                    }
+                    machine.calls.push_back(ReturnAddress{chunk, ip, frame});
+                    // The arguments already on the stack become the callee's parameter slots.
+                    frame = static_cast<std::size_t>(sp - ins.slot - machine.stack.data());
+                }
+                chunk = &fn->code;
+                reserve_frame(machine, *chunk, frame);
+                slots = machine.stack.data() + frame;
+                live = machine.live.data() + frame;
+                sp = slots + chunk->slot_count;
+                code = chunk->code.data();
+                ip = code;
+                break;
+            }
+            case Op::Reduce: {
+                sp -= ins.slot;
+                const auto value = try_reduce(*chunk->reductions[ins.operand], sp, context);
+                if (!value) {
+                    return fail(value.error(), entry, machine, ip);
+                }
+                *sp++ = *value;
+                break;
+            }
+            case Op::Throw:
+                return fail(chunk->errors[ins.operand], entry, machine, ip);
+            case Op::Return: {
+                const double value = sp[-1];
+                if (machine.calls.empty()) {
+                    return value;
+                }
+                const ReturnAddress caller = machine.calls.back();
+                machine.calls.pop_back();
+                if (!machine.memos.empty() && machine.memos.back().call == machine.calls.size()) {
+                    machine.memos.back().memo->insert(machine.memos.back().key, value);
+                    machine.memos.pop_back();
+                }
+                --context.call_depth;
+                // The value replaces the arguments, which start the callee's frame.
+                sp = machine.stack.data() + frame;
+                *sp++ = value;
+                chunk = caller.chunk;
+                frame = caller.frame;
+                slots = machine.stack.data() + frame;
+                live = machine.live.data() + frame;
+                code = chunk->code.data();
+                ip = caller.ip;
+                break;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+std::expected<double, Error> execute(const Chunk& chunk, State& state) {
+    thread_local Machine machine;
+    machine.callees.clear();
+    machine.calls.clear();
+    machine.memos.clear();
+    const std::size_t depth = state.call_depth;
+    auto value = run(chunk, state, machine);
+    if (!value) {
+        state.call_depth = depth;
+    }
+    return value;
+}
+
+ChunkRunner::ChunkRunner(const Chunk& chunk)
+    : chunk_(&chunk), machine_(std::make_unique<Machine>()) {}
+
+ChunkRunner::~ChunkRunner() = default;
+ChunkRunner::ChunkRunner(ChunkRunner&&) noexcept = default;
+ChunkRunner& ChunkRunner::operator=(ChunkRunner&&) noexcept = default;
+
+std::expected<double, Error> ChunkRunner::operator()(const double* args, WorkerView& view) {
+    Machine& machine = *machine_;
+    machine.callees.clear();
+    machine.calls.clear();
+    machine.memos.clear();
+    reserve_frame(machine, *chunk_, 0);
+    std::copy_n(args, chunk_->param_count, machine.stack.data());
+    const std::size_t depth = view.call_depth;
+    auto value = run(*chunk_, view, machine);
+    if (!value) {
+        view.call_depth = depth;
+    }
+    return value;
+}
+
+}  // namespace repl
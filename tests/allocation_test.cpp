@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+
+#include "repl/evaluator.hpp"
+#include "repl/state.hpp"
+
+namespace {
+
+/** @brief Heap allocations made by this thread so far. */
+thread_local std::size_t allocations = 0;
+
+}  // namespace
+
+// Counts every allocation in the test binary; the other forms of `new` forward here.
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* block = std::malloc(size == 0 ? 1 : size)) {
+        return block;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+    std::free(block);
+}
+
+TEST_CASE("A warmed-up query loop does not allocate") {
+    // Engine::Bytecode compiles each line it is given into a new chunk; only
+    // lines from an ExpressionCache reuse theirs.
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        repl::QueryContext ctx;
+        repl::process_query("x = 3", state, ctx);
+        constexpr std::string_view kLines[] = {
+            "1 + 2 * 3",
+            "x = x + 1",
+            "3 * x ^ 3 + 2 * x * x - x / 2 + 5",
+            "(x - 1) * (x + 1) / 4",
+            "x > 2 ? sin(x) : x ^ 0.5",
+        };
+        const auto run = [&] {
+            for (std::string_view line : kLines) {
+                repl::process_query(line, state, ctx);
+            }
+        };
+
+        run();
+        run();
+        const std::size_t before = allocations;
+        for (int round = 0; round < 100; ++round) {
+            run();
+        }
+        REQUIRE(allocations == before);
+    }
+}
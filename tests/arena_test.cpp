@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "repl/arena.hpp"
+
+TEST_CASE("Arena returns aligned, distinct storage") {
+    repl::Arena arena{64};
+    auto* byte = arena.make<char>('a');
+    auto* value = arena.make<double>(1.5);
+    REQUIRE(*byte == 'a');
+    REQUIRE(*value == 1.5);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(value) % alignof(double) == 0);
+
+    // Larger than the first block: gets a block of its own.
+    auto* big = static_cast<char*>(arena.allocate(1000, 16));
+    REQUIRE(reinterpret_cast<std::uintptr_t>(big) % 16 == 0);
+    REQUIRE(*value == 1.5);
+}
+
+TEST_CASE("Arena reset reuses blocks without growing") {
+    repl::Arena arena{128};
+    auto fill = [&arena] {
+        for (int index = 0; index < 200; ++index) {
+            arena.make<std::uint64_t>(static_cast<std::uint64_t>(index));
+        }
+    };
+
+    fill();
+    const std::size_t warmed = arena.capacity();
+    for (int round = 0; round < 10; ++round) {
+        arena.reset();
+        fill();
+    }
+    REQUIRE(arena.capacity() == warmed);
+
+    arena.release();
+    REQUIRE(arena.capacity() == 0);
+}
+
+TEST_CASE("Arena copies spans and transfers ownership on move") {
+    repl::Arena arena;
+    std::array<int, 3> values{1, 2, 3};
+    auto copy = arena.copy<int>(values);
+    REQUIRE(copy.size() == 3);
+    REQUIRE(copy.data() != values.data());
+    REQUIRE(copy[2] == 3);
+
+    repl::Arena moved{std::move(arena)};
+    REQUIRE(copy[0] == 1);
+    REQUIRE(moved.capacity() > 0);
+}
@@ -0,0 +1,157 @@
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "repl/errors.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/optimize.hpp"
+#include "repl/state.hpp"
+
+using Catch::Approx;
+
+namespace {
+
+constexpr const char* kDefinitions[] = {
+    "k = 3",
+    "t = 0.5",
+    "f(a, b) = (t = a * b) > k ? t - k : sqrt(t) + b / a",
+    "g(x) = x^3 - 2 * x^2 + x - 1",
+    "h(a) = t + (a > 0 ? (t = a) : 0) + t",
+};
+
+/** @brief Owns the parsed expression and columns of one batch. */
+struct BatchQuery {
+    BatchQuery(const char* source, std::vector<std::pair<const char*, std::vector<double>>> data)
+        : columns_data(std::move(data)) {
+        expr = repl::optimize(repl::parse(source, ctx), ctx.arena);
+        for (const auto& [name, values] : columns_data) {
+            columns.push_back(repl::BatchColumn{repl::intern(name), values});
+        }
+    }
+
+    repl::BatchResult run(repl::State& state) const {
+        return repl::evaluate_batch(*expr, columns, state);
+    }
+
+    repl::QueryContext ctx;
+    repl::ExpressionPtr expr = nullptr;
+    std::vector<std::pair<const char*, std::vector<double>>> columns_data;
+    std::vector<repl::BatchColumn> columns;
+};
+
+std::string error_at(const repl::BatchResult& result, std::size_t row) {
+    for (const repl::BatchError& error : result.errors) {
+        if (error.row == row) {
+            return result.messages[error.message];
+        }
+    }
+    return {};
+}
+
+}  // namespace
+
+TEST_CASE("Batch evaluation matches per-row queries") {
+    repl::State state;
+    for (const char* definition : kDefinitions) {
+        repl::process_query(definition, state);
+    }
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    for (int row = 0; row < 150; ++row) {
+        xs.push_back((row % 17) - 6.5);
+        ys.push_back((row % 5) * 0.75 - 1.0);
+    }
+    const char* sources[] = {"x * y + k", "f(x, y)", "x < y ? g(x) : cos(y) * x % 2",
+                             "y / (x - 0.5) + ln(y)", "g(x) + hypot(x, y)", "h(x) * y"};
+    for (const char* source : sources) {
+        BatchQuery query{source, {{"x", xs}, {"y", ys}}};
+        const repl::BatchResult result = query.run(state);
+        REQUIRE(result.values.size() == xs.size());
+        for (std::size_t row = 0; row < xs.size(); ++row) {
+            repl::State scalar;
+            for (const char* definition : kDefinitions) {
+                repl::process_query(definition, scalar);
+            }
+            scalar.vars.set(repl::intern("x"), xs[row]);
+            scalar.vars.set(repl::intern("y"), ys[row]);
+            try {
+                const double expected = *repl::process_query(source, scalar).value;
+                REQUIRE(error_at(result, row).empty());
+                REQUIRE(result.values[row] == Approx(expected));
+            } catch (const repl::EvalError& e) {
+                REQUIRE(error_at(result, row) == e.what());
+                REQUIRE(std::isnan(result.values[row]));
+            }
+        }
+    }
+}
+
+TEST_CASE("Batch evaluation reports errors per row") {
+    repl::State state;
+    BatchQuery query{"1 / x + sqrt(x)", {{"x", {4.0, 0.0, -1.0, 1.0}}}};
+    const repl::BatchResult result = query.run(state);
+    REQUIRE(result.values[0] == Approx(2.25));
+    REQUIRE(result.values[3] == Approx(2.0));
+    REQUIRE(result.errors.size() == 2);
+    REQUIRE(result.errors[0].row == 1);
+    REQUIRE(result.errors[1].row == 2);
+    REQUIRE(error_at(result, 1) == "Division by zero");
+    REQUIRE(error_at(result, 2) == "Domain error in function 'sqrt'");
+
+    BatchQuery undefined{"x + y", {{"x", {1.0, 2.0}}}};
+    const repl::BatchResult missing = undefined.run(state);
+    REQUIRE(missing.errors.size() == 2);
+    REQUIRE(missing.messages.size() == 1);
+    REQUIRE(missing.messages[0] == "Variable 'y' not defined");
+
+    BatchQuery assignment{"y = x", {{"x", {1.0}}}};
+    REQUIRE(error_at(assignment.run(state), 0) == "Variable 'y' cannot be assigned in a batch");
+    REQUIRE(state.vars.find(repl::intern("y")) == nullptr);
+}
+
+TEST_CASE("Batch evaluation handles recursion and memoized functions") {
+    repl::State state;
+    repl::process_query("p(x, n) = n == 0 ? 1 : x * p(x, n - 1)", state);
+    repl::process_query("fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)", state);
+    repl::process_query("loop(n, acc) = n == 0 ? acc : loop(n - 1, acc + n)", state);
+
+    std::vector<double> ns;
+    for (int n = 0; n < 70; ++n) {
+        ns.push_back(n);
+    }
+    BatchQuery power{"p(1.1, n)", {{"n", ns}}};
+    const repl::BatchResult powers = power.run(state);
+    REQUIRE(powers.errors.empty());
+    for (int n = 0; n < 70; ++n) {
+        REQUIRE(powers.values[n] == Approx(std::pow(1.1, n)));
+    }
+
+    BatchQuery fib{"fib(n)", {{"n", ns}}};
+    const repl::BatchResult fibs = fib.run(state);
+    REQUIRE(fibs.values[69] == 117669030460994.0);
+    REQUIRE(state.fns.at(repl::intern("fib")).memo->hits() > 0);
+
+    state.max_call_depth = 20;
+    BatchQuery loop{"loop(n * 100, 0)", {{"n", {1.0, 2.0}}}};
+    const repl::BatchResult loops = loop.run(state);
+    REQUIRE(loops.values[1] == 20100.0);
+    const repl::BatchResult deep = power.run(state);
+    REQUIRE(deep.errors.size() == 50);
+    REQUIRE(error_at(deep, 69) == "Maximum call depth of 20 exceeded");
+    REQUIRE(state.call_depth == 0);
+}
+
+TEST_CASE("Batch columns must agree") {
+    repl::State state;
+    BatchQuery uneven{"x + y", {{"x", {1.0, 2.0}}, {"y", {1.0}}}};
+    REQUIRE_THROWS_AS(uneven.run(state), repl::EvalError);
+    BatchQuery repeated{"x", {{"x", {1.0}}, {"x", {2.0}}}};
+    REQUIRE_THROWS_AS(repeated.run(state), repl::EvalError);
+    BatchQuery constant{"2 * pi", {}};
+    REQUIRE(constant.run(state).values.size() == 1);
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include "repl/bytecode.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/state.hpp"
+
+namespace {
+
+/** @brief Run a session and record each line's value, info, or error text. */
+std::vector<std::string> run_session(repl::Engine engine, const std::vector<std::string>& lines) {
+    repl::State state;
+    state.engine = engine;
+    std::vector<std::string> outcomes;
+    for (const auto& line : lines) {
+        try {
+            auto result = repl::process_query(line, state);
+            outcomes.push_back(result.info ? *result.info : std::to_string(*result.value));
+        } catch (const repl::EvalError& e) {
+            outcomes.push_back(std::string{"error: "} + e.what());
+        }
+    }
+    return outcomes;
+}
+
+}  // namespace
+
+TEST_CASE("Bytecode engine matches the tree walker") {
+    const std::vector<std::string> lines = {
+        "1 + 2 * 3 - 4 / 5 % 3",
+        "2 ^ 3 ^ 2",
+        "-2 ^ 2",
+        "x = y = 4",
+        "x * y + pi",
+        "_ + 1",
+        "(1 < 2) + (2 <= 2) + (3 > 4) + (4 >= 4) + (5 == 5) + (5 != 5)",
+        "0 ? 1 / 0 : 2",
+        "1 ? 3 : sqrt(-1)",
+        "5 / 0",
+        "(z = 1) / 0",
+        "z",
+        "0 % (w = 0)",
+        "w",
+        "(-8) ^ 0.5",
+        "sqrt(-1)",
+        "max(1, 2, 3)",
+        "atan2(1, 2) + hypot(3, 4)",
+        "pi = 3",
+        "sin = 1",
+        "2 = 3",
+        "undefined(q = 5)",
+        "q",
+        "fact(n) = n <= 1 ? 1 : n * fact(n - 1)",
+        "fact(10)",
+        "fact(1, 2)",
+        "f(a) = (b = a + 1) * b + x",
+        "f(2)",
+        "b",
+        "g(a) = c + (c = a) + c",
+        "g(1)",
+        "c = 10",
+        "g(1)",
+        "h(a) = k(a) + 1",
+        "h(1)",
+        "k(a) = a * 100",
+        "h(1)",
+        "k(a) = a * 1000",
+        "h(1)",
+        "n(a) = a = 7",
+        "n(1)",
+        "m(a) = x + a",
+        "x = 100",
+        "m(1)",
+        "d(a) = e(a) = 1",
+        "d(1)",
+        "1e308 * 10 - 1e308 * 10",
+        "s(v) = v > 0 ? sqrt(v) + 1 : 0 - (sqrt(v) + 1) * (sqrt(v) + 1)",
+        "s(4)",
+        "s(-4)",
+        "s(0)",
+        "r(v) = (1 / v + 2) + (v = 1) + (1 / v + 2)",
+        "r(4)",
+        "r(0)",
+        "h(v) = 2 * v ^ 3 - v / 4 + v ^ -2 + v ^ 0.5",
+        "h(3)",
+        "h(0)",
+        "h(-1)",
+        "h(1e150)",
+        "c(v) = (v + 1) ^ 2 * (v * v - 1)",
+        "c(0.5)",
+    };
+
+    REQUIRE(run_session(repl::Engine::Bytecode, lines) ==
+            run_session(repl::Engine::Tree, lines));
+}
+
+TEST_CASE("Binary operands run left to right in every engine") {
+    const std::vector<std::string> lines = {
+        "(y = 1) ^ (y = 2)",
+        "y",
+        "(y = 3) + (y = 4) * (y = 5)",
+        "y",
+        "(y = 6) < (y = 7)",
+        "y",
+        "(1 / 0) ^ sqrt(-1)",
+        "(1 / 0) == nope",
+        "sqrt(-1) - (0 % 0)",
+        "g(n) = n > 0 ? 1 + g(n - 1) : (1 / (n - n)) ^ sqrt(n - 1)",
+        "g(3)",
+        "p(a) = (a = a + 1) * (a = a * 10) + a",
+        "p(1)",
+    };
+
+    const auto tree = run_session(repl::Engine::Tree, lines);
+    REQUIRE(tree[1] == std::to_string(2.0));
+    REQUIRE(tree[3] == std::to_string(5.0));
+    REQUIRE(tree[6] == "error: Division by zero");
+    REQUIRE(tree[8] == "error: Domain error in function 'sqrt'");
+    REQUIRE(tree[10] == "error: Division by zero");
+    REQUIRE(run_session(repl::Engine::Bytecode, lines) == tree);
+    REQUIRE(run_session(repl::Engine::Jit, lines) == tree);
+}
+
+TEST_CASE("Compiler resolves parameters and locals to slots") {
+    repl::State state;
+    repl::process_query("f(a, b) = (t = a * b) + t", state);
+    const repl::Chunk& code = state.fns.at(repl::intern("f")).code;
+    REQUIRE(code.param_count == 2);
+    REQUIRE(code.slot_count == 3);
+    REQUIRE(code.code.back().op == repl::Op::Return);
+    REQUIRE(code.max_stack == 2);
+}
@@ -0,0 +1,58 @@
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "repl/cache.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/state.hpp"
+
+using Catch::Approx;
+
+TEST_CASE("Expression cache counts hits and evicts least recently used") {
+    repl::ExpressionCache cache{2};
+    repl::Expression* first = &cache.get("1 + 2");
+    REQUIRE(&cache.get("1 + 2") == first);
+    cache.get("3 * 4");
+    cache.get("1 + 2");
+    cache.get("5 - 6");  // evicts "3 * 4"
+
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.hits() == 2);
+    REQUIRE(cache.misses() == 3);
+
+    cache.get("3 * 4");
+    REQUIRE(cache.misses() == 4);
+    cache.get("5 - 6");
+    REQUIRE(cache.hits() == 3);
+
+    cache.set_capacity(1);
+    REQUIRE(cache.size() == 1);
+    cache.set_capacity(0);
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.get("7").type == repl::EType::Number);
+    REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("Expression cache does not keep sources that fail to parse") {
+    repl::ExpressionCache cache{4};
+    REQUIRE_THROWS_AS(cache.get("1 +"), repl::ParseError);
+    REQUIRE_THROWS_AS(cache.get("1 +"), repl::ParseError);
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.misses() == 2);
+}
+
+TEST_CASE("Cached queries see redefined functions and variables") {
+    repl::State state;
+    repl::ExpressionCache cache;
+    repl::process_query("f(x) = x + 1", state, cache);
+    repl::process_query("y = 10", state, cache);
+    REQUIRE(*repl::process_query("f(y)", state, cache).value == Approx(11.0));
+
+    repl::process_query("f(x) = x * 2", state, cache);
+    repl::process_query("y = 4", state, cache);
+    REQUIRE(*repl::process_query("f(y)", state, cache).value == Approx(8.0));
+    REQUIRE(cache.hits() == 1);
+
+    // Re-running a cached definition redefines the function again.
+    repl::process_query("f(x) = x + 1", state, cache);
+    REQUIRE(*repl::process_query("f(y)", state, cache).value == Approx(5.0));
+}
@@ -0,0 +1,22 @@
+# Runs the repl executable on a few lines of input and checks what it prints.
+#
+#   cmake -DREPL=<path to repl> -DWORK_DIR=<scratch directory> -P cli_test.cmake
+
+set(input "${WORK_DIR}/cli_test_input.txt")
+file(WRITE "${input}" "ast = 5\nast + 1\nast * 2\nast 2 * 3 + ast\n")
+
+execute_process(
+    COMMAND "${REPL}"
+    INPUT_FILE "${input}"
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE errors
+    RESULT_VARIABLE result
+)
+
+# `ast` followed by an operator is an expression over a variable named ast;
+# followed by anything else it is the command.
+set(expected "5\n6\n10\n+\n  6\n  ast\n")
+if(NOT result EQUAL 0 OR NOT errors STREQUAL "" OR NOT output STREQUAL expected)
+    message(FATAL_ERROR "repl exited with ${result}\nstdout:\n${output}\nstderr:\n${errors}\n"
+                        "expected stdout:\n${expected}")
+endif()
@@ -0,0 +1,83 @@
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+
+#include "repl/dag.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/memo.hpp"
+#include "repl/state.hpp"
+
+using Catch::Approx;
+
+TEST_CASE("Expression DAG shares structurally equal subtrees") {
+    repl::QueryContext ctx;
+    repl::ExpressionDag dag;
+    auto first = dag.intern(*repl::parse(std::string_view{"(x ^ 2 + 1) * sin(x ^ 2 + 1)"}, ctx));
+    // x, 2, x^2, 1, x^2+1, sin(..), product
+    REQUIRE(dag.size() == 7);
+
+    const auto& product = first->get<repl::BinaryNode>();
+    REQUIRE(product.left == product.right->get<repl::FnNode>().args[0]);
+
+    auto second = dag.intern(*repl::parse(std::string_view{"sin(x ^ 2 + 1)"}, ctx));
+    REQUIRE(second == product.right);
+    REQUIRE(dag.size() == 7);
+
+    auto zero = dag.intern(*repl::parse(std::string_view{"0"}, ctx));
+    auto negative_zero = dag.intern(repl::Expression{repl::EType::Number, 1, -0.0});
+    REQUIRE(zero != negative_zero);
+}
+
+TEST_CASE("Function bodies share nodes across definitions") {
+    repl::State state;
+    repl::process_query("f(x) = sin(x * x + 1) * 3", state);
+    const std::size_t after_first = state.dag.size();
+    repl::process_query("g(x) = sin(x * x + 1) * 4", state);
+    REQUIRE(state.dag.size() == after_first + 2);
+}
+
+TEST_CASE("Bytecode evaluates repeated pure subexpressions once per call") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode}) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("f(x) = (x ^ 2 + 1) * sin(x ^ 2 + 1) / (x ^ 2 + 1)", state);
+        REQUIRE(*repl::process_query("f(2)", state).value == Approx(std::sin(5.0)));
+
+        const auto& code = state.fns.at(repl::intern("f")).code.code;
+        auto powers = std::count_if(code.begin(), code.end(), [](const repl::Instruction& ins) {
+            return ins.op == repl::Op::Power;
+        });
+        REQUIRE(powers == 1);
+
+        // Reads of an assigned name are not shared across the assignment.
+        repl::process_query("g(a) = (a + 1) * (a = 2) + (a + 1)", state);
+        REQUIRE(*repl::process_query("g(5)", state).value == Approx(15.0));
+    }
+}
+
+TEST_CASE("Every engine evaluates a repeated call once per call") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("k(x) = x + 1", state);
+        repl::process_query("f(x) = k(x) * sin(k(x)) / k(x)", state);
+        repl::process_query("d(n) = n == 0 ? f(2) : 1 + d(n - 1)", state);
+        // k's memo table counts every call of k that is evaluated.
+        repl::FnObj& k = state.fns.at(repl::intern("k"));
+        k.memo = std::make_unique<repl::MemoTable>(k.params.size());
+        const auto calls = [&k] { return k.memo->hits() + k.memo->misses(); };
+
+        REQUIRE(*repl::process_query("f(2)", state).value == Approx(std::sin(3.0)));
+        REQUIRE(calls() == 1);
+        REQUIRE(*repl::process_query("f(2) + f(4)", state).value ==
+                Approx(std::sin(3.0) + std::sin(5.0)));
+        REQUIRE(calls() == 3);
+        // Deep enough that f runs on the walker's explicit stacks.
+        REQUIRE(*repl::process_query("d(100)", state).value == Approx(100 + std::sin(3.0)));
+        REQUIRE(calls() == 4);
+    }
+}
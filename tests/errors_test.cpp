@@ -0,0 +1,155 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <string>
+
+#include "repl/errors.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/expression.hpp"
+#include "repl/state.hpp"
+#include "repl/token.hpp"
+
+namespace {
+
+constexpr repl::Engine kEngines[] = {repl::Engine::Tree, repl::Engine::Bytecode,
+                                     repl::Engine::Jit};
+
+/** @brief Error of a query expected to fail. */
+repl::Error error_of(const char* input, repl::State& state) {
+    auto result = repl::try_process_query(input, state);
+    REQUIRE_FALSE(result);
+    return result.error();
+}
+
+}  // namespace
+
+TEST_CASE("Tokenizer and parser errors carry a code and a position") {
+    auto tokens = repl::try_tokenize("1 + @");
+    REQUIRE_FALSE(tokens);
+    REQUIRE(tokens.error().code == repl::ErrorCode::UnexpectedCharacter);
+    REQUIRE(tokens.error().position == 4);
+    REQUIRE(repl::format_error(tokens.error()) == "Could not parse character '@' at position 4");
+
+    auto number = repl::try_tokenize("2 * 1e999");
+    REQUIRE_FALSE(number);
+    REQUIRE(number.error().code == repl::ErrorCode::NumberOutOfRange);
+    REQUIRE(repl::format_error(number.error(), "2 * 1e999") == "Number out of range: '1e999'");
+
+    repl::QueryContext ctx;
+    auto expr = repl::try_parse("1 + (2 * 3", ctx);
+    REQUIRE_FALSE(expr);
+    REQUIRE(expr.error().code == repl::ErrorCode::UnclosedGroup);
+    REQUIRE(repl::is_parse_error(expr.error().code));
+
+    auto leftover = repl::try_parse("1 2", ctx);
+    REQUIRE_FALSE(leftover);
+    REQUIRE(leftover.error().code == repl::ErrorCode::UnexpectedToken);
+    REQUIRE(leftover.error().position == 2);
+
+    repl::State state;
+    REQUIRE(error_of("1 + * 2", state).code == repl::ErrorCode::ExpectedOperand);
+    REQUIRE(repl::try_process_query("1 + 2", state));
+}
+
+TEST_CASE("Evaluation errors point at the failing node in every engine") {
+    for (auto engine : kEngines) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("x = 0", state);
+
+        repl::Error error = error_of("1 + 2 / x", state);
+        REQUIRE(error.code == repl::ErrorCode::DivisionByZero);
+        REQUIRE(error.position == 6);
+        REQUIRE_FALSE(repl::is_parse_error(error.code));
+
+        error = error_of("x + nope", state);
+        REQUIRE(error.code == repl::ErrorCode::UndefinedVariable);
+        REQUIRE(error.position == 4);
+        REQUIRE(repl::format_error(error) == "Variable 'nope' not defined");
+
+        error = error_of("1 + sin(1, 2)", state);
+        REQUIRE(error.code == repl::ErrorCode::ArityMismatch);
+        REQUIRE(error.position == 4);
+
+        error = error_of("2 * sum(i, 1, 10, 1 / (i - 5))", state);
+        REQUIRE(error.code == repl::ErrorCode::DivisionByZero);
+        REQUIRE(error.position == 4);
+
+        // The first error wins, and nothing after it is assigned.
+        error = error_of("1 / x + (y = 5) + nope", state);
+        REQUIRE(error.code == repl::ErrorCode::DivisionByZero);
+        REQUIRE_FALSE(state.vars.contains(repl::intern("y")));
+        REQUIRE(state.last_result == 0.0);
+    }
+}
+
+TEST_CASE("Errors inside user functions point at the query's call") {
+    for (auto engine : kEngines) {
+        repl::State state;
+        state.engine = engine;
+        state.max_call_depth = 50;
+        repl::process_query("z = 0", state);
+        repl::process_query("inv(a) = 1 / a", state);
+        repl::process_query("g(n) = n == 0 ? inv(z) : 1 + g(n - 1)", state);
+        repl::process_query("d(n) = n == 0 ? 0 : 1 + d(n - 1)", state);
+
+        repl::Error error = error_of("3 * inv(0)", state);
+        REQUIRE(error.code == repl::ErrorCode::DivisionByZero);
+        REQUIRE(error.position == 4);
+
+        // Deep enough for the walker's explicit stacks.
+        state.max_call_depth = 1000;
+        error = error_of("1 + g(500)", state);
+        REQUIRE(error.code == repl::ErrorCode::DivisionByZero);
+        REQUIRE(error.position == 4);
+        REQUIRE(state.call_depth == 0);
+
+        state.max_call_depth = 50;
+        error = error_of("d(100)", state);
+        REQUIRE(error.code == repl::ErrorCode::CallDepthExceeded);
+        REQUIRE(error.position == 0);
+        REQUIRE(repl::format_error(error) == "Maximum call depth of 50 exceeded");
+        REQUIRE(state.call_depth == 0);
+        REQUIRE(*repl::process_query("inv(4)", state).value == 0.25);
+    }
+}
+
+TEST_CASE("Throwing wrappers raise the error with its code") {
+    repl::State state;
+    repl::process_query("x = 0", state);
+    try {
+        repl::process_query("5 % x", state);
+        FAIL("expected an EvalError");
+    } catch (const repl::EvalError& e) {
+        REQUIRE(std::string{e.what()} == "Modulo by zero");
+        REQUIRE(e.error().code == repl::ErrorCode::ModuloByZero);
+        REQUIRE(e.error().position == 2);
+    }
+    try {
+        repl::process_query("3 +", state);
+        FAIL("expected a ParseError");
+    } catch (const repl::ParseError& e) {
+        REQUIRE(repl::is_parse_error(e.error().code));
+    }
+    repl::ExpressionCache cache;
+    REQUIRE_THROWS_WITH(repl::process_query("1 / x", state, cache), "Division by zero");
+    REQUIRE_FALSE(repl::try_process_query("1 / x", state, cache));
+    REQUIRE(cache.hits() == 1);
+}
+
+TEST_CASE("Failed binding updates name the binding") {
+    repl::State state;
+    repl::process_query("w = 4", state);
+    repl::process_query("inv := 1 / w", state);
+
+    repl::Error error = error_of("w = 0", state);
+    REQUIRE(error.code == repl::ErrorCode::DivisionByZero);
+    REQUIRE(error.binding == static_cast<std::uint32_t>(repl::intern("inv")));
+    REQUIRE(error.position == repl::kNoPosition);
+    REQUIRE(repl::format_error(error) == "Could not update 'inv': Division by zero");
+
+    // A function definition is not a binding's value.
+    error = error_of("a := f(t) = t", state);
+    REQUIRE(error.code == repl::ErrorCode::BindingAssigns);
+    REQUIRE(state.fns.find(repl::intern("f")) == state.fns.end());
+}
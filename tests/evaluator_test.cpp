@@ -1,6 +1,8 @@
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <string>
+
 #include "repl/evaluator.hpp"
 #include "repl/state.hpp"
 
@@ -138,3 +140,70 @@ TEST_CASE("Evaluator supports min max hypot and sign") {
     REQUIRE(sp.value);
     REQUIRE(*sp.value == Approx(1.0));
 }
+
+TEST_CASE("Evaluator keeps function bodies across reused query contexts") {
+    repl::State state;
+    repl::QueryContext ctx;
+    repl::process_query("sq(x) = x * x + 0 * (1 + 2 + 3 + 4)", state, ctx);
+    repl::process_query("y = 1 + 2 + 3 + 4 + 5 + 6 + 7 + 8", state, ctx);
+
+    const std::size_t warmed = ctx.arena.capacity();
+    for (int index = 0; index < 100; ++index) {
+        auto result = repl::process_query("sq(y - 33) + max(1, 2)", state, ctx);
+        REQUIRE(result.value);
+        REQUIRE(*result.value == Approx(11.0));
+    }
+    REQUIRE(ctx.arena.capacity() == warmed);
+}
+
+TEST_CASE("Evaluator handles expressions near the nesting limit") {
+    repl::State state;
+    repl::process_query("inc(x) = x + 1", state);
+
+    const std::size_t depth = repl::kDefaultMaxDepth / 2 - 1;
+    std::string calls;
+    for (std::size_t index = 0; index < depth; ++index) {
+        calls += "inc(-";
+    }
+    calls += "0" + std::string(depth, ')');
+    auto result = repl::process_query(calls, state);
+    REQUIRE(result.value);
+    REQUIRE(*result.value == Approx(1.0));
+}
+
+TEST_CASE("Evaluator bounds recursion depth in every engine") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("s(n) = n == 0 ? 0 : 1 + s(n - 1)", state);
+        REQUIRE(*repl::process_query("s(9999)", state).value == Approx(9999.0));
+        REQUIRE_THROWS_WITH(repl::process_query("s(10000)", state),
+                            "Maximum call depth of 10000 exceeded");
+        // Errors raised inside a deep recursion unwind the whole call.
+        repl::process_query("d(n) = n == 0 ? 1 / n : 1 + d(n - 1)", state);
+        REQUIRE_THROWS_WITH(repl::process_query("d(500)", state), "Division by zero");
+        REQUIRE(state.call_depth == 0);
+
+        state.max_call_depth = 50;
+        REQUIRE(*repl::process_query("s(49)", state).value == Approx(49.0));
+        REQUIRE_THROWS_WITH(repl::process_query("s(50)", state),
+                            "Maximum call depth of 50 exceeded");
+    }
+}
+
+TEST_CASE("Evaluator runs tail calls in constant depth") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        state.max_call_depth = 100;
+        repl::process_query("loop(n, acc) = n == 0 ? acc : loop(n - 1, acc + n)", state);
+        REQUIRE(*repl::process_query("loop(100000, 0)", state).value == Approx(5000050000.0));
+
+        repl::process_query("even(n) = n == 0 ? 1 : odd(n - 1)", state);
+        repl::process_query("odd(n) = n == 0 ? 0 : even(n - 1)", state);
+        REQUIRE(*repl::process_query("even(20001)", state).value == Approx(0.0));
+        // Only the call in tail position is free; the inner one still counts.
+        REQUIRE(*repl::process_query("1 + loop(10, 0) * even(4)", state).value == Approx(56.0));
+        REQUIRE(state.call_depth == 0);
+    }
+}
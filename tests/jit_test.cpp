@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "repl/evaluator.hpp"
+#include "repl/jit.hpp"
+#include "repl/state.hpp"
+
+namespace {
+
+const std::vector<std::string> kDefinitions = {
+    "arith(x, y) = x + y * 2 - x / y % 3 + -x",
+    "cmp(x, y) = (x < y) + 2 * (x <= y) + 4 * (x > y) + 8 * (x >= y) + 16 * (x == y) + "
+    "32 * (x != y)",
+    "pick(x) = x > 0 ? sqrt(x) : -x",
+    "powers(x, y) = x ^ y + x ^ 3 + x ^ -2 + x ^ 0.5",
+    "poly(x) = 3 * x ^ 3 - 2 * x ^ 2 + x - 1",
+    "shared(x) = (t = x * 2) * t + (x + 1) * (x + 1) + (x + 1)",
+    "builtins(x, y) = sin(x) + atan2(x, y) + ln(y) + max(x, y)",
+    "global(x) = x + k + _",
+    "sq(x) = x * x",
+    "nested(x, y) = sq(x) + sq(y + 1) - sq(x)",
+    "fact(n) = n <= 1 ? 1 : n * fact(n - 1)",
+    "arity(x) = sq(x, 1)",
+    "missing(x) = nope(x)",
+    "readonly(x) = x > 0 ? x : (pi = 1)",
+    "mod(x, y) = x % y",
+};
+
+/** @brief Call every function on a grid of arguments and record each outcome. */
+std::vector<std::string> run_calls(repl::State& state) {
+    const std::vector<std::string> xs = {"-2", "-0.5", "0", "0.5", "3", "1e200"};
+    const std::vector<std::string> ys = {"0", "2", "-3"};
+    std::vector<std::string> lines;
+    for (const auto& x : xs) {
+        lines.push_back(std::format("shared({0}) + pick({0}) + poly({0}) + fact({0})", x));
+        lines.push_back(std::format("global({}) + arity({}) + missing(1)", x, x));
+        lines.push_back(std::format("readonly({})", x));
+        for (const auto& y : ys) {
+            lines.push_back(std::format("arith({}, {})", x, y));
+            lines.push_back(std::format("cmp({}, {})", x, y));
+            lines.push_back(std::format("powers({}, {})", x, y));
+            lines.push_back(std::format("builtins({}, {})", x, y));
+            lines.push_back(std::format("nested({}, {})", x, y));
+            lines.push_back(std::format("mod({}, {})", x, y));
+            lines.push_back(std::format("global({})", x));
+        }
+    }
+
+    std::vector<std::string> outcomes;
+    for (const auto& line : lines) {
+        try {
+            outcomes.push_back(std::format("{}", *repl::process_query(line, state).value));
+        } catch (const repl::EvalError& e) {
+            outcomes.push_back(std::string{"error: "} + e.what());
+        }
+    }
+    return outcomes;
+}
+
+std::vector<std::string> run_session(repl::Engine engine, int rounds) {
+    repl::State state;
+    state.engine = engine;
+    for (const auto& definition : kDefinitions) {
+        repl::process_query(definition, state);
+    }
+    std::vector<std::string> outcomes;
+    for (int round = 0; round < rounds; ++round) {
+        if (round == rounds / 2) {
+            repl::process_query("k = 0.25", state);
+        }
+        auto results = run_calls(state);
+        outcomes.insert(outcomes.end(), results.begin(), results.end());
+    }
+    if (engine == repl::Engine::Jit && repl::jit_supported()) {
+        for (const char* name : {"arith", "cmp", "poly", "shared", "builtins", "nested", "fact"}) {
+            INFO(name);
+            REQUIRE(state.fns.at(repl::intern(name)).native != nullptr);
+        }
+    }
+    return outcomes;
+}
+
+}  // namespace
+
+TEST_CASE("Native code matches the tree walker, errors included") {
+    constexpr int kRounds = 12;
+    REQUIRE(run_session(repl::Engine::Jit, kRounds) == run_session(repl::Engine::Tree, kRounds));
+}
+
+TEST_CASE("Hot functions tier up and redefinition drops native code") {
+    repl::State state;
+    state.engine = repl::Engine::Jit;
+    repl::process_query("f(x) = x * 2 + 1", state);
+    const repl::FnObj& before = state.fns.at(repl::intern("f"));
+    for (std::uint32_t call = 0; call < repl::kJitThreshold; ++call) {
+        REQUIRE(*repl::process_query("f(3)", state).value == 7.0);
+    }
+    REQUIRE((before.native != nullptr) == repl::jit_supported());
+
+    repl::process_query("f(x) = x * 3", state);
+    const repl::FnObj& after = state.fns.at(repl::intern("f"));
+    REQUIRE(after.native == nullptr);
+    REQUIRE(after.calls == 0);
+    REQUIRE(*repl::process_query("f(3)", state).value == 9.0);
+}
+
+TEST_CASE("Native code is emitted for supported chunks only") {
+    repl::State state;
+    repl::process_query("f(a, b) = a < b ? a * b : sqrt(a) + hypot(a, b)", state);
+    auto native = repl::jit_compile(state.fns.at(repl::intern("f")).code);
+    REQUIRE((native != nullptr) == repl::jit_supported());
+    if (native) {
+        const double args[] = {9.0, 4.0};
+        REQUIRE(*native->run(args, state) == 3.0 + std::hypot(9.0, 4.0));
+        const double negative[] = {-9.0, -10.0};
+        REQUIRE(native->run(negative, state) == std::nullopt);
+    }
+}
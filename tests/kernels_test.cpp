@@ -0,0 +1,140 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "repl/kernels.hpp"
+#include "repl/registry.hpp"
+#include "ulp.hpp"
+
+namespace {
+
+using repl::test::ulp_distance;
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+constexpr double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+/** @brief Arguments across every binade, the reduction boundaries, and special values. */
+std::vector<double> sample_arguments() {
+    std::vector<double> values;
+    std::mt19937_64 rng{20240611};
+    std::uniform_real_distribution<double> unit{1.0, 2.0};
+    for (int exponent = -1074; exponent <= 1023; exponent += 3) {
+        const double value = std::ldexp(unit(rng), exponent);
+        values.push_back(value);
+        values.push_back(-value);
+    }
+    for (double limit : {1e-8, 0.5, 1.0, 3.0, 10.0, 100.0, 710.0, 1e6, 1e12}) {
+        std::uniform_real_distribution<double> range{-limit, limit};
+        for (int count = 0; count < 2000; ++count) {
+            values.push_back(range(rng));
+        }
+    }
+    for (int step = -64; step <= 64; ++step) {
+        values.push_back(step * 0.25);
+        values.push_back(step * std::numbers::pi / 4);
+    }
+    for (double value : {0.0, -0.0, kInf, -kInf, kNaN, std::numeric_limits<double>::denorm_min(),
+                         std::numeric_limits<double>::min(), std::numeric_limits<double>::max(),
+                         0x1p52, 0x1p52 + 1.0, -0x1p53, 708.39, -708.4, 823549.0, 1e300}) {
+        values.push_back(value);
+        values.push_back(-value);
+    }
+    return values;
+}
+
+/** @brief Whether `actual` is within `max_ulp` of `expected`, with NaN, infinities
+ *  and, for exact kernels, the sign of zero matching.
+ */
+bool within(double expected, double actual, std::uint32_t max_ulp) {
+    if (std::isnan(expected) || std::isnan(actual)) {
+        return std::isnan(expected) && std::isnan(actual);
+    }
+    if (std::isinf(expected) || std::isinf(actual) || max_ulp == 0) {
+        return std::bit_cast<std::uint64_t>(expected) == std::bit_cast<std::uint64_t>(actual);
+    }
+    return ulp_distance(expected, actual) <= max_ulp;
+}
+
+std::vector<repl::KernelIsa> supported_isas() {
+    std::vector<repl::KernelIsa> isas;
+    for (auto isa : {repl::KernelIsa::Scalar, repl::KernelIsa::SSE2, repl::KernelIsa::AVX2}) {
+        if (static_cast<int>(isa) <= static_cast<int>(repl::detected_kernel_isa())) {
+            isas.push_back(isa);
+        }
+    }
+    return isas;
+}
+
+}  // namespace
+
+TEST_CASE("Array kernels stay within their documented error") {
+    const std::vector<double> first = sample_arguments();
+    std::vector<double> second = first;
+    std::shuffle(second.begin(), second.end(), std::mt19937_64{7});
+    std::vector<double> out(first.size());
+
+    for (repl::KernelIsa isa : supported_isas()) {
+        REQUIRE(repl::set_kernel_isa(isa) == isa);
+        REQUIRE(repl::kernel_isa() == isa);
+        for (const repl::BuiltinSpec& spec : repl::kBuiltins) {
+            // An odd count exercises the padded tail of the packed loop.
+            const std::size_t count = first.size() - 1;
+            if (spec.arity == 1) {
+                spec.unary_array(first.data(), out.data(), count);
+            } else {
+                spec.binary_array(first.data(), second.data(), out.data(), count);
+            }
+            for (std::size_t index = 0; index < count; ++index) {
+                const double expected = spec.arity == 1
+                                            ? spec.unary(first[index])
+                                            : spec.binary(first[index], second[index]);
+                if (!within(expected, out[index], spec.max_ulp)) {
+                    FAIL(std::string(repl::to_string(isa)) + " " + std::string(spec.name) + "("
+                         + std::to_string(first[index]) + ", " + std::to_string(second[index])
+                         + ") is off by " + std::to_string(ulp_distance(expected, out[index]))
+                         + " ulp");
+                }
+            }
+        }
+    }
+    repl::set_kernel_isa(repl::detected_kernel_isa());
+}
+
+TEST_CASE("Array kernels allow the output to alias an input") {
+    for (repl::KernelIsa isa : supported_isas()) {
+        repl::set_kernel_isa(isa);
+        std::vector<double> values = {0.5, -kInf, 1e7, -0.0, 2.0, kNaN, 1e-320};
+        repl::kernels::sin(values.data(), values.data(), values.size());
+        REQUIRE(values[0] == std::sin(0.5));
+        REQUIRE(std::isnan(values[1]));
+        REQUIRE(values[2] == std::sin(1e7));
+        REQUIRE(std::signbit(values[3]));
+        REQUIRE(std::isnan(values[5]));
+        REQUIRE(values[6] == 1e-320);
+
+        std::vector<double> bases = {3.0, 0.0, -1.0, 4.0, 1.0};
+        const std::vector<double> exponents = {2.0, -1.0, 0.5, 0.5, kNaN};
+        repl::kernels::pow(bases.data(), exponents.data(), bases.data(), bases.size());
+        REQUIRE(bases[0] == 9.0);
+        REQUIRE(std::isinf(bases[1]));
+        REQUIRE(std::isnan(bases[2]));
+        REQUIRE(bases[3] == 2.0);
+        REQUIRE(bases[4] == 1.0);
+    }
+    repl::set_kernel_isa(repl::detected_kernel_isa());
+}
+
+TEST_CASE("Kernel instruction set requests are clamped") {
+    const repl::KernelIsa detected = repl::detected_kernel_isa();
+    REQUIRE(repl::set_kernel_isa(repl::KernelIsa::AVX2) == detected);
+    REQUIRE(repl::kernel_isa() == detected);
+    REQUIRE(repl::to_string(repl::KernelIsa::Scalar) == "scalar");
+}
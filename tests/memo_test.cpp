@@ -0,0 +1,110 @@
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+
+#include "repl/evaluator.hpp"
+#include "repl/memo.hpp"
+#include "repl/state.hpp"
+
+using Catch::Approx;
+
+namespace {
+
+constexpr repl::Engine kEngines[] = {repl::Engine::Tree, repl::Engine::Bytecode,
+                                     repl::Engine::Jit};
+
+const repl::MemoTable* memo_of(const repl::State& state, const char* name) {
+    return state.fns.at(repl::intern(name)).memo.get();
+}
+
+}  // namespace
+
+TEST_CASE("Memo table is bounded and compares arguments bitwise") {
+    repl::MemoTable table{2, 8};
+    REQUIRE(table.capacity() == 8);
+    REQUIRE(table.find({1.0, 2.0}) == std::nullopt);
+    table.insert({1.0, 2.0}, 3.0);
+    REQUIRE(table.find({1.0, 2.0}) == 3.0);
+    REQUIRE(table.find({2.0, 1.0}) != 3.0);
+    table.insert({0.0, 1.0}, 1.0);
+    REQUIRE(table.find({-0.0, 1.0}) == std::nullopt);
+
+    for (int index = 0; index < 100; ++index) {
+        table.insert({static_cast<double>(index), 0.0}, index);
+    }
+    REQUIRE(table.size() <= table.capacity());
+    REQUIRE(table.hits() == 1);
+
+    table.clear();
+    REQUIRE(table.size() == 0);
+    REQUIRE(table.find({99.0, 0.0}) == std::nullopt);
+}
+
+TEST_CASE("Tree-recursive functions are memoized in every engine") {
+    for (auto engine : kEngines) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)", state);
+        repl::process_query("sq(x) = x * x", state);
+        REQUIRE(memo_of(state, "fib") != nullptr);
+        REQUIRE(memo_of(state, "sq") == nullptr);
+
+        REQUIRE(*repl::process_query("fib(90)", state).value == 2880067194370816000.0);
+        // Linear in n; a colliding entry may cost a few extra calls.
+        const repl::MemoTable& memo = *memo_of(state, "fib");
+        REQUIRE(memo.misses() < 2 * 91);
+        REQUIRE(memo.size() > 80);
+        const std::size_t lookups = memo.hits() + memo.misses();
+        REQUIRE(*repl::process_query("fib(90)", state).value == 2880067194370816000.0);
+        REQUIRE(memo.hits() + memo.misses() - lookups < 10);
+    }
+}
+
+TEST_CASE("Memoized results follow the globals and functions they depend on") {
+    for (auto engine : kEngines) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("k = 2", state);
+        repl::process_query("leaf(n) = k * n", state);
+        repl::process_query("g(n) = n < 2 ? leaf(n) : g(n - 1) + g(n - 2)", state);
+        REQUIRE(*repl::process_query("g(10)", state).value == Approx(110.0));
+
+        repl::process_query("k = 3", state);
+        REQUIRE(*repl::process_query("g(10)", state).value == Approx(165.0));
+        repl::process_query("leaf(n) = n", state);
+        REQUIRE(*repl::process_query("g(10)", state).value == Approx(55.0));
+
+        // `_` changes with every query, so a function reading it is not cached.
+        repl::process_query("u(n) = n < 1 ? _ : u(n - 1) + u(n - 1)", state);
+        REQUIRE(*repl::process_query("u(3)", state).value == Approx(440.0));
+        REQUIRE(*repl::process_query("u(3)", state).value == Approx(3520.0));
+        REQUIRE(memo_of(state, "u")->size() == 0);
+    }
+}
+
+TEST_CASE("Memoized calls that fail cache nothing") {
+    for (auto engine : kEngines) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("r(n) = n == 3 ? 1 / (n - 3) : n < 2 ? n : r(n - 1) + r(n - 2)", state);
+        REQUIRE_THROWS_WITH(repl::process_query("r(10)", state), "Division by zero");
+        REQUIRE_THROWS_WITH(repl::process_query("r(10)", state), "Division by zero");
+        REQUIRE(*repl::process_query("r(2)", state).value == Approx(1.0));
+        REQUIRE(state.call_depth == 0);
+    }
+}
+
+TEST_CASE("Opting in to memoization survives redefinition") {
+    repl::State state;
+    repl::process_query("h(x) = x * 2", state);
+    repl::FnObj& fn = state.fns.at(repl::intern("h"));
+    fn.memo = std::make_unique<repl::MemoTable>(fn.params.size());
+    REQUIRE(*repl::process_query("h(4)", state).value == Approx(8.0));
+    REQUIRE(*repl::process_query("h(4)", state).value == Approx(8.0));
+    REQUIRE(memo_of(state, "h")->hits() == 1);
+
+    repl::process_query("h(x) = x * 3", state);
+    REQUIRE(memo_of(state, "h") != nullptr);
+    REQUIRE(*repl::process_query("h(4)", state).value == Approx(12.0));
+}
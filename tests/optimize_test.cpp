@@ -0,0 +1,203 @@
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+#include "repl/evaluator.hpp"
+#include "repl/expression.hpp"
+#include "repl/optimize.hpp"
+#include "ulp.hpp"
+
+using Catch::Approx;
+using repl::EType;
+using repl::test::ulp_distance;
+
+namespace {
+
+repl::ExpressionPtr optimized(std::string_view source, repl::QueryContext& ctx) {
+    return repl::optimize(repl::parse(source, ctx), ctx.arena);
+}
+
+}  // namespace
+
+TEST_CASE("Optimizer folds constant subtrees") {
+    repl::QueryContext ctx;
+    auto expr = optimized("2 * pi * r", ctx);
+    REQUIRE(expr->type == EType::Binary);
+    const auto& node = expr->get<repl::BinaryNode>();
+    REQUIRE(node.left->type == EType::Number);
+    REQUIRE(node.left->get<double>() == Approx(6.283185307179586));
+    REQUIRE(expr->height == 2);
+
+    auto call = optimized("sqrt(16) + max(1, -2) * -(3 > 2) + tau", ctx);
+    REQUIRE(call->type == EType::Number);
+    REQUIRE(call->get<double>() == Approx(3.0 + 6.283185307179586));
+}
+
+TEST_CASE("Optimizer prunes ternary branches with constant conditions") {
+    repl::QueryContext ctx;
+    auto expr = optimized("1 < 2 ? x : 1 / 0", ctx);
+    REQUIRE(expr->type == EType::Variable);
+
+    auto nested = optimized("0 ? a : (pi > 3 ? b + 1 * 2 : c)", ctx);
+    REQUIRE(nested->type == EType::Binary);
+    REQUIRE(nested->get<repl::BinaryNode>().right->get<double>() == 2.0);
+}
+
+TEST_CASE("Optimizer leaves failing folds for run time") {
+    repl::QueryContext ctx;
+    REQUIRE(optimized("1 / 0", ctx)->type == EType::Binary);
+    REQUIRE(optimized("5 % 0", ctx)->type == EType::Binary);
+    REQUIRE(optimized("(-8) ^ 0.5", ctx)->type == EType::Power);
+    REQUIRE(optimized("ln(0)", ctx)->type == EType::Builtin);
+    REQUIRE(optimized("sin(1, 2)", ctx)->type == EType::FnCall);
+
+    repl::State state;
+    REQUIRE_THROWS_WITH(repl::process_query("x = 1 / (2 - 2)", state), "Division by zero");
+    REQUIRE_THROWS_WITH(repl::process_query("sqrt(-pi)", state),
+                        "Domain error in function 'sqrt'");
+    REQUIRE_THROWS_WITH(repl::process_query("f(pi) = 1", state), "'pi' is read-only");
+    REQUIRE_THROWS_WITH(repl::process_query("2 = 1 + 1", state),
+                        "Left side of '=' must be a variable name");
+}
+
+TEST_CASE("Function bodies are stored optimized") {
+    repl::State state;
+    repl::process_query("area(r) = pi * r ^ 2 * (1 ? 1 : 0)", state);
+    const auto& body = *state.fns.at(repl::intern("area")).expr;
+    REQUIRE(repl::format_tree(body) == "*\n  *\n    3.14159\n    ^2\n      r\n  1");
+    REQUIRE(*repl::process_query("area(2)", state).value == Approx(12.566370614359172));
+}
+
+TEST_CASE("Optimizer strength-reduces powers and exact divisions") {
+    repl::QueryContext ctx;
+    auto cube = optimized("x ^ 3", ctx);
+    REQUIRE(cube->type == EType::Power);
+    REQUIRE(cube->get<repl::PowerNode>().exponent == 3);
+    REQUIRE(optimized("x ^ -2", ctx)->get<repl::PowerNode>().exponent == -2);
+    REQUIRE(optimized("x ^ 0.5", ctx)->get<repl::PowerNode>().kind ==
+            repl::PowerNode::Kind::SquareRoot);
+    REQUIRE(optimized("x ^ 2.5", ctx)->type == EType::Binary);
+    REQUIRE(optimized("x ^ 17", ctx)->type == EType::Binary);
+
+    auto quarter = optimized("x / 4", ctx);
+    REQUIRE(quarter->get<repl::BinaryNode>().op == repl::TType::Star);
+    REQUIRE(quarter->get<repl::BinaryNode>().right->get<double>() == 0.25);
+    REQUIRE(optimized("x / 3", ctx)->get<repl::BinaryNode>().op == repl::TType::Slash);
+    REQUIRE(optimized("x / 0", ctx)->get<repl::BinaryNode>().op == repl::TType::Slash);
+
+    auto poly = optimized("3 * x ^ 3 + 2 * x * x - x / 2 + 5", ctx);
+    REQUIRE(poly->type == EType::Polynomial);
+    REQUIRE(repl::format_tree(*poly) == "horner x: 3, 2, -0.5, 5");
+    REQUIRE(optimized("x ^ 2 + y", ctx)->type == EType::Binary);
+    REQUIRE(optimized("sin(x ^ 2 - 1)", ctx)->get<repl::BuiltinNode>().args[0]->type ==
+            EType::Polynomial);
+}
+
+TEST_CASE("Optimizer binds builtin calls with matching arity") {
+    repl::QueryContext ctx;
+    auto unary = optimized("sqrt(x)", ctx);
+    REQUIRE(unary->type == EType::Builtin);
+    const auto& sqrt_call = unary->get<repl::BuiltinNode>();
+    REQUIRE(sqrt_call.spec == repl::find_builtin("sqrt"));
+    REQUIRE(sqrt_call.args[1] == nullptr);
+    REQUIRE(repl::format_tree(*unary) == "call sqrt\n  x");
+
+    auto binary = optimized("max(x, y + 1)", ctx);
+    REQUIRE(binary->type == EType::Builtin);
+    REQUIRE(binary->get<repl::BuiltinNode>().args[1]->type == EType::Binary);
+    REQUIRE(binary->height == 3);
+
+    REQUIRE(optimized("max(x)", ctx)->type == EType::FnCall);
+    REQUIRE(optimized("f(x)", ctx)->type == EType::FnCall);
+
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode}) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("x = 0.25", state);
+        REQUIRE(*repl::process_query("atan2(x, 1) + abs(-x)", state).value ==
+                std::atan2(0.25, 1.0) + 0.25);
+        REQUIRE_THROWS_WITH(repl::process_query("max(x)", state),
+                            "Function 'max' expects 2 arguments, got 1");
+        REQUIRE_THROWS_WITH(repl::process_query("ln(x - x)", state),
+                            "Domain error in function 'ln'");
+        REQUIRE_THROWS_WITH(repl::process_query("sin(x) = 1", state), "'sin' is read-only");
+        repl::process_query("g(a) = hypot(a, 4) * cos(a)", state);
+        REQUIRE(*repl::process_query("g(3)", state).value == 5.0 * std::cos(3.0));
+    }
+}
+
+TEST_CASE("Strength-reduced powers stay within their ULP bounds") {
+    std::mt19937_64 rng{42};
+    std::uniform_real_distribution<double> base{0.5, 2.0};
+    for (int sample = 0; sample < 200; ++sample) {
+        const double x = sample % 2 == 0 ? base(rng) : -base(rng);
+        for (std::int32_t n = -repl::kMaxReducedExponent; n <= repl::kMaxReducedExponent; ++n) {
+            const auto bound = static_cast<std::uint64_t>(std::abs(n));
+            REQUIRE(ulp_distance(repl::integer_power(x, n), std::pow(x, n)) <= bound);
+        }
+        REQUIRE(ulp_distance(repl::square_root(std::abs(x)), std::pow(std::abs(x), 0.5)) <= 1);
+    }
+    REQUIRE_FALSE(std::signbit(repl::square_root(-0.0)));
+    REQUIRE(repl::integer_power(std::nan(""), 0) == 1.0);
+
+    repl::State state;
+    repl::process_query("big = 1e200", state);
+    repl::process_query("zero = 0", state);
+    REQUIRE_THROWS_WITH(repl::process_query("big ^ 2", state), "Domain error in '^'");
+    REQUIRE(*repl::process_query("big ^ -2", state).value == 0.0);
+    REQUIRE_THROWS_WITH(repl::process_query("zero ^ -1", state), "Domain error in '^'");
+    REQUIRE_THROWS_WITH(repl::process_query("(zero - 4) ^ 0.5", state), "Domain error in '^'");
+}
+
+TEST_CASE("Horner evaluation stays within its bound of the written polynomial") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        repl::QueryContext ctx;
+        repl::process_query("p(x) = 3 * x ^ 3 - 2 * x ^ 2 + x / 3 - 7", state);
+        for (int step = -100; step <= 100; ++step) {
+            const double x = step * 0.1003;
+            state.vars.set(repl::intern("t"), x);
+            const double value = *repl::process_query("p(t)", state, ctx).value;
+            const double written = 3 * std::pow(x, 3) - 2 * std::pow(x, 2) + x / 3 - 7;
+            const double magnitude = 3 * std::pow(std::abs(x), 3) +
+                                     2 * std::pow(std::abs(x), 2) + std::abs(x) / 3 + 7;
+            const double bound = 4 * (3 + 1) * std::numeric_limits<double>::epsilon() * magnitude;
+            REQUIRE(std::abs(value - written) <= bound);
+        }
+
+        // Out of range the written tree runs, with its errors.
+        repl::process_query("big = 1e200", state);
+        REQUIRE_THROWS_WITH(repl::process_query("p(big)", state), "Domain error in '^'");
+        REQUIRE_THROWS_WITH(repl::process_query("q ^ 2 + q", state), "Variable 'q' not defined");
+        REQUIRE(*repl::process_query("p(1e100)", state).value == Approx(3e300));
+    }
+}
+
+TEST_CASE("Products of sums are not multiplied out") {
+    repl::QueryContext ctx;
+    REQUIRE(optimized("(x - 1e5) * (x - 1e5) * (x - 1e5)", ctx)->type == EType::Binary);
+    REQUIRE(optimized("(x + 1) * (x - 1)", ctx)->type == EType::Binary);
+    REQUIRE(optimized("(x * x + 1) * x", ctx)->type == EType::Binary);
+    REQUIRE(optimized("(x * x + x) / 3", ctx)->type == EType::Binary);
+
+    // Near a root the expanded coefficients cancel; the written factors do not.
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("x = 100000.001", state);
+        const double near = 100000.001 - 1e5;
+        REQUIRE(*repl::process_query("(x - 1e5) * (x - 1e5) * (x - 1e5)", state).value ==
+                near * near * near);
+
+        repl::process_query("p(x) = (x - 1000) * (x - 1000) * (x - 1000)", state);
+        const double small = 1000.00001 - 1000;
+        for (int call = 0; call < 200; ++call) {
+            REQUIRE(*repl::process_query("p(1000.00001)", state).value == small * small * small);
+        }
+    }
+}
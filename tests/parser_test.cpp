@@ -1,5 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <string>
+
 #include "repl/expression.hpp"
 #include "repl/token.hpp"
 
@@ -8,7 +10,8 @@ using repl::EType;
 using repl::TType;
 
 TEST_CASE("Parser respects operator precedence") {
-    auto expr = repl::parse(repl::tokenize("2 + 3 * 4"));
+    repl::QueryContext ctx;
+    auto expr = repl::parse(repl::tokenize("2 + 3 * 4"), ctx);
     REQUIRE(expr->type == EType::Binary);
     const auto& root = expr->get<BinaryNode>();
     REQUIRE(root.op == TType::Plus);
@@ -17,7 +20,8 @@ TEST_CASE("Parser respects operator precedence") {
 }
 
 TEST_CASE("Parser handles right-associative power") {
-    auto expr = repl::parse(repl::tokenize("2 ^ 3 ^ 2"));
+    repl::QueryContext ctx;
+    auto expr = repl::parse(repl::tokenize("2 ^ 3 ^ 2"), ctx);
     REQUIRE(expr->type == EType::Binary);
     const auto& root = expr->get<BinaryNode>();
     REQUIRE(root.op == TType::Caret);
@@ -26,19 +30,127 @@ TEST_CASE("Parser handles right-associative power") {
 }
 
 TEST_CASE("Parser handles ternary expressions") {
-    auto expr = repl::parse(repl::tokenize("1 ? 2 : 3"));
+    repl::QueryContext ctx;
+    auto expr = repl::parse(repl::tokenize("1 ? 2 : 3"), ctx);
     REQUIRE(expr->type == EType::Ternary);
 }
 
 TEST_CASE("Parser rejects incomplete ternary expressions") {
-    REQUIRE_THROWS_AS(repl::parse(repl::tokenize("1 ? 2")), repl::ParseError);
+    repl::QueryContext ctx;
+    REQUIRE_THROWS_AS(repl::parse(repl::tokenize("1 ? 2"), ctx), repl::ParseError);
 }
 
 TEST_CASE("Parser builds right-associative assignment") {
-    auto expr = repl::parse(repl::tokenize("a = b = 3"));
+    repl::QueryContext ctx;
+    auto expr = repl::parse(repl::tokenize("a = b = 3"), ctx);
     REQUIRE(expr->type == EType::Binary);
     const auto& root = expr->get<BinaryNode>();
     REQUIRE(root.op == TType::Equals);
     REQUIRE(root.right->type == EType::Binary);
     REQUIRE(root.right->get<BinaryNode>().op == TType::Equals);
 }
+
+TEST_CASE("Parser accepts a reactive binding only as a whole expression") {
+    repl::QueryContext ctx;
+    auto expr = repl::parse(repl::tokenize("area := w * h ? 1 : 2"), ctx);
+    REQUIRE(expr->type == EType::Binary);
+    const auto& root = expr->get<BinaryNode>();
+    REQUIRE(root.op == TType::ColonEquals);
+    REQUIRE(root.left->type == EType::Variable);
+    REQUIRE(root.right->type == EType::Ternary);
+
+    for (const char* source : {"1 + a := 2", "a := b := 2", "(a := 2)", "f(a := 2)", "2 := a"}) {
+        REQUIRE_THROWS_AS(repl::parse(repl::tokenize(source), ctx), repl::ParseError);
+    }
+}
+
+TEST_CASE("Parser consumes source text through the streaming lexer") {
+    repl::QueryContext ctx;
+    auto expr = repl::parse(std::string_view{"max(1, 2) * -x"}, ctx);
+    REQUIRE(expr->type == EType::Binary);
+    const auto& root = expr->get<BinaryNode>();
+    REQUIRE(root.op == TType::Star);
+    REQUIRE(root.left->type == EType::FnCall);
+    REQUIRE(root.right->type == EType::Unary);
+
+    REQUIRE_THROWS_AS(repl::parse(std::string_view{"1 + 2)"}, ctx), repl::ParseError);
+    REQUIRE_THROWS_AS(repl::parse(std::string_view{"1 + $"}, ctx), repl::ParseError);
+}
+
+TEST_CASE("Parser parses nested and multi-argument calls in place") {
+    repl::QueryContext ctx;
+    auto expr = repl::parse(repl::tokenize("f(g(1, h(2)), (3), k())"), ctx);
+    REQUIRE(expr->type == EType::FnCall);
+    const auto& call = expr->get<repl::FnNode>();
+    REQUIRE(call.args.size() == 3);
+    REQUIRE(call.args[0]->type == EType::FnCall);
+    REQUIRE(call.args[0]->get<repl::FnNode>().args.size() == 2);
+    REQUIRE(call.args[1]->type == EType::Number);
+    REQUIRE(call.args[2]->get<repl::FnNode>().args.empty());
+}
+
+TEST_CASE("Parser rejects malformed argument lists") {
+    repl::QueryContext ctx;
+    REQUIRE_THROWS_AS(repl::parse(repl::tokenize("f(1,)"), ctx), repl::ParseError);
+    REQUIRE_THROWS_AS(repl::parse(repl::tokenize("f(,1)"), ctx), repl::ParseError);
+    REQUIRE_THROWS_AS(repl::parse(repl::tokenize("f(1 2)"), ctx), repl::ParseError);
+    REQUIRE_THROWS_AS(repl::parse(repl::tokenize("f(1, g(2)"), ctx), repl::ParseError);
+}
+
+TEST_CASE("Parser binds unary operators tighter than power") {
+    repl::QueryContext ctx;
+    auto expr = repl::parse(repl::tokenize("-2 ^ -3 ^ 2"), ctx);
+    const auto& root = expr->get<BinaryNode>();
+    REQUIRE(root.op == TType::Caret);
+    REQUIRE(root.left->type == EType::Unary);
+    REQUIRE(root.right->get<BinaryNode>().op == TType::Caret);
+    REQUIRE(root.right->get<BinaryNode>().left->type == EType::Unary);
+}
+
+TEST_CASE("Parser nests ternaries to the right below assignment") {
+    repl::QueryContext ctx;
+    auto expr = repl::parse(repl::tokenize("x = 1 + a ? b : c ? d : e"), ctx);
+    const auto& assign = expr->get<BinaryNode>();
+    REQUIRE(assign.op == TType::Equals);
+    REQUIRE(assign.right->type == EType::Ternary);
+    const auto& ternary = assign.right->get<repl::TernaryNode>();
+    REQUIRE(ternary.condition->get<BinaryNode>().op == TType::Plus);
+    REQUIRE(ternary.else_branch->type == EType::Ternary);
+
+    REQUIRE_THROWS_AS(repl::parse(repl::tokenize("a ? b = 1 : c"), ctx), repl::ParseError);
+}
+
+TEST_CASE("Parser rejects overly deep nesting without recursing") {
+    repl::QueryContext ctx;
+    const std::size_t deep = 100000;
+    std::string parens = std::string(deep, '(') + "1" + std::string(deep, ')');
+    REQUIRE_THROWS_AS(repl::parse(std::string_view{parens}, ctx), repl::ParseError);
+
+    std::string negations;
+    for (std::size_t index = 0; index < deep; ++index) {
+        negations += "- ";
+    }
+    negations += "x";
+    REQUIRE_THROWS_AS(repl::parse(std::string_view{negations}, ctx), repl::ParseError);
+
+    std::string chain = "1";
+    for (std::size_t index = 0; index < deep; ++index) {
+        chain += "+1";
+    }
+    REQUIRE_THROWS_AS(repl::parse(std::string_view{chain}, ctx), repl::ParseError);
+}
+
+TEST_CASE("Parser depth limit is configurable") {
+    repl::QueryContext ctx;
+    ctx.max_depth = 8;
+    REQUIRE(repl::parse(std::string_view{"((((1))))"}, ctx)->height == 1);
+    REQUIRE(repl::parse(std::string_view{"f(g(h(1)))"}, ctx)->height == 4);
+    REQUIRE_THROWS_AS(repl::parse(std::string_view{"1+1+1+1+1+1+1+1+1"}, ctx),
+                      repl::ParseError);
+    REQUIRE_THROWS_AS(repl::parse(std::string_view{"((((((((((1))))))))))"}, ctx),
+                      repl::ParseError);
+
+    ctx.max_depth = 1000;
+    std::string nested = std::string(900, '(') + "1" + std::string(900, ')');
+    REQUIRE(repl::parse(std::string_view{nested}, ctx)->type == EType::Number);
+}
@@ -0,0 +1,155 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <string>
+
+#include "repl/errors.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/state.hpp"
+
+namespace {
+
+double value_of(const repl::State& state, const char* name) {
+    return state.vars.at(repl::intern(name));
+}
+
+}  // namespace
+
+TEST_CASE("Bindings recompute downstream of an assignment in every engine") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        repl::ExpressionCache cache;
+        repl::process_query("w = 2", state);
+        repl::process_query("h = 3", state);
+        REQUIRE(*repl::process_query("area := w * h", state).value == 6.0);
+        // A diamond: `total` must see both of its inputs already updated.
+        repl::process_query("double := area * 2", state);
+        repl::process_query("total := area + double", state);
+        REQUIRE(value_of(state, "total") == 18.0);
+
+        repl::process_query("w = 5", state, cache);
+        REQUIRE(value_of(state, "area") == 15.0);
+        REQUIRE(value_of(state, "total") == 45.0);
+        REQUIRE(*repl::process_query("h = 1", state, cache).value == 1.0);
+        REQUIRE(value_of(state, "total") == 15.0);
+        REQUIRE(state.last_result == 1.0);
+
+        // Bindings read globals through the functions they call.
+        repl::process_query("rate = 10", state);
+        repl::process_query("price(n) = n * rate", state);
+        repl::process_query("cost := price(area)", state);
+        REQUIRE(value_of(state, "cost") == 50.0);
+        repl::process_query("rate = 2", state);
+        REQUIRE(value_of(state, "cost") == 10.0);
+        repl::process_query("price(n) = n * rate + h", state);
+        REQUIRE(value_of(state, "cost") == 11.0);
+        repl::process_query("h = 2", state);
+        REQUIRE(value_of(state, "cost") == 22.0);
+
+        // Only assignments that ran count, and `=` on a bound name unbinds it.
+        repl::process_query("w > 100 ? (h = 50) : 0", state);
+        REQUIRE(value_of(state, "area") == 10.0);
+        repl::process_query("area = 1", state);
+        REQUIRE(state.bindings.find(repl::intern("area")) == nullptr);
+        REQUIRE(value_of(state, "total") == 3.0);
+        repl::process_query("w = 8", state);
+        REQUIRE(value_of(state, "area") == 1.0);
+
+        // Redefining a binding moves its edges.
+        repl::process_query("double := w", state);
+        REQUIRE(value_of(state, "total") == 9.0);
+        repl::process_query("area = 2", state);
+        REQUIRE(value_of(state, "total") == 10.0);
+        REQUIRE(state.bindings.size() == 3);
+    }
+}
+
+TEST_CASE("Bindings that would form a cycle are rejected") {
+    repl::State state;
+    repl::process_query("b = 1", state);
+    repl::process_query("a := b + 1", state);
+    repl::process_query("c := a * 2", state);
+    REQUIRE_THROWS_WITH(repl::process_query("x := x + 1", state),
+                        "Binding 'x' would depend on itself");
+    REQUIRE_THROWS_WITH(repl::process_query("b := c", state),
+                        "Binding 'b' would depend on itself");
+    REQUIRE(state.bindings.find(repl::intern("b")) == nullptr);
+    REQUIRE_THROWS_WITH(repl::process_query("q := (z = 1)", state),
+                        "Binding 'q' cannot assign variables");
+    REQUIRE_THROWS_WITH(repl::process_query("q := _", state), "Binding 'q' cannot read '_'");
+    REQUIRE_THROWS_WITH(repl::process_query("q := nope", state), "Variable 'nope' not defined");
+    REQUIRE_THROWS_WITH(repl::process_query("pi := 3", state), "'pi' is read-only");
+    REQUIRE_FALSE(state.vars.contains(repl::intern("q")));
+    REQUIRE_THROWS_AS(repl::process_query("1 + (q := 2)", state), repl::ParseError);
+
+    // A function definition that would close a cycle is undone.
+    repl::process_query("g(t) = t + 1", state);
+    repl::process_query("d := g(b)", state);
+    repl::process_query("k := d + 1", state);
+    REQUIRE_THROWS_WITH(repl::process_query("g(t) = t + k", state),
+                        "Binding 'd' would depend on itself");
+    REQUIRE_THROWS_WITH(repl::process_query("b := g(d)", state),
+                        "Binding 'b' would depend on itself");
+    REQUIRE(*repl::process_query("g(5)", state).value == 6.0);
+    repl::process_query("b = 3", state);
+    REQUIRE(value_of(state, "c") == 8.0);
+    REQUIRE(value_of(state, "d") == 4.0);
+    REQUIRE(value_of(state, "k") == 5.0);
+}
+
+TEST_CASE("Bindings that fail to update are left undefined") {
+    repl::State state;
+    repl::process_query("w = 4", state);
+    repl::process_query("inv := 1 / w", state);
+    repl::process_query("twice := inv * 2", state);
+    repl::process_query("other := w + 1", state);
+
+    REQUIRE_THROWS_WITH(repl::process_query("w = 0", state),
+                        "Could not update 'inv': Division by zero");
+    REQUIRE(value_of(state, "w") == 0.0);
+    REQUIRE_FALSE(state.vars.contains(repl::intern("inv")));
+    REQUIRE_FALSE(state.vars.contains(repl::intern("twice")));
+    REQUIRE(value_of(state, "other") == 1.0);
+
+    repl::process_query("w = 2", state);
+    REQUIRE(value_of(state, "twice") == 1.0);
+
+    // A query that fails after assigning still updates, and reports its own error.
+    REQUIRE_THROWS_WITH(repl::process_query("(w = 5) + 1 / (w - 5)", state), "Division by zero");
+    REQUIRE(value_of(state, "other") == 6.0);
+    REQUIRE(state.call_depth == 0);
+}
+
+TEST_CASE("An assignment only recomputes the bindings it reaches") {
+    // Two independent chains of 25000 bindings each; every update is
+    // visible in the variable's version.
+    repl::State state;
+    repl::QueryContext ctx;
+    constexpr int kLength = 25000;
+    for (const char* prefix : {"a", "b"}) {
+        repl::process_query(std::string(prefix) + "0 = 1", state, ctx);
+        for (int index = 1; index < kLength; ++index) {
+            repl::process_query(std::string(prefix) + std::to_string(index) + " := " + prefix +
+                                    std::to_string(index - 1) + " + 1",
+                                state, ctx);
+        }
+    }
+    REQUIRE(state.bindings.size() == 2 * (kLength - 1));
+
+    const repl::Identifier a_last = repl::intern("a" + std::to_string(kLength - 1));
+    const repl::Identifier b_last = repl::intern("b" + std::to_string(kLength - 1));
+    const repl::Identifier a_middle = repl::intern("a" + std::to_string(kLength / 2));
+    const std::uint64_t b_version = state.vars.version(b_last);
+    const std::uint64_t a_version = state.vars.version(a_middle);
+
+    repl::process_query("a0 = 100", state, ctx);
+    REQUIRE(state.vars.at(a_last) == 100.0 + kLength - 1);
+    REQUIRE(state.vars.version(a_middle) == a_version + 1);
+    REQUIRE(state.vars.version(b_last) == b_version);
+
+    const std::string middle = "a" + std::to_string(kLength / 2);
+    repl::process_query(middle + " = 0", state, ctx);
+    REQUIRE(state.vars.at(a_last) == kLength - 1 - kLength / 2);
+    REQUIRE(state.vars.at(repl::intern("a1")) == 101.0);
+}
@@ -0,0 +1,188 @@
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <string>
+#include <vector>
+
+#include "repl/errors.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/optimize.hpp"
+#include "repl/reduce.hpp"
+#include "repl/state.hpp"
+
+using Catch::Approx;
+
+namespace {
+
+/** @brief Value of a top-level reduction with constant bounds, run on `pool`. */
+double reduce_on(const char* source, repl::State& state, repl::ThreadPool& pool) {
+    repl::QueryContext ctx;
+    const repl::Expression& expr = *repl::optimize(repl::parse(source, ctx), ctx.arena);
+    const repl::ReduceNode& node = expr.get<repl::ReduceNode>();
+    const double bounds[] = {node.lower()->get<double>(), node.upper()->get<double>()};
+    return repl::reduce(node, bounds, state, {}, pool);
+}
+
+}  // namespace
+
+TEST_CASE("Reductions give the same values and errors in every engine") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        REQUIRE(*repl::process_query("sum(i, 1, 100, i)", state).value == 5050.0);
+        REQUIRE(*repl::process_query("prod(k, 1, 20, k)", state).value == 2432902008176640000.0);
+        REQUIRE(*repl::process_query("sum(i, 3, 2.5, i)", state).value == 0.0);
+        REQUIRE(*repl::process_query("prod(i, 3, 2, i)", state).value == 1.0);
+        REQUIRE(*repl::process_query("sum(i, 0.5, 3, i)", state).value == 4.5);
+
+        // Captures read enclosing locals and globals; the bound variable shadows both.
+        repl::process_query("a = 2", state);
+        repl::process_query("i = 100", state);
+        REQUIRE(*repl::process_query("sum(i, 1, 4, a * i)", state).value == 20.0);
+        repl::process_query("f(n) = sum(i, 1, n, (t = i * n) + t)", state);
+        repl::process_query("g(n) = sum(j, 1, n, f(j) + prod(k, 1, j, a))", state);
+        for (int call = 0; call < 100; ++call) {
+            REQUIRE(*repl::process_query("f(4)", state).value == 80.0);
+        }
+        REQUIRE(*repl::process_query("g(3)", state).value == 2.0 + 12.0 + 36.0 + 14.0);
+        REQUIRE(*repl::process_query("sum(i, 1, 3, sum(j, 1, i, j))", state).value == 10.0);
+        REQUIRE_FALSE(state.vars.contains(repl::intern("t")));
+        REQUIRE(state.vars.at(repl::intern("i")) == 100.0);
+
+        REQUIRE_THROWS_WITH(repl::process_query("sum(i, 1, 10, 1 / (i - 5))", state),
+                            "Division by zero");
+        REQUIRE_THROWS_WITH(repl::process_query("sum(i, 1, 3, i * zz)", state),
+                            "Variable 'zz' not defined");
+        REQUIRE_THROWS_WITH(repl::process_query("sum(i, 0, 1e308 * 10, i)", state),
+                            "Bounds of 'sum' must be finite");
+        REQUIRE_THROWS_WITH(repl::process_query("sum(i, 0, 1e12, i)", state),
+                            "Too many terms in 'sum'");
+        REQUIRE_THROWS_WITH(repl::process_query("prod(i, 1, 400, i)", state),
+                            "Domain error in function 'prod'");
+        REQUIRE_THROWS_WITH(repl::process_query("integrate(x, -1, 1, 1 / x)", state),
+                            "'integrate' did not converge");
+        REQUIRE_THROWS_WITH(repl::process_query("sum(i, 1, 2)", state),
+                            "Function 'sum' not defined");
+        REQUIRE_THROWS_AS(repl::process_query("sum(2, 1, 2, 3)", state), repl::ParseError);
+        REQUIRE(state.call_depth == 0);
+    }
+}
+
+TEST_CASE("Reduction names stay usable outside the four-argument form") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        // Sessions written before reductions existed keep working.
+        REQUIRE(*repl::process_query("sum = 10", state).value == 10.0);
+        REQUIRE(*repl::process_query("prod := sum * 2", state).value == 20.0);
+        repl::process_query("integrate(a, b) = a * b + sum", state);
+        REQUIRE(*repl::process_query("integrate(2, 3)", state).value == 16.0);
+        REQUIRE(*repl::process_query("sum(i, 1, 4, i * sum) + prod", state).value == 120.0);
+
+        // A four-argument call is always the reduction, so it cannot be defined.
+        const auto defined = repl::try_process_query("sum(a, b, c, d) = a", state);
+        REQUIRE_FALSE(defined);
+        REQUIRE(defined.error().code == repl::ErrorCode::ReductionDefinition);
+        REQUIRE(repl::format_error(defined.error()) ==
+                "'sum' with four arguments is a reduction and cannot be defined");
+        REQUIRE(state.fns.find(repl::intern("sum")) == state.fns.end());
+    }
+}
+
+TEST_CASE("Reduction results do not depend on the number of workers") {
+    repl::State state;
+    repl::process_query("fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)", state);
+    repl::process_query("w = 0.1", state);
+    const std::vector<std::string> sources = {
+        "sum(i, -50000, 50000, sin(i) * w)",
+        "prod(i, 1, 30000, 1 + w * sin(i) / 1000)",
+        "sum(i, 0, 20000, fib(i % 12) / (i + 1))",
+        "integrate(x, -3, 5, exp(-x * x) * cos(3 * x) + fib(3))",
+        "sum(i, 1, 3, integrate(x, 0, i, x * x + i))",
+    };
+
+    repl::ThreadPool serial{1};
+    for (const std::string& source : sources) {
+        const double expected = reduce_on(source.c_str(), state, serial);
+        for (std::size_t workers : {2, 4, 7}) {
+            repl::ThreadPool pool{workers};
+            const double value = reduce_on(source.c_str(), state, pool);
+            REQUIRE(std::bit_cast<std::uint64_t>(value) == std::bit_cast<std::uint64_t>(expected));
+        }
+    }
+
+    // The first failing point's error wins, whichever worker reaches it.
+    for (std::size_t workers : {1, 2, 4, 7}) {
+        repl::ThreadPool pool{workers};
+        REQUIRE_THROWS_WITH(reduce_on("sum(i, 0, 40000, i == 30000 ? q : 1 / (i - 9000))", state,
+                                      pool),
+                            "Division by zero");
+        REQUIRE(state.call_depth == 0);
+    }
+}
+
+TEST_CASE("Compiled reduction bodies follow globals, redefinitions and resets") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode, repl::Engine::Jit}) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("g = 2", state);
+        repl::process_query("f(n) = sum(i, 1, n, i * g)", state);
+        REQUIRE(*repl::process_query("f(10)", state).value == 110.0);
+        repl::process_query("g = 3", state);
+        REQUIRE(*repl::process_query("f(10)", state).value == 165.0);
+        repl::process_query("f(n) = prod(i, 1, n, i)", state);
+        REQUIRE(*repl::process_query("f(5)", state).value == 120.0);
+
+        state = repl::State{};
+        state.engine = engine;
+        repl::process_query("f(n) = sum(i, 1, n, i * i)", state);
+        REQUIRE(*repl::process_query("f(3)", state).value == 14.0);
+    }
+}
+
+TEST_CASE("Reduction workers only read the caller's state") {
+    repl::State state;
+    repl::process_query("fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)", state);
+    repl::process_query("depth(n) = n == 0 ? 0 : 1 + depth(n - 1)", state);
+    const repl::FnObj& fib = state.fns.at(repl::intern("fib"));
+    REQUIRE(fib.memo);
+
+    for (std::size_t workers : {1, 4}) {
+        repl::ThreadPool pool{workers};
+        REQUIRE(reduce_on("sum(i, 0, 20000, fib(i % 25))", state, pool) == 800 * 121392.0);
+        REQUIRE(fib.memo->hits() + fib.memo->misses() == 0);
+
+        // Each worker counts its own calls against the caller's limit.
+        state.max_call_depth = 50;
+        REQUIRE(reduce_on("sum(i, 0, 9000, depth(40))", state, pool) == 9001 * 40.0);
+        REQUIRE_THROWS_WITH(reduce_on("sum(i, 0, 9000, depth(i % 60))", state, pool),
+                            repl::format_error(repl::call_depth_exceeded(state)));
+        REQUIRE(state.call_depth == 0);
+        state.max_call_depth = repl::kDefaultMaxCallDepth;
+    }
+}
+
+TEST_CASE("Reductions are accurate") {
+    repl::State state;
+    const auto value = [&](const char* source) {
+        return *repl::process_query(source, state).value;
+    };
+
+    REQUIRE(value("sum(i, 1, 1000000, 0.1)") == 100000.0);
+    REQUIRE(value("sum(i, 1, 100000, 1 / i^2)")
+            == Approx(std::numbers::pi * std::numbers::pi / 6 - 1e-5 + 5e-11).epsilon(1e-15));
+    REQUIRE(value("prod(i, 1, 100000, 1 + 2^-33)")
+            == Approx(std::exp(1e5 * std::log1p(std::ldexp(1.0, -33)))).epsilon(1e-15));
+
+    REQUIRE(value("integrate(x, 0, pi, sin(x))") == Approx(2.0).epsilon(1e-13));
+    REQUIRE(value("integrate(x, 0, 1, 4 / (1 + x^2))")
+            == Approx(std::numbers::pi).epsilon(1e-13));
+    REQUIRE(value("integrate(x, 0, 1, 1 / sqrt(x))") == Approx(2.0).epsilon(1e-9));
+    REQUIRE(value("integrate(x, 2, 0, x)") == Approx(-2.0).epsilon(1e-14));
+    REQUIRE(value("integrate(x, 1, 1, x)") == 0.0);
+    REQUIRE(value("integrate(x, -1, 1, x < 1 / 3 ? 0 : 1)") == Approx(2.0 / 3).epsilon(1e-10));
+}
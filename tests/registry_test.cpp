@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <string_view>
+
+#include "repl/perfect_hash.hpp"
+#include "repl/registry.hpp"
+
+namespace {
+
+struct Named {
+    std::string_view name;
+    int value;
+};
+
+constexpr repl::PerfectHashTable kSample{std::array{
+    Named{"alpha", 1},
+    Named{"beta", 2},
+    Named{"gamma", 3},
+    Named{"delta", 4},
+    Named{"epsilon", 5},
+}};
+
+}  // namespace
+
+// Lookups are constant expressions: the tables exist before main runs.
+static_assert(kSample.find("gamma")->value == 3);
+static_assert(kSample.find("zeta") == nullptr);
+static_assert(repl::find_builtin("atan2")->arity == 2);
+static_assert(repl::is_reserved_identifier("_"));
+static_assert(repl::is_reserved_identifier("tau"));
+static_assert(!repl::is_reserved_identifier("x"));
+static_assert(!repl::is_reserved_identifier("integrate"));
+static_assert(repl::reduction_spec(repl::ReduceKind::Product).name == "prod");
+
+TEST_CASE("Perfect hash tables find every entry and reject other names") {
+    for (const Named& entry : kSample) {
+        REQUIRE(kSample.find(entry.name) == &entry);
+    }
+    for (std::string_view name : {"", "alph", "alphaa", "Beta", "eta", "omega"}) {
+        REQUIRE_FALSE(kSample.contains(name));
+    }
+    REQUIRE(kSample.size() == 5);
+}
+
+TEST_CASE("Builtin and constant registries resolve names") {
+    REQUIRE(repl::kBuiltins.size() == 30);
+    for (const repl::BuiltinSpec& spec : repl::kBuiltins) {
+        REQUIRE(repl::find_builtin(spec.name) == &spec);
+        REQUIRE(repl::find_builtin(repl::intern(spec.name)) == &spec);
+        REQUIRE((spec.arity == 1 ? spec.unary != nullptr : spec.binary != nullptr));
+    }
+    const double args[] = {3.0, 4.0};
+    REQUIRE(repl::call_builtin(*repl::find_builtin("hypot"), args) == 5.0);
+    REQUIRE(repl::call_builtin(*repl::find_builtin("sign"), args) == 1.0);
+
+    REQUIRE(*repl::find_constant("pi") == std::numbers::pi);
+    REQUIRE(*repl::find_constant(repl::intern("tau")) == 2.0 * std::numbers::pi);
+    REQUIRE(repl::find_constant("sin") == nullptr);
+    REQUIRE(repl::find_builtin("pi") == nullptr);
+
+    REQUIRE(repl::is_reserved_identifier(repl::intern("ln")));
+    REQUIRE_FALSE(repl::is_reserved_identifier(repl::intern("lnx")));
+    REQUIRE(repl::is_builtin_function(repl::intern("cbrt")));
+    REQUIRE(repl::is_constant(repl::intern("e")));
+
+    REQUIRE(repl::kReductions.size() == 3);
+    for (const repl::ReductionSpec& spec : repl::kReductions) {
+        REQUIRE(repl::find_reduction(repl::intern(spec.name)) == &spec);
+        REQUIRE(&repl::reduction_spec(spec.kind) == &spec);
+    }
+    REQUIRE(repl::find_reduction("sin") == nullptr);
+    REQUIRE_FALSE(repl::is_builtin_function(repl::intern("sum")));
+}
+
+TEST_CASE("Symbol lookups agree with name lookups without hashing") {
+    // Registry names are interned first, so their symbols are fixed.
+    REQUIRE(repl::index_of(repl::intern("sin")) == 0);
+    REQUIRE(repl::index_of(repl::intern("_")) == repl::registry_symbols::kLastResult);
+
+    for (std::string_view name : {"sin", "hypot", "pi", "e", "tau", "sum", "integrate", "_",
+                                  "x", "sine", "pie", "summ", "f", ""}) {
+        const repl::Identifier symbol = repl::intern(name);
+        REQUIRE(repl::find_builtin(symbol) == repl::find_builtin(name));
+        REQUIRE(repl::find_constant(symbol) == repl::find_constant(name));
+        REQUIRE(repl::find_reduction(symbol) == repl::find_reduction(name));
+        REQUIRE(repl::is_builtin_function(symbol) == repl::is_builtin_function(name));
+        REQUIRE(repl::is_constant(symbol) == repl::is_constant(name));
+        REQUIRE(repl::is_reserved_identifier(symbol) == repl::is_reserved_identifier(name));
+    }
+}
@@ -0,0 +1,80 @@
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+#include "repl/evaluator.hpp"
+#include "repl/expression.hpp"
+#include "repl/resolve.hpp"
+#include "repl/state.hpp"
+
+using Catch::Approx;
+using repl::EType;
+
+TEST_CASE("Resolution binds parameters and assigned locals to frame slots") {
+    repl::QueryContext ctx;
+    auto body = repl::parse(std::string_view{"(t = a * 2) + b * t + g"}, ctx);
+    const std::vector<repl::Identifier> params{repl::intern("a"), repl::intern("b")};
+    REQUIRE(*repl::resolve_locals(*body, params) == 3);
+
+    const auto& sum = body->get<repl::BinaryNode>();
+    const auto& assignment = sum.left->get<repl::BinaryNode>().left->get<repl::BinaryNode>();
+    REQUIRE(assignment.left->type == EType::Local);
+    REQUIRE(assignment.left->get<repl::LocalNode>().slot == 2);
+    REQUIRE(assignment.right->get<repl::BinaryNode>().left->get<repl::LocalNode>().slot == 0);
+    REQUIRE(sum.right->type == EType::Variable);
+
+    // Resolving again with the same parameters is a no-op.
+    REQUIRE(*repl::resolve_locals(*body, params) == 3);
+    REQUIRE(assignment.left->get<repl::LocalNode>().slot == 2);
+}
+
+TEST_CASE("Resolved functions keep scoping rules in both engines") {
+    for (auto engine : {repl::Engine::Tree, repl::Engine::Bytecode}) {
+        repl::State state;
+        state.engine = engine;
+        repl::process_query("t = 100", state);
+        // `t` reads the global until the body assigns it.
+        repl::process_query("f(a) = t + (t = a) + t", state);
+        REQUIRE(*repl::process_query("f(1)", state).value == Approx(102.0));
+        REQUIRE(*repl::process_query("t", state).value == Approx(100.0));
+
+        repl::process_query("g(a) = (a = a * 2) + a", state);
+        REQUIRE(*repl::process_query("g(3)", state).value == Approx(12.0));
+
+        // More slots than fit in an inline frame.
+        repl::process_query("wide(a, b, c, d, e1, f1, g1, h, i, j) = "
+                            "(k = a + j) + b + c + d + e1 + f1 + g1 + h + i + k",
+                            state);
+        REQUIRE(*repl::process_query("wide(1, 2, 3, 4, 5, 6, 7, 8, 9, 10)", state).value ==
+                Approx(66.0));
+    }
+}
+
+TEST_CASE("Variable store keeps one stable slot per symbol") {
+    repl::VariableStore vars;
+    const auto x = repl::intern("store_x");
+    const auto y = repl::intern("store_y");
+    REQUIRE(vars.empty());
+    REQUIRE(vars.find(x) == nullptr);
+    REQUIRE_THROWS_AS(vars.at(x), std::out_of_range);
+
+    vars.set(y, 2.0);
+    vars.set(x, 1.0);
+    const double* slot = vars.find(x);
+    vars.set(x, 3.0);
+    REQUIRE(vars.find(x) == slot);
+    REQUIRE(vars.at(x) == 3.0);
+    REQUIRE(vars.size() == 2);
+
+    std::vector<repl::Identifier> names;
+    for (const auto& [name, value] : vars) {
+        names.push_back(name);
+    }
+    REQUIRE(names == std::vector<repl::Identifier>{x, y});
+
+    vars.clear();
+    REQUIRE(vars.empty());
+    REQUIRE_FALSE(vars.contains(y));
+}
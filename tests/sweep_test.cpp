@@ -0,0 +1,110 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "repl/errors.hpp"
+#include "repl/evaluator.hpp"
+#include "repl/optimize.hpp"
+#include "repl/state.hpp"
+#include "repl/sweep.hpp"
+
+namespace {
+
+repl::BatchResult run_sweep(const char* source, const std::vector<repl::SweepRange>& ranges,
+                            const repl::State& state, repl::ThreadPool& pool) {
+    repl::QueryContext ctx;
+    const repl::Expression& expr = *repl::optimize(repl::parse(source, ctx), ctx.arena);
+    return repl::sweep(expr, ranges, state, pool);
+}
+
+bool same_bits(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t index = 0; index < a.size(); ++index) {
+        if (std::bit_cast<std::uint64_t>(a[index]) != std::bit_cast<std::uint64_t>(b[index])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+TEST_CASE("Sweep rows follow the grid in row-major order") {
+    repl::State state;
+    repl::process_query("k = 10", state);
+    repl::ThreadPool pool{3};
+    const std::vector<repl::SweepRange> ranges = {{repl::intern("x"), 0.0, 1.0, 3},
+                                                  {repl::intern("y"), -2.0, 2.0, 5}};
+    const repl::BatchResult result = run_sweep("k * x + y", ranges, state, pool);
+    REQUIRE(result.values.size() == 15);
+    REQUIRE(result.values[0] == -2.0);
+    REQUIRE(result.values[4] == 2.0);
+    REQUIRE(result.values[5] == 3.0);
+    REQUIRE(result.values[14] == 12.0);
+    REQUIRE(ranges[1].at(4) == 2.0);
+
+    const repl::BatchResult single = run_sweep("k", {}, state, pool);
+    REQUIRE(single.values == std::vector<double>{10.0});
+}
+
+TEST_CASE("Sweep results do not depend on the number of workers") {
+    repl::State state;
+    repl::process_query("f(a, b) = (t = a * b) > 1 ? t - a : sqrt(b - t) / a", state);
+    repl::process_query("fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)", state);
+    const std::vector<repl::SweepRange> ranges = {{repl::intern("x"), -3.0, 3.0, 301},
+                                                  {repl::intern("y"), -1.0, 4.0, 97}};
+
+    repl::ThreadPool serial{1};
+    const repl::BatchResult expected = run_sweep("f(x, y) + fib(abs(round(x)) * 9)", ranges,
+                                                 state, serial);
+    REQUIRE(expected.values.size() == 301 * 97);
+    REQUIRE_FALSE(expected.errors.empty());
+    REQUIRE(expected.messages.size() == 2);
+
+    for (std::size_t workers : {2, 4, 7}) {
+        repl::ThreadPool pool{workers};
+        const repl::BatchResult result =
+            run_sweep("f(x, y) + fib(abs(round(x)) * 9)", ranges, state, pool);
+        REQUIRE(same_bits(result.values, expected.values));
+        REQUIRE(result.messages == expected.messages);
+        REQUIRE(result.errors.size() == expected.errors.size());
+        for (std::size_t index = 0; index < result.errors.size(); ++index) {
+            REQUIRE(result.errors[index].row == expected.errors[index].row);
+            REQUIRE(result.errors[index].message == expected.errors[index].message);
+        }
+    }
+
+    // Each row agrees with the scalar evaluator.
+    for (std::size_t row : {0, 4000, 15000, 29196}) {
+        repl::State scalar;
+        repl::process_query("f(a, b) = (t = a * b) > 1 ? t - a : sqrt(b - t) / a", scalar);
+        repl::process_query("fib(n) = n < 2 ? n : fib(n - 1) + fib(n - 2)", scalar);
+        scalar.vars.set(repl::intern("x"), ranges[0].at(row / 97));
+        scalar.vars.set(repl::intern("y"), ranges[1].at(row % 97));
+        try {
+            const double value =
+                *repl::process_query("f(x, y) + fib(abs(round(x)) * 9)", scalar).value;
+            REQUIRE(std::abs(value - expected.values[row]) <= 1e-9 * std::abs(value));
+        } catch (const repl::EvalError&) {
+            REQUIRE(std::isnan(expected.values[row]));
+        }
+    }
+
+    // The shared state was only read.
+    REQUIRE(state.fns.at(repl::intern("fib")).memo->size() == 0);
+    REQUIRE(state.call_depth == 0);
+    REQUIRE_FALSE(state.vars.contains(repl::intern("t")));
+}
+
+TEST_CASE("Sweep rejects repeated names") {
+    repl::State state;
+    repl::ThreadPool pool{2};
+    const std::vector<repl::SweepRange> ranges = {{repl::intern("x"), 0.0, 1.0, 2},
+                                                  {repl::intern("x"), 0.0, 1.0, 2}};
+    REQUIRE_THROWS_AS(run_sweep("x", ranges, state, pool), repl::EvalError);
+}
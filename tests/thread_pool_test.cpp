@@ -0,0 +1,66 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "repl/thread_pool.hpp"
+
+TEST_CASE("Thread pool runs every task once") {
+    for (std::size_t workers : {1, 2, 5}) {
+        repl::ThreadPool pool{workers};
+        REQUIRE(pool.size() == workers);
+        for (std::size_t count : {0, 1, 3, 1000}) {
+            std::vector<std::atomic<int>> runs(count);
+            std::atomic<bool> worker_in_range = true;
+            pool.run(count, [&](std::size_t task, std::size_t worker) {
+                runs[task].fetch_add(1);
+                if (worker >= workers) {
+                    worker_in_range = false;
+                }
+            });
+            REQUIRE(worker_in_range);
+            for (const auto& run : runs) {
+                REQUIRE(run.load() == 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("Thread pool balances uneven tasks and nests") {
+    repl::ThreadPool pool{4};
+    std::atomic<std::size_t> total = 0;
+    std::atomic<bool> nested_serial = true;
+    pool.run(64, [&](std::size_t task, std::size_t) {
+        // Later tasks are far more expensive, so workers must steal them.
+        std::size_t local = 0;
+        pool.run(task * 10, [&](std::size_t, std::size_t worker) {
+            if (worker != 0) {
+                nested_serial = false;
+            }
+            ++local;
+        });
+        total += local;
+    });
+    REQUIRE(total == 10 * 63 * 64 / 2);
+    REQUIRE(nested_serial);
+}
+
+TEST_CASE("Thread pool rethrows the first task error") {
+    repl::ThreadPool pool{3};
+    std::atomic<int> runs = 0;
+    REQUIRE_THROWS_AS(pool.run(100,
+                               [&](std::size_t task, std::size_t) {
+                                   ++runs;
+                                   if (task == 10) {
+                                       throw std::runtime_error("task failed");
+                                   }
+                               }),
+                      std::runtime_error);
+    REQUIRE(runs <= 100);
+
+    // The pool stays usable.
+    std::atomic<int> after = 0;
+    pool.run(10, [&](std::size_t, std::size_t) { ++after; });
+    REQUIRE(after == 10);
+}
@@ -1,6 +1,9 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <string>
+
 #include "repl/errors.hpp"
+#include "repl/scan.hpp"
 #include "repl/token.hpp"
 
 using repl::TType;
@@ -32,6 +35,41 @@ TEST_CASE("Tokenize multi-character comparisons") {
     REQUIRE(tokens[7].type == TType::GreaterEqual);
     REQUIRE(tokens[9].type == TType::Less);
     REQUIRE(tokens[11].type == TType::Greater);
+
+    tokens = repl::tokenize("a:=b?c:d");
+    REQUIRE(tokens.size() == 7);
+    REQUIRE(tokens[1].type == TType::ColonEquals);
+    REQUIRE(tokens[5].type == TType::Colon);
+}
+
+TEST_CASE("Tokenize records identifier source spans") {
+    auto tokens = repl::tokenize("  alpha_1 + beta");
+    REQUIRE(tokens.size() == 3);
+    REQUIRE(tokens[0].offset == 2);
+    REQUIRE(tokens[0].length == 7);
+    REQUIRE(tokens.text(tokens[0]) == "alpha_1");
+    REQUIRE(tokens.text(tokens[2]) == "beta");
+}
+
+TEST_CASE("Tokenize interns identifiers into shared symbols") {
+    auto tokens = repl::tokenize("width * height + width");
+    REQUIRE(tokens.size() == 5);
+    REQUIRE(tokens[0].symbol == tokens[4].symbol);
+    REQUIRE(tokens[0].symbol != tokens[2].symbol);
+    REQUIRE(repl::symbol_name(tokens[2].symbol) == "height");
+    REQUIRE(repl::symbols().find("width") == tokens[0].symbol);
+}
+
+TEST_CASE("Token stream lexes source text on demand") {
+    repl::TokenStream stream{std::string_view{"f(x) + 2 @"}};
+    REQUIRE(stream.get().type == TType::Identifier);
+    REQUIRE(stream.match(TType::LParen));
+    REQUIRE(stream.text(stream.peek()) == "x");
+    REQUIRE(stream.get().type == TType::Identifier);
+    REQUIRE(stream.expect(TType::RParen).type == TType::RParen);
+    REQUIRE(stream.get().type == TType::Plus);
+    REQUIRE(stream.get().number == 2.0);
+    REQUIRE_THROWS_AS(stream.peek(), repl::ParseError);
 }
 
 TEST_CASE("Tokenize rejects unexpected characters") {
@@ -42,15 +80,15 @@ TEST_CASE("Tokenize scientific notation") {
     auto tokens = repl::tokenize("1e3 2.5e-2 1E+10 6.02E23 .5e2");
     REQUIRE(tokens.size() == 5);
     REQUIRE(tokens[0].type == TType::Number);
-    REQUIRE(tokens[0].get<double>() == 1000.0);
+    REQUIRE(tokens[0].number == 1000.0);
     REQUIRE(tokens[1].type == TType::Number);
-    REQUIRE(tokens[1].get<double>() == 0.025);
+    REQUIRE(tokens[1].number == 0.025);
     REQUIRE(tokens[2].type == TType::Number);
-    REQUIRE(tokens[2].get<double>() == 1e10);
+    REQUIRE(tokens[2].number == 1e10);
     REQUIRE(tokens[3].type == TType::Number);
-    REQUIRE(tokens[3].get<double>() == 6.02e23);
+    REQUIRE(tokens[3].number == 6.02e23);
     REQUIRE(tokens[4].type == TType::Number);
-    REQUIRE(tokens[4].get<double>() == 50.0);
+    REQUIRE(tokens[4].number == 50.0);
 }
 
 TEST_CASE("Tokenize rejects incomplete scientific notation") {
@@ -64,3 +102,27 @@ TEST_CASE("Tokenize rejects multi-dot numbers") {
     REQUIRE_THROWS_AS(repl::tokenize(".1.2"), repl::ParseError);
     REQUIRE_THROWS_AS(repl::tokenize("0.0.0"), repl::ParseError);
 }
+
+TEST_CASE("Tokenize agrees across scanner instruction sets") {
+    std::string input;
+    for (int index = 0; index < 40; ++index) {
+        input += "  long_identifier_name_" + std::to_string(index);
+        input += " *\t(123456789012345678.25e-3 + \n\r   x)  -  ";
+    }
+    input += "0";
+
+    repl::set_scan_isa(repl::ScanIsa::Scalar);
+    const auto expected = repl::tokenize(input);
+
+    for (auto isa : {repl::ScanIsa::SSE2, repl::ScanIsa::AVX2}) {
+        repl::set_scan_isa(isa);
+        const auto tokens = repl::tokenize(input);
+        REQUIRE(tokens.size() == expected.size());
+        for (std::size_t index = 0; index < tokens.size(); ++index) {
+            REQUIRE(tokens[index].type == expected[index].type);
+            REQUIRE(tokens[index].offset == expected[index].offset);
+            REQUIRE(tokens[index].length == expected[index].length);
+        }
+    }
+    repl::set_scan_isa(repl::detected_scan_isa());
+}
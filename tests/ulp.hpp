@@ -0,0 +1,22 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace repl::test {
+
+/** @brief Doubles mapped onto integers so that adjacent values differ by one. */
+inline std::int64_t ordered(double value) {
+    const auto bits = std::bit_cast<std::int64_t>(value);
+    return bits < 0 ? std::numeric_limits<std::int64_t>::min() - bits : bits;
+}
+
+/** @brief Distance between two finite doubles in units in the last place. */
+inline std::uint64_t ulp_distance(double a, double b) {
+    const std::int64_t x = ordered(a);
+    const std::int64_t y = ordered(b);
+    return x > y ? static_cast<std::uint64_t>(x - y) : static_cast<std::uint64_t>(y - x);
+}
+
+}  // namespace repl::test